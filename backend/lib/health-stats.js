@@ -40,7 +40,8 @@ function getWebSocketStats(io, socketRateLimits) {
     .map(socket => ({
       device_id: socket.deviceId,
       connected_at: socket.handshake.time,
-      metrics: socket.metrics || null
+      metrics: socket.metrics || null,
+      boot: socket.bootReport || null
     }));
 
   return {
@@ -0,0 +1,384 @@
+/**
+ * OTA Delta Patches
+ * Encoder (and reference decoder) for the patch format applied by the firmware's
+ * DeltaPatcher (esp32-firmware/include/delta_patch.h)
+ *
+ * A patch is a 16-byte header followed by an LZSS stream (4 KB window) whose
+ * decompressed content is a list of bsdiff-style operations:
+ *   0x01 ADD     zigzag varint seek, varint length, diff bytes (target - source)
+ *   0x02 INSERT  varint length, literal bytes
+ *   0x03 COPY    zigzag varint seek, varint length (source bytes unchanged)
+ *   0x00 END
+ */
+
+const MAGIC = Buffer.from('GHDP', 'ascii');
+const FORMAT_VERSION = 1;
+const HEADER_SIZE = 16;
+
+const OP_END = 0x00;
+const OP_ADD = 0x01;
+const OP_INSERT = 0x02;
+const OP_COPY = 0x03;
+
+// Source matching
+const BLOCK = 8;                 // Bytes hashed per source position
+const HASH_BITS = 20;
+const MAX_CANDIDATES = 32;       // Source positions tried per target position
+const MIN_SOURCE_MATCH = 16;     // Shorter exact matches are cheaper as INSERT
+const EXTENSION_SLACK = 64;      // Stop extending once the score falls this far below its best
+const MIN_COPY = 12;             // Zero-diff runs inside an ADD at least this long become COPY
+
+// LZSS layer (must match DELTA_WINDOW_BITS / DELTA_MIN_MATCH in delta_patch.h)
+const WINDOW_SIZE = 4096;
+const LZ_MIN_MATCH = 3;
+const LZ_MAX_MATCH = LZ_MIN_MATCH + 15;
+const LZ_MAX_CANDIDATES = 64;
+
+function blockHash(data, offset) {
+  let hash = 0;
+  for (let i = 0; i < BLOCK; i++) {
+    hash = (Math.imul(hash, 0x01000193) ^ data[offset + i]) >>> 0;
+  }
+  return hash >>> (32 - HASH_BITS);
+}
+
+function indexSource(source) {
+  const head = new Int32Array(1 << HASH_BITS).fill(-1);
+  const next = new Int32Array(Math.max(source.length, 1)).fill(-1);
+  for (let s = source.length - BLOCK; s >= 0; s--) {
+    const hash = blockHash(source, s);
+    next[s] = head[hash];
+    head[hash] = s;
+  }
+  return { head, next };
+}
+
+function findMatch(index, source, target, t) {
+  if (t + BLOCK > target.length) {
+    return null;
+  }
+  let best = null;
+  let candidates = 0;
+  for (let s = index.head[blockHash(target, t)]; s >= 0 && candidates < MAX_CANDIDATES; s = index.next[s]) {
+    candidates++;
+    let length = 0;
+    while (t + length < target.length && s + length < source.length && source[s + length] === target[t + length]) {
+      length++;
+    }
+    if (!best || length > best.length) {
+      best = { source: s, length };
+    }
+  }
+  return best && best.length >= MIN_SOURCE_MATCH ? best : null;
+}
+
+/**
+ * Grow a match past mismatching bytes while at least half of them still agree
+ * (bsdiff's approximate extension: shifted addresses become small diff bytes)
+ * @returns {number} Extra bytes to include (forward when step = 1, backward when -1)
+ */
+function extend(source, target, s, t, step, limit) {
+  let score = 0;
+  let bestScore = 0;
+  let best = 0;
+  for (let i = 1; i <= limit; i++) {
+    const sp = s + step * i;
+    const tp = t + step * i;
+    if (sp < 0 || sp >= source.length) {
+      break;
+    }
+    score += source[sp] === target[tp] ? 1 : -1;
+    if (score > bestScore) {
+      bestScore = score;
+      best = i;
+    } else if (score < bestScore - EXTENSION_SLACK) {
+      break;
+    }
+  }
+  return best;
+}
+
+function diffOps(source, target) {
+  const ops = [];
+  const index = indexSource(source);
+  let t = 0;
+  let literalStart = 0;
+  while (t < target.length) {
+    const match = findMatch(index, source, target, t);
+    if (!match) {
+      t++;
+      continue;
+    }
+    const back = extend(source, target, match.source, t, -1, t - literalStart);
+    const forwardLimit = target.length - (t + match.length);
+    const forward = extend(source, target, match.source + match.length - 1, t + match.length - 1, 1, forwardLimit);
+
+    const start = t - back;
+    if (start > literalStart) {
+      ops.push({ op: OP_INSERT, target: literalStart, length: start - literalStart });
+    }
+    ops.push({ op: OP_ADD, source: match.source - back, target: start, length: back + match.length + forward });
+    t += match.length + forward;
+    literalStart = t;
+  }
+  if (target.length > literalStart) {
+    ops.push({ op: OP_INSERT, target: literalStart, length: target.length - literalStart });
+  }
+  return ops;
+}
+
+function pushVarint(out, value) {
+  let remaining = value >>> 0;
+  while (remaining >= 0x80) {
+    out.push((remaining & 0x7f) | 0x80);
+    remaining >>>= 7;
+  }
+  out.push(remaining);
+}
+
+function encodeOps(source, target, ops) {
+  const out = [];
+  let sourcePos = 0;
+  const emitSourceRun = (op, from, length) => {
+    const seek = from - sourcePos;
+    out.push(op);
+    pushVarint(out, seek >= 0 ? seek * 2 : -seek * 2 - 1);
+    pushVarint(out, length);
+    sourcePos = from + length;
+  };
+
+  for (const entry of ops) {
+    if (entry.op === OP_INSERT) {
+      out.push(OP_INSERT);
+      pushVarint(out, entry.length);
+      for (let i = 0; i < entry.length; i++) {
+        out.push(target[entry.target + i]);
+      }
+      continue;
+    }
+
+    // Split the ADD into COPY (long unchanged runs) and ADD (everything else)
+    const diff = (i) => (target[entry.target + i] - source[entry.source + i]) & 0xff;
+    let i = 0;
+    while (i < entry.length) {
+      let zeros = 0;
+      while (i + zeros < entry.length && diff(i + zeros) === 0) {
+        zeros++;
+      }
+      if (zeros >= MIN_COPY || i + zeros === entry.length) {
+        if (zeros > 0) {
+          emitSourceRun(OP_COPY, entry.source + i, zeros);
+        }
+        i += zeros;
+        continue;
+      }
+      // ADD up to the next long zero run
+      let end = i + zeros;
+      let run = 0;
+      while (end < entry.length && run < MIN_COPY) {
+        run = diff(end) === 0 ? run + 1 : 0;
+        end++;
+      }
+      if (run >= MIN_COPY) {
+        end -= run;
+      }
+      emitSourceRun(OP_ADD, entry.source + i, end - i);
+      for (let k = i; k < end; k++) {
+        out.push(diff(k));
+      }
+      i = end;
+    }
+  }
+  out.push(OP_END);
+  return Buffer.from(out);
+}
+
+function lzssCompress(data) {
+  const out = [];
+  const head = new Int32Array(1 << 16).fill(-1);
+  const prev = new Int32Array(Math.max(data.length, 1)).fill(-1);
+  const hashAt = (p) => ((data[p] << 8) ^ (data[p + 1] << 4) ^ data[p + 2]) & 0xffff;
+  const insert = (p) => {
+    if (p + LZ_MIN_MATCH <= data.length) {
+      const hash = hashAt(p);
+      prev[p] = head[hash];
+      head[hash] = p;
+    }
+  };
+
+  let flagIndex = -1;
+  let flagBit = 8;
+  const item = (literal) => {
+    if (flagBit === 8) {
+      flagIndex = out.length;
+      out.push(0);
+      flagBit = 0;
+    }
+    if (literal) {
+      out[flagIndex] |= 1 << flagBit;
+    }
+    flagBit++;
+  };
+
+  let p = 0;
+  while (p < data.length) {
+    let bestLength = 0;
+    let bestDistance = 0;
+    if (p + LZ_MIN_MATCH <= data.length) {
+      let candidates = 0;
+      for (let c = head[hashAt(p)]; c >= 0 && p - c <= WINDOW_SIZE && candidates < LZ_MAX_CANDIDATES; c = prev[c]) {
+        candidates++;
+        let length = 0;
+        // The copy may overlap what it produces, as in the decoder
+        while (length < LZ_MAX_MATCH && p + length < data.length && data[c + length] === data[p + length]) {
+          length++;
+        }
+        if (length > bestLength) {
+          bestLength = length;
+          bestDistance = p - c;
+          if (length === LZ_MAX_MATCH) {
+            break;
+          }
+        }
+      }
+    }
+
+    if (bestLength >= LZ_MIN_MATCH) {
+      item(false);
+      const distance = bestDistance - 1;
+      out.push(distance >> 4, ((distance & 0x0f) << 4) | (bestLength - LZ_MIN_MATCH));
+      for (let i = 0; i < bestLength; i++) {
+        insert(p + i);
+      }
+      p += bestLength;
+    } else {
+      item(true);
+      out.push(data[p]);
+      insert(p);
+      p++;
+    }
+  }
+  return Buffer.from(out);
+}
+
+function lzssDecompress(data) {
+  const out = [];
+  let i = 0;
+  while (i < data.length) {
+    const flags = data[i++];
+    for (let bit = 0; bit < 8 && i < data.length; bit++) {
+      if (flags & (1 << bit)) {
+        out.push(data[i++]);
+      } else {
+        if (i + 1 >= data.length) {
+          throw new Error('truncated match');
+        }
+        const distance = ((data[i] << 4) | (data[i + 1] >> 4)) + 1;
+        const length = (data[i + 1] & 0x0f) + LZ_MIN_MATCH;
+        i += 2;
+        if (distance > out.length) {
+          throw new Error('match before start of stream');
+        }
+        for (let k = 0; k < length; k++) {
+          out.push(out[out.length - distance]);
+        }
+      }
+    }
+  }
+  return Buffer.from(out);
+}
+
+/**
+ * Build a patch that turns `source` into `target`
+ * @param {Buffer|null} source - Image running on the device (null or empty for a full image)
+ * @param {Buffer} target - New image
+ * @returns {Buffer} Patch
+ */
+function createPatch(source, target) {
+  const from = source || Buffer.alloc(0);
+  const body = lzssCompress(encodeOps(from, target, diffOps(from, target)));
+  const header = Buffer.alloc(HEADER_SIZE);
+  MAGIC.copy(header, 0);
+  header[4] = FORMAT_VERSION;
+  header.writeUInt32LE(from.length, 8);
+  header.writeUInt32LE(target.length, 12);
+  return Buffer.concat([header, body]);
+}
+
+/**
+ * Apply a patch (same checks as the firmware); used to verify a patch before it is offered
+ * @param {Buffer|null} source - Image the patch was made against
+ * @param {Buffer} patch - Output of createPatch()
+ * @returns {Buffer} Rebuilt image
+ */
+function applyPatch(source, patch) {
+  const from = source || Buffer.alloc(0);
+  if (patch.length < HEADER_SIZE || !patch.subarray(0, 4).equals(MAGIC) || patch[4] !== FORMAT_VERSION) {
+    throw new Error('bad patch header');
+  }
+  if (patch.readUInt32LE(8) !== from.length) {
+    throw new Error('patch made against a different source size');
+  }
+  const target = Buffer.alloc(patch.readUInt32LE(12));
+  const ops = lzssDecompress(patch.subarray(HEADER_SIZE));
+
+  let i = 0;
+  const varint = () => {
+    let value = 0;
+    let shift = 0;
+    for (;;) {
+      if (i >= ops.length || shift > 28) {
+        throw new Error('bad varint');
+      }
+      const byte = ops[i++];
+      value += (byte & 0x7f) * 2 ** shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+      shift += 7;
+    }
+  };
+
+  let sourcePos = 0;
+  let produced = 0;
+  for (;;) {
+    if (i >= ops.length) {
+      throw new Error('missing END');
+    }
+    const op = ops[i++];
+    if (op === OP_END) {
+      break;
+    }
+    if (op === OP_ADD || op === OP_COPY) {
+      const zigzag = varint();
+      sourcePos += zigzag % 2 ? -(zigzag + 1) / 2 : zigzag / 2;
+      const length = varint();
+      const diffBytes = op === OP_ADD ? length : 0;
+      if (sourcePos < 0 || sourcePos + length > from.length || produced + length > target.length || i + diffBytes > ops.length) {
+        throw new Error('ADD/COPY out of bounds');
+      }
+      for (let k = 0; k < length; k++) {
+        target[produced++] = (from[sourcePos++] + (op === OP_ADD ? ops[i++] : 0)) & 0xff;
+      }
+    } else if (op === OP_INSERT) {
+      const length = varint();
+      if (produced + length > target.length || i + length > ops.length) {
+        throw new Error('INSERT out of bounds');
+      }
+      ops.copy(target, produced, i, i + length);
+      produced += length;
+      i += length;
+    } else {
+      throw new Error(`bad opcode ${op}`);
+    }
+  }
+  if (i !== ops.length || produced !== target.length) {
+    throw new Error('patch size mismatch');
+  }
+  return target;
+}
+
+module.exports = {
+  createPatch,
+  applyPatch
+};
@@ -0,0 +1,153 @@
+/**
+ * OTA Releases
+ * Signed firmware images on disk and the delta patches offered to ESP32 devices
+ *
+ * A release is `<version>.bin` plus `<version>.json` ({version, size, sha256,
+ * signature}) in OTA_RELEASE_DIR, written by scripts/ota-release.js. The
+ * signature covers the manifest text below, which the firmware rebuilds and
+ * checks against its compiled-in public key before pulling anything.
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const { createPatch, applyPatch } = require('./otaDelta');
+
+const RELEASE_DIR = process.env.OTA_RELEASE_DIR || path.join(__dirname, '..', 'ota-releases');
+const MAX_CACHED_PATCHES = 8;
+const OFFER_TTL_MS = 6 * 60 * 60 * 1000;  // Devices may resume a download this long after the offer
+const MAX_CHUNK_BYTES = 16384;
+
+const patchCache = new Map();  // `${fromSha}:${toSha}` → Buffer, oldest first
+const offers = new Map();      // offer id → { patch, version, device_id, created }
+
+function sha256(buffer) {
+  return crypto.createHash('sha256').update(buffer).digest('hex');
+}
+
+/**
+ * Text signed for a release (must match OtaUpdater::verifySignature in the firmware)
+ */
+function manifestText(version, size, sha256Hex) {
+  return `ghota1\n${version}\n${size}\n${sha256Hex}\n`;
+}
+
+function signRelease(version, image, privateKeyPem) {
+  const digest = sha256(image);
+  const signature = crypto.sign('sha256', Buffer.from(manifestText(version, image.length, digest)), privateKeyPem);
+  return { version, size: image.length, sha256: digest, signature: signature.toString('hex') };
+}
+
+function validVersion(version) {
+  return typeof version === 'string' && /^[A-Za-z0-9._-]{1,23}$/.test(version);
+}
+
+/**
+ * Load a release from OTA_RELEASE_DIR
+ * @returns {Object|null} {version, size, sha256, signature, image} or null when missing or inconsistent
+ */
+function loadRelease(version) {
+  if (!validVersion(version)) {
+    return null;
+  }
+  try {
+    const manifest = JSON.parse(fs.readFileSync(path.join(RELEASE_DIR, `${version}.json`), 'utf8'));
+    const image = fs.readFileSync(path.join(RELEASE_DIR, `${version}.bin`));
+    if (manifest.version !== version || manifest.size !== image.length || manifest.sha256 !== sha256(image)) {
+      console.error(`❌ [OTA] Release ${version} does not match its manifest`);
+      return null;
+    }
+    return { ...manifest, image };
+  } catch (error) {
+    return null;
+  }
+}
+
+function cachedPatch(source, target) {
+  const key = `${source ? source.sha256 : 'full'}:${target.sha256}`;
+  let patch = patchCache.get(key);
+  if (patch) {
+    patchCache.delete(key);
+  } else {
+    patch = createPatch(source ? source.image : null, target.image);
+    // Never offer a patch that does not rebuild the image
+    if (!applyPatch(source ? source.image : null, patch).equals(target.image)) {
+      throw new Error(`patch ${key} does not reproduce the target image`);
+    }
+  }
+  patchCache.set(key, patch);
+  while (patchCache.size > MAX_CACHED_PATCHES) {
+    patchCache.delete(patchCache.keys().next().value);
+  }
+  return patch;
+}
+
+function pruneOffers(now = Date.now()) {
+  for (const [id, offer] of offers.entries()) {
+    if (now - offer.created > OFFER_TTL_MS) {
+      offers.delete(id);
+    }
+  }
+}
+
+/**
+ * Build an ota:offer for one device
+ * @param {string} deviceId - Target device
+ * @param {string} runningVersion - firmware_version the device registered with
+ * @param {string} targetVersion - Release to install
+ * @param {Object} [options] - {full: true} to skip the delta (e.g. after a source mismatch)
+ * @returns {Object} Event payload (the patch stays on the server until pulled)
+ */
+function createOffer(deviceId, runningVersion, targetVersion, options = {}) {
+  const target = loadRelease(targetVersion);
+  if (!target) {
+    throw new Error(`release ${targetVersion} not found in ${RELEASE_DIR}`);
+  }
+  const source = options.full || runningVersion === targetVersion ? null : loadRelease(runningVersion);
+  const patch = cachedPatch(source, target);
+
+  pruneOffers();
+  const id = `${Date.now().toString(36)}-${crypto.randomBytes(4).toString('hex')}`;
+  offers.set(id, { patch, version: target.version, device_id: deviceId, created: Date.now() });
+
+  return {
+    id,
+    version: target.version,
+    patch_size: patch.length,
+    target_size: target.size,
+    target_sha256: target.sha256,
+    source_size: source ? source.size : 0,
+    source_sha256: source ? source.sha256 : '',
+    signature: target.signature
+  };
+}
+
+/**
+ * Patch bytes for an ota:pull
+ * @returns {Buffer|null} null for unknown offers or invalid ranges
+ */
+function readChunk(id, offset, length) {
+  const offer = offers.get(id);
+  if (!offer || !Number.isInteger(offset) || !Number.isInteger(length)) {
+    return null;
+  }
+  if (offset < 0 || length <= 0 || length > MAX_CHUNK_BYTES || offset >= offer.patch.length) {
+    return null;
+  }
+  return offer.patch.subarray(offset, Math.min(offset + length, offer.patch.length));
+}
+
+function getOffer(id) {
+  return offers.get(id) || null;
+}
+
+module.exports = {
+  RELEASE_DIR,
+  manifestText,
+  signRelease,
+  validVersion,
+  loadRelease,
+  createOffer,
+  readChunk,
+  getOffer
+};
@@ -0,0 +1,148 @@
+/**
+ * Relay Commands
+ * Sequenced relay:command delivery to ESP32 devices with cumulative acks
+ *
+ * Every command to a device carries {epoch, seq}: epoch is random per backend
+ * start, seq counts up per device. The firmware applies a command only when
+ * seq is the next one (duplicates and out-of-order frames are not applied)
+ * and answers relay:ack {epoch, ack} with the highest seq applied, once per
+ * loop iteration however many commands arrived.
+ *
+ * Commands stay pending until acked, so several can be in flight without
+ * waiting for each round trip. Pending commands are resent (go-back-N) when
+ * the device registers again, when its ack reports a gap, or after
+ * RETRANSMIT_MS without progress. They set absolute states, so resending one
+ * the device already applied under an earlier epoch is harmless.
+ */
+
+const crypto = require('crypto');
+
+const EPOCH = crypto.randomBytes(4).toString('hex');
+const RETRANSMIT_MS = 3000;
+const MAX_PENDING = 64;  // Per device; the oldest is dropped beyond this (a newer command supersedes it in practice)
+
+const outboxes = new Map();  // device_id → { socket, nextSeq, pending: [{ seq, command }], timer }
+
+function outboxFor(socket) {
+  let outbox = outboxes.get(socket.deviceId);
+  if (!outbox) {
+    outbox = { socket, nextSeq: 1, pending: [], timer: null };
+    outboxes.set(socket.deviceId, outbox);
+  }
+  return outbox;
+}
+
+function emitCommand(outbox, entry) {
+  outbox.socket.emit('relay:command', { ...entry.command, epoch: EPOCH, seq: entry.seq });
+}
+
+function armRetransmit(outbox) {
+  clearTimeout(outbox.timer);
+  outbox.timer = null;
+  if (outbox.pending.length === 0) {
+    return;
+  }
+  outbox.timer = setTimeout(() => {
+    outbox.timer = null;
+    if (outbox.socket.connected) {
+      console.log(`🔁 [RELAY_CMD] No ack from ${outbox.socket.deviceId}: resending ${outbox.pending.length} command(s)`);
+      resend(outbox);
+    }
+    // Disconnected: resume() resends when the device registers again
+  }, RETRANSMIT_MS);
+}
+
+function resend(outbox) {
+  outbox.pending.forEach((entry) => emitCommand(outbox, entry));
+  armRetransmit(outbox);
+}
+
+/**
+ * Queue a command for one device socket and send it at once
+ * @param {Object} socket - Authenticated ESP32 socket
+ * @param {Object} command - {relay_id, state, mode, ...}
+ * @returns {number} seq assigned to the command
+ */
+function send(socket, command) {
+  const outbox = outboxFor(socket);
+  outbox.socket = socket;
+  const entry = { seq: outbox.nextSeq++, command };
+  outbox.pending.push(entry);
+  if (outbox.pending.length > MAX_PENDING) {
+    const dropped = outbox.pending.shift();
+    console.warn(`⚠️  [RELAY_CMD] ${socket.deviceId}: ${MAX_PENDING} commands unacked, dropping seq ${dropped.seq}`);
+  }
+  emitCommand(outbox, entry);
+  if (!outbox.timer) {
+    armRetransmit(outbox);
+  }
+  return entry.seq;
+}
+
+/**
+ * Send a command to every authenticated ESP32 socket (what io.to('esp32_devices') did)
+ * @param {Object} io - Socket.IO instance
+ * @param {Object} command - {relay_id, state, mode, ...}
+ * @returns {number} Devices the command was queued for
+ */
+function broadcast(io, command) {
+  const devices = Array.from(io.sockets.sockets.values()).filter((device) =>
+    device.authenticated && device.deviceType === 'esp32' && device.deviceId);
+  devices.forEach((device) => send(device, command));
+  return devices.length;
+}
+
+/**
+ * Drop acked commands (relay:ack from the device)
+ * @param {Object} socket - Device socket
+ * @param {Object} data - {epoch, ack, gap}; gap is set when the device skipped an out-of-order command
+ */
+function acknowledge(socket, data) {
+  const outbox = outboxes.get(socket.deviceId);
+  if (!outbox || data.epoch !== EPOCH || !Number.isInteger(data.ack)) {
+    return;  // Ack for an earlier backend start: nothing of ours is pending under it
+  }
+  outbox.socket = socket;
+  const before = outbox.pending.length;
+  outbox.pending = outbox.pending.filter((entry) => entry.seq > data.ack);
+  if (data.gap && outbox.pending.length > 0) {
+    resend(outbox);
+  } else if (outbox.pending.length !== before) {
+    armRetransmit(outbox);  // Progress: restart the timeout for what is left
+  }
+}
+
+/**
+ * Device (re)registered: drop what it reports as applied and resend the rest
+ * @param {Object} socket - Newly authenticated device socket
+ * @param {string} epoch - command_epoch from device:register ('' after a reboot)
+ * @param {number} ack - command_ack from device:register
+ */
+function resume(socket, epoch, ack) {
+  const outbox = outboxes.get(socket.deviceId);
+  if (!outbox) {
+    return;
+  }
+  outbox.socket = socket;
+  if (epoch === EPOCH && Number.isInteger(ack)) {
+    outbox.pending = outbox.pending.filter((entry) => entry.seq > ack);
+  }
+  if (outbox.pending.length > 0) {
+    console.log(`🔁 [RELAY_CMD] ${socket.deviceId} reconnected: resending ${outbox.pending.length} unacked command(s)`);
+    resend(outbox);
+  }
+}
+
+function pendingCount(deviceId) {
+  const outbox = outboxes.get(deviceId);
+  return outbox ? outbox.pending.length : 0;
+}
+
+module.exports = {
+  EPOCH,
+  send,
+  broadcast,
+  acknowledge,
+  resume,
+  pendingCount
+};
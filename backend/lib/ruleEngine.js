@@ -10,6 +10,7 @@
 const Rule = require('../models/Rule');
 const RelayState = require('../models/RelayState');
 const SystemLog = require('../models/SystemLog');
+const relayCommands = require('./relayCommands');
 
 // Map relay IDs to names (must match frontend)
 const RELAY_NAMES = {
@@ -23,7 +24,7 @@ const RELAY_NAMES = {
  * Evaluate sensor-based rules 
  * Called when new sensor data arrives from ESP32
  * 
- * @param {Object} sensorReading - Latest sensor data {temperature, humidity, soil_moisture}
+ * @param {Object} sensorReading - Latest sensor data {temperature, humidity, soil_moisture, vpd, dew_point, ...}
  * @param {Object} io - Socket.IO instance for broadcasting relay:command
  * @returns {Promise<void>}
  */
@@ -55,7 +56,8 @@ async function evaluateSensorRules(sensorReading, io) {
 
       // Get sensor value
       const sensorValue = sensorReading[condition.sensor];
-      if (sensorValue === undefined) {
+      if (sensorValue === undefined || sensorValue === null) {
+        // null: a derived value the device did not send (older firmware, no outdoor data)
         console.warn(`⚠️  [WARN] Sensor "${condition.sensor}" not found in reading`);
         continue;
       }  
@@ -170,7 +172,7 @@ function evaluateCondition(value, operator, threshold) {
  * Helper: Execute relay action (turn on/off)
  * This saves the state to the database, logs the action, and broadcasts to ESP32
  * 
- * @param {number} relayId - 0=Lights, 1=Fan, 2=Pump, 3=Heater
+ * @param {number} relayId - 0=Lights, 1=Fan, 2=Pump, 3=Heater, 4+ = expander channels
  * @param {boolean} state - true=on, false=off
  * @param {string} mode - 'manual' | 'auto' | 'rule' | 'system'
  * @param {string} changedBy - Rule ID or user identifier
@@ -180,7 +182,7 @@ function evaluateCondition(value, operator, threshold) {
 async function executeRelayAction(relayId, state, mode = 'auto', changedBy = 'system', io = null) {
   try {
     // Validate relay ID
-    if (relayId < 0 || relayId > 3) {
+    if (!Number.isInteger(relayId) || relayId < 0 || relayId > RelayState.MAX_RELAY_ID) {
       console.warn(`⚠️  [WARN] Invalid relay ID: ${relayId}`);
       return null;
     }
@@ -211,7 +213,7 @@ async function executeRelayAction(relayId, state, mode = 'auto', changedBy = 'sy
 
     // Broadcast relay:command to ESP32 devices (same as dashboard command)
     if (io) {
-      io.to('esp32_devices').emit('relay:command', {
+      relayCommands.broadcast(io, {
         relay_id: relayId,
         state: state,
         mode: mode,
@@ -0,0 +1,141 @@
+/**
+ * Sensor Blocks
+ * Decoder for the compressed reading blocks ESP32 devices upload as sensor:block
+ *
+ * Layout (esp32-firmware/include/sensor_block.h): a 12-byte little-endian
+ * header {version, channels, count u16, first timestamp u64} and one bit
+ * stream, MSB first. The first reading's values are raw float32 bits; every
+ * later reading is a delta-of-delta timestamp code followed by one XOR code
+ * per channel (Facebook Gorilla, with 32-bit floats and millisecond times).
+ *
+ * Block timestamps are the device's monotonic clock; the event carries the
+ * epoch times of the first and last reading to place them.
+ */
+
+const VERSION = 1;
+const CHANNELS = ['temperature', 'humidity', 'soil_moisture'];
+const HEADER_BYTES = 12;
+// Delta-of-delta codes after the leading '1': '0' + 7 bits, '10' + 9, '110' + 12, '111' + 32 (two's complement)
+const TIMESTAMP_BUCKETS = [
+  { bits: 7, bias: 63 },
+  { bits: 9, bias: 255 },
+  { bits: 12, bias: 2047 }
+];
+
+class BitReader {
+  constructor(buffer, offset) {
+    this.buffer = buffer;
+    this.position = offset * 8;
+  }
+
+  read(bits) {
+    if (this.position + bits > this.buffer.length * 8) {
+      throw new Error('truncated block');
+    }
+    let value = 0;
+    while (bits > 0) {
+      const room = 8 - (this.position % 8);
+      const take = Math.min(bits, room);
+      const chunk = (this.buffer[Math.floor(this.position / 8)] >> (room - take)) & ((1 << take) - 1);
+      value = value * (1 << take) + chunk;  // Arithmetic, not <<: values reach 2^32 - 1
+      this.position += take;
+      bits -= take;
+    }
+    return value;
+  }
+}
+
+const floatView = new DataView(new ArrayBuffer(4));
+
+function toFloat(bits) {
+  floatView.setUint32(0, bits);
+  // float32 carried to 7 significant digits, as the firmware prints it in sensor:data
+  return Number(floatView.getFloat32(0).toPrecision(7));
+}
+
+/**
+ * Decode a block
+ * @param {Buffer} buffer - sensor:block attachment
+ * @returns {Object[]} [{ t, temperature, humidity, soil_moisture }], t in device monotonic ms
+ * @throws {Error} On an unknown version or a truncated block
+ */
+function decode(buffer) {
+  if (!Buffer.isBuffer(buffer) || buffer.length < HEADER_BYTES) {
+    throw new Error('not a sensor block');
+  }
+  if (buffer[0] !== VERSION || buffer[1] !== CHANNELS.length) {
+    throw new Error(`unsupported block version ${buffer[0]} with ${buffer[1]} channels`);
+  }
+  const count = buffer.readUInt16LE(2);
+  let t = Number(buffer.readBigUInt64LE(4));
+  const reader = new BitReader(buffer, HEADER_BYTES);
+  const values = CHANNELS.map(() => reader.read(32));
+  const windows = CHANNELS.map(() => ({ leading: 0, trailing: 0 }));
+  const readings = [];
+  let delta = 0;
+
+  for (let i = 0; i < count; i++) {
+    if (i > 0) {
+      delta += readDeltaOfDelta(reader);
+      t += delta;
+      CHANNELS.forEach((channel, c) => {
+        if (reader.read(1) === 0) {
+          return;  // Unchanged
+        }
+        const window = windows[c];
+        if (reader.read(1) === 1) {
+          window.leading = reader.read(5);
+          const length = reader.read(5) + 1;
+          if (window.leading + length > 32) {
+            throw new Error('bad value window');
+          }
+          window.trailing = 32 - window.leading - length;
+        }
+        const bits = reader.read(32 - window.leading - window.trailing);
+        values[c] = (values[c] ^ (bits * 2 ** window.trailing)) >>> 0;
+      });
+    }
+    const reading = { t };
+    CHANNELS.forEach((channel, c) => {
+      reading[channel] = toFloat(values[c]);
+    });
+    readings.push(reading);
+  }
+  return readings;
+}
+
+function readDeltaOfDelta(reader) {
+  if (reader.read(1) === 0) {
+    return 0;
+  }
+  for (const bucket of TIMESTAMP_BUCKETS) {
+    if (reader.read(1) === 0) {
+      return reader.read(bucket.bits) - bucket.bias;
+    }
+  }
+  return reader.read(32) | 0;  // Two's complement
+}
+
+/**
+ * Map block (monotonic) times to epoch ms from the first/last reading's epoch times
+ * @param {Object[]} readings - Output of decode()
+ * @param {number} firstTimestamp - Epoch ms of readings[0]
+ * @param {number} lastTimestamp - Epoch ms of the last reading (defaults to a fixed offset)
+ * @returns {Function} t → epoch ms
+ */
+function epochMapper(readings, firstTimestamp, lastTimestamp) {
+  const first = readings[0].t;
+  const span = readings[readings.length - 1].t - first;
+  if (span <= 0 || typeof lastTimestamp !== 'number') {
+    return (t) => firstTimestamp + (t - first);
+  }
+  // Linear: follows the device's drift correction between the two ends
+  const rate = (lastTimestamp - firstTimestamp) / span;
+  return (t) => firstTimestamp + (t - first) * rate;
+}
+
+module.exports = {
+  CHANNELS,
+  decode,
+  epochMapper
+};
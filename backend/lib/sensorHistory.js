@@ -0,0 +1,96 @@
+/**
+ * Sensor History
+ * On-device history queries: sensor:history to an ESP32, sensor:history:chunk back
+ *
+ * The firmware keeps weeks of readings in its flash (esp32-firmware/include/
+ * history_store.h) and answers {request_id, from, to, step} with buckets of
+ * step ms, streamed as chunks {request_id, seq, from, step, buckets, done,
+ * data}. `data` is a binary attachment of 44-byte little-endian buckets:
+ * index u32, reading count u32, then min/mean/max float32 per channel.
+ * Empty buckets are left out; the last chunk has done: true and totals.
+ *
+ * Requests are kept here until their last chunk (or REQUEST_TIMEOUT_MS) so
+ * chunks can be relayed to the dashboard socket that asked.
+ */
+
+const crypto = require('crypto');
+
+const CHANNELS = ['temperature', 'humidity', 'soil_moisture'];
+const BUCKET_BYTES = 8 + CHANNELS.length * 12;
+const REQUEST_TIMEOUT_MS = 60000;
+
+const requests = new Map();  // request_id → { requester, deviceId, timer }
+
+/**
+ * Decode a chunk attachment
+ * @param {Buffer} buffer - sensor:history:chunk data
+ * @param {number} from - Epoch ms of bucket 0 (the chunk's `from`)
+ * @param {number} step - Bucket width in ms
+ * @returns {Object[]} [{ timestamp, count, temperature: {min, mean, max}, humidity, soil_moisture }]
+ * @throws {Error} When the attachment is not a whole number of buckets
+ */
+function decodeBuckets(buffer, from, step) {
+  if (!Buffer.isBuffer(buffer) || buffer.length % BUCKET_BYTES !== 0) {
+    throw new Error('not a history chunk');
+  }
+  const buckets = [];
+  for (let offset = 0; offset < buffer.length; offset += BUCKET_BYTES) {
+    const bucket = {
+      timestamp: from + buffer.readUInt32LE(offset) * step,
+      count: buffer.readUInt32LE(offset + 4)
+    };
+    CHANNELS.forEach((channel, c) => {
+      const base = offset + 8 + c * 12;
+      bucket[channel] = {
+        min: round(buffer.readFloatLE(base)),
+        mean: round(buffer.readFloatLE(base + 4)),
+        max: round(buffer.readFloatLE(base + 8))
+      };
+    });
+    buckets.push(bucket);
+  }
+  return buckets;
+}
+
+// float32 to 7 significant digits, as sensor:data carries it
+function round(value) {
+  return Number(value.toPrecision(7));
+}
+
+/**
+ * Register a query and the socket its chunks go to
+ * @param {Socket} requester - Dashboard socket
+ * @param {string} deviceId - Device asked
+ * @returns {string} request_id to send with sensor:history
+ */
+function track(requester, deviceId) {
+  const requestId = crypto.randomBytes(8).toString('hex');
+  const timer = setTimeout(() => requests.delete(requestId), REQUEST_TIMEOUT_MS);
+  requests.set(requestId, { requester, deviceId, timer });
+  return requestId;
+}
+
+/**
+ * Socket that asked for request_id, if the query is still open
+ * @param {string} requestId
+ * @param {boolean} done - Last chunk: forget the request
+ * @returns {Socket|null}
+ */
+function requesterOf(requestId, done) {
+  const request = requests.get(requestId);
+  if (!request) {
+    return null;
+  }
+  if (done) {
+    clearTimeout(request.timer);
+    requests.delete(requestId);
+  }
+  return request.requester;
+}
+
+module.exports = {
+  CHANNELS,
+  decodeBuckets,
+  track,
+  requesterOf
+};
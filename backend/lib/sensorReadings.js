@@ -0,0 +1,57 @@
+/**
+ * Sensor Reading Storage
+ * Device-timestamped, idempotent inserts for readings from ESP32 devices
+ */
+
+const SensorReading = require('../models/SensorReading');
+
+// Device clocks before this are not synced yet (the firmware omits them, but be safe)
+const MIN_DEVICE_EPOCH_MS = Date.UTC(2020, 0, 1);
+// Device timestamps further ahead of the server clock than this are not trusted
+const MAX_FUTURE_SKEW_MS = 5 * 60 * 1000;
+
+/**
+ * Acquisition time reported by the device
+ * @param {*} value - `timestamp` field of the frame (epoch milliseconds)
+ * @param {number} receivedAt - Server time the frame arrived (epoch milliseconds)
+ * @returns {Date|null} null when missing or implausible (use the arrival time instead)
+ */
+function deviceTimestamp(value, receivedAt = Date.now()) {
+  if (typeof value !== 'number' || !Number.isFinite(value)) {
+    return null;
+  }
+  if (value < MIN_DEVICE_EPOCH_MS || value > receivedAt + MAX_FUTURE_SKEW_MS) {
+    return null;
+  }
+  return new Date(Math.round(value));
+}
+
+/**
+ * Insert readings in acquisition order, skipping ones already stored
+ *
+ * Readings stamped by the device are unique per (device_id, timestamp), so a
+ * reading sent again after a reconnect or a reboot is dropped by the index
+ * instead of being stored twice.
+ * @param {Object[]} readings - Documents for SensorReading
+ * @returns {Promise<Object[]>} The readings actually inserted, oldest first
+ */
+async function insertReadings(readings) {
+  if (readings.length === 0) {
+    return [];
+  }
+  const ordered = [...readings].sort((a, b) => a.timestamp - b.timestamp);
+  try {
+    return await SensorReading.insertMany(ordered, { ordered: false });
+  } catch (error) {
+    const writeErrors = error.writeErrors || [];
+    if (writeErrors.length === 0 || !writeErrors.every((writeError) => writeError.code === 11000)) {
+      throw error;
+    }
+    return (error.insertedDocs || []).sort((a, b) => a.timestamp - b.timestamp);
+  }
+}
+
+module.exports = {
+  deviceTimestamp,
+  insertReadings
+};
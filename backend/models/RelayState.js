@@ -1,11 +1,14 @@
 const mongoose = require('mongoose');
 
+// Firmware RELAY_MAX_COUNT - 1: 4 GPIO relays plus up to 16 channels per I2C expander
+const MAX_RELAY_ID = 63;
+
 const relayStateSchema = new mongoose.Schema({
   relay_id: {
     type: Number,
     required: true,
     min: 0,
-    max: 3
+    max: MAX_RELAY_ID
   },
   state: {
     type: Boolean,
@@ -37,3 +40,4 @@ relayStateSchema.index({ relay_id: 1, timestamp: -1 });
 relayStateSchema.index({ createdAt: 1 }, { expireAfterSeconds: 2592000 });
 
 module.exports = mongoose.model('RelayState', relayStateSchema);
+module.exports.MAX_RELAY_ID = MAX_RELAY_ID;
@@ -1,11 +1,12 @@
 const mongoose = require('mongoose');
+const { MAX_RELAY_ID } = require('./RelayState');
 
 const ruleSchema = new mongoose.Schema({
   relay_id: {
     type: Number,
     required: true,
     min: 0,
-    max: 3
+    max: MAX_RELAY_ID
   },
   enabled: {
     type: Boolean,
@@ -21,7 +22,7 @@ const ruleSchema = new mongoose.Schema({
   condition: {
     sensor: {
       type: String,
-      enum: ['temperature', 'humidity', 'soil_moisture']
+      enum: ['temperature', 'humidity', 'soil_moisture', 'vpd', 'dew_point', 'dew_point_margin', 'absolute_humidity', 'absolute_humidity_delta']
     },
     operator: {
       type: String,
@@ -30,10 +30,42 @@ const sensorReadingSchema = new mongoose.Schema({
     type: Number,
     default: 0
   },
+  // Derived on the device: vapour pressure deficit (kPa), dew point (°C), water vapour (g/m³);
+  // dew_point_margin = temperature - dew_point; outdoor ones need sensor:climate data
+  vpd: {
+    type: Number,
+    default: null
+  },
+  dew_point: {
+    type: Number,
+    default: null
+  },
+  dew_point_margin: {
+    type: Number,
+    default: null
+  },
+  absolute_humidity: {
+    type: Number,
+    default: null
+  },
+  outdoor_dew_point: {
+    type: Number,
+    default: null
+  },
+  absolute_humidity_delta: {
+    type: Number,
+    default: null
+  },
   timestamp: {
     type: Date,
     default: Date.now,
     index: true
+  },
+  // 'device': acquisition time reported by the ESP32; 'server': arrival time
+  time_source: {
+    type: String,
+    enum: ['device', 'server'],
+    default: 'server'
   }
 }, {
   timestamps: true
@@ -42,6 +74,12 @@ const sensorReadingSchema = new mongoose.Schema({
 // Índice compuesto para queries eficientes (device_id + timestamp)
 sensorReadingSchema.index({ device_id: 1, timestamp: -1 });
 
+// Un mismo instante de adquisición se guarda una sola vez (reenvíos tras reconexión o reinicio)
+sensorReadingSchema.index(
+  { device_id: 1, timestamp: 1 },
+  { unique: true, partialFilterExpression: { time_source: 'device' } }
+);
+
 // TTL index: auto-delete documents after 30 days (2592000 seconds)
 // MongoDB will automatically remove documents where createdAt is older than 30 days
 sensorReadingSchema.index({ createdAt: 1 }, { expireAfterSeconds: 2592000 });
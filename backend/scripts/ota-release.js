@@ -0,0 +1,82 @@
+#!/usr/bin/env node
+/**
+ * OTA release tool
+ *
+ *   node scripts/ota-release.js --generate-key <dir>
+ *       New ECDSA P-256 signing key; prints the public key for esp32-firmware/include/ota_key.h
+ *   node scripts/ota-release.js --key <private.pem> --version <version> <firmware.bin>
+ *       Sign the image and install it in OTA_RELEASE_DIR as <version>.bin + <version>.json
+ *   node scripts/ota-release.js --delta <old.bin> <new.bin> <out.ghdp>
+ *       Write the patch the backend would offer (for bench/delta_apply.cpp);
+ *       "-" as <old.bin> for a full-image patch
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const { createPatch, applyPatch } = require('../lib/otaDelta');
+const { RELEASE_DIR, signRelease, validVersion } = require('../lib/otaReleases');
+
+function usage() {
+  console.error('usage: ota-release.js --generate-key <dir>');
+  console.error('       ota-release.js --key <private.pem> --version <version> <firmware.bin>');
+  console.error('       ota-release.js --delta <old.bin> <new.bin> <out.ghdp>');
+  process.exit(2);
+}
+
+function generateKey(dir) {
+  const { privateKey, publicKey } = crypto.generateKeyPairSync('ec', { namedCurve: 'prime256v1' });
+  fs.mkdirSync(dir, { recursive: true });
+  const privatePath = path.join(dir, 'ota_signing_key.pem');
+  const publicPem = publicKey.export({ type: 'spki', format: 'pem' });
+  fs.writeFileSync(privatePath, privateKey.export({ type: 'pkcs8', format: 'pem' }), { mode: 0o600, flag: 'wx' });
+  fs.writeFileSync(path.join(dir, 'ota_signing_key.pub.pem'), publicPem);
+  console.log(`Private key: ${privatePath} (keep it out of the repository)`);
+  console.log('Public key for include/ota_key.h:\n');
+  console.log('#define OTA_SIGNING_PUBLIC_KEY \\');
+  const lines = publicPem.trim().split('\n');
+  lines.forEach((line, i) => console.log(`    "${line}\\n"${i < lines.length - 1 ? ' \\' : ''}`));
+}
+
+function release(keyPath, version, imagePath) {
+  if (!validVersion(version)) {
+    console.error('version must be 1-23 characters of [A-Za-z0-9._-]');
+    process.exit(2);
+  }
+  const image = fs.readFileSync(imagePath);
+  if (image[0] !== 0xe9) {
+    console.error(`${imagePath} is not an ESP32 application image (magic 0xE9)`);
+    process.exit(1);
+  }
+  const manifest = signRelease(version, image, fs.readFileSync(keyPath, 'utf8'));
+  fs.mkdirSync(RELEASE_DIR, { recursive: true });
+  fs.writeFileSync(path.join(RELEASE_DIR, `${version}.bin`), image);
+  fs.writeFileSync(path.join(RELEASE_DIR, `${version}.json`), `${JSON.stringify(manifest, null, 2)}\n`);
+  console.log(`Release ${version}: ${image.length} bytes, sha256 ${manifest.sha256} → ${RELEASE_DIR}`);
+}
+
+function delta(oldPath, newPath, outPath) {
+  const source = oldPath === '-' ? null : fs.readFileSync(oldPath);
+  const target = fs.readFileSync(newPath);
+  const started = Date.now();
+  const patch = createPatch(source, target);
+  const elapsed = Date.now() - started;
+  if (!applyPatch(source, patch).equals(target)) {
+    console.error('patch does not reproduce the target image');
+    process.exit(1);
+  }
+  fs.writeFileSync(outPath, patch);
+  const ratio = ((100 * patch.length) / target.length).toFixed(2);
+  console.log(`${outPath}: ${patch.length} bytes for a ${target.length} byte image (${ratio}%), built in ${elapsed} ms`);
+}
+
+const args = process.argv.slice(2);
+if (args[0] === '--generate-key' && args.length === 2) {
+  generateKey(args[1]);
+} else if (args[0] === '--delta' && args.length === 4) {
+  delta(args[1], args[2], args[3]);
+} else if (args[0] === '--key' && args[2] === '--version' && args.length === 5) {
+  release(args[1], args[3], args[4]);
+} else {
+  usage();
+}
@@ -0,0 +1,24 @@
+#!/usr/bin/env node
+/**
+ * Sensor block dump
+ *
+ *   node scripts/sensor-block.js <block.bin>
+ *       Decode a sensor:block attachment and print one "t temperature humidity
+ *       soil_moisture" line per reading (t in device monotonic ms). Compare with
+ *       the readings esp32-firmware/bench/sensor_block_bench.cpp --write saved.
+ */
+
+const fs = require('fs');
+const { decode } = require('../lib/sensorBlock');
+
+if (process.argv.length !== 3) {
+  console.error('usage: sensor-block.js <block.bin>');
+  process.exit(2);
+}
+
+const block = fs.readFileSync(process.argv[2]);
+const readings = decode(block);
+readings.forEach((reading) => {
+  console.log(`${reading.t} ${reading.temperature} ${reading.humidity} ${reading.soil_moisture}`);
+});
+console.error(`${readings.length} readings in ${block.length} bytes`);
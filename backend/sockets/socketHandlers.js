@@ -5,12 +5,59 @@ const SensorReading = require('../models/SensorReading');
 const RelayState = require('../models/RelayState');
 const Rule = require('../models/Rule');
 const SystemLog = require('../models/SystemLog');
+const { deviceTimestamp, insertReadings } = require('../lib/sensorReadings');
+const otaReleases = require('../lib/otaReleases');
+const relayCommands = require('../lib/relayCommands');
+const sensorBlock = require('../lib/sensorBlock');
+const sensorHistory = require('../lib/sensorHistory');
+
+// ESP32 log level names → SystemLog level enum
+const ESP32_LOG_LEVELS = { error: 'error', warning: 'warning', warn: 'warning', info: 'info', debug: 'debug' };
+// Values accepted by the firmware log:level handler
+const LOG_LEVEL_VALUES = ['none', 'error', 'warning', 'info', 'debug', 0, 1, 2, 3, 4];
+// sensor:anomaly channels and kinds sent by the firmware (anomaly_detector.cpp)
+const SENSOR_ANOMALY_CHANNELS = ['temperature', 'humidity', 'soil_moisture'];
+const SENSOR_ANOMALY_KINDS = ['spike', 'drift_up', 'drift_down', 'stuck'];
+// link:recovery rungs sent by the firmware (link_recovery.cpp), cheapest first
+const LINK_RECOVERY_RUNGS = ['socket', 'tls', 'reassociate', 'wifi_restart', 'reboot'];
+// Keys accepted by the firmware config:set handler (ranges are enforced on the device, see runtime_config.cpp)
+const DEVICE_CONFIG_KEYS = [
+  'sensor_interval_ms', 'metrics_interval_ms', 'health_check_interval_ms',
+  'reconnect_interval_ms', 'auth_backoff_base_ms', 'auth_backoff_max_ms', 'log_forward_interval_ms',
+  'time_probe_interval_ms', 'memory_sample_interval_ms', 'max_temp_change', 'max_humidity_change',
+  // On-device heater/fan loops (climate_control.h); mode 0 = off, 1 = hysteresis, 2 = PID
+  'heater_mode', 'heater_setpoint', 'heater_kp', 'heater_ki', 'heater_kd',
+  'fan_mode', 'fan_setpoint', 'fan_kp', 'fan_ki', 'fan_kd', 'fan_humidity_max',
+  'control_band', 'control_window_ms', 'control_min_switch_ms'
+];
 
 // Variables that will be set from main server
 let io = null;
 let ESP32_AUTH_TOKEN = '';
 let evaluateSensorRules = async () => {};
 
+// Agronomic values the firmware derives from temperature and humidity (esp32-firmware/include/psychrometrics.h)
+const DERIVED_CLIMATE_KEYS = ['vpd', 'dew_point', 'absolute_humidity', 'outdoor_dew_point', 'absolute_humidity_delta'];
+
+function derivedClimate(data) {
+  const derived = {};
+  DERIVED_CLIMATE_KEYS.forEach((key) => {
+    if (typeof data[key] === 'number' && Number.isFinite(data[key])) {
+      derived[key] = data[key];
+    }
+  });
+  if (derived.dew_point !== undefined && typeof data.temperature === 'number') {
+    derived.dew_point_margin = Math.round((data.temperature - derived.dew_point) * 100) / 100;
+  }
+  return derived;
+}
+
+// Authenticated ESP32 sockets, optionally only the one registered as deviceId
+function esp32Sockets(deviceId) {
+  return Array.from(io.sockets.sockets.values()).filter((device) =>
+    device.authenticated && device.deviceType === 'esp32' && (!deviceId || device.deviceId === deviceId));
+}
+
 function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
   io = ioInstance;
   ESP32_AUTH_TOKEN = esp32Token;
@@ -93,6 +140,9 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
       */
       socket.deviceId = data.device_id;
       socket.deviceType = data.device_type;
+      socket.firmwareVersion = data.firmware_version;
+      socket.configRevision = data.config_revision;
+      socket.relayCount = Number.isInteger(data.relay_count) ? data.relay_count : 4;  // Firmware before the relay bank
       socket.authenticated = true;
 
       // Join device room for targeted messages
@@ -104,6 +154,9 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
         message: 'Authentication successful'
       });
 
+      // Resend relay commands the device has not acked (lost with the previous connection)
+      relayCommands.resume(socket, data.command_epoch, data.command_ack);
+
       // Initialize default relay states if they don't exist
       try {
         const RELAY_DEFAULTS = {
@@ -180,20 +233,23 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
         // Consulta a Open-Meteo solo si el cache está vencido (usar fetch nativo de Node 18+)
         const LAT_LA_PLATA = -34.9214;
         const LON_LA_PLATA = -57.9544;
-        let climateCache = io.climateCache || { value: null, error: null, timestamp: 0 };
+        let climateCache = io.climateCache || { value: null, temperature: null, error: null, timestamp: 0 };
         
         let ciudadHumidity = climateCache.value;
+        let ciudadTemperature = climateCache.temperature;
         let apiError = climateCache.error;
         const now = Date.now();
         
         if (!climateCache.timestamp || (now - climateCache.timestamp > 5 * 60 * 1000)) {
           try {
-            const url = `https://api.open-meteo.com/v1/forecast?latitude=${LAT_LA_PLATA}&longitude=${LON_LA_PLATA}&current_weather=true`;
+            const url = `https://api.open-meteo.com/v1/forecast?latitude=${LAT_LA_PLATA}&longitude=${LON_LA_PLATA}&current=temperature_2m,relative_humidity_2m`;
             const response = await fetch(url);
             const jsonData = await response.json();
-            ciudadHumidity = jsonData?.current_weather?.relative_humidity ?? null;
+            ciudadHumidity = jsonData?.current?.relative_humidity_2m ?? null;
+            ciudadTemperature = jsonData?.current?.temperature_2m ?? null;
             apiError = null;
             climateCache.value = ciudadHumidity;
+            climateCache.temperature = ciudadTemperature;
             climateCache.error = null;
             climateCache.timestamp = now;
             io.climateCache = climateCache;
@@ -212,18 +268,38 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
             sensor_humidity: humidityToUse,
             ciudad: 'La Plata',
             ciudad_humidity: ciudadHumidity,
+            ciudad_temperature: ciudadTemperature,
             api_error: apiError
           });
         }
 
-        const sensorReading = await SensorReading.create({
+        // Outdoor conditions for the device's indoor/outdoor deltas (VPD, dew point), once per refresh
+        if (socket.climateSentAt !== climateCache.timestamp) {
+          socket.climateSentAt = climateCache.timestamp;
+          socket.emit('sensor:climate', {
+            ciudad: 'La Plata',
+            ciudad_humidity: ciudadHumidity ?? -1,
+            ciudad_temperature: ciudadTemperature,
+            api_error: apiError
+          });
+        }
+
+        // Acquisition time from the device clock when it is synced, arrival time otherwise
+        const acquiredAt = deviceTimestamp(data.timestamp, now);
+        const [sensorReading] = await insertReadings([{
           device_id: data.device_id || 'ESP32_GREENHOUSE_01',
           temperature: data.temperature,
           humidity: humidityToUse,
           soil_moisture: data.soil_moisture,
           temp_errors: data.temp_errors || 0,
-          humidity_errors: data.humidity_errors || 0
-        });
+          humidity_errors: data.humidity_errors || 0,
+          ...derivedClimate(data),
+          timestamp: acquiredAt || new Date(now),
+          time_source: acquiredAt ? 'device' : 'server'
+        }]);
+        if (!sensorReading) {
+          return;  // Already stored (sent again after a reconnect)
+        }
 
         // Broadcast to all connected clients (dashboard)
         io.emit('sensor:new', sensorReading);
@@ -235,6 +311,145 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
       }
     });
 
+    // Streaming anomaly detectors on the ESP32 (CUSUM drift, EWMA z-score spike, stuck value)
+    socket.on('sensor:anomaly', async (data) => {
+      if (!checkSocketRateLimit(socket, 'sensor:anomaly')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+
+      const channel = SENSOR_ANOMALY_CHANNELS.includes(data?.channel) ? data.channel : null;
+      const kind = SENSOR_ANOMALY_KINDS.includes(data?.kind) ? data.kind : null;
+      if (!channel || !kind) {
+        return;
+      }
+      const deviceId = data.device_id || socket.deviceId;
+      const anomaly = {
+        device_id: deviceId,
+        channel,
+        kind,
+        value: data.value,
+        baseline: data.baseline,
+        sigma: data.sigma,
+        score: data.score,
+        timestamp: deviceTimestamp(data.timestamp, Date.now()) || new Date()
+      };
+      console.log(`⚠️ [ANOMALY] ${deviceId} ${channel} ${kind} | value ${data.value} | expected ${data.baseline}`);
+
+      io.emit('sensor:anomaly', anomaly);
+      try {
+        const log = await SystemLog.create({
+          level: 'warning',
+          source: 'esp32',
+          message: `Sensor anomaly: ${channel} ${kind}`,
+          metadata: anomaly
+        });
+        io.emit('log:new', log);
+      } catch (error) {
+        console.error('❌ [ERROR] Failed to save sensor anomaly:', error.message);
+      }
+    });
+
+    // Readings the device took while offline, as one compressed block (lib/sensorBlock.js).
+    // Stored for history only: rules and dashboards already moved on from them
+    socket.on('sensor:block', async (data) => {
+      if (!checkSocketRateLimit(socket, 'sensor:block')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+
+      const deviceId = data?.device_id || socket.deviceId;
+      let readings;
+      try {
+        readings = sensorBlock.decode(data?.block);
+      } catch (error) {
+        console.warn(`⚠️  [SENSOR_BLOCK] ${deviceId}: ${error.message}`);
+        return;
+      }
+      if (readings.length === 0 || typeof data.first_timestamp !== 'number') {
+        return;
+      }
+
+      const now = Date.now();
+      const toEpoch = sensorBlock.epochMapper(readings, data.first_timestamp, data.last_timestamp);
+      const documents = [];
+      readings.forEach((reading) => {
+        const acquiredAt = deviceTimestamp(toEpoch(reading.t), now);
+        if (acquiredAt) {
+          documents.push({
+            device_id: deviceId,
+            temperature: reading.temperature,
+            humidity: reading.humidity,
+            soil_moisture: reading.soil_moisture,
+            timestamp: acquiredAt,
+            time_source: 'device'
+          });
+        }
+      });
+      try {
+        const inserted = await insertReadings(documents);
+        console.log(`📦 [SENSOR_BLOCK] ${deviceId}: ${inserted.length} of ${readings.length} offline readings stored (${data.block.length} bytes)`);
+      } catch (error) {
+        console.error('❌ [ERROR] Failed to save sensor block:', error.message);
+      }
+    });
+
+    // Answer to a sensor:history query relayed from a dashboard; forwarded, decoded, to the socket that asked
+    socket.on('sensor:history:chunk', (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32' || !data) {
+        return;
+      }
+      const requester = sensorHistory.requesterOf(data.request_id, data.done === true);
+      if (!requester) {
+        return;
+      }
+      const reply = {
+        success: !data.error,
+        request_id: data.request_id,
+        device_id: socket.deviceId,
+        seq: data.seq,
+        done: data.done === true,
+        data: []
+      };
+      if (data.error) {
+        reply.error = data.error;
+      } else if (data.data) {
+        try {
+          reply.data = sensorHistory.decodeBuckets(data.data, data.from, data.step);
+        } catch (error) {
+          reply.success = false;
+          reply.error = error.message;
+        }
+      }
+      if (reply.done) {
+        console.log(`📈 [HISTORY] ${socket.deviceId}: ${data.readings ?? 0} readings, ${data.records ?? 0} records read${data.error ? ` (${data.error})` : ''}`);
+      }
+      requester.emit('sensor:history:chunk', reply);
+    });
+
+    // Cumulative ack of sequenced relay:command events (lib/relayCommands.js).
+    // Not rate limited: a dropped ack only turns into a retransmit.
+    socket.on('relay:ack', (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32' || !data) {
+        return;
+      }
+      relayCommands.acknowledge(socket, data);
+    });
+
     // Relay state update from ESP32
     socket.on('relay:state', async (data) => {
       // Check rate limit
@@ -318,26 +533,345 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
       }
     });
 
-    // Ping/Pong for keepalive
+    // Batched logs from ESP32 (rate-limited and deduplicated on the device)
+    socket.on('log:batch', async (data) => {
+      if (!checkSocketRateLimit(socket, 'log:batch')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+
+      const entries = Array.isArray(data?.logs) ? data.logs.slice(0, 32) : [];
+      const deviceId = data?.device_id || socket.deviceId;
+      const docs = entries
+        .filter((entry) => entry && typeof entry.message === 'string' && entry.message.length > 0)
+        .map((entry) => ({
+          level: ESP32_LOG_LEVELS[entry.level] || 'info',
+          source: 'esp32',
+          message: entry.message.substring(0, 500),
+          metadata: {
+            device_id: deviceId,
+            device_ts: entry.ts,
+            ...(entry.count > 1 ? { count: entry.count } : {})
+          }
+        }));
+
+      if (data?.dropped > 0) {
+        console.log(`⚠️ [ESP32-LOG] ${deviceId} rate limiter dropped ${data.dropped} log records`);
+      }
+      if (docs.length === 0) {
+        return;
+      }
+
+      for (const doc of docs) {
+        if (doc.level === 'warning' || doc.level === 'error') {
+          console.log(`⚠️ [ESP32-${doc.level.toUpperCase()}]`, doc.message);
+        }
+      }
+
+      try {
+        const saved = await SystemLog.insertMany(docs);
+        saved.forEach((log) => io.emit('log:new', log));
+      } catch (error) {
+        console.error('❌ [ERROR] Failed to save ESP32 log batch to database:', error.message);
+        console.error('   Batch size:', docs.length, '| Device:', deviceId);
+      }
+    });
+
+    // Runtime log level: dashboard → ESP32 command, ESP32 → dashboard confirmation
+    socket.on('log:level', (data) => {
+      if (!checkSocketRateLimit(socket, 'log:level')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+
+      if (socket.authenticated && socket.deviceType === 'esp32') {
+        io.emit('log:level:changed', {
+          device_id: data?.device_id || socket.deviceId,
+          level: data?.level,
+          remote: data?.remote,
+          timestamp: new Date()
+        });
+        return;
+      }
+
+      const command = {};
+      if (data?.level !== undefined) command.level = data.level;
+      if (data?.remote !== undefined) command.remote = data.remote;
+      const valid = Object.values(command).every((value) => LOG_LEVEL_VALUES.includes(value));
+      if (Object.keys(command).length === 0 || !valid) {
+        socket.emit('log:level', {
+          success: false,
+          error: `level/remote must be one of: ${LOG_LEVEL_VALUES.join(', ')}`
+        });
+        return;
+      }
+
+      io.to('esp32_devices').emit('log:level', command);
+      console.log(`📝 [LOG_LEVEL] Requested serial=${command.level ?? '-'} remote=${command.remote ?? '-'}`);
+      socket.emit('log:level', { success: true, data: command });
+    });
+
+    // Runtime configuration: dashboard → ESP32 config:set/config:get, ESP32 → dashboard config:state
+    socket.on('config:set', (data) => {
+      if (!checkSocketRateLimit(socket, 'config:set')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+
+      const command = {};
+      if (data?.reset === true) {
+        command.reset = true;
+      } else {
+        for (const key of DEVICE_CONFIG_KEYS) {
+          if (data?.[key] !== undefined) command[key] = data[key];
+        }
+      }
+      const valid = Object.entries(command).every(([key, value]) => key === 'reset' || (typeof value === 'number' && Number.isFinite(value)));
+      if (Object.keys(command).length === 0 || !valid) {
+        socket.emit('config:set', {
+          success: false,
+          error: `reset: true or numeric values for: ${DEVICE_CONFIG_KEYS.join(', ')}`
+        });
+        return;
+      }
+
+      const devices = esp32Sockets(data.device_id);
+      devices.forEach((device) => device.emit('config:set', command));
+      console.log(`⚙️ [CONFIG] config:set ${JSON.stringify(command)} → ${devices.length} device(s)`);
+      socket.emit('config:set', { success: true, data: command, count: devices.length });
+    });
+
+    socket.on('config:get', (data) => {
+      if (!checkSocketRateLimit(socket, 'config:get')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+
+      const devices = esp32Sockets(data?.device_id);
+      devices.forEach((device) => device.emit('config:get', {}));
+      socket.emit('config:get', { success: true, count: devices.length });
+    });
+
+    socket.on('config:state', async (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+      socket.configRevision = data?.revision;
+      io.emit('config:changed', { ...data, device_id: socket.deviceId, timestamp: new Date() });
+      if (Array.isArray(data?.rejected) && data.rejected.length > 0) {
+        // The device lists the first few keys and counts them all
+        const count = Number.isInteger(data.rejected_count) ? data.rejected_count : data.rejected.length;
+        const more = count > data.rejected.length ? ` (+${count - data.rejected.length} more)` : '';
+        try {
+          await SystemLog.create({
+            level: 'warning',
+            message: `ESP32 ${socket.deviceId} rejected ${count} config key(s): ${data.rejected.join(', ')}${more}`,
+            metadata: { device_id: socket.deviceId, revision: data.revision, rejected: data.rejected, rejected_count: count }
+          });
+        } catch (error) {
+          console.error('❌ [ERROR] Failed to log config:state:', error.message);
+        }
+      }
+    });
+
+    // Clock offset probe: t0 is echoed with the server clock so the device can estimate its offset.
+    // Liveness is Engine.IO's own ping/pong (pingInterval/pingTimeout), not an event
+    socket.on('time:sync', (data) => {
+      const reply = { server_time: Date.now() };
+      if (typeof data?.t0 === 'number') {
+        reply.t0 = data.t0;
+      }
+      socket.emit('time:sync', reply);
+    });
+
+    // Legacy keepalive + offset probe from firmware that predates time:sync
     socket.on('ping', (data) => {
-      // Silent ping/pong - no log spam
-      socket.emit('pong', { timestamp: new Date() });
+      const pong = { timestamp: new Date(), server_time: Date.now() };
+      if (typeof data?.t0 === 'number') {
+        pong.t0 = data.t0;
+      }
+      socket.emit('pong', pong);
     });
 
     // ESP32 metrics reporting
     socket.on('metrics', (data) => {
       // Store metrics on socket for access via health endpoint
       if (socket.authenticated && socket.deviceType === 'esp32') {
-        socket.metrics = data;
+        if (!data || typeof data.series !== 'object' || data.series === null) {
+          return;
+        }
+        // Frames are delta-encoded: only changed series are sent, and a full
+        // frame (periodic, or after every reconnect) resets the view
+        if (data.full || !socket.metricSeries) {
+          socket.metricSeries = {};
+        }
+        Object.assign(socket.metricSeries, data.series);
+        socket.metrics = { ...socket.metricSeries, memory: data.memory, seq: data.seq };
+
         // Log significant metrics updates
-        if (data.authFailures > 0 || data.reconnections > 5) {
-          console.log(`📊 [METRICS] ${socket.deviceId} - Reconnections: ${data.reconnections}, Auth Failures: ${data.authFailures}, Uptime: ${data.uptimeSeconds}s`);
+        const series = socket.metricSeries;
+        const authFailures = series.ws_auth_failures_total || 0;
+        const reconnections = series.ws_reconnections_total || 0;
+        if (authFailures > 0 || reconnections > 5) {
+          console.log(`📊 [METRICS] ${socket.deviceId} - Reconnections: ${reconnections}, Auth Failures: ${authFailures}, Uptime: ${series.uptime_seconds}s`);
+        }
+        // Heap telemetry: warn when the device entered low-memory shedding
+        if (data.memory && (data.memory.low || data.memory.low_events > 0)) {
+          console.log(`⚠️ [METRICS] ${socket.deviceId} - Low memory: min ever ${data.memory.min_ever} bytes, shed ${data.memory.shed} items`);
+        }
+      }
+    });
+
+    // ESP32 boot timeline: sent once per boot, on the first connection after ready
+    socket.on('device:boot', (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+      if (!data || typeof data.phases !== 'object' || data.phases === null) {
+        return;
+      }
+
+      // Milliseconds since reset at which each boot phase completed
+      socket.bootReport = { phases: data.phases, firmware_version: data.firmware_version, received_at: new Date() };
+      const { first_reading: firstReading, ready } = data.phases;
+      console.log(`🚀 [BOOT] ${socket.deviceId} - First reading: ${firstReading ?? '-'} ms, Ready: ${ready ?? '-'} ms`);
+    });
+
+    // The device's recovery ladder ended an outage: which rung did it and how long it took
+    socket.on('link:recovery', async (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+      const rung = LINK_RECOVERY_RUNGS.includes(data?.rung) ? data.rung : null;
+      if (!rung) {
+        return;
+      }
+      const recovery = {
+        device_id: socket.deviceId,
+        rung,
+        recovery_ms: data.recovery_ms,
+        outage_ms: data.outage_ms
+      };
+      console.log(`🔌 [RECOVERY] ${socket.deviceId} - ${rung} after ${Math.round((data.outage_ms || 0) / 1000)} s, back in ${data.recovery_ms ?? '-'} ms`);
+
+      try {
+        const log = await SystemLog.create({
+          level: rung === 'reboot' ? 'warning' : 'info',
+          source: 'esp32',
+          message: `Link recovered by ${rung}`,
+          metadata: recovery
+        });
+        io.emit('log:new', log);
+      } catch (error) {
+        console.error('❌ [ERROR] Failed to save link recovery:', error.message);
+      }
+    });
+
+    // Delta OTA: the device pulls the offered patch in chunks (binary attachments)
+    socket.on('ota:pull', (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32') {
+        return;
+      }
+      const chunk = otaReleases.readChunk(data?.id, data?.offset, data?.length);
+      if (!chunk) {
+        console.log(`⚠️ [OTA] ${socket.deviceId} pulled unknown offer or range: ${data?.id} @ ${data?.offset}`);
+        return;
+      }
+      socket.emit('ota:chunk', { id: data.id, offset: data.offset, data: chunk });
+    });
+
+    socket.on('ota:status', async (data) => {
+      if (!socket.authenticated || socket.deviceType !== 'esp32' || !data) {
+        return;
+      }
+      socket.otaStatus = { ...data, received_at: new Date() };
+      io.emit('ota:progress', { ...data, device_id: socket.deviceId });
+
+      if (data.state === 'downloading') {
+        return;
+      }
+      const summary = `${data.state}${data.error ? ` (${data.error})` : ''}`;
+      console.log(`📦 [OTA] ${socket.deviceId} v${data.version ?? '-'}: ${summary} | ${data.bytes_received ?? 0}/${data.patch_size ?? 0} patch bytes, ${data.target_size ?? 0} byte image, apply ${data.apply_ms ?? '-'} ms, total ${data.transfer_ms ?? '-'} ms`);
+
+      // The running image is not the release we diffed against: send the whole image instead
+      const offer = otaReleases.getOffer(data.id);
+      if (data.state === 'failed' && data.error === 'source_mismatch' && offer) {
+        try {
+          const full = otaReleases.createOffer(socket.deviceId, socket.firmwareVersion, offer.version, { full: true });
+          socket.emit('ota:offer', full);
+          console.log(`📦 [OTA] ${socket.deviceId}: source mismatch, offering the full ${full.patch_size} byte image`);
+        } catch (error) {
+          console.error('❌ [ERROR] Failed to create full OTA offer:', error.message);
+        }
+      }
+
+      if (data.state === 'applied' || data.state === 'failed' || data.state === 'rejected') {
+        try {
+          await SystemLog.create({
+            level: data.state === 'applied' ? 'info' : 'warning',
+            source: 'esp32',
+            message: `OTA ${data.version ?? data.id} ${summary} on ${socket.deviceId}`,
+            metadata: data
+          });
+        } catch (error) {
+          console.error('❌ [ERROR] Failed to save OTA status:', error.message);
         }
       }
     });
 
     // ====== Dashboard Real-time Events (WebSocket Modern API) ======
 
+    // Offer a firmware release to connected devices (all, or the one in device_id)
+    socket.on('ota:deploy', (data) => {
+      if (!checkSocketRateLimit(socket, 'ota:deploy')) {
+        socket.emit('error', {
+          message: 'Rate limit exceeded. Please slow down.',
+          code: 'RATE_LIMIT_EXCEEDED'
+        });
+        return;
+      }
+      if (!otaReleases.validVersion(data?.version)) {
+        socket.emit('ota:deploy', { success: false, error: 'version is required' });
+        return;
+      }
+
+      const devices = esp32Sockets(data.device_id);
+      const offers = [];
+      try {
+        for (const device of devices) {
+          if (device.firmwareVersion === data.version) {
+            continue;
+          }
+          const offer = otaReleases.createOffer(device.deviceId, device.firmwareVersion, data.version, { full: data.full === true });
+          device.emit('ota:offer', offer);
+          offers.push({ device_id: device.deviceId, from: device.firmwareVersion, ...offer });
+          console.log(`📦 [OTA] Offered v${offer.version} to ${device.deviceId} (from v${device.firmwareVersion}): ${offer.patch_size} byte ${offer.source_size ? 'delta' : 'full image'} for ${offer.target_size} bytes`);
+        }
+      } catch (error) {
+        console.error('❌ [ERROR] Failed to create OTA offer:', error.message);
+        socket.emit('ota:deploy', { success: false, error: error.message });
+        return;
+      }
+      socket.emit('ota:deploy', { success: true, data: offers, count: offers.length });
+    });
+
+
     // Request log list with optional filters
     socket.on('log:list', async (data) => {
       try {
@@ -568,6 +1102,21 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
         }
 
         const { relay_id, state, mode = 'manual', changed_by = 'user' } = data;
+        if (!Number.isInteger(relay_id) || relay_id < 0 || relay_id > RelayState.MAX_RELAY_ID) {
+          socket.emit('relay:command', {
+            success: false,
+            error: `relay_id must be an integer between 0 and ${RelayState.MAX_RELAY_ID}`
+          });
+          return;
+        }
+        const devices = esp32Sockets();
+        if (devices.length > 0 && devices.every((device) => relay_id >= device.relayCount)) {
+          socket.emit('relay:command', {
+            success: false,
+            error: `No connected device has relay ${relay_id}`
+          });
+          return;
+        }
 
         // Save relay state change
         const relayState = await RelayState.findOneAndUpdate(
@@ -584,8 +1133,8 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
         // Broadcast state change to all clients
         io.emit('relay:changed', relayState);
 
-        // Send command to ESP32 device
-        io.to('esp32_devices').emit('relay:command', {
+        // Send command to ESP32 devices (sequenced, resent until acked)
+        relayCommands.broadcast(io, {
           relay_id,
           state,
           mode
@@ -664,6 +1213,25 @@ function setupSocketHandlers(ioInstance, esp32Token, evaluateSensorRulesFn) {
           return;
         }
 
+        // From the device's own flash (lib/sensorHistory.js): aggregated buckets, streamed as sensor:history:chunk
+        if (data?.source === 'device') {
+          const devices = esp32Sockets(data.device_id);
+          if (devices.length === 0) {
+            socket.emit('sensor:history:chunk', { success: false, error: 'device not connected' });
+            return;
+          }
+          const to = typeof data.to === 'number' ? data.to : Date.now();
+          const query = {
+            request_id: sensorHistory.track(socket, devices[0].deviceId),
+            from: typeof data.from === 'number' ? data.from : to - 24 * 60 * 60 * 1000,
+            to,
+            step: typeof data.step === 'number' ? data.step : 60 * 60 * 1000
+          };
+          devices[0].emit('sensor:history', query);
+          socket.emit('sensor:history', { success: true, source: 'device', device_id: devices[0].deviceId, ...query });
+          return;
+        }
+
         const limit = data?.limit || 100;
         const startDate = data?.startDate ? new Date(data.startDate) : new Date(Date.now() - 24 * 60 * 60 * 1000);
         const endDate = data?.endDate ? new Date(data.endDate) : new Date();
@@ -0,0 +1,207 @@
+// Host check for the streaming anomaly detectors: feeds AnomalyDetector synthetic
+// greenhouse readings (diurnal swing, sensor noise, irrigation cycles) and reports
+// false alarms on a quiet run and the detection delay of injected faults.
+//
+//   pio run -e native-anomaly
+//   .pio/build/native-anomaly/program [--days 7] [--seed 1] [--quantize]
+//
+// --quantize rounds readings to DHT11 steps: 0.1 °C and 1 %RH.
+// Exits 1 on any false alarm or missed fault.
+
+#include <Arduino.h>
+#include "anomaly_detector.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+const uint64_t SAMPLE_MS = SENSOR_READ_INTERVAL_MS;
+const uint64_t HOUR_MS = 3600000ULL;
+const uint64_t WARMUP_MS = 6 * HOUR_MS;     // Quiet time before a fault is injected
+const uint64_t OBSERVE_MS = 8 * HOUR_MS;    // Time allowed to detect it
+const float PI_F = 3.14159265f;
+
+std::vector<AnomalyEvent> events;
+
+void collect(const AnomalyEvent& event) {
+    events.push_back(event);
+}
+
+enum Fault {
+    FAULT_NONE,
+    FAULT_HEATER,       // Heater holding 18 °C at night dies: exponential fall toward outside
+    FAULT_STUCK_DHT,    // DHT keeps returning its last frame
+    FAULT_DRY_PROBE,    // Soil probe pulled out: reading falls to the 0 % clamp in 20 min
+    FAULT_GLITCH        // One temperature reading 4 °C off (inside the per-read step gate)
+};
+
+struct Scenario {
+    const char* name;
+    Fault fault;
+    AnomalyChannel channel;
+    uint8_t expectedKinds;  // Any of these counts as a detection
+};
+
+const Scenario SCENARIOS[] = {
+    {"heater failure", FAULT_HEATER, ANOMALY_CHANNEL_TEMPERATURE, 1 << ANOMALY_DRIFT_DOWN},
+    {"stuck DHT", FAULT_STUCK_DHT, ANOMALY_CHANNEL_TEMPERATURE, 1 << ANOMALY_STUCK},
+    {"dry soil probe", FAULT_DRY_PROBE, ANOMALY_CHANNEL_SOIL,
+     (1 << ANOMALY_SPIKE) | (1 << ANOMALY_DRIFT_DOWN) | (1 << ANOMALY_STUCK)},
+    {"glitch", FAULT_GLITCH, ANOMALY_CHANNEL_TEMPERATURE, 1 << ANOMALY_SPIKE},
+};
+
+/**
+ * Greenhouse readings: temperature and humidity follow the day, the soil dries
+ * and is irrigated back (a relay change) when it falls below 30 %.
+ */
+class Signal {
+public:
+    Signal(unsigned seed, bool quantize) : _rng(seed), _noise(0.0f, 0.15f), _quantize(quantize), _soil(55.0f) {}
+
+    SensorData sample(uint64_t nowMs, AnomalyDetector& detector, Fault fault, uint64_t faultMs) {
+        float hour = fmodf(nowMs / (float)HOUR_MS + 6.0f, 24.0f);
+        float phase = 2.0f * PI_F * (hour - 9.0f) / 24.0f;
+        float temperature = 19.0f + 5.0f * sinf(phase);
+        float humidity = 65.0f - 12.0f * sinf(phase);
+
+        // Irrigation: 3 %/min while the pump runs, drying otherwise
+        float dtS = SAMPLE_MS / 1000.0f;
+        if (_pumping) {
+            _soil += 0.05f * dtS;
+            if (_soil >= 60.0f) {
+                _pumping = false;
+                detector.actuatorChanged(nowMs);
+            }
+        } else {
+            _soil -= (1.0f + 0.5f * fmaxf(0.0f, sinf(phase))) / 3600.0f * dtS;
+            if (_soil < 30.0f) {
+                _pumping = true;
+                detector.actuatorChanged(nowMs);
+            }
+        }
+        float soil = _soil + _noise(_rng);
+
+        bool faulted = fault != FAULT_NONE && nowMs >= faultMs;
+        float sinceS = faulted ? (nowMs - faultMs) / 1000.0f : 0.0f;
+        if (fault == FAULT_HEATER) {
+            // Night with the heater on: held at 18 °C; afterwards the house falls toward 8 °C (1 h)
+            temperature = faulted ? 8.0f + 10.0f * expf(-sinceS / 3600.0f) : 18.0f;
+        } else if (fault == FAULT_DRY_PROBE && faulted) {
+            soil = fmaxf(0.0f, _soil * (1.0f - sinceS / 1200.0f) + (sinceS < 1200.0f ? _noise(_rng) : 0.0f));
+        } else if (fault == FAULT_GLITCH && faulted && nowMs < faultMs + SAMPLE_MS) {
+            temperature += 4.0f;
+        }
+
+        SensorData data = {};
+        data.temperature = read(temperature, 0.1f);
+        data.humidity = read(humidity, 1.0f);
+        data.soil_moisture = soil;
+        data.acquired_ms = nowMs;
+        data.valid = true;
+        if (fault == FAULT_STUCK_DHT && faulted) {
+            data.temperature = _lastTemperature;
+            data.humidity = _lastHumidity;
+        }
+        _lastTemperature = data.temperature;
+        _lastHumidity = data.humidity;
+        return data;
+    }
+
+private:
+    std::mt19937 _rng;
+    std::normal_distribution<float> _noise;
+    bool _quantize;
+    bool _pumping = false;
+    float _soil;
+    float _lastTemperature = 0.0f;
+    float _lastHumidity = 0.0f;
+
+    float read(float value, float step) {
+        value += _noise(_rng);
+        return _quantize ? roundf(value / step) * step : value;
+    }
+};
+
+void printEvent(const AnomalyEvent& event, uint64_t originMs) {
+    printf("    %-13s %-10s at %7.1f min  value %.2f  baseline %.2f  score %.1f\n",
+           AnomalyDetector::channelName(event.channel), AnomalyDetector::kindName(event.kind),
+           ((int64_t)event.acquiredMs - (int64_t)originMs) / 60000.0, event.value, event.baseline, event.score);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    double days = 7.0;
+    unsigned seed = 1;
+    bool quantize = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--quantize") == 0) {
+            quantize = true;
+        } else {
+            fprintf(stderr, "usage: %s [--days N] [--seed N] [--quantize]\n", argv[0]);
+            return 2;
+        }
+    }
+    int failures = 0;
+
+    printf("\n=== Anomaly detection (%s readings every %llu s) ===\n", quantize ? "quantized" : "float",
+           (unsigned long long)(SAMPLE_MS / 1000));
+
+    // Quiet run: every detection is a false alarm
+    {
+        AnomalyDetector detector;
+        detector.onAnomaly(collect);
+        events.clear();
+        Signal signal(seed, quantize);
+        uint64_t endMs = (uint64_t)(days * 24 * HOUR_MS);
+        for (uint64_t now = SAMPLE_MS; now <= endMs; now += SAMPLE_MS) {
+            detector.observe(signal.sample(now, detector, FAULT_NONE, 0));
+        }
+        printf("quiet %.1f days     %zu false alarm(s)\n", days, events.size());
+        for (size_t i = 0; i < events.size() && i < 10; i++) {
+            printEvent(events[i], 0);
+        }
+        failures += events.size() > 0;
+    }
+
+    for (const Scenario& scenario : SCENARIOS) {
+        AnomalyDetector detector;
+        detector.onAnomaly(collect);
+        events.clear();
+        Signal signal(seed, quantize);
+        uint64_t faultMs = WARMUP_MS;
+        for (uint64_t now = SAMPLE_MS; now <= faultMs + OBSERVE_MS; now += SAMPLE_MS) {
+            detector.observe(signal.sample(now, detector, scenario.fault, faultMs));
+        }
+
+        const AnomalyEvent* detection = nullptr;
+        size_t falseAlarms = 0;
+        for (const AnomalyEvent& event : events) {
+            if (event.acquiredMs < faultMs) {
+                falseAlarms++;
+            } else if (!detection && event.channel == scenario.channel &&
+                       (scenario.expectedKinds & (1 << event.kind))) {
+                detection = &event;
+            }
+        }
+        char delay[32] = "MISSED";
+        if (detection) {
+            snprintf(delay, sizeof(delay), "%.1f min (%s)", (detection->acquiredMs - faultMs) / 60000.0,
+                     AnomalyDetector::kindName(detection->kind));
+        }
+        printf("%-18s %s, %zu false alarm(s) before the fault\n", scenario.name, delay, falseAlarms);
+        for (const AnomalyEvent& event : events) {
+            printEvent(event, faultMs);
+        }
+        failures += !detection || falseAlarms > 0;
+    }
+
+    printf("result             %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
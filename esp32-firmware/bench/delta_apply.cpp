@@ -0,0 +1,220 @@
+// Host check for the OTA patch engine: applies a patch made by backend/lib/otaDelta.js
+// with the firmware's DeltaPatcher, fed in OTA_CHUNK_SIZE pieces under the same output
+// budget as OtaUpdater, and reports size, apply time and memory.
+//
+//   node backend/scripts/ota-release.js --delta old.bin new.bin old-new.ghdp
+//   pio run -e native-delta
+//   .pio/build/native-delta/program old.bin old-new.ghdp --target new.bin [--fuzz 200]
+//
+// Pass "-" as the source for a full-image patch.
+
+#include <Arduino.h>
+#include <hal_native.h>
+#include "config.h"
+#include "delta_patch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return true;
+}
+
+class VectorSource : public DeltaSource {
+public:
+    explicit VectorSource(const std::vector<uint8_t>& data) : _data(data) {}
+    bool read(uint32_t offset, uint8_t* buffer, size_t length) override {
+        if ((uint64_t)offset + length > _data.size()) {
+            return false;
+        }
+        memcpy(buffer, _data.data() + offset, length);
+        return true;
+    }
+private:
+    const std::vector<uint8_t>& _data;
+};
+
+class VectorSink : public DeltaSink {
+public:
+    std::vector<uint8_t> data;
+    size_t writes = 0;
+    bool write(const uint8_t* bytes, size_t length) override {
+        data.insert(data.end(), bytes, bytes + length);
+        writes++;
+        return true;
+    }
+};
+
+struct ApplyResult {
+    DeltaStatus status;
+    double totalMs;
+    double maxStepMs;   // Longest single feed() call: what one loop iteration costs
+    size_t steps;
+};
+
+// Same call pattern as OtaUpdater: one chunk at a time, budgeted feed() calls
+ApplyResult apply(DeltaPatcher& patcher, const std::vector<uint8_t>& source, const std::vector<uint8_t>& patch,
+                  VectorSink& sink, size_t chunkSize, size_t budget) {
+    typedef std::chrono::steady_clock Clock;
+    VectorSource reader(source);
+    patcher.begin(&reader, &sink);
+    ApplyResult result = {DELTA_OK, 0.0, 0.0, 0};
+
+    for (size_t offset = 0; offset < patch.size() && patcher.status() <= DELTA_DONE; offset += chunkSize) {
+        size_t length = std::min(chunkSize, patch.size() - offset);
+        size_t pos = 0;
+        do {
+            Clock::time_point start = Clock::now();
+            pos += patcher.feed(patch.data() + offset + pos, length - pos, budget);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            result.totalMs += ms;
+            result.maxStepMs = std::max(result.maxStepMs, ms);
+            result.steps++;
+        } while ((pos < length || patcher.hasPendingOutput()) && patcher.status() <= DELTA_DONE);
+    }
+    Clock::time_point start = Clock::now();
+    result.status = patcher.finish();
+    result.totalMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return result;
+}
+
+// Flip random bytes in the patch body: the patcher must fail cleanly (or, rarely,
+// produce some image that the SHA-256 check on the device would reject)
+int fuzz(const std::vector<uint8_t>& source, const std::vector<uint8_t>& patch, int rounds) {
+    static DeltaPatcher patcher;
+    std::mt19937 rng(12345);
+    int rejected = 0;
+    int accepted = 0;
+    for (int round = 0; round < rounds; round++) {
+        std::vector<uint8_t> corrupt = patch;
+        int flips = 1 + (int)(rng() % 4);
+        for (int f = 0; f < flips; f++) {
+            size_t at = DELTA_HEADER_SIZE + rng() % (corrupt.size() - DELTA_HEADER_SIZE);
+            corrupt[at] ^= (uint8_t)(1 + rng() % 255);
+        }
+        if (round % 8 == 7) {
+            corrupt.resize(DELTA_HEADER_SIZE + rng() % (corrupt.size() - DELTA_HEADER_SIZE));  // Truncated
+        }
+        VectorSink sink;
+        ApplyResult result = apply(patcher, source, corrupt, sink, OTA_CHUNK_SIZE, OTA_APPLY_BUDGET_BYTES);
+        if (result.status == DELTA_DONE) {
+            accepted++;
+        } else {
+            rejected++;
+        }
+        if (sink.data.size() > patcher.targetSize()) {
+            printf("fuzz: round %d wrote %zu bytes past the target size\n", round, sink.data.size());
+            return 1;
+        }
+    }
+    printf("fuzz:    %d corrupted patches, %d rejected, %d decoded to some image (caught by the SHA-256 check)\n",
+           rounds, rejected, accepted);
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* sourcePath = nullptr;
+    const char* patchPath = nullptr;
+    const char* targetPath = nullptr;
+    const char* outPath = nullptr;
+    size_t chunkSize = OTA_CHUNK_SIZE;
+    size_t budget = OTA_APPLY_BUDGET_BYTES;
+    int fuzzRounds = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
+            targetPath = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunkSize = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzzRounds = atoi(argv[++i]);
+        } else if (!sourcePath) {
+            sourcePath = argv[i];
+        } else if (!patchPath) {
+            patchPath = argv[i];
+        } else {
+            sourcePath = nullptr;
+            break;
+        }
+    }
+    if (!sourcePath || !patchPath) {
+        fprintf(stderr,
+                "usage: %s <source.bin|-> <patch.ghdp> [--target new.bin] [--out rebuilt.bin] [--chunk N] [--budget N] "
+                "[--fuzz N]\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> source;
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> expected;
+    if ((strcmp(sourcePath, "-") != 0 && !readFile(sourcePath, source)) || !readFile(patchPath, patch) ||
+        (targetPath && !readFile(targetPath, expected))) {
+        fprintf(stderr, "cannot read input files\n");
+        return 2;
+    }
+
+    // Static like the firmware's OtaUpdater, so the heap count covers the apply path only
+    static DeltaPatcher patcher;
+    VectorSink sink;
+    if (patch.size() >= DELTA_HEADER_SIZE) {
+        // Target size from the header: the sink then never reallocates while applying
+        sink.data.reserve((uint32_t)patch[12] | ((uint32_t)patch[13] << 8) | ((uint32_t)patch[14] << 16) |
+                          ((uint32_t)patch[15] << 24));
+    }
+    hal::HeapStats before = hal::heapStats();
+    ApplyResult result = apply(patcher, source, patch, sink, chunkSize, budget);
+    hal::HeapStats after = hal::heapStats();
+
+    printf("source:  %zu bytes\n", source.size());
+    printf("patch:   %zu bytes (%.2f%% of the %u byte target)\n", patch.size(),
+           patcher.targetSize() ? 100.0 * patch.size() / patcher.targetSize() : 0.0, (unsigned)patcher.targetSize());
+    printf("apply:   %.2f ms total, %.3f ms max per step (%zu steps, chunk %zu, budget %zu), %.1f MB/s\n",
+           result.totalMs, result.maxStepMs, result.steps, chunkSize, budget,
+           result.totalMs > 0 ? sink.data.size() / 1000.0 / result.totalMs : 0.0);
+    printf("memory:  %zu bytes of patcher state, %zu sink writes, %llu heap allocations while applying\n",
+           sizeof(DeltaPatcher), sink.writes, (unsigned long long)(after.allocations - before.allocations));
+    printf("status:  %s\n", DeltaPatcher::statusName(result.status));
+
+    int exitCode = result.status == DELTA_DONE ? 0 : 1;
+    if (targetPath) {
+        bool match = sink.data == expected;
+        printf("target:  %s\n", match ? "identical" : "MISMATCH");
+        if (!match) {
+            exitCode = 1;
+        }
+    }
+    if (outPath) {
+        FILE* file = fopen(outPath, "wb");
+        if (!file || fwrite(sink.data.data(), 1, sink.data.size(), file) != sink.data.size()) {
+            fprintf(stderr, "cannot write %s\n", outPath);
+            exitCode = 1;
+        }
+        if (file) {
+            fclose(file);
+        }
+    }
+    if (fuzzRounds > 0 && patch.size() > DELTA_HEADER_SIZE && fuzz(source, patch, fuzzRounds) != 0) {
+        exitCode = 1;
+    }
+    return exitCode;
+}
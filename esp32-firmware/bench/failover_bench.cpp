@@ -0,0 +1,204 @@
+// Endpoint failover benchmark for the native build: runs the real setup()/loop()
+// against several local Socket.IO stand-ins (one per VPS_ENDPOINTS entry it
+// starts) and times failover and fail back while the primary is killed,
+// restarted and frozen. The last endpoint is never started, so it must show up
+// as unhealthy and never be selected. Exits non-zero if a phase misses its bound.
+//
+//   pio run -e native-failover
+//   .pio/build/native-failover/program --max-failover 15
+//
+// Phases:
+//   kill     primary process killed: connections refused (probe failures)
+//   restart  primary back: fail back after ENDPOINT_FAILBACK_HOLD_MS
+//   freeze   primary stopped (SIGSTOP): TCP still accepted by the kernel, no
+//            WebSocket; found by the Engine.IO ping timeout and the connect timeout
+
+#include <Arduino.h>
+#include <hal_native.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "vps_websocket.h"
+#include <lwip/sockets.h>
+
+void setup();
+void loop();
+
+extern VPSWebSocketClient vpsWebSocket;
+
+namespace {
+
+const char* standinPath = "scripts/socketio_standin.py";
+pid_t standins[ENDPOINT_MAX];
+
+int32_t gaugeValue(const char* name) {
+    Metric* metric = MetricsRegistry::find(name);
+    return metric && metric->type() == METRIC_GAUGE ? static_cast<Gauge*>(metric)->value() : 0;
+}
+
+uint32_t counterValue(const char* name) {
+    Metric* metric = MetricsRegistry::find(name);
+    return metric && metric->type() == METRIC_COUNTER ? static_cast<Counter*>(metric)->value() : 0;
+}
+
+bool listening(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0;
+    close(fd);
+    return ok;
+}
+
+bool startStandin(uint8_t index) {
+    const BackendEndpoint& endpoint = vpsWebSocket.endpoints().endpoint(index);
+    char port[8];
+    snprintf(port, sizeof(port), "%u", (unsigned)endpoint.port);
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Short Engine.IO heartbeat so a frozen server is noticed within seconds
+        execlp("python3", "python3", standinPath, "--port", port, "--quiet", "--report", "0", "--ping-interval",
+               "2000", "--ping-timeout", "2000", (char*)nullptr);
+        _exit(127);
+    }
+    standins[index] = pid;
+    for (int i = 0; i < 100 && !listening(endpoint.port); i++) {
+        usleep(50000);
+    }
+    return listening(endpoint.port);
+}
+
+void stopStandin(uint8_t index) {
+    if (standins[index] > 0) {
+        kill(standins[index], SIGCONT);
+        kill(standins[index], SIGKILL);
+        waitpid(standins[index], nullptr, 0);
+        standins[index] = 0;
+    }
+}
+
+void stopAll() {
+    for (uint8_t i = 0; i < ENDPOINT_MAX; i++) {
+        stopStandin(i);
+    }
+}
+
+/// Run loop() until the client is authenticated on `index`; elapsed ms, or -1 on timeout
+long runUntilOn(uint8_t index, unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (millis() - start < timeoutMs) {
+        loop();
+        if (vpsWebSocket.isAuthenticated() && vpsWebSocket.endpoints().activeIndex() == index) {
+            return (long)(millis() - start);
+        }
+    }
+    return -1;
+}
+
+/// Keep looping for a while (probes fill in) and report whether the client stayed on `index`
+bool holdOn(uint8_t index, unsigned long ms) {
+    unsigned long start = millis();
+    while (millis() - start < ms) {
+        loop();
+        if (vpsWebSocket.endpoints().activeIndex() != index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool report(const char* phase, long elapsedMs, unsigned long boundMs) {
+    bool ok = elapsedMs >= 0 && (unsigned long)elapsedMs <= boundMs;
+    if (elapsedMs < 0) {
+        printf("%-10s timeout (bound %lu ms)  %s\n", phase, boundMs, ok ? "ok" : "FAILED");
+    } else {
+        printf("%-10s %6ld ms (bound %lu ms)  %s\n", phase, elapsedMs, boundMs, ok ? "ok" : "FAILED");
+    }
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned long maxFailoverMs = 15000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-failover") == 0 && i + 1 < argc) {
+            maxFailoverMs = strtoul(argv[++i], nullptr, 10) * 1000;
+        } else if (strcmp(argv[i], "--standin") == 0 && i + 1 < argc) {
+            standinPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--max-failover N] [--standin PATH]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    setup();
+    // The client (and its endpoint list) starts once the boot pipeline has WiFi
+    unsigned long start = millis();
+    while (vpsWebSocket.endpoints().count() == 0 && millis() - start < maxFailoverMs) {
+        loop();
+    }
+    uint8_t count = vpsWebSocket.endpoints().count();
+    if (count < 3) {
+        fprintf(stderr, "[bench] needs VPS_ENDPOINTS with 3 entries (primary, secondary, never started)\n");
+        return 2;
+    }
+    atexit(stopAll);
+    for (uint8_t i = 0; i + 1 < count; i++) {
+        if (!startStandin(i)) {
+            fprintf(stderr, "[bench] stand-in on port %u did not start\n", (unsigned)vpsWebSocket.endpoints().endpoint(i).port);
+            return 1;
+        }
+    }
+
+    // Fail back waits for the hold, then for the primary's next probe
+    unsigned long failbackBoundMs = ENDPOINT_FAILBACK_HOLD_MS + ENDPOINT_PROBE_INTERVAL_MS + maxFailoverMs;
+    bool ok = true;
+
+    printf("\n=== Endpoint failover (%u endpoints, hold %lu ms, probe every %lu ms) ===\n", (unsigned)count,
+           (unsigned long)ENDPOINT_FAILBACK_HOLD_MS, (unsigned long)ENDPOINT_PROBE_INTERVAL_MS);
+    ok &= report("connect", runUntilOn(0, maxFailoverMs), maxFailoverMs);
+    // Let every endpoint be probed before the first fault
+    bool stayed = holdOn(0, ENDPOINT_PROBE_INTERVAL_MS + 1000);
+    printf("%-10s primary kept while probing: %s\n", "steady", stayed ? "ok" : "FAILED");
+    ok &= stayed;
+
+    stopStandin(0);
+    ok &= report("kill", runUntilOn(1, maxFailoverMs), maxFailoverMs);
+
+    if (!startStandin(0)) {
+        fprintf(stderr, "[bench] primary stand-in did not restart\n");
+        return 1;
+    }
+    ok &= report("restart", runUntilOn(0, failbackBoundMs), failbackBoundMs);
+
+    kill(standins[0], SIGSTOP);
+    ok &= report("freeze", runUntilOn(1, maxFailoverMs), maxFailoverMs);
+    kill(standins[0], SIGCONT);
+
+    printf("%-10s", "rtt ms");
+    for (uint8_t i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "ws_endpoint%u_rtt_ms", (unsigned)i);
+        printf("  [%u] %ld", (unsigned)i, (long)gaugeValue(name));
+    }
+    printf("\n");
+    char lastName[32];
+    snprintf(lastName, sizeof(lastName), "ws_endpoint%u_rtt_ms", (unsigned)(count - 1));
+    bool deadUnhealthy = gaugeValue(lastName) < 0;
+    printf("%-10s %u switches, %u probe failures, never-started endpoint unhealthy: %s\n", "totals",
+           counterValue("ws_endpoint_switches_total"), counterValue("ws_endpoint_probe_failures_total"),
+           deadUnhealthy ? "ok" : "FAILED");
+    ok &= deadUnhealthy;
+    printf("result     %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,511 @@
+// Fleet load generator: N copies of the real VPSWebSocketClient and SensorManager,
+// each with its own device ID, multiplexed on one epoll loop against a local
+// backend. Reports registration throughput, command latency percentiles and
+// reconnect storms.
+//
+//   scripts/socketio_standin.py --quiet &    (or the backend, same auth token)
+//   pio run -e native-loadgen
+//   .pio/build/native-loadgen/program --devices 1000 --seconds 60 --drop-at 30
+//
+// Commands: a dashboard connection emits relay:command at --commands-per-sec.
+// The backend fans it out to every device; each device answers with relay:state
+// (changed_by = its device ID), and the dashboard times the relay:changed echo.
+// Delivery latency is dashboard emit -> device callback, round trip is
+// dashboard emit -> relay:changed for that device.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WebSocketsClient.h>
+#include <hal_native.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "metrics.h"
+#include "sensors.h"
+#include "vps_websocket.h"
+
+namespace {
+
+struct Options {
+    int devices = 100;
+    double seconds = 60;
+    double rampPerSec = 0;          // 0 = start every device at once
+    unsigned long sensorIntervalMs = SENSOR_READ_INTERVAL_MS;
+    double commandsPerSec = 0.5;
+    double dropAt = 0;              // Seconds; 0 = no forced drop
+    unsigned long tickMs = 100;     // Timer sweep over all devices
+    int report = 5;                 // Seconds between progress lines (0 = off)
+    const char* idPrefix = "LOADGEN_";
+};
+
+Options options;
+
+/**
+ * @brief Latency histogram with 1 ms buckets (exact percentiles up to 60 s)
+ */
+class LatencyHistogram {
+public:
+    static const uint32_t BUCKETS = 60000;
+
+    void record(unsigned long ms) {
+        _counts[ms < BUCKETS ? ms : BUCKETS]++;
+        _count++;
+        if (ms > _max) {
+            _max = ms;
+        }
+    }
+
+    uint64_t count() const { return _count; }
+
+    unsigned long percentile(double p) const {
+        uint64_t target = (uint64_t)(p * _count);
+        uint64_t seen = 0;
+        for (uint32_t ms = 0; ms <= BUCKETS; ms++) {
+            seen += _counts[ms];
+            if (seen > target) {
+                return ms;
+            }
+        }
+        return BUCKETS;
+    }
+
+    void print(const char* label) const {
+        if (_count == 0) {
+            printf("%-18s -\n", label);
+            return;
+        }
+        printf("%-18s ms p50 %lu  p90 %lu  p99 %lu  max %lu  (%llu samples)\n", label, percentile(0.50),
+               percentile(0.90), percentile(0.99), _max, (unsigned long long)_count);
+    }
+
+private:
+    uint64_t _counts[BUCKETS + 1] = {};
+    uint64_t _count = 0;
+    unsigned long _max = 0;
+};
+
+struct VirtualDevice {
+    VPSWebSocketClient client;
+    SensorManager sensors;
+    char id[DEVICE_ID_MAX_LENGTH];
+    bool started = false;
+    bool connected = false;
+    bool authenticated = false;
+    unsigned long waitingSinceMs = 0;   // begin() or last disconnect
+    unsigned long nextSensorMs = 0;
+    uint32_t deliveredRound = 0;
+    uint32_t ackedRound = 0;
+};
+
+struct Totals {
+    uint32_t registrations = 0;
+    uint32_t disconnects = 0;
+    uint32_t sensorFrames = 0;
+    uint32_t commandsDelivered = 0;
+    uint32_t roundTrips = 0;
+};
+
+std::vector<std::unique_ptr<VirtualDevice>> devices;
+int activeDevice = -1;              // Device whose loop() is running (for callbacks and sockets)
+int dashboardIndex = -1;            // epoll tag of the dashboard connection
+Totals totals;
+Totals lastReport;
+uint32_t authenticatedCount = 0;
+LatencyHistogram registerLatency;
+LatencyHistogram deliveryLatency;
+LatencyHistogram roundTripLatency;
+
+// Registrations per wall-clock second, for the peak rate
+std::vector<uint32_t> registrationsPerSecond;
+unsigned long runStartMs = 0;
+
+// Current command round (one outstanding at a time)
+uint32_t commandRound = 0;
+int roundRelay = -1;
+bool roundState = false;
+unsigned long roundSentMs = 0;
+
+// Reconnect storm bookkeeping (--drop-at)
+bool dropped = false;
+unsigned long dropMs = 0;
+unsigned long stormRecoveredMs = 0;
+
+// ---------- epoll ----------
+
+int epollFd = -1;
+std::unordered_map<int, int> socketOwner;  // fd -> device index (or dashboardIndex)
+
+class EpollWatcher : public hal::SocketWatcher {
+public:
+    void socketOpened(int fd) override {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        // Edge-triggered: the client drains its socket until EAGAIN on every loop()
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u32 = (uint32_t)activeDevice;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        socketOwner[fd] = activeDevice;
+    }
+    void socketClosed(int fd) override {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        socketOwner.erase(fd);
+    }
+};
+
+EpollWatcher watcher;
+
+// ---------- Devices ----------
+
+void onDeviceRelayCommand(int relayId, bool state) {
+    VirtualDevice& device = *devices[activeDevice];
+    if (relayId == roundRelay && state == roundState && device.deliveredRound != commandRound) {
+        device.deliveredRound = commandRound;
+        deliveryLatency.record(millis() - roundSentMs);
+        totals.commandsDelivered++;
+    }
+    // Same answer as the firmware's handler, with the device ID as changed_by so the
+    // dashboard can attribute the relay:changed echo
+    device.client.sendRelayState(relayId, state, "remote", device.id);
+}
+
+void countRegistration(unsigned long now) {
+    size_t second = (now - runStartMs) / 1000;
+    if (registrationsPerSecond.size() <= second) {
+        registrationsPerSecond.resize(second + 1, 0);
+    }
+    registrationsPerSecond[second]++;
+}
+
+void startDevice(int index) {
+    VirtualDevice& device = *devices[index];
+    activeDevice = index;
+    device.sensors.begin();
+    device.client.setDeviceId(device.id);
+    device.client.onRelayCommand(onDeviceRelayCommand);
+    device.client.begin();
+    device.started = true;
+    device.waitingSinceMs = millis();
+    // Spread sensor frames over the interval, as a real fleet would be
+    device.nextSensorMs = millis() + (unsigned long)random(options.sensorIntervalMs);
+    activeDevice = -1;
+}
+
+void runDevice(int index) {
+    VirtualDevice& device = *devices[index];
+    activeDevice = index;
+    device.client.loop();
+    unsigned long now = millis();
+
+    bool connected = device.client.isConnected();
+    bool authenticated = device.client.isAuthenticated();
+    if (device.connected && !connected) {
+        totals.disconnects++;
+        device.waitingSinceMs = now;
+    }
+    if (!device.authenticated && authenticated) {
+        totals.registrations++;
+        authenticatedCount++;
+        registerLatency.record(now - device.waitingSinceMs);
+        countRegistration(now);
+        if (dropped && stormRecoveredMs == 0 && authenticatedCount == devices.size()) {
+            stormRecoveredMs = now;
+        }
+    } else if (device.authenticated && !authenticated) {
+        authenticatedCount--;
+        if (connected) {
+            device.waitingSinceMs = now;  // auth_failed without a disconnect
+        }
+    }
+    device.connected = connected;
+    device.authenticated = authenticated;
+
+    if (authenticated && (long)(now - device.nextSensorMs) >= 0) {
+        device.nextSensorMs = now + options.sensorIntervalMs;
+        device.sensors.readSensors();
+        SensorData data = device.sensors.getCurrentData();
+        if (device.client.sendSensorData(data.temperature, data.humidity, data.soil_moisture,
+                                         device.sensors.getTempErrors(), device.sensors.getHumidityErrors(),
+                                         data.acquired_ms)) {
+            totals.sensorFrames++;
+        }
+    }
+    activeDevice = -1;
+}
+
+// ---------- Dashboard ----------
+
+WebSocketsClient dashboard;
+bool dashboardReady = false;
+
+void handleRelayChanged(const char* json) {
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    const char* changedBy = doc[1]["changed_by"] | "";
+    size_t prefixLength = strlen(options.idPrefix);
+    if (strncmp(changedBy, options.idPrefix, prefixLength) != 0) {
+        return;
+    }
+    int index = atoi(changedBy + prefixLength);
+    int relayId = doc[1]["relay_id"] | -1;
+    bool state = doc[1]["state"] | false;
+    if (index < 0 || index >= (int)devices.size() || relayId != roundRelay || state != roundState) {
+        return;
+    }
+    VirtualDevice& device = *devices[index];
+    if (device.ackedRound != commandRound) {
+        device.ackedRound = commandRound;
+        roundTripLatency.record(millis() - roundSentMs);
+        totals.roundTrips++;
+    }
+}
+
+void onDashboardEvent(WStype_t type, uint8_t* payload, size_t length) {
+    if (type == WStype_DISCONNECTED) {
+        dashboardReady = false;
+        return;
+    }
+    if (type != WStype_TEXT || length == 0) {
+        return;
+    }
+    const char* text = (const char*)payload;
+    if (text[0] == '0') {
+        dashboard.sendTXT("40");
+    } else if (text[0] == '2' && length == 1) {
+        dashboard.sendTXT("3");
+    } else if (strncmp(text, "40", 2) == 0 && text[2] != '\0') {
+        dashboardReady = true;
+    } else if (strncmp(text, "42[\"relay:changed\"", 18) == 0) {
+        handleRelayChanged(text + 2);
+    }
+}
+
+void sendCommandRound() {
+    commandRound++;
+    roundRelay = (int)(commandRound % 4);
+    roundState = (commandRound / 4) % 2 == 0;
+    roundSentMs = millis();
+    char frame[128];
+    snprintf(frame, sizeof(frame),
+             "42[\"relay:command\",{\"relay_id\":%d,\"state\":%s,\"mode\":\"manual\",\"changed_by\":\"loadgen\"}]",
+             roundRelay, roundState ? "true" : "false");
+    dashboard.sendTXT(frame);
+}
+
+void runDashboard() {
+    activeDevice = dashboardIndex;
+    dashboard.loop();
+    activeDevice = -1;
+}
+
+// ---------- Reporting ----------
+
+uint32_t counterValue(const char* name) {
+    Metric* metric = MetricsRegistry::find(name);
+    if (!metric || metric->type() != METRIC_COUNTER) {
+        return 0;
+    }
+    return static_cast<Counter*>(metric)->value();
+}
+
+void dropAllSockets() {
+    uint32_t count = 0;
+    for (const auto& entry : socketOwner) {
+        if (entry.second != dashboardIndex) {
+            // The clients notice on their next read, like a NAT or load balancer reset
+            shutdown(entry.first, SHUT_RDWR);
+            count++;
+        }
+    }
+    dropped = true;
+    dropMs = millis();
+    printf("[loadgen] dropped %u device connections at %.1f s\n", count, (dropMs - runStartMs) / 1000.0);
+}
+
+void printProgress(unsigned long now, double intervalSeconds) {
+    int started = 0;
+    int connected = 0;
+    for (const auto& device : devices) {
+        started += device->started;
+        connected += device->connected;
+    }
+    printf("[%6.1f s] started %d  connected %d  authenticated %u  +reg %.0f/s  disc %u  sensor %.0f/s  "
+           "commands %u/%u rt\n",
+           (now - runStartMs) / 1000.0, started, connected, authenticatedCount,
+           (totals.registrations - lastReport.registrations) / intervalSeconds,
+           totals.disconnects - lastReport.disconnects,
+           (totals.sensorFrames - lastReport.sensorFrames) / intervalSeconds, totals.commandsDelivered,
+           totals.roundTrips);
+    fflush(stdout);
+    lastReport = totals;
+}
+
+void printSummary(double wallSeconds, uint32_t receivedFrames) {
+    uint32_t peak = 0;
+    for (uint32_t perSecond : registrationsPerSecond) {
+        peak = max(peak, perSecond);
+    }
+    printf("\n=== Fleet load: %d devices, %.1f s against %s:%d ===\n", options.devices, wallSeconds,
+           VPS_WEBSOCKET_HOST, (int)VPS_WEBSOCKET_PORT);
+    printf("authenticated      %u/%d at the end\n", authenticatedCount, options.devices);
+    printf("registrations      %u (peak %u/s), disconnects %u, auth failures %u\n", totals.registrations, peak,
+           totals.disconnects, counterValue("ws_auth_failures_total"));
+    registerLatency.print("time to register");
+    printf("sensor frames      %u (%.1f/s)\n", totals.sensorFrames, totals.sensorFrames / wallSeconds);
+    printf("command rounds     %u, delivered %u, round trips %u (expected %llu)\n", commandRound,
+           totals.commandsDelivered, totals.roundTrips, (unsigned long long)commandRound * options.devices);
+    deliveryLatency.print("command delivery");
+    roundTripLatency.print("command round trip");
+    printf("frames received    %.2f per device per second\n",
+           options.devices ? receivedFrames / wallSeconds / options.devices : 0.0);
+    if (dropped) {
+        if (stormRecoveredMs) {
+            printf("reconnect storm    all devices re-registered %.1f s after the drop\n",
+                   (stormRecoveredMs - dropMs) / 1000.0);
+        } else {
+            printf("reconnect storm    %u/%d re-registered by the end of the run\n", authenticatedCount,
+                   options.devices);
+        }
+    }
+}
+
+void raiseFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (strcmp(arg, "--devices") == 0) {
+            options.devices = atoi(value);
+        } else if (strcmp(arg, "--seconds") == 0) {
+            options.seconds = atof(value);
+        } else if (strcmp(arg, "--ramp-per-sec") == 0) {
+            options.rampPerSec = atof(value);
+        } else if (strcmp(arg, "--sensor-interval-ms") == 0) {
+            options.sensorIntervalMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--commands-per-sec") == 0) {
+            options.commandsPerSec = atof(value);
+        } else if (strcmp(arg, "--drop-at") == 0) {
+            options.dropAt = atof(value);
+        } else if (strcmp(arg, "--tick-ms") == 0) {
+            options.tickMs = strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--report") == 0) {
+            options.report = atoi(value);
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return options.devices > 0 && options.sensorIntervalMs > 0 && options.tickMs > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        fprintf(stderr,
+                "usage: %s [--devices N] [--seconds S] [--ramp-per-sec R] [--sensor-interval-ms MS]\n"
+                "          [--commands-per-sec R] [--drop-at S] [--tick-ms MS] [--report S]\n",
+                argv[0]);
+        return 2;
+    }
+    raiseFileLimit();
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+    hal::setSocketWatcher(&watcher);
+
+    for (int i = 0; i < options.devices; i++) {
+        devices.emplace_back(new VirtualDevice());
+        snprintf(devices.back()->id, sizeof(devices.back()->id), "%s%05d", options.idPrefix, i);
+    }
+    dashboardIndex = options.devices;
+
+    runStartMs = millis();
+    activeDevice = dashboardIndex;
+    dashboard.begin(VPS_WEBSOCKET_HOST, VPS_WEBSOCKET_PORT, VPS_WEBSOCKET_PATH);
+    dashboard.onEvent(onDashboardEvent);
+    dashboard.setReconnectInterval(1000);
+    activeDevice = -1;
+
+    int nextToStart = 0;
+    unsigned long nextSweepMs = runStartMs;
+    unsigned long nextReportMs = runStartMs + options.report * 1000UL;
+    unsigned long nextCommandMs = runStartMs + 1000;
+    unsigned long endMs = runStartMs + (unsigned long)(options.seconds * 1000);
+    uint32_t receivedBefore = counterValue("ws_messages_received_total");
+    epoll_event events[256];
+
+    while ((long)(millis() - endMs) < 0) {
+        unsigned long now = millis();
+
+        // Ramp: start the devices that are due
+        double elapsed = (now - runStartMs) / 1000.0;
+        int due = options.rampPerSec > 0 ? (int)(elapsed * options.rampPerSec) + 1 : options.devices;
+        while (nextToStart < options.devices && nextToStart < due) {
+            startDevice(nextToStart++);
+        }
+
+        int timeoutMs = (int)((long)(nextSweepMs - now) > 0 ? nextSweepMs - now : 0);
+        int ready = epoll_wait(epollFd, events, 256, timeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            return 1;
+        }
+        for (int i = 0; i < ready; i++) {
+            int index = (int)events[i].data.u32;
+            if (index == dashboardIndex) {
+                runDashboard();
+            } else if (index >= 0 && index < (int)devices.size()) {
+                runDevice(index);
+            }
+        }
+
+        now = millis();
+        if ((long)(now - nextSweepMs) >= 0) {
+            // Timers (reconnect interval, sensor period, heartbeat) for every device
+            nextSweepMs = now + options.tickMs;
+            runDashboard();
+            for (int i = 0; i < nextToStart; i++) {
+                runDevice(i);
+            }
+        }
+        if (options.commandsPerSec > 0 && dashboardReady && (long)(now - nextCommandMs) >= 0) {
+            nextCommandMs = now + (unsigned long)(1000.0 / options.commandsPerSec);
+            sendCommandRound();
+        }
+        if (options.dropAt > 0 && !dropped && now - runStartMs >= (unsigned long)(options.dropAt * 1000)) {
+            dropAllSockets();
+        }
+        if (options.report > 0 && (long)(now - nextReportMs) >= 0) {
+            nextReportMs = now + options.report * 1000UL;
+            printProgress(now, options.report);
+        }
+    }
+
+    double wallSeconds = (millis() - runStartMs) / 1000.0;
+    printSummary(wallSeconds, counterValue("ws_messages_received_total") - receivedBefore);
+    return 0;
+}
@@ -0,0 +1,423 @@
+// Host check for the flash history: fills the (RAM-backed) spiffs partition
+// with weeks of 5 s greenhouse readings through HistoryStore, then answers
+// sensor:history queries over an in-process WebSocket and compares every
+// bucket with a brute-force aggregation of the same readings. Reports the
+// append cost, flash bytes and erases per day, how many days the ring keeps,
+// the index rebuild at boot and how much of the flash a query reads.
+//
+//   pio run -e native-history
+//   .pio/build/native-history/program [--days 16] [--seed 1]
+//
+// Exits 1 on any bucket mismatch, a flash write that needed a 0 -> 1 bit
+// change, or a corrupted record that is not skipped.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <hal_native.h>
+#include "history_store.h"
+#include "vps_websocket.h"
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+extern VPSWebSocketClient vpsWebSocket;
+
+namespace {
+
+const uint64_t SAMPLE_MS = SENSOR_READ_INTERVAL_MS;
+const uint64_t DAY_MS = 86400000ULL;
+const uint64_t START_MS = 1767225600000ULL;  // 2026-01-01 00:00 UTC
+const float PI_F = 3.14159265f;
+
+struct Reading {
+    uint64_t t;
+    float values[SENSOR_BLOCK_CHANNELS];
+};
+
+struct Bucket {
+    uint32_t index;
+    uint32_t count;
+    float min[SENSOR_BLOCK_CHANNELS];
+    float mean[SENSOR_BLOCK_CHANNELS];
+    float max[SENSOR_BLOCK_CHANNELS];
+};
+
+struct QueryResult {
+    std::vector<Bucket> buckets;
+    uint32_t chunks = 0;
+    uint32_t readings = 0;
+    uint32_t records = 0;
+    uint32_t skipped = 0;
+    uint32_t iterations = 0;   // historyStore.loop() calls until done
+    std::string error;
+    bool done = false;
+};
+
+bool startsWith(const std::string& text, const char* prefix) {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// Plays the backend: queues sensor:history queries, collects the chunks
+class HistorySink : public hal::WebSocketPeer {
+public:
+    std::deque<std::string> toClient;
+    QueryResult* result = nullptr;
+
+    bool open(const char*, uint16_t, const char*) override {
+        toClient.clear();
+        toClient.push_back("0{\"sid\":\"bench\",\"upgrades\":[],\"pingInterval\":25000,\"pingTimeout\":20000}");
+        toClient.push_back("40{\"sid\":\"bench\"}");
+        return true;
+    }
+
+    bool receive(const char* payload, size_t length) override {
+        std::string text(payload, length);
+        if (!result) {
+            return true;
+        }
+        bool binary = startsWith(text, "451-[\"sensor:history:chunk\",");
+        if (!binary && !startsWith(text, "42[\"sensor:history:chunk\",")) {
+            return true;
+        }
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, text.c_str() + (binary ? 4 : 2)) != DeserializationError::Ok) {
+            result->error = "unparsable chunk";
+            return true;
+        }
+        JsonObject data = doc[1];
+        if ((uint32_t)(data["seq"] | 0) != result->chunks) {
+            result->error = "chunk out of order";
+        }
+        result->chunks++;
+        _pendingBuckets = binary ? (uint32_t)(data["buckets"] | 0) : 0;
+        if (data.containsKey("error")) {
+            result->error = (const char*)(data["error"] | "");
+        }
+        if (data["done"] | false) {
+            result->done = true;
+            result->readings = data["readings"] | 0;
+            result->records = data["records"] | 0;
+            result->skipped = data["skipped"] | 0;
+        }
+        return true;
+    }
+
+    bool receiveBinary(const uint8_t* payload, size_t length) override {
+        if (!result || length != _pendingBuckets * HISTORY_BUCKET_BYTES) {
+            if (result) {
+                result->error = "attachment size";
+            }
+            return true;
+        }
+        for (uint32_t i = 0; i < _pendingBuckets; i++) {
+            const uint8_t* in = payload + i * HISTORY_BUCKET_BYTES;
+            Bucket bucket;
+            memcpy(&bucket.index, in, 4);
+            memcpy(&bucket.count, in + 4, 4);
+            for (int c = 0; c < SENSOR_BLOCK_CHANNELS; c++) {
+                memcpy(&bucket.min[c], in + 8 + c * 12, 4);
+                memcpy(&bucket.mean[c], in + 12 + c * 12, 4);
+                memcpy(&bucket.max[c], in + 16 + c * 12, 4);
+            }
+            result->buckets.push_back(bucket);
+        }
+        _pendingBuckets = 0;
+        return true;
+    }
+
+    bool poll(std::string& payload) override {
+        if (toClient.empty()) {
+            return false;
+        }
+        payload.swap(toClient.front());
+        toClient.pop_front();
+        return true;
+    }
+
+    bool isOpen() override { return true; }
+    void close() override {}
+
+private:
+    uint32_t _pendingBuckets = 0;
+};
+
+HistorySink sink;
+
+// Diurnal temperature and humidity at DHT11 resolution, a soil probe drying and being watered
+std::vector<Reading> makeReadings(int days, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    std::uniform_int_distribution<int> jitter(0, 12);
+    std::vector<Reading> readings;
+    uint64_t end = START_MS + days * DAY_MS;
+    float soil = 60.0f;
+    for (uint64_t t = START_MS + 1234; t < end; t += SAMPLE_MS) {
+        float hour = fmodf((float)((t - START_MS) % DAY_MS) / 3600000.0f, 24.0f);
+        float phase = 2.0f * PI_F * (hour - 9.0f) / 24.0f;
+        soil = soil < 35.0f ? 60.0f : soil - 1.0f / 720.0f;
+        Reading reading;
+        reading.t = t + jitter(rng);
+        reading.values[0] = roundf((19.0f + 5.0f * sinf(phase) + noise(rng)) * 10.0f) / 10.0f;
+        reading.values[1] = roundf(65.0f - 12.0f * sinf(phase) + noise(rng) * 4.0f);
+        reading.values[2] = roundf((soil + noise(rng)) * 10.0f) / 10.0f;
+        readings.push_back(reading);
+    }
+    return readings;
+}
+
+double nowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool connectToSink() {
+    hal::setWebSocketPeer(&sink);
+    vpsWebSocket.begin();
+    for (int attempt = 0; attempt < 200 && !vpsWebSocket.isConnected(); attempt++) {
+        vpsWebSocket.loop();
+        delay(50);
+    }
+    return vpsWebSocket.isConnected();
+}
+
+// Send sensor:history through the client and run the loop until the last chunk
+QueryResult runQuery(uint64_t from, uint64_t to, uint32_t step) {
+    QueryResult result;
+    sink.result = &result;
+    char frame[160];
+    snprintf(frame, sizeof(frame), "42[\"sensor:history\",{\"request_id\":\"bench\",\"from\":%llu,\"to\":%llu,\"step\":%lu}]",
+             (unsigned long long)from, (unsigned long long)to, (unsigned long)step);
+    sink.toClient.push_back(frame);
+    vpsWebSocket.loop();
+    while (historyStore.isQueryActive() && result.iterations < 1000000) {
+        historyStore.loop();
+        result.iterations++;
+    }
+    sink.result = nullptr;
+    return result;
+}
+
+// What the query must return: every reading the store still holds, bucketed the same way
+std::vector<Bucket> bruteForce(const std::vector<Reading>& readings, uint64_t oldest, uint64_t from, uint64_t to,
+                               uint32_t step, uint64_t lostFirst, uint64_t lostLast) {
+    std::vector<Bucket> buckets;
+    std::vector<double> sums;
+    for (const Reading& reading : readings) {
+        if (reading.t < oldest || reading.t < from || reading.t >= to ||
+            (reading.t >= lostFirst && reading.t <= lostLast)) {
+            continue;
+        }
+        uint32_t index = (uint32_t)((reading.t - from) / step);
+        if (buckets.empty() || buckets.back().index != index) {
+            Bucket bucket;
+            bucket.index = index;
+            bucket.count = 0;
+            buckets.push_back(bucket);
+            sums.assign(SENSOR_BLOCK_CHANNELS, 0.0);
+        }
+        Bucket& bucket = buckets.back();
+        for (int c = 0; c < SENSOR_BLOCK_CHANNELS; c++) {
+            float value = reading.values[c];
+            bucket.min[c] = bucket.count == 0 || value < bucket.min[c] ? value : bucket.min[c];
+            bucket.max[c] = bucket.count == 0 || value > bucket.max[c] ? value : bucket.max[c];
+            sums[c] += value;
+        }
+        bucket.count++;
+        for (int c = 0; c < SENSOR_BLOCK_CHANNELS; c++) {
+            bucket.mean[c] = (float)(sums[c] / bucket.count);
+        }
+    }
+    return buckets;
+}
+
+bool compare(const char* name, const QueryResult& result, const std::vector<Bucket>& expected) {
+    if (!result.done || !result.error.empty()) {
+        printf("  %s: %s\n", name, result.done ? result.error.c_str() : "no final chunk");
+        return false;
+    }
+    if (result.buckets.size() != expected.size()) {
+        printf("  %s: %zu buckets, expected %zu\n", name, result.buckets.size(), expected.size());
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        const Bucket& got = result.buckets[i];
+        const Bucket& want = expected[i];
+        bool ok = got.index == want.index && got.count == want.count;
+        for (int c = 0; ok && c < SENSOR_BLOCK_CHANNELS; c++) {
+            ok = got.min[c] == want.min[c] && got.max[c] == want.max[c] &&
+                 fabsf(got.mean[c] - want.mean[c]) <= 1e-4f * fabsf(want.mean[c]);
+        }
+        if (!ok) {
+            printf("  %s: bucket %u differs (count %u, expected %u)\n", name, want.index, got.count, want.count);
+            return false;
+        }
+    }
+    return true;
+}
+
+void printQuery(const char* name, const QueryResult& result, double ms) {
+    printf("%-10s %4zu buckets in %3u chunks  %7u readings  %4u records read  %4u skipped  %6u loop calls  "
+           "%6.1f ms\n",
+           name, result.buckets.size(), result.chunks, result.readings, result.records, result.skipped,
+           result.iterations, ms);
+}
+
+// Find a record holding `t` and clear one of its block bytes, as a torn write would; returns its span
+bool corruptRecordAt(uint64_t t, uint64_t& first, uint64_t& last) {
+    const esp_partition_t* partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTORY_PARTITION_LABEL);
+    for (uint32_t sector = 0; sector < historyStore.sectorCount(); sector++) {
+        uint32_t base = sector * SPI_FLASH_SEC_SIZE;
+        uint32_t offset = HISTORY_SECTOR_HEADER_BYTES;
+        while (offset + HISTORY_RECORD_HEADER_BYTES <= SPI_FLASH_SEC_SIZE) {
+            uint8_t header[HISTORY_RECORD_HEADER_BYTES];
+            esp_partition_read(partition, base + offset, header, sizeof(header));
+            uint16_t marker;
+            uint16_t length;
+            memcpy(&marker, header, 2);
+            memcpy(&length, header + 2, 2);
+            if (marker != HISTORY_RECORD_MARKER) {
+                break;
+            }
+            memcpy(&first, header + 8, 8);
+            memcpy(&last, header + 16, 8);
+            if (t >= first && t <= last) {
+                for (uint32_t i = length / 2; i < length; i++) {
+                    uint8_t byte;
+                    esp_partition_read(partition, base + offset + HISTORY_RECORD_HEADER_BYTES + i, &byte, 1);
+                    if (byte != 0) {
+                        byte = 0;
+                        return esp_partition_write(partition, base + offset + HISTORY_RECORD_HEADER_BYTES + i, &byte,
+                                                   1) == ESP_OK;
+                    }
+                }
+                return false;
+            }
+            offset += (HISTORY_RECORD_HEADER_BYTES + length + 3) & ~3u;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int days = 16;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = std::max(2, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--days N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    hal::useVirtualClock(1000000);
+    if (!connectToSink()) {
+        fprintf(stderr, "[bench] WebSocket client did not connect to the in-process sink\n");
+        return 1;
+    }
+    if (!historyStore.begin()) {
+        fprintf(stderr, "[bench] No history partition\n");
+        return 1;
+    }
+
+    int failures = 0;
+    std::vector<Reading> readings = makeReadings(days, seed);
+    printf("\n=== Flash history (%d days of readings every %llu s, %u sectors of %u B) ===\n", days,
+           (unsigned long long)(SAMPLE_MS / 1000), (unsigned)historyStore.sectorCount(), (unsigned)SPI_FLASH_SEC_SIZE);
+
+    // Fill: the first day alone gives the write rate, the rest wraps the ring
+    size_t perDay = (size_t)(DAY_MS / SAMPLE_MS);
+    double start = nowNs();
+    for (size_t i = 0; i < perDay; i++) {
+        historyStore.append(readings[i].t, readings[i].values);
+    }
+    double appendNs = (nowNs() - start) / perDay;
+    hal::FlashStats day = hal::flashStats();
+    for (size_t i = perDay; i < readings.size(); i++) {
+        historyStore.append(readings[i].t, readings[i].values);
+    }
+    historyStore.flush();  // As a reboot would lose the RAM block
+    hal::FlashStats total = hal::flashStats();
+    uint64_t newest = readings.back().t;
+    uint64_t oldest = historyStore.oldestMs();
+    printf("append     %6.0f ns/reading  %6.1f KB/day written (%4.2f B/reading)  %5.1f sector erases/day\n", appendNs,
+           day.bytesWritten / 1024.0, (double)day.bytesWritten / perDay, (double)total.sectorErases / days);
+    printf("retention  %6.2f days in %u of %u sectors  most erased sector %u times (mean %.1f)\n",
+           (newest - oldest) / (double)DAY_MS, (unsigned)historyStore.sectorsUsed(),
+           (unsigned)historyStore.sectorCount(), total.maxSectorErases,
+           (double)total.sectorErases / historyStore.sectorCount());
+    if (total.lostBits != 0) {
+        printf("  %llu flash writes needed a 0 -> 1 bit change\n", (unsigned long long)total.lostBits);
+        failures++;
+    }
+    if (oldest == 0 || (days * DAY_MS > 12 * DAY_MS && oldest <= readings.front().t)) {
+        printf("  the ring did not wrap\n");
+        failures++;
+    }
+
+    // Boot: the index comes back from the sector and record headers
+    uint16_t used = historyStore.sectorsUsed();
+    start = nowNs();
+    historyStore.begin();
+    double beginMs = (nowNs() - start) / 1e6;
+    printf("begin      %6.2f ms to rebuild the index of %u sectors\n", beginMs, (unsigned)used);
+    if (historyStore.sectorsUsed() != used || historyStore.oldestMs() != oldest) {
+        printf("  index rebuilt at boot differs\n");
+        failures++;
+    }
+
+    // A week in hours (the dashboard chart), the last two hours in minutes, everything in days
+    struct Query {
+        const char* name;
+        uint64_t from;
+        uint64_t to;
+        uint32_t step;
+    };
+    uint64_t end = START_MS + days * DAY_MS;
+    const Query queries[] = {
+        {"week/1h", end - 7 * DAY_MS, end, 3600000UL},
+        {"2h/1min", end - 7200000ULL, end, 60000UL},
+        {"all/1d", START_MS, end, (uint32_t)DAY_MS},
+    };
+    for (const Query& query : queries) {
+        start = nowNs();
+        QueryResult result = runQuery(query.from, query.to, query.step);
+        printQuery(query.name, result, (nowNs() - start) / 1e6);
+        if (!compare(query.name, result, bruteForce(readings, oldest, query.from, query.to, query.step, 1, 0))) {
+            failures++;
+        }
+    }
+
+    // One record damaged in the middle of the week: skipped by its CRC, the rest still served
+    uint64_t lostFirst = 0;
+    uint64_t lostLast = 0;
+    const Query& week = queries[0];
+    if (!corruptRecordAt(week.from + 3 * DAY_MS, lostFirst, lostLast)) {
+        printf("  no record to corrupt\n");
+        failures++;
+    } else {
+        QueryResult result = runQuery(week.from, week.to, week.step);
+        printf("corrupt    record of %llu s skipped, %u readings served\n",
+               (unsigned long long)((lostLast - lostFirst) / 1000), result.readings);
+        if (!compare("corrupt", result, bruteForce(readings, oldest, week.from, week.to, week.step, lostFirst, lostLast))) {
+            failures++;
+        }
+    }
+
+    // Rejected: a range too fine to answer
+    QueryResult tooFine = runQuery(START_MS, end, HISTORY_MIN_STEP_MS);
+    if (tooFine.error != "too many buckets") {
+        printf("  too-fine query: \"%s\"\n", tooFine.error.c_str());
+        failures++;
+    }
+
+    printf("result     %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
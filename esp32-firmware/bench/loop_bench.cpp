@@ -0,0 +1,169 @@
+// Loop benchmark for the native build: runs the real setup()/loop() against a
+// local Socket.IO server and reports loop latency, frame rates and allocations.
+// With ALLOC_COUNTER (env:native-bench) it also counts the iterations that made
+// firmware-side heap allocations (the HAL leaves out its host-only transport
+// buffers), split into idle ones (no frame in or out) and ones that sent or
+// handled frames: sensor:data, relay:state, relay:command and the rest.
+// --require-zero-idle-allocs turns the idle count into the exit status,
+// --require-zero-allocs both.
+//
+//   scripts/socketio_standin.py --commands-per-sec 50 &
+//   pio run -e native-bench && .pio/build/native-bench/program --seconds 10
+
+#include <Arduino.h>
+#include <hal_native.h>
+#include "metrics.h"
+#include "vps_websocket.h"
+#include "alloc_counter.h"
+
+void setup();
+void loop();
+
+extern VPSWebSocketClient vpsWebSocket;
+
+namespace {
+
+Counter* findCounter(const char* name) {
+    Metric* metric = MetricsRegistry::find(name);
+    return metric && metric->type() == METRIC_COUNTER ? static_cast<Counter*>(metric) : nullptr;
+}
+
+uint32_t counterValue(const char* name) {
+    Counter* counter = findCounter(name);
+    return counter ? counter->value() : 0;
+}
+
+// One bucket per microsecond gives exact percentiles without storing samples;
+// iterations slower than the last bucket are only reflected in max
+const uint32_t LATENCY_BUCKETS = 100000;
+uint64_t latencyCounts[LATENCY_BUCKETS + 1];
+
+uint32_t percentile(uint64_t iterations, double p) {
+    uint64_t target = (uint64_t)(p * iterations);
+    uint64_t seen = 0;
+    for (uint32_t us = 0; us <= LATENCY_BUCKETS; us++) {
+        seen += latencyCounts[us];
+        if (seen > target) {
+            return us;
+        }
+    }
+    return LATENCY_BUCKETS;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned long seconds = 10;
+    unsigned long connectTimeoutMs = 15000;
+    bool requireZeroIdleAllocs = false;
+    bool requireZeroAllocs = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--connect-timeout") == 0 && i + 1 < argc) {
+            connectTimeoutMs = strtoul(argv[++i], nullptr, 10) * 1000;
+        } else if (strcmp(argv[i], "--require-zero-idle-allocs") == 0) {
+            requireZeroIdleAllocs = true;
+        } else if (strcmp(argv[i], "--require-zero-allocs") == 0) {
+            requireZeroAllocs = true;
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--seconds N] [--connect-timeout N] [--require-zero-idle-allocs] [--require-zero-allocs]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    setup();
+
+    unsigned long start = millis();
+    while (!vpsWebSocket.isConnected() && millis() - start < connectTimeoutMs) {
+        loop();
+    }
+    if (!vpsWebSocket.isConnected()) {
+        fprintf(stderr, "[bench] no connection to %s:%d after %lu ms\n", VPS_WEBSOCKET_HOST,
+                (int)VPS_WEBSOCKET_PORT, connectTimeoutMs);
+        return 1;
+    }
+
+    uint32_t sentBefore = counterValue("ws_messages_sent_total");
+    uint32_t receivedBefore = counterValue("ws_messages_received_total");
+    uint32_t bytesBefore = counterValue("ws_bytes_sent_total");
+    hal::HeapStats heapBefore = hal::heapStats();
+
+    unsigned long benchStart = millis();
+    uint64_t iterations = 0;
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+    Counter* sentCounter = findCounter("ws_messages_sent_total");
+    Counter* receivedCounter = findCounter("ws_messages_received_total");
+    uint64_t idleIterations = 0;
+    uint64_t idleAllocatingIterations = 0;
+    uint64_t idleAllocations = 0;
+    uint64_t frameIterations = 0;
+    uint64_t frameAllocatingIterations = 0;
+    uint64_t frameAllocations = 0;
+    while (millis() - benchStart < seconds * 1000) {
+        uint32_t framesBefore = (sentCounter ? sentCounter->value() : 0) + (receivedCounter ? receivedCounter->value() : 0);
+        unsigned long t0 = micros();
+        loop();
+        uint32_t elapsed = (uint32_t)(micros() - t0);
+        latencyCounts[elapsed < LATENCY_BUCKETS ? elapsed : LATENCY_BUCKETS]++;
+        totalUs += elapsed;
+        maxUs = max(maxUs, elapsed);
+        iterations++;
+#if ALLOC_COUNTER
+        uint32_t framesAfter = (sentCounter ? sentCounter->value() : 0) + (receivedCounter ? receivedCounter->value() : 0);
+        if (framesAfter == framesBefore) {
+            idleIterations++;
+            if (allocCounter.lastIteration() > 0) {
+                idleAllocatingIterations++;
+                idleAllocations += allocCounter.lastIteration();
+            }
+        } else {
+            frameIterations++;
+            if (allocCounter.lastIteration() > 0) {
+                frameAllocatingIterations++;
+                frameAllocations += allocCounter.lastIteration();
+            }
+        }
+#else
+        (void)framesBefore;
+#endif
+    }
+    double wallSeconds = (millis() - benchStart) / 1000.0;
+
+    hal::HeapStats heapAfter = hal::heapStats();
+    uint32_t sent = counterValue("ws_messages_sent_total") - sentBefore;
+    uint32_t received = counterValue("ws_messages_received_total") - receivedBefore;
+    uint32_t bytes = counterValue("ws_bytes_sent_total") - bytesBefore;
+    uint64_t allocations = heapAfter.allocations - heapBefore.allocations;
+
+    // LOOP_ITERATION_DELAY_MS is part of loop(); build with -D LOOP_ITERATION_DELAY_MS=0 to measure work only
+    printf("\n=== Loop benchmark (%.1f s, loop delay %d ms) ===\n", wallSeconds, (int)LOOP_ITERATION_DELAY_MS);
+    printf("iterations        %llu (%.0f/s)\n", (unsigned long long)iterations, iterations / wallSeconds);
+    printf("loop latency us   mean %.2f  p50 %u  p90 %u  p99 %u  p99.9 %u  max %u\n",
+           iterations ? (double)totalUs / iterations : 0.0, percentile(iterations, 0.50),
+           percentile(iterations, 0.90), percentile(iterations, 0.99), percentile(iterations, 0.999), maxUs);
+    printf("frames sent       %u (%.1f/s, %.1f KiB/s)\n", sent, sent / wallSeconds, bytes / 1024.0 / wallSeconds);
+    printf("frames received   %u (%.1f/s)\n", received, received / wallSeconds);
+    printf("heap allocations  %llu (%.2f per frame), peak in use %zu bytes\n", (unsigned long long)allocations,
+           sent + received ? (double)allocations / (sent + received) : 0.0, heapAfter.peakBytesInUse);
+#if ALLOC_COUNTER
+    printf("idle iterations   %llu, %llu allocated (%llu allocations)\n", (unsigned long long)idleIterations,
+           (unsigned long long)idleAllocatingIterations, (unsigned long long)idleAllocations);
+    printf("frame iterations  %llu, %llu allocated (%llu allocations)\n", (unsigned long long)frameIterations,
+           (unsigned long long)frameAllocatingIterations, (unsigned long long)frameAllocations);
+    fflush(stdout);
+    bool allocated = (requireZeroIdleAllocs || requireZeroAllocs) && idleAllocatingIterations > 0;
+    allocated = allocated || (requireZeroAllocs && frameAllocatingIterations > 0);
+    return allocated ? 1 : 0;
+#else
+    if (requireZeroIdleAllocs || requireZeroAllocs) {
+        fprintf(stderr, "[bench] --require-zero-*allocs needs -D ALLOC_COUNTER=1\n");
+        return 2;
+    }
+    fflush(stdout);
+    return 0;
+#endif
+}
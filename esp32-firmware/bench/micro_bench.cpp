@@ -0,0 +1,583 @@
+// Microbenchmarks for the serialization, parsing and validation hot paths.
+//
+//   pio run -e native-microbench
+//   .pio/build/native-microbench/program                                  # run, print table
+//   .pio/build/native-microbench/program --compare bench/micro_baseline.txt
+//   .pio/build/native-microbench/program --write-baseline bench/micro_baseline.txt
+//   .pio/build/native-microbench/program --write-baseline bench/micro_baseline.txt --filter frame/  # those rows only
+//
+// Every benchmark reports ns/op (best of --repetitions runs, iteration count
+// scaled to --min-time), firmware-side heap allocations and bytes per op (HAL
+// operator new accounting without the transport stand-in's own buffers) and
+// the peak stack depth of one op, measured on a painted ucontext stack.
+// --compare exits 1 when a benchmark is slower than the baseline by more than
+// --tolerance, allocates more, or uses more stack. Any benchmark that allocates
+// at all fails the run, baseline or not: frame building and event parsing
+// (sensor:data, relay:state, relay:command, ...) run on StaticJsonDocument and
+// stack buffers and must stay off the heap like relay switching and
+// validation. The run also fails when a full metrics frame or the largest
+// config:state no longer fits its buffer.
+//
+// Rows that build or parse JSON are only compared against a baseline taken
+// with the same JSON library, and only allocation-checked when built against
+// ArduinoJson itself (a stand-in header's own allocations are not the
+// firmware's); the other rows are gated either way.
+
+#include <Arduino.h>
+#include <hal_native.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <ucontext.h>
+#include <vector>
+
+#include "anomaly_detector.h"
+#include "log_forwarder.h"
+#include "metrics.h"
+#include "relays.h"
+#include "sensors.h"
+#include "vps_websocket.h"
+
+extern VPSWebSocketClient vpsWebSocket;
+
+/**
+ * @class MicroBenchAccess
+ * @brief Reaches the private VPSWebSocketClient handlers (friend of the class)
+ */
+class MicroBenchAccess {
+public:
+    static void handleMessage(char* frame, size_t length) {
+        vpsWebSocket.handleMessage((uint8_t*)frame, length);
+    }
+    static bool sendLogBatch() { return vpsWebSocket.sendLogBatch(); }
+    static void sendRelayAck() { vpsWebSocket.sendRelayAck(); }
+    static void sendTimeProbe() { vpsWebSocket.sendTimeProbe(); }
+    // Some inbound events (auth_failed) drop the session flag; keep sending possible
+    static void restoreSession() {
+        vpsWebSocket._connected = true;
+        vpsWebSocket._authFailed = false;
+    }
+};
+
+namespace {
+
+// Collects frames instead of a socket; only the size of the last one is kept
+class SinkPeer : public hal::WebSocketPeer {
+public:
+    size_t lastFrameBytes = 0;
+    bool open(const char*, uint16_t, const char*) override { return true; }
+    bool receive(const char*, size_t length) override {
+        lastFrameBytes = length;
+        return true;
+    }
+    bool poll(std::string&) override { return false; }
+    bool isOpen() override { return true; }
+    void close() override {}
+};
+
+SinkPeer sink;
+volatile float floatSink;
+volatile bool boolSink;
+volatile const char* stringSink;
+
+// ---------- Inbound frames (mutable: handleMessage takes a non-const payload) ----------
+
+char FRAME_ENGINEIO_OPEN[] =
+    "0{\"sid\":\"bench\",\"upgrades\":[],\"pingInterval\":25000,\"pingTimeout\":20000,\"maxPayload\":1000000}";
+char FRAME_NAMESPACE_ACK[] = "40{\"sid\":\"bench\"}";
+char FRAME_ENGINEIO_PING[] = "2";
+char FRAME_SENSOR_CLIMATE[] =
+    "42[\"sensor:climate\",{\"ciudad_humidity\":71.5,\"ciudad\":\"Valencia\",\"api_error\":\"\"}]";
+char FRAME_SENSOR_STORM[] =
+    "42[\"sensor:storm\",{\"ciudad_humidity\":93.0,\"ciudad\":\"Valencia\",\"api_error\":\"\"}]";
+char FRAME_AUTH_SUCCESS[] = "42[\"device:auth_success\",{\"message\":\"Authentication successful\"}]";
+char FRAME_AUTH_FAILED[] = "42[\"device:auth_failed\",{\"error\":\"Invalid authentication token\"}]";
+char FRAME_RELAY_COMMAND[] = "42[\"relay:command\",{\"relay_id\":2,\"state\":true}]";
+char FRAME_RELAY_COMMAND_INVALID[] = "42[\"relay:command\",{\"relay_id\":9,\"state\":true}]";
+char FRAME_SENSOR_REQUEST[] = "42[\"sensor:request\",{}]";
+char FRAME_LOG_LEVEL[] = "42[\"log:level\",{\"level\":\"error\",\"remote\":\"warn\"}]";
+char FRAME_TIME_SYNC[] = "42[\"time:sync\",{\"server_time\":1767225600000,\"t0\":1}]";
+
+template <size_t N>
+void inbound(char (&frame)[N]) {
+    MicroBenchAccess::handleMessage(frame, N - 1);
+    MicroBenchAccess::restoreSession();
+}
+
+void inEngineIoOpen() { inbound(FRAME_ENGINEIO_OPEN); }
+void inNamespaceAck() { inbound(FRAME_NAMESPACE_ACK); }
+void inEngineIoPing() { inbound(FRAME_ENGINEIO_PING); }
+void inSensorClimate() { inbound(FRAME_SENSOR_CLIMATE); }
+void inSensorStorm() { inbound(FRAME_SENSOR_STORM); }
+void inAuthSuccess() { inbound(FRAME_AUTH_SUCCESS); }
+void inAuthFailed() { inbound(FRAME_AUTH_FAILED); }
+void inRelayCommand() { inbound(FRAME_RELAY_COMMAND); }
+void inRelayCommandInvalid() { inbound(FRAME_RELAY_COMMAND_INVALID); }
+void inSensorRequest() { inbound(FRAME_SENSOR_REQUEST); }
+void inLogLevel() { inbound(FRAME_LOG_LEVEL); }
+void inTimeSync() { inbound(FRAME_TIME_SYNC); }
+
+// Sequenced command: a new seq every call, so each one is applied rather than dropped as a resend
+char frameRelayCommandSeq[128];
+uint32_t relayCommandSeq = 0;
+
+void inRelayCommandSeq() {
+    int length = snprintf(frameRelayCommandSeq, sizeof(frameRelayCommandSeq),
+                          "42[\"relay:command\",{\"relay_id\":2,\"state\":true,\"epoch\":\"9f0c12ab\",\"seq\":%u}]",
+                          (unsigned)++relayCommandSeq);
+    MicroBenchAccess::handleMessage(frameRelayCommandSeq, length);
+    MicroBenchAccess::restoreSession();
+}
+
+// ---------- Outbound frames ----------
+
+void outSensorData() {
+    boolSink = vpsWebSocket.sendSensorData(23.4f, 61.2f, 44.0f, 0, 0);
+}
+
+void outRelayState() {
+    boolSink = vpsWebSocket.sendRelayState(1, true, "auto", "rule");
+}
+
+void outRelayAck() {
+    MicroBenchAccess::sendRelayAck();
+}
+
+void outTimeProbe() {
+    MicroBenchAccess::sendTimeProbe();
+}
+
+void outMetricsDelta() {
+    boolSink = vpsWebSocket.sendMetrics();
+}
+
+void outMetricsFull() {
+    metricsRegistry.forceFull();
+    boolSink = vpsWebSocket.sendMetrics();
+}
+
+void outLogBatch() {
+    for (int i = 0; i < LOG_FORWARD_BATCH_MAX; i++) {
+        logForwarder.enqueue(LOG_LEVEL_WARN, "Temperature change too abrupt: 6.2°C change (max: 5.0°C)");
+    }
+    boolSink = MicroBenchAccess::sendLogBatch();
+}
+
+// ---------- Validation ----------
+
+// Small steps around a plausible value keep every call on the accepting path
+const float TEMPERATURES[] = {21.8f, 22.1f, 22.4f, 22.0f, 21.7f, 21.9f, 22.3f, 22.2f};
+const float HUMIDITIES[] = {55.0f, 55.6f, 56.1f, 55.4f, 54.8f, 55.2f, 55.9f, 55.3f};
+const float SOIL_RAW[] = {1200.0f, 1500.0f, 2100.0f, 2750.0f, 3300.0f, 3900.0f, 4095.0f, 4200.0f};
+unsigned validationIndex = 0;
+
+void validateTemperature() {
+    boolSink = sensors.validateTemperature(TEMPERATURES[validationIndex++ & 7]);
+}
+
+void validateHumidity() {
+    boolSink = sensors.validateHumidity(HUMIDITIES[validationIndex++ & 7]);
+}
+
+void soilToPercentage() {
+    floatSink = sensors.convertSoilMoistureToPercentage(SOIL_RAW[validationIndex++ & 7]);
+}
+
+// ---------- Relays and status (steady-state loop work: must never allocate) ----------
+
+unsigned relayIndex = 0;
+
+void relaySet() {
+    relayIndex++;
+    boolSink = relays.setRelay(relayIndex % 4, (relayIndex >> 2) & 1);
+}
+
+void relayStateStruct() {
+    RelayState state = relays.getRelayStateStruct(relayIndex++ % 4);
+    boolSink = state.is_on;
+}
+
+void relayName() {
+    stringSink = relays.relayName(relayIndex++ % 4);
+}
+
+void statusStrings() {
+    stringSink = vpsWebSocket.getStatus();
+    stringSink = sensors.getLastError();
+}
+
+// ---------- Anomaly detection (every sensor reading: must never allocate) ----------
+
+uint64_t anomalyClockMs = 1000;
+
+void anomalyObserve() {
+    SensorData data = {};
+    data.temperature = TEMPERATURES[validationIndex & 7];
+    data.humidity = HUMIDITIES[validationIndex & 7];
+    data.soil_moisture = 40.0f + (validationIndex++ & 3);
+    data.acquired_ms = anomalyClockMs += 5000;
+    data.valid = true;
+    anomalyDetector.observe(data);
+}
+
+struct Benchmark {
+    const char* name;
+    void (*op)();
+    bool json;  ///< Builds or parses JSON: measures the JSON library as much as the firmware
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"frame/sensor_data", outSensorData, true},
+    {"frame/relay_state", outRelayState, true},
+    {"frame/relay_ack", outRelayAck, true},
+    {"frame/time_sync", outTimeProbe, true},
+    {"frame/metrics_delta", outMetricsDelta, true},
+    {"frame/metrics_full", outMetricsFull, true},
+    {"frame/log_batch", outLogBatch, true},
+    {"parse/engineio_open", inEngineIoOpen, true},
+    {"parse/namespace_ack", inNamespaceAck, true},
+    {"parse/engineio_ping", inEngineIoPing, false},
+    {"parse/sensor_climate", inSensorClimate, true},
+    {"parse/sensor_storm", inSensorStorm, true},
+    {"parse/auth_success", inAuthSuccess, true},
+    {"parse/auth_failed", inAuthFailed, true},
+    {"parse/relay_command", inRelayCommand, true},
+    {"parse/relay_command_invalid", inRelayCommandInvalid, true},
+    {"parse/relay_command_seq", inRelayCommandSeq, true},
+    {"parse/sensor_request", inSensorRequest, true},
+    {"parse/log_level", inLogLevel, true},
+    {"parse/time_sync", inTimeSync, true},
+    {"relay/set", relaySet, false},
+    {"relay/state_struct", relayStateStruct, false},
+    {"relay/name", relayName, false},
+    {"status/strings", statusStrings, false},
+    {"validate/temperature", validateTemperature, false},
+    {"validate/humidity", validateHumidity, false},
+    {"validate/soil_percentage", soilToPercentage, false},
+    {"anomaly/observe", anomalyObserve, false},
+};
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+    size_t stackBytes;
+};
+
+// ---------- Stack high-water mark ----------
+
+const size_t BENCH_STACK_SIZE = 256 * 1024;
+const uint8_t STACK_PAINT = 0xA5;
+alignas(16) uint8_t benchStack[BENCH_STACK_SIZE];
+ucontext_t callerContext;
+ucontext_t benchContext;
+void (*stackOp)();
+
+void runOnBenchStack() {
+    // A few calls so first-use paths (lazy init, buffer growth) are included
+    for (int i = 0; i < 4; i++) {
+        stackOp();
+    }
+}
+
+size_t measureStack(void (*op)()) {
+    memset(benchStack, STACK_PAINT, sizeof(benchStack));
+    getcontext(&benchContext);
+    benchContext.uc_stack.ss_sp = benchStack;
+    benchContext.uc_stack.ss_size = sizeof(benchStack);
+    benchContext.uc_link = &callerContext;
+    stackOp = op;
+    makecontext(&benchContext, runOnBenchStack, 0);
+    swapcontext(&callerContext, &benchContext);
+
+    // The stack grows down: the first byte that lost its paint is the deepest one
+    size_t untouched = 0;
+    while (untouched < sizeof(benchStack) && benchStack[untouched] == STACK_PAINT) {
+        untouched++;
+    }
+    return sizeof(benchStack) - untouched;
+}
+
+// ---------- Timing ----------
+
+typedef std::chrono::steady_clock Clock;
+
+double timeBatch(void (*op)(), uint64_t iterations) {
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        op();
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+Result run(const Benchmark& benchmark, double minTimeNs, int repetitions) {
+    Result result;
+    result.name = benchmark.name;
+    result.stackBytes = measureStack(benchmark.op);
+
+    // Scale the batch until it runs for at least minTime
+    uint64_t iterations = 1;
+    double elapsed = timeBatch(benchmark.op, iterations);
+    while (elapsed < minTimeNs) {
+        double scale = elapsed > 0 ? minTimeNs / elapsed * 1.2 : 10.0;
+        iterations = (uint64_t)(iterations * std::min(std::max(scale, 2.0), 100.0));
+        elapsed = timeBatch(benchmark.op, iterations);
+    }
+
+    std::vector<double> samples;
+    samples.reserve(repetitions);  // Keep the harness out of the allocation count
+    hal::FirmwareHeapStats before = hal::firmwareHeapStats();
+    for (int r = 0; r < repetitions; r++) {
+        samples.push_back(timeBatch(benchmark.op, iterations) / iterations);
+    }
+    hal::FirmwareHeapStats after = hal::firmwareHeapStats();
+
+    // Best run: host scheduling noise only ever adds time
+    uint64_t ops = iterations * (uint64_t)repetitions;
+    result.nsPerOp = *std::min_element(samples.begin(), samples.end());
+    result.allocsPerOp = (double)(after.allocations - before.allocations) / ops;
+    result.bytesPerOp = (double)(after.bytesAllocated - before.bytesAllocated) / ops;
+    return result;
+}
+
+// ---------- Baseline file ----------
+//
+// One line per benchmark: <name> <ns/op> <allocs/op> <bytes/op> <stack bytes>.
+// The header names the JSON library the numbers were taken with: the JSON rows
+// of a baseline written against another ArduinoJson (or a stand-in header) are
+// skipped rather than compared.
+
+#ifdef ARDUINOJSON_VERSION
+const char* const JSON_LIBRARY = "ArduinoJson-" ARDUINOJSON_VERSION;
+const bool JSON_ALLOCATIONS_CHECKED = true;
+#else
+const char* const JSON_LIBRARY = "unknown";
+const bool JSON_ALLOCATIONS_CHECKED = false;
+#endif
+
+const Result* findResult(const std::vector<Result>& results, const std::string& name) {
+    for (const Result& result : results) {
+        if (result.name == name) {
+            return &result;
+        }
+    }
+    return nullptr;
+}
+
+bool loadBaseline(const char* path, std::vector<Result>& baseline, std::string& library) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open baseline %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char tag[64];
+        if (sscanf(line, "# json %63s", tag) == 1) {
+            library = tag;
+            continue;
+        }
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        char name[128];
+        Result entry;
+        if (sscanf(line, "%127s %lf %lf %lf %zu", name, &entry.nsPerOp, &entry.allocsPerOp, &entry.bytesPerOp,
+                   &entry.stackBytes) == 5) {
+            entry.name = name;
+            baseline.push_back(entry);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// With --filter only the matching rows are rewritten; the other rows of an
+// existing file are kept, so re-measuring one frame never hand-edits the rest
+bool writeBaseline(const char* path, const std::vector<Result>& measured, const char* filter) {
+    std::vector<Result> previous;
+    if (filter) {
+        FILE* existing = fopen(path, "r");
+        if (existing) {
+            fclose(existing);
+            std::string library;
+            loadBaseline(path, previous, library);
+            if (library != JSON_LIBRARY) {
+                fprintf(stderr, "baseline %s was written with json %s, this build has %s: write it without --filter\n",
+                        path, library.empty() ? "(not recorded)" : library.c_str(), JSON_LIBRARY);
+                return false;
+            }
+        }
+    }
+    std::vector<Result> results;
+    for (const Benchmark& benchmark : BENCHMARKS) {
+        const Result* row = findResult(measured, benchmark.name);
+        if (!row) {
+            row = findResult(previous, benchmark.name);
+        }
+        if (row) {
+            results.push_back(*row);
+        }
+    }
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "cannot write baseline %s\n", path);
+        return false;
+    }
+    fprintf(file, "# Microbenchmark baseline: bench/micro_bench.cpp --write-baseline\n");
+    fprintf(file, "# Host numbers: compare against a baseline written on the same machine and toolchain\n");
+    fprintf(file, "# json %s\n", JSON_LIBRARY);
+    fprintf(file, "# name ns_per_op allocs_per_op bytes_per_op stack_bytes\n");
+    for (const Result& result : results) {
+        fprintf(file, "%s %.1f %.2f %.1f %zu\n", result.name.c_str(), result.nsPerOp, result.allocsPerOp,
+                result.bytesPerOp, result.stackBytes);
+    }
+    fclose(file);
+    return true;
+}
+
+bool connectToSink() {
+    hal::setWebSocketPeer(&sink);
+    vpsWebSocket.begin();
+    for (int attempt = 0; attempt < 200 && !vpsWebSocket.isConnected(); attempt++) {
+        vpsWebSocket.loop();
+        delay(50);
+    }
+    return vpsWebSocket.isConnected();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* comparePath = nullptr;
+    const char* writePath = nullptr;
+    const char* filter = nullptr;
+    double minTimeMs = 200;
+    int repetitions = 5;
+    double tolerance = 0.25;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            comparePath = argv[++i];
+        } else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) {
+            writePath = argv[++i];
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minTimeMs = atof(argv[++i]) * 1000;
+        } else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]) / 100.0;
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--compare FILE] [--write-baseline FILE] [--filter SUBSTRING]\n"
+                    "          [--min-time SECONDS] [--repetitions N] [--tolerance PERCENT]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> baseline;
+    std::string baselineLibrary;
+    if (comparePath && !loadBaseline(comparePath, baseline, baselineLibrary)) {
+        return 2;
+    }
+    bool compareJson = baselineLibrary == JSON_LIBRARY;
+    if (comparePath && !compareJson) {
+        fprintf(stderr,
+                "baseline %s was written with json %s, this build has %s: JSON rows are not compared, "
+                "regenerate it with --write-baseline\n",
+                comparePath, baselineLibrary.empty() ? "(not recorded)" : baselineLibrary.c_str(), JSON_LIBRARY);
+    }
+
+    relays.begin();
+    sensors.begin();
+    if (!connectToSink()) {
+        fprintf(stderr, "[bench] WebSocket client did not connect to the in-process sink\n");
+        return 1;
+    }
+    // Every registered series in one frame: on the device a frame over the capacity is dropped
+    metricsRegistry.forceFull();
+    if (!vpsWebSocket.sendMetrics()) {
+        fprintf(stderr, "[bench] full metrics frame does not fit METRICS_JSON_CAPACITY (%d B)\n",
+                METRICS_JSON_CAPACITY);
+        return 1;
+    }
+    printf("full metrics frame: %zu of %d B\n", sink.lastFrameBytes, METRICS_JSON_CAPACITY);
+    // Largest config:state: every value plus CONFIG_REJECTED_KEYS_MAX rejected keys as long as
+    // the longest real one (memory_sample_interval_ms); an oversized event is not sent at all
+    char configSet[1024];
+    int configLength = snprintf(configSet, sizeof(configSet), "42[\"config:set\",{");
+    for (int i = 0; i < CONFIG_REJECTED_KEYS_MAX + 4; i++) {
+        configLength += snprintf(configSet + configLength, sizeof(configSet) - configLength,
+                                 "%s\"rejected_key_%012d\":1", i ? "," : "", i);
+    }
+    configLength += snprintf(configSet + configLength, sizeof(configSet) - configLength, "}]");
+    sink.lastFrameBytes = 0;
+    MicroBenchAccess::handleMessage(configSet, configLength);
+    if (sink.lastFrameBytes == 0) {
+        fprintf(stderr, "[bench] config:state does not fit CONFIG_STATE_FRAME_CAPACITY (%d B)\n",
+                CONFIG_STATE_FRAME_CAPACITY);
+        return 1;
+    }
+    printf("largest config:state frame: %zu of %d B\n\n", sink.lastFrameBytes, CONFIG_STATE_FRAME_CAPACITY);
+
+    std::vector<Result> results;
+    printf("%-30s %12s %10s %10s %10s%s\n", "benchmark", "ns/op", "allocs/op", "bytes/op", "stack B",
+           comparePath ? "   vs baseline" : "");
+    int regressions = 0;
+    int allocating = 0;
+    for (const Benchmark& benchmark : BENCHMARKS) {
+        if (filter && !strstr(benchmark.name, filter)) {
+            // Still one op: first-use paths land where a full run puts them, so the
+            // stack of a filtered row matches the full-run row
+            benchmark.op();
+            continue;
+        }
+        Result result = run(benchmark, minTimeMs * 1e6, repetitions);
+        results.push_back(result);
+        printf("%-30s %12.1f %10.2f %10.1f %10zu", result.name.c_str(), result.nsPerOp, result.allocsPerOp,
+               result.bytesPerOp, result.stackBytes);
+
+        if (result.allocsPerOp > 0 && (!benchmark.json || JSON_ALLOCATIONS_CHECKED)) {
+            printf("   ALLOCATES");
+            allocating++;
+        }
+        const Result* base = comparePath ? findResult(baseline, result.name) : nullptr;
+        if (comparePath && benchmark.json && !compareJson) {
+            printf("   (other json)");
+        } else if (comparePath && !base) {
+            printf("   (new)");
+        } else if (base) {
+            double change = base->nsPerOp > 0 ? (result.nsPerOp / base->nsPerOp - 1.0) * 100.0 : 0.0;
+            bool slower = result.nsPerOp > base->nsPerOp * (1.0 + tolerance);
+            bool moreAllocs = result.allocsPerOp > base->allocsPerOp + 0.01;
+            bool moreStack = result.stackBytes > base->stackBytes + 64;
+            printf("   %+6.1f%%%s%s%s", change, slower ? " SLOWER" : "", moreAllocs ? " ALLOCS" : "",
+                   moreStack ? " STACK" : "");
+            if (slower || moreAllocs || moreStack) {
+                regressions++;
+            }
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (writePath && !writeBaseline(writePath, results, filter)) {
+        return 2;
+    }
+    if (allocating > 0) {
+        printf("\n%d benchmark(s) allocated\n", allocating);
+    }
+    if (comparePath) {
+        printf("\n%d regression(s) against %s (tolerance %.0f%%)\n", regressions, comparePath, tolerance * 100);
+        return regressions > 0 || allocating > 0 ? 1 : 0;
+    }
+    return allocating > 0 ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+// Host check for the table-driven psychrometrics: sweeps temperature and
+// relative humidity over the range the firmware reports, compares every
+// derived value with the Magnus formula evaluated with exp/log in double
+// precision, and times both.
+//
+//   pio run -e native-psychro
+//   .pio/build/native-psychro/program
+//
+// Exits 1 when an error exceeds its PSYCHRO_MAX_* bound (psychrometrics.h).
+
+#include <Arduino.h>
+#include "psychrometrics.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const double MAGNUS_A = 0.61094;    // kPa
+const double MAGNUS_B = 17.625;
+const double MAGNUS_C = 243.04;     // °C
+
+double referenceSvp(double t) {
+    return MAGNUS_A * exp(MAGNUS_B * t / (t + MAGNUS_C));
+}
+
+double referenceDewPoint(double t, double rh) {
+    double gamma = log(rh / 100.0) + MAGNUS_B * t / (t + MAGNUS_C);
+    return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+double referenceAbsoluteHumidity(double t, double rh) {
+    return 2167.4 * referenceSvp(t) * rh / 100.0 / (t + 273.15);
+}
+
+// What the firmware would cost with libm in single precision
+float libmDewPoint(float t, float rh) {
+    float gamma = logf(rh / 100.0f) + 17.625f * t / (t + 243.04f);
+    return 243.04f * gamma / (17.625f - gamma);
+}
+
+struct Error {
+    const char* name;
+    const char* unit;
+    double bound;
+    double worst;
+    double atT;
+    double atRh;
+
+    void add(double error, double t, double rh) {
+        if (error > worst) {
+            worst = error;
+            atT = t;
+            atRh = rh;
+        }
+    }
+};
+
+double nowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+volatile float floatSink;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    (void)argv;
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    Error errors[] = {
+        {"svp", "relative", PSYCHRO_MAX_SVP_ERROR, 0, 0, 0},
+        {"dew point", "°C", PSYCHRO_MAX_DEW_POINT_ERROR_C, 0, 0, 0},
+        {"vpd", "kPa", PSYCHRO_MAX_VPD_ERROR_KPA, 0, 0, 0},
+        {"abs humid", "relative", PSYCHRO_MAX_AH_ERROR, 0, 0, 0},
+    };
+    size_t points = 0;
+    size_t floored = 0;
+    // 0.01 °C and 0.1 %RH steps: well below the table's 1 °C cells
+    for (int ti = -4000; ti <= 6000; ti++) {
+        float t = ti / 100.0f;
+        double svp = referenceSvp(t);
+        errors[0].add(fabs(Psychrometrics::saturationVaporPressure(t) - svp) / svp, t, 100);
+        for (int hi = 10; hi <= 1000; hi++) {
+            float rh = hi / 10.0f;
+            ClimateMetrics metrics;
+            psychrometrics.compute(t, rh, metrics);
+            double dewPoint = referenceDewPoint(t, rh);
+            if (dewPoint >= PSYCHRO_TABLE_MIN_C) {
+                errors[1].add(fabs(metrics.dewPoint - dewPoint), t, rh);
+            } else if (metrics.dewPoint > PSYCHRO_TABLE_MIN_C + PSYCHRO_MAX_DEW_POINT_ERROR_C) {
+                floored++;  // Below the table: must report its floor
+            }
+            errors[2].add(fabs(metrics.vpd - svp * (1.0 - rh / 100.0)), t, rh);
+            double ah = referenceAbsoluteHumidity(t, rh);
+            errors[3].add(fabs(metrics.absoluteHumidity - ah) / ah, t, rh);
+            points++;
+        }
+    }
+
+    int failures = floored > 0 ? 1 : 0;
+    printf("\n=== Psychrometrics (%zu points, -40..60 C, 1..100 %%RH, vs Magnus with exp/log) ===\n", points);
+    for (const Error& error : errors) {
+        bool ok = error.worst <= error.bound;
+        printf("%-10s max error %.5f %-8s (bound %.4f) at %6.2f C %5.1f %%RH  %s\n", error.name, error.worst,
+               error.unit, error.bound, error.atT, error.atRh, ok ? "ok" : "EXCEEDED");
+        if (!ok) {
+            failures++;
+        }
+    }
+
+    if (floored > 0) {
+        printf("  %zu dew points below %d C not reported as %d C\n", floored, PSYCHRO_TABLE_MIN_C, PSYCHRO_TABLE_MIN_C);
+    }
+
+    // Greenhouse range: a reading at DHT11 resolution every call
+    std::vector<float> temperatures;
+    std::vector<float> humidities;
+    for (int i = 0; i < 4096; i++) {
+        temperatures.push_back(5.0f + (i % 400) / 10.0f);
+        humidities.push_back((float)(20 + (i * 7) % 80));
+    }
+    const int rounds = 500;
+    ClimateMetrics metrics;
+    double start = nowNs();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < temperatures.size(); i++) {
+            psychrometrics.compute(temperatures[i], humidities[i], metrics);
+            floatSink = metrics.dewPoint;
+        }
+    }
+    double tableNs = (nowNs() - start) / (rounds * temperatures.size());
+    start = nowNs();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < temperatures.size(); i++) {
+            float t = temperatures[i];
+            float svp = 0.61094f * expf(17.625f * t / (t + 243.04f));
+            float vapor = svp * humidities[i] / 100.0f;
+            floatSink = libmDewPoint(t, humidities[i]) + (svp - vapor) + 2167.4f * vapor / (t + 273.15f);
+        }
+    }
+    double libmNs = (nowNs() - start) / (rounds * temperatures.size());
+    printf("cost       %.1f ns per reading (all metrics), %.1f ns with expf/logf\n", tableNs,
+           libmNs);
+
+    // Outdoor deltas and the inputs compute() refuses
+    psychrometrics.setOutdoor(12.0f, 90.0f);
+    bool outdoorOk = psychrometrics.compute(24.0f, 70.0f, metrics) && metrics.outdoor &&
+                     fabs(metrics.absoluteHumidityDelta -
+                          (referenceAbsoluteHumidity(24.0, 70.0) - referenceAbsoluteHumidity(12.0, 90.0))) < 0.05 &&
+                     fabs(metrics.outdoorDewPoint - referenceDewPoint(12.0, 90.0)) < PSYCHRO_MAX_DEW_POINT_ERROR_C;
+    psychrometrics.setOutdoor(NAN, 90.0f);
+    outdoorOk = outdoorOk && psychrometrics.compute(24.0f, 70.0f, metrics) && !metrics.outdoor;
+    psychrometrics.setOutdoor(12.0f, -1.0f);
+    outdoorOk = outdoorOk && !psychrometrics.hasOutdoor();
+    bool refusedOk = !psychrometrics.compute(NAN, 50.0f, metrics) && !psychrometrics.compute(20.0f, 101.0f, metrics) &&
+                     !psychrometrics.compute(20.0f, NAN, metrics);
+    printf("outdoor    deltas %s, missing/invalid readings refused %s\n", outdoorOk ? "ok" : "WRONG",
+           refusedOk ? "ok" : "WRONG");
+    if (!outdoorOk || !refusedOk) {
+        failures++;
+    }
+
+    printf("result     %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
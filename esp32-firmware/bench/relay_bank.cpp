@@ -0,0 +1,179 @@
+// Host check for the relay bank: drives RelayManager against the HAL's simulated I2C
+// bus (hal::attachI2cDevice) with random command bursts, then with an expander that
+// browns out and one that stops answering, and verifies every pin after each tick.
+//
+//   pio run -e native-relaybank
+//   .pio/build/native-relaybank/program [--ticks 20000] [--seed 1]
+//
+// Build with -D RELAY_EXPANDER_TYPE=RELAY_EXPANDER_PCF8575 to check the other backend.
+
+#include <Arduino.h>
+#include <hal_native.h>
+#include "config.h"
+#include "relays.h"
+
+#include <chrono>
+#include <random>
+
+#if RELAY_EXPANDER_COUNT == 0
+#error "bench/relay_bank.cpp needs RELAY_EXPANDER_COUNT > 0 (env:native-relaybank)"
+#endif
+
+namespace {
+
+const uint8_t FIRST_ADDRESS = RELAY_EXPANDER_BASE_ADDRESS;
+
+bool expected[RELAY_COUNT];
+int mismatches = 0;
+
+// Level a relay input must see for a channel to be ON
+bool onLevel(int relay) {
+    return relay < RELAY_GPIO_COUNT ? true : !RELAY_EXPANDER_ACTIVE_LOW;
+}
+
+bool pinIsOn(int relay) {
+    if (relay < RELAY_GPIO_COUNT) {
+        return hal::pinLevel(RelayManager::relayPins[relay]) == HIGH;
+    }
+    int channel = relay - RELAY_GPIO_COUNT;
+    uint16_t levels = hal::i2cPinLevels(FIRST_ADDRESS + channel / RELAY_CHANNELS_PER_EXPANDER);
+    bool high = (levels >> (channel % RELAY_CHANNELS_PER_EXPANDER)) & 1;
+    return high == onLevel(relay);
+}
+
+// Every channel (optionally skipping one expander) must match what was commanded
+void verify(const char* phase, int skipExpander = -1) {
+    for (int relay = 0; relay < RELAY_COUNT; relay++) {
+        if (relay >= RELAY_GPIO_COUNT && (relay - RELAY_GPIO_COUNT) / RELAY_CHANNELS_PER_EXPANDER == skipExpander) {
+            continue;
+        }
+        if (pinIsOn(relay) != expected[relay] || relays.getRelayState(relay) != expected[relay]) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "[relay] %s: relay %d (%s) pin %s, expected %s\n", phase, relay, relays.relayName(relay),
+                        pinIsOn(relay) ? "ON" : "OFF", expected[relay] ? "ON" : "OFF");
+            }
+        }
+    }
+}
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        mismatches++;
+        fprintf(stderr, "[relay] FAILED: %s\n", what);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned long ticks = 20000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--ticks N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Virtual clock: retry and refresh periods pass instantly
+    hal::useVirtualClock(1000000);
+    for (int e = 0; e < RELAY_EXPANDER_COUNT; e++) {
+        hal::attachI2cDevice(FIRST_ADDRESS + e, RELAY_EXPANDER_TYPE == RELAY_EXPANDER_MCP23017 ? hal::I2C_MCP23017
+                                                                                             : hal::I2C_PCF8575);
+    }
+    check(relays.begin(), "begin() with every expander present");
+    verify("after begin");
+
+    // Random bursts, as a dashboard scene or a rule sweep would send them
+    std::mt19937 rng(seed);
+    uint64_t commands = 0;
+    uint64_t busyTicks = 0;
+    uint64_t updateNs = 0;
+    hal::I2cStats before = hal::i2cStats();
+    unsigned long lastRefresh = millis();  // begin() starts the refresh period
+    for (unsigned long tick = 0; tick < ticks; tick++) {
+        bool chipChanged[RELAY_EXPANDER_COUNT] = {};
+        int burst = rng() % 9;
+        for (int k = 0; k < burst; k++) {
+            int relay = rng() % RELAY_COUNT;
+            bool state = rng() & 1;
+            if (relay >= RELAY_GPIO_COUNT && state != expected[relay]) {
+                chipChanged[(relay - RELAY_GPIO_COUNT) / RELAY_CHANNELS_PER_EXPANDER] = true;
+            }
+            expected[relay] = state;
+            relays.setRelay(relay, state);
+            commands++;
+        }
+        uint64_t transactionsBefore = hal::i2cStats().transactions;
+        auto t0 = std::chrono::steady_clock::now();
+        relays.update();
+        updateNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        uint64_t transactions = hal::i2cStats().transactions - transactionsBefore;
+
+        uint64_t changedChips = 0;
+        for (int e = 0; e < RELAY_EXPANDER_COUNT; e++) {
+            changedChips += chipChanged[e];
+        }
+        busyTicks += changedChips > 0;
+        // The periodic refresh reconfigures every expander instead (MCP23017: latch + direction)
+        uint64_t expectedTransactions = changedChips;
+        if (millis() - lastRefresh >= RELAY_BUS_REFRESH_MS) {
+            lastRefresh = millis();
+            expectedTransactions = RELAY_EXPANDER_COUNT * (RELAY_EXPANDER_TYPE == RELAY_EXPANDER_MCP23017 ? 2 : 1);
+        }
+        if (transactions != expectedTransactions) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "[relay] tick %lu: %llu transaction(s) for %llu changed expander(s)\n", tick,
+                        (unsigned long long)transactions, (unsigned long long)changedChips);
+            }
+        }
+        verify("burst");
+        hal::advanceClock(10000);  // LOOP_ITERATION_DELAY_MS
+    }
+    hal::I2cStats after = hal::i2cStats();
+    uint64_t writes = after.transactions - before.transactions;
+
+    // Brown-out of the last expander alone: pins fall back to inputs without a NACK
+    uint8_t victim = RELAY_EXPANDER_COUNT - 1;
+    hal::resetI2cDevice(FIRST_ADDRESS + victim);
+    hal::advanceClock((uint64_t)RELAY_BUS_REFRESH_MS * 1000);
+    relays.update();
+    verify("after brown-out and refresh");
+
+    // Expander stops answering: commands for it stay pending, the others keep working
+    hal::setI2cDeviceResponding(FIRST_ADDRESS + victim, false);
+    int victimRelay = RELAY_GPIO_COUNT + victim * RELAY_CHANNELS_PER_EXPANDER;
+    expected[victimRelay] = !expected[victimRelay];
+    relays.setRelay(victimRelay, expected[victimRelay]);
+    expected[1] = !expected[1];
+    relays.setRelay(1, expected[1]);
+    relays.update();
+    check(!relays.busSettled(), "busSettled() false while an expander NACKs");
+    verify("with an expander down", victim);
+    uint64_t nacksBefore = hal::i2cStats().nacks;
+    relays.update();
+    check(hal::i2cStats().nacks == nacksBefore, "no retry before RELAY_BUS_RETRY_MS");
+    hal::setI2cDeviceResponding(FIRST_ADDRESS + victim, true);
+    hal::resetI2cDevice(FIRST_ADDRESS + victim);  // Came back from a power cut
+    hal::advanceClock((uint64_t)RELAY_BUS_RETRY_MS * 1000);
+    relays.update();
+    check(relays.busSettled(), "busSettled() after the expander answers again");
+    verify("after recovery");
+
+    printf("\n=== Relay bank (%d channels: %d GPIO + %d x %s at 0x%02X, %s) ===\n", RELAY_COUNT, RELAY_GPIO_COUNT,
+           RELAY_EXPANDER_COUNT, RELAY_EXPANDER_TYPE == RELAY_EXPANDER_MCP23017 ? "MCP23017" : "PCF8575",
+           RELAY_EXPANDER_BASE_ADDRESS, RELAY_EXPANDER_ACTIVE_LOW ? "active low" : "active high");
+    printf("ticks             %lu (%llu with expander changes)\n", ticks, (unsigned long long)busyTicks);
+    printf("commands          %llu\n", (unsigned long long)commands);
+    printf("I2C writes        %llu (%.2f per command, %.2f per busy tick), %llu bytes\n", (unsigned long long)writes,
+           commands ? (double)writes / commands : 0.0, busyTicks ? (double)writes / busyTicks : 0.0,
+           (unsigned long long)(after.bytesWritten - before.bytesWritten));
+    printf("update()          %.0f ns mean (simulated bus)\n", ticks ? (double)updateNs / ticks : 0.0);
+    printf("faults            brown-out, NACK + recovery: %s\n", mismatches ? "FAILED" : "ok");
+    printf("mismatches        %d\n", mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,292 @@
+// Host check for the compressed sensor blocks: round-trips synthetic greenhouse
+// readings through SensorBlockEncoder / SensorBlockDecoder and reports readings
+// per block, bytes per reading against the sensor:data JSON frame, and the
+// encode and decode cost.
+//
+//   pio run -e native-sensorblock
+//   .pio/build/native-sensorblock/program [--seed 1] [--write block.bin]
+//
+// --write saves a DHT11 block and its readings (block.bin.txt, one
+// "t temperature humidity soil_moisture" line each) for the backend decoder:
+//   node backend/scripts/sensor-block.js block.bin | diff - block.bin.txt
+// Exits 1 on any round-trip mismatch.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "sensor_block.h"
+#include "vps_websocket.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+extern VPSWebSocketClient vpsWebSocket;
+
+namespace {
+
+const uint64_t SAMPLE_MS = SENSOR_READ_INTERVAL_MS;
+const float PI_F = 3.14159265f;
+
+struct Reading {
+    uint64_t t;
+    float values[SENSOR_BLOCK_CHANNELS];
+};
+
+enum Profile {
+    PROFILE_DHT11,      // 0.1 °C / 1 %RH steps, averaged ADC soil reading
+    PROFILE_FLOAT,      // Unquantized noise on every channel (worst case for XOR)
+    PROFILE_IRREGULAR   // DHT11 with loop jitter, missed reads and long gaps
+};
+
+const char* const PROFILE_NAMES[] = {"dht11", "float", "irregular"};
+
+/**
+ * Greenhouse readings every SAMPLE_MS: diurnal temperature and humidity, a
+ * soil probe drying slowly. Timestamps jitter by a few ms like the loop does.
+ */
+std::vector<Reading> makeReadings(Profile profile, size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    std::uniform_int_distribution<int> jitter(0, 12);
+    std::uniform_int_distribution<int> chance(0, 99);
+    std::vector<Reading> readings;
+    uint64_t t = 123456;
+    float soil = 55.0f;
+    for (size_t i = 0; i < count; i++) {
+        float hour = fmodf(t / 3600000.0f + 6.0f, 24.0f);
+        float phase = 2.0f * PI_F * (hour - 9.0f) / 24.0f;
+        float temperature = 19.0f + 5.0f * sinf(phase) + noise(rng);
+        float humidity = 65.0f - 12.0f * sinf(phase) + noise(rng) * 4.0f;
+        soil -= 1.0f / 360.0f;
+        Reading reading;
+        reading.t = t + jitter(rng);
+        if (profile == PROFILE_FLOAT) {
+            reading.values[0] = temperature;
+            reading.values[1] = humidity;
+        } else {
+            reading.values[0] = roundf(temperature * 10.0f) / 10.0f;
+            reading.values[1] = roundf(humidity);
+        }
+        // Ten-sample ADC average, converted like SensorManager does
+        float raw = roundf((4095.0f - (soil + noise(rng)) / 100.0f * 2595.0f) * 10.0f) / 10.0f;
+        reading.values[2] = 100.0f * (4095.0f - raw) / (4095.0f - 1500.0f);
+        readings.push_back(reading);
+
+        t += SAMPLE_MS;
+        if (profile == PROFILE_IRREGULAR) {
+            int roll = chance(rng);
+            if (roll < 5) {
+                t += SAMPLE_MS;             // A read skipped (DHT checksum error)
+            } else if (roll < 6) {
+                t += 37 * 60 * 1000ULL;     // Device busy or rebooting
+            } else if (roll < 20) {
+                t += jitter(rng) * 40;      // A slow loop iteration
+            }
+        }
+    }
+    return readings;
+}
+
+bool sameBits(float a, float b) {
+    return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+// Encode as many readings as fit from `from`, decode the block and compare; returns readings taken
+size_t roundTrip(SensorBlockEncoder& encoder, const std::vector<Reading>& readings, size_t from, int& failures) {
+    encoder.reset();
+    size_t i = from;
+    while (i < readings.size() && encoder.append(readings[i].t, readings[i].values)) {
+        i++;
+    }
+    SensorBlockDecoder decoder(encoder.data(), encoder.size());
+    if (!decoder.valid() || decoder.count() != i - from) {
+        printf("  block header mismatch: %u readings, %zu appended\n", decoder.count(), i - from);
+        failures++;
+        return i - from;
+    }
+    Reading decoded;
+    for (size_t j = from; j < i; j++) {
+        bool ok = decoder.next(decoded.t, decoded.values);
+        for (int c = 0; ok && c < SENSOR_BLOCK_CHANNELS; c++) {
+            ok = sameBits(decoded.values[c], readings[j].values[c]);
+        }
+        if (!ok || decoded.t != readings[j].t) {
+            printf("  reading %zu does not round-trip\n", j - from);
+            failures++;
+            break;
+        }
+    }
+    if (decoder.next(decoded.t, decoded.values)) {
+        printf("  decoder returned more readings than appended\n");
+        failures++;
+    }
+    return i - from;
+}
+
+// Size of the sensor:data frame the same reading costs when sent live
+size_t jsonFrameBytes(const Reading& reading) {
+    StaticJsonDocument<256> data;
+    vpsWebSocket.fillSensorData(data.to<JsonObject>(), reading.values[0], reading.values[1], reading.values[2], 0, 0,
+                                reading.t);
+    data["timestamp"] = 1767225600000ULL + reading.t;  // Synced clock, as in normal operation
+    char json[256];
+    return strlen("42[\"sensor:data\",]") + serializeJson(data, json, sizeof(json));
+}
+
+double nowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void runProfile(Profile profile, unsigned seed, int& failures) {
+    std::vector<Reading> readings = makeReadings(profile, 20000, seed);
+    SensorBlockEncoder encoder;
+    size_t blocks = 0;
+    size_t bytes = 0;
+    size_t minCount = SIZE_MAX;
+    for (size_t from = 0; from < readings.size(); blocks++) {
+        size_t taken = roundTrip(encoder, readings, from, failures);
+        if (taken == 0) {
+            failures++;
+            break;
+        }
+        if (from + taken < readings.size() && taken < minCount) {
+            minCount = taken;  // Full blocks only
+        }
+        bytes += encoder.size();
+        from += taken;
+    }
+
+    // Cost: encode and decode the same readings again, timed
+    double start = nowNs();
+    for (size_t from = 0; from < readings.size();) {
+        encoder.reset();
+        while (from < readings.size() && encoder.append(readings[from].t, readings[from].values)) {
+            from++;
+        }
+    }
+    double encodeNs = (nowNs() - start) / readings.size();
+    encoder.reset();
+    size_t n = 0;
+    while (n < readings.size() && encoder.append(readings[n].t, readings[n].values)) {
+        n++;
+    }
+    Reading decoded;
+    start = nowNs();
+    const int rounds = 50;
+    for (int r = 0; r < rounds; r++) {
+        SensorBlockDecoder decoder(encoder.data(), encoder.size());
+        while (decoder.next(decoded.t, decoded.values)) {
+        }
+    }
+    double decodeNs = (nowNs() - start) / (rounds * n);
+
+    double perReading = (double)bytes / readings.size();
+    double json = (double)jsonFrameBytes(readings[readings.size() / 2]);
+    printf("%-10s %5zu per %u B block  %5.2f B/reading  %5.1fx vs JSON (%3.0f B)  %4.1fx vs raw  "
+           "encode %5.1f ns  decode %5.1f ns\n",
+           PROFILE_NAMES[profile], minCount == SIZE_MAX ? readings.size() : minCount, (unsigned)SENSOR_BLOCK_MAX_BYTES,
+           perReading, json / perReading, json, (8.0 + 4.0 * SENSOR_BLOCK_CHANNELS) / perReading, encodeNs,
+           decodeNs);
+}
+
+// Values and timings the profiles never produce
+void edgeCases(int& failures) {
+    std::vector<Reading> readings;
+    const float specials[] = {0.0f, -0.0f, -1.0f, 1e-30f, 3.4e38f, INFINITY, -INFINITY, NAN, 23.4f, 23.4f, -40.0f};
+    uint64_t t = 0;
+    const int64_t steps[] = {0, 1, 64, 65, -63, 256, 257, -255, 2048, 2049, -2047, 3600000, 0, 1};
+    int64_t delta = 10000;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        delta += steps[i];
+        t += delta;
+        Reading reading;
+        reading.t = t;
+        for (int c = 0; c < SENSOR_BLOCK_CHANNELS; c++) {
+            reading.values[c] = specials[(i + c * 3) % (sizeof(specials) / sizeof(specials[0]))];
+        }
+        readings.push_back(reading);
+    }
+    SensorBlockEncoder encoder;
+    size_t taken = roundTrip(encoder, readings, 0, failures);
+    if (taken != readings.size()) {
+        printf("  edge cases: %zu of %zu readings taken\n", taken, readings.size());
+        failures++;
+    }
+
+    // Refused: time going backwards and a gap the 32-bit code cannot carry; the block stays intact
+    float values[SENSOR_BLOCK_CHANNELS] = {1.0f, 2.0f, 3.0f};
+    size_t size = encoder.size();
+    if (encoder.append(t - 1, values) || encoder.append(t + (1ULL << 31), values) || encoder.size() != size) {
+        printf("  edge cases: out-of-order reading accepted\n");
+        failures++;
+    }
+
+    // Truncated block: the decoder stops, it does not read past the end
+    SensorBlockDecoder truncated(encoder.data(), encoder.size() / 2);
+    Reading decoded;
+    size_t decodedCount = 0;
+    while (truncated.next(decoded.t, decoded.values)) {
+        decodedCount++;
+    }
+    if (decodedCount >= readings.size()) {
+        printf("  edge cases: truncated block decoded in full\n");
+        failures++;
+    }
+    printf("%-10s %zu readings round-trip, out-of-order refused, truncation stops at %zu\n", "edge", taken,
+           decodedCount);
+}
+
+bool writeSample(const char* path, unsigned seed) {
+    std::vector<Reading> readings = makeReadings(PROFILE_DHT11, 400, seed);
+    SensorBlockEncoder encoder;
+    size_t n = 0;
+    while (n < readings.size() && encoder.append(readings[n].t, readings[n].values)) {
+        n++;
+    }
+    FILE* block = fopen(path, "wb");
+    std::string textPath = std::string(path) + ".txt";
+    FILE* text = fopen(textPath.c_str(), "w");
+    if (!block || !text) {
+        return false;
+    }
+    fwrite(encoder.data(), 1, encoder.size(), block);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(text, "%llu %.7g %.7g %.7g\n", (unsigned long long)readings[i].t, readings[i].values[0],
+                readings[i].values[1], readings[i].values[2]);
+    }
+    fclose(block);
+    fclose(text);
+    printf("wrote %zu readings in %zu bytes to %s (readings in %s)\n", n, encoder.size(), path, textPath.c_str());
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    unsigned seed = 1;
+    const char* writePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+            writePath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--seed N] [--write block.bin]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (writePath) {
+        return writeSample(writePath, seed) ? 0 : 1;
+    }
+
+    int failures = 0;
+    printf("\n=== Sensor blocks (readings every %llu s, %d channels) ===\n", (unsigned long long)(SAMPLE_MS / 1000),
+           SENSOR_BLOCK_CHANNELS);
+    runProfile(PROFILE_DHT11, seed, failures);
+    runProfile(PROFILE_FLOAT, seed, failures);
+    runProfile(PROFILE_IRREGULAR, seed, failures);
+    edgeCases(failures);
+    printf("result     %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include "config.h"
+
+/**
+ * @class AllocCounter
+ * @brief Heap allocations made by the loop task, per loop iteration (debug builds)
+ *
+ * The steady-state paths (sensor reads, relay switching, frame building and
+ * parsing) are meant to run without touching the heap: on a device that runs
+ * for months every malloc/free pair is a chance to fragment it. This counter
+ * proves it. With ALLOC_COUNTER=1 the firmware build wraps malloc, calloc and
+ * realloc at link time (env:greenhouse-alloc-debug), so operator new and
+ * Arduino String are counted too; the native build counts the loop thread's
+ * operator new calls through the HAL, leaving out the host stand-ins' own
+ * buffers (hal::HostHeapScope).
+ *
+ * Key Features:
+ * - Only the task that called begin() is counted; WiFi, lwIP and the log
+ *   drain task allocate on their own schedule and are ignored
+ * - Iterations after the boot pipeline is ready feed the
+ *   loop_allocations_total and loop_allocating_iterations_total counters
+ * - Compiled out entirely with ALLOC_COUNTER=0 (the default)
+ */
+class AllocCounter {
+public:
+    AllocCounter();
+
+    /**
+     * @brief Start counting the calling task's allocations
+     */
+    void begin();
+
+    /**
+     * @brief Allocations by the counted task since begin()
+     */
+    uint32_t total() const;
+
+    /**
+     * @brief Close one loop iteration
+     * @param steady true once the boot pipeline is ready (iteration goes to the metrics)
+     */
+    void endIteration(bool steady);
+
+    /**
+     * @brief Allocations made during the last closed iteration
+     */
+    uint32_t lastIteration() const { return _lastIteration; }
+
+private:
+    uint32_t _mark;
+    uint32_t _lastIteration;
+};
+
+extern AllocCounter allocCounter;
+
+#endif
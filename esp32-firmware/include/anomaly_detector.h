@@ -0,0 +1,160 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include "config.h"
+
+/// Sensor channels watched by the anomaly detector
+enum AnomalyChannel {
+    ANOMALY_CHANNEL_TEMPERATURE = 0,
+    ANOMALY_CHANNEL_HUMIDITY,
+    ANOMALY_CHANNEL_SOIL,
+    ANOMALY_CHANNEL_COUNT
+};
+
+/// What a detector saw
+enum AnomalyKind {
+    ANOMALY_SPIKE = 0,      ///< EWMA z-score: one reading far from the recent mean
+    ANOMALY_DRIFT_UP,       ///< CUSUM: sustained rise above the level + trend prediction
+    ANOMALY_DRIFT_DOWN,     ///< CUSUM: sustained fall below the level + trend prediction
+    ANOMALY_STUCK,          ///< Identical readings for the channel's stuck window
+    ANOMALY_KIND_COUNT
+};
+
+/**
+ * @struct AnomalyEvent
+ * @brief One detection, as sent in a sensor:anomaly event
+ */
+struct AnomalyEvent {
+    AnomalyChannel channel;
+    AnomalyKind kind;
+    float value;            ///< Reading that raised it
+    float baseline;         ///< Prediction (drift, stuck) or fast mean (spike) before the reading
+    float sigma;            ///< Noise estimate the score is scaled by
+    float score;            ///< |z| (spike), CUSUM sum in sigmas (drift), seconds unchanged (stuck)
+    uint64_t acquiredMs;    ///< TimeBase::monotonicMs() of the reading
+};
+
+typedef void (*AnomalyCallback)(const AnomalyEvent& event);
+
+/**
+ * @class ChannelDetector
+ * @brief Constant-memory streaming detectors for one sensor channel
+ *
+ * Every reading updates exponentially weighted estimates, with time constants
+ * in seconds so a runtime change of the sensor interval does not retune them:
+ * a fast mean, a Holt level and trend (the prediction of the next reading)
+ * and the noise sigma, taken from successive differences so a slow trend does
+ * not inflate it.
+ *
+ * Key Features:
+ * - Spike: |reading - fast mean| / sigma above ANOMALY_Z_THRESHOLD
+ * - Drift: two-sided CUSUM of (reading - prediction) / sigma with allowance
+ *   ANOMALY_CUSUM_K; the diurnal swing and solar gain are predicted by the
+ *   trend, a change of course is not, and the sum crosses ANOMALY_CUSUM_H
+ *   where a fixed per-read gate never fires
+ * - Stuck: bit-identical readings for the channel's stuck window (a dead ADC
+ *   or a probe clamped at 0 %)
+ * - Sigma floor per channel (sensor resolution), so a quantized DHT11 sitting
+ *   on one value does not make every 1-count step an anomaly
+ * - While settling (after an actuator change) the prediction follows
+ *   the readings and the CUSUM is held, so a heater or pump doing its job is not
+ *   a drift
+ */
+class ChannelDetector {
+public:
+    ChannelDetector();
+
+    /**
+     * @brief Forget everything (warm-up starts again)
+     */
+    void reset();
+
+    /**
+     * @brief Feed one reading
+     * @param value Reading
+     * @param nowMs Acquisition time (monotonic ms)
+     * @param noiseFloor Smallest sigma used for scoring
+     * @param stuckMs Identical readings for this long raise ANOMALY_STUCK (0 = off)
+     * @param settling true while an actuator change is settling (drift suppressed)
+     * @param events Filled at [kind] for every detector that fired (channel left to the caller)
+     * @return Bit (1 << AnomalyKind) per detector that fired on this reading
+     */
+    uint8_t update(float value, uint64_t nowMs, float noiseFloor, uint32_t stuckMs, bool settling,
+                   AnomalyEvent events[ANOMALY_KIND_COUNT]);
+
+    float fastMean() const { return _fastMean; }
+    float level() const { return _level; }
+    float trend() const { return _trend; }
+    float sigma(float noiseFloor) const;
+    float cusumHigh() const { return _cusumHigh; }
+    float cusumLow() const { return _cusumLow; }
+    uint32_t samples() const { return _samples; }
+    /// Seconds the reading has been unchanged
+    float stuckSeconds(uint64_t nowMs) const { return (nowMs - _stuckSinceMs) / 1000.0f; }
+
+private:
+    float _fastMean;
+    float _level;           // Holt level and trend (per second): the drift prediction
+    float _trend;
+    float _diffVariance;    // EWMA of (successive difference)^2 / 2
+    float _cusumHigh;
+    float _cusumLow;
+    float _last;
+    uint64_t _lastMs;
+    uint64_t _stuckSinceMs;
+    uint32_t _samples;
+    uint8_t _latched;       // Bit per kind: spike/stuck raised and not cleared yet
+};
+
+/**
+ * @class AnomalyDetector
+ * @brief Runs a ChannelDetector per sensor channel and reports detections
+ *
+ * Fed from the sensor path with every new reading; a detection is handed to
+ * the callback at once (main.cpp sends it as sensor:anomaly), so the backend
+ * gets drifts and dead probes without scanning history.
+ *
+ * Key Features:
+ * - Temperature and humidity only from validated DHT readings; readings the
+ *   range/step gate rejected are already reported through the error counters
+ * - Spike and stuck stay latched until the condition clears; a drift
+ *   restarts the CUSUM from the current level. Either way the same channel
+ *   and kind is raised again no sooner than ANOMALY_REPEAT_MS
+ * - No heap use; a few hundred bytes of state in total
+ */
+class AnomalyDetector {
+public:
+    AnomalyDetector();
+
+    /**
+     * @brief Feed the latest sensor data (no-op if no new reading was taken)
+     */
+    void observe(const SensorData& data);
+
+    /**
+     * @brief A relay changed state: hold drift detection for ANOMALY_SETTLE_MS
+     */
+    void actuatorChanged(uint64_t nowMs);
+
+    void onAnomaly(AnomalyCallback callback);
+
+    const ChannelDetector& channel(AnomalyChannel channel) const { return _channels[channel]; }
+    uint32_t raisedCount() const { return _raised; }
+
+    static const char* channelName(AnomalyChannel channel);
+    static const char* kindName(AnomalyKind kind);
+
+private:
+    ChannelDetector _channels[ANOMALY_CHANNEL_COUNT];
+    uint64_t _lastRaisedMs[ANOMALY_CHANNEL_COUNT][ANOMALY_KIND_COUNT];
+    uint64_t _lastAcquiredMs;
+    uint64_t _settleUntilMs;
+    uint32_t _raised;
+    AnomalyCallback _callback;
+
+    void feed(AnomalyChannel channel, float value, uint64_t nowMs);
+};
+
+extern AnomalyDetector anomalyDetector;
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,97 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+
+/**
+ * @enum BootPhase
+ * @brief Milestones of the boot pipeline, in the order they usually complete
+ *
+ * Phases run concurrently, so the recorded times are not monotonic in this
+ * order (e.g. the first reading can land before or after WiFi).
+ */
+enum BootPhase {
+    BOOT_PHASE_HARDWARE,        ///< Relays in their boot state, sensors powered
+    BOOT_PHASE_FIRST_READING,   ///< First valid sensor reading after warm-up
+    BOOT_PHASE_WIFI,            ///< Associated and holding an IP address
+    BOOT_PHASE_TIME,            ///< SNTP produced a valid wall clock
+    BOOT_PHASE_WS_CONNECTED,    ///< WebSocket (and TLS) handshake completed
+    BOOT_PHASE_REGISTERED,      ///< device:auth_success received
+    BOOT_PHASE_READY,           ///< Initial relay states published to the backend
+    BOOT_PHASE_COUNT
+};
+
+/**
+ * @class BootTimeline
+ * @brief Records when each boot phase first completed (milliseconds since reset)
+ *
+ * The boot pipeline in setup()/loop() marks phases as they complete; only
+ * the first mark of each phase counts, so reconnects later in the uptime do
+ * not move the boot numbers. The timeline is reported once, as a
+ * `device:boot` event, on the first connection after BOOT_PHASE_READY (held
+ * back briefly so the first sensor reading is included).
+ *
+ * Key Features:
+ * - Fixed-size storage, safe to mark from any point in the pipeline
+ * - boot_first_reading_ms and boot_ready_ms gauges in the metrics registry
+ * - Phases that never completed are omitted from the report
+ */
+class BootTimeline {
+public:
+    BootTimeline();
+
+    /**
+     * @brief Record that a phase completed now (no-op if already recorded)
+     * @param phase Phase that completed
+     */
+    void mark(BootPhase phase);
+
+    /**
+     * @brief Check whether a phase has completed
+     * @param phase Phase to query
+     * @return true once mark() was called for the phase
+     */
+    bool reached(BootPhase phase) const { return _reached[phase]; }
+
+    /**
+     * @brief Time at which a phase completed
+     * @param phase Phase to query
+     * @return millis() at the first mark, 0 if not reached
+     */
+    uint32_t at(BootPhase phase) const { return _at[phase]; }
+
+    /**
+     * @brief Check whether the boot report is due
+     * @return true once ready and the first reading is in (or BOOT_REPORT_MAX_WAIT_MS
+     *         passed without one), until markReported()
+     */
+    bool reportPending() const;
+
+    /**
+     * @brief Add the reached phases to a report object ({"wifi": 812, ...})
+     * @param phases Destination object
+     */
+    void appendTo(JsonObject phases) const;
+
+    /**
+     * @brief Record that the report was delivered
+     */
+    void markReported() { _reported = true; }
+
+    /**
+     * @brief Short name of a phase as used in reports and logs
+     * @param phase Phase to name
+     * @return Static string
+     */
+    static const char* phaseName(BootPhase phase);
+
+private:
+    uint32_t _at[BOOT_PHASE_COUNT];
+    bool _reached[BOOT_PHASE_COUNT];
+    bool _reported;
+};
+
+extern BootTimeline bootTimeline;
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef CLIMATE_CONTROL_H
+#define CLIMATE_CONTROL_H
+
+#include "config.h"
+
+/// Actuators with an on-device loop
+enum ControlLoop {
+    CONTROL_LOOP_HEATER = 0,    ///< CONTROL_HEATER_RELAY, raises the temperature
+    CONTROL_LOOP_FAN,           ///< CONTROL_FAN_RELAY, lowers temperature and humidity
+    CONTROL_LOOP_COUNT
+};
+
+/**
+ * @struct ControlLoopState
+ * @brief What one loop did on its last tick
+ */
+struct ControlLoopState {
+    uint8_t mode;               ///< CONTROL_MODE_* in effect
+    float error;                ///< °C in the direction the actuator corrects (> 0: it should run)
+    float integral;             ///< PID integral term (duty)
+    float duty;                 ///< Requested duty cycle (0..1)
+    bool output;                ///< Relay state the loop is holding
+    bool humidityHold;          ///< Fan: forced on by CONTROL_FAN_HUMIDITY_MAX
+    uint64_t windowStartUs;     ///< Current time-proportioning window (0 = start one on the next tick)
+    uint32_t onTimeMs;          ///< On time of the current window
+    int32_t carryMs;            ///< On time owed (> 0) or given in excess (< 0) by earlier windows
+    uint64_t lastSwitchUs;      ///< Last relay change made by the loop
+    uint64_t overrideUntilUs;   ///< relay:command hold (0 = none)
+};
+
+typedef void (*ControlSwitchCallback)(int relayId, bool state);
+
+/**
+ * @class ClimateController
+ * @brief Closed-loop heater and fan control on the device
+ *
+ * Each loop reads the latest valid temperature every CONTROL_PERIOD_MS and
+ * either switches its relay around the setpoint (hysteresis) or computes a
+ * PID duty cycle that is applied through time-proportioning windows: the
+ * relay is on for duty × control_window_ms at the start of each window. Mode,
+ * setpoint and gains are runtime configuration (heater_*, fan_*, control_*
+ * keys of config:set) and are read on every tick.
+ *
+ * Key Features:
+ * - Fixed-rate ticks on the esp_timer clock, scheduled from loop() so relays
+ *   and the expander bus keep a single owner; late ticks are caught up with
+ *   the same dt, so the gains do not depend on the loop rate
+ * - Anti-windup by conditional integration: the integral only grows while the
+ *   output is not saturated in the same direction
+ * - Derivative on the filtered measurement, so a setpoint change does not kick
+ * - Minimum on and off times (control_min_switch_ms) in both modes; on time a
+ *   window cannot deliver is carried into the next ones, so low duties still
+ *   heat, in fewer, longer pulses
+ * - Fail safe: loops switch their relay off when the reading is older than
+ *   CONTROL_MAX_READING_AGE_MS or their mode is set to off
+ * - A relay:command (backend or LAN) on a controlled relay wins: the loop
+ *   leaves the relay alone for CONTROL_OVERRIDE_MS
+ * - Error, duty and relay cycles exported as metrics per loop
+ */
+class ClimateController {
+public:
+    ClimateController();
+
+    /**
+     * @brief Run the ticks that are due; called every loop iteration
+     * @param reading Latest sensor data (invalid readings are ignored)
+     */
+    void loop(const SensorData& reading);
+
+    /**
+     * @brief Manual command on a relay: hold its loop for CONTROL_OVERRIDE_MS
+     * @return true if a loop controls that relay
+     */
+    bool overrideRelay(int relayId);
+
+    /**
+     * @brief Called after every relay change the controller makes
+     */
+    void onSwitch(ControlSwitchCallback callback) { _switchCallback = callback; }
+
+    const ControlLoopState& state(ControlLoop loop) const { return _loops[loop]; }
+
+    static const char* loopName(ControlLoop loop);
+
+private:
+    ControlLoopState _loops[CONTROL_LOOP_COUNT];
+    ControlSwitchCallback _switchCallback;
+    uint64_t _nextTickUs;       ///< 0 = not started
+    uint64_t _readingMs;        ///< acquired_ms of the reading in use (0 = none yet)
+    float _temperature;
+    float _humidity;
+    float _slope;               ///< Filtered temperature change (°C/min)
+
+    void take(const SensorData& reading);
+    void tick(uint64_t nowUs);
+    void runLoop(ControlLoop loop, uint64_t nowUs, bool fresh);
+    bool runPid(ControlLoopState& state, ControlLoop loop, uint64_t nowUs);
+    bool runHysteresis(ControlLoopState& state, ControlLoop loop);
+    void drive(ControlLoop loop, bool on, uint64_t nowUs);
+};
+
+extern ClimateController climateControl;
+
+#endif // CLIMATE_CONTROL_H
@@ -53,17 +53,27 @@
     #define LOG_WARNF(...) ((void)0)
     #define LOG_INFOF(...) ((void)0)
     #define LOG_DEBUGF(...) ((void)0)
-    // Legacy macros for backward compatibility
+    
     #define DEBUG_PRINT(...) ((void)0)
     #define DEBUG_PRINTLN(...) ((void)0)
     #define DEBUG_PRINTF(...) ((void)0)
 #else
+    #include "deferred_log.h"
+
     #define DEBUG_SERIAL_BEGIN(x) Serial.begin(x)
-    
+
+    // All log macros only enqueue a record in the deferred logger ring; the
+    // drain task formats and prints it. Messages must be string literals
+    // (printf-style forms take literal formats), values go in the arguments.
+    static inline void logFormatCheck(const char*, ...) __attribute__((format(printf, 1, 2)));
+    static inline void logFormatCheck(const char*, ...) {}
+    #define LOG_RECORD(level, fmt, ...) \
+        (false ? logFormatCheck(fmt, ##__VA_ARGS__) : deferredLog.log(level, LOG_FORMAT_REF(fmt), ##__VA_ARGS__))
+
     // Error level (always shown if LOG_LEVEL >= 1)
     #if LOG_LEVEL >= 1
-        #define LOG_ERROR(...) Serial.print("❌ ERROR: "); Serial.println(__VA_ARGS__)
-        #define LOG_ERRORF(...) Serial.print("❌ ERROR: "); Serial.printf(__VA_ARGS__)
+        #define LOG_ERROR(...) LOG_RECORD(LOG_LEVEL_ERROR, __VA_ARGS__ "\n")
+        #define LOG_ERRORF(...) LOG_RECORD(LOG_LEVEL_ERROR, __VA_ARGS__)
     #else
         #define LOG_ERROR(...) ((void)0)
         #define LOG_ERRORF(...) ((void)0)
@@ -71,8 +81,8 @@
     
     // Warn level (shown if LOG_LEVEL >= 2)
     #if LOG_LEVEL >= 2
-        #define LOG_WARN(...) Serial.print("⚠ WARN: "); Serial.println(__VA_ARGS__)
-        #define LOG_WARNF(...) Serial.print("⚠ WARN: "); Serial.printf(__VA_ARGS__)
+        #define LOG_WARN(...) LOG_RECORD(LOG_LEVEL_WARN, __VA_ARGS__ "\n")
+        #define LOG_WARNF(...) LOG_RECORD(LOG_LEVEL_WARN, __VA_ARGS__)
     #else
         #define LOG_WARN(...) ((void)0)
         #define LOG_WARNF(...) ((void)0)
@@ -80,8 +90,8 @@
     
     // Info level (shown if LOG_LEVEL >= 3)
     #if LOG_LEVEL >= 3
-        #define LOG_INFO(...) Serial.print("ℹ INFO: "); Serial.println(__VA_ARGS__)
-        #define LOG_INFOF(...) Serial.print("ℹ INFO: "); Serial.printf(__VA_ARGS__)
+        #define LOG_INFO(...) LOG_RECORD(LOG_LEVEL_INFO, __VA_ARGS__ "\n")
+        #define LOG_INFOF(...) LOG_RECORD(LOG_LEVEL_INFO, __VA_ARGS__)
     #else
         #define LOG_INFO(...) ((void)0)
         #define LOG_INFOF(...) ((void)0)
@@ -89,15 +99,16 @@
     
     // Debug level (shown if LOG_LEVEL >= 4)
     #if LOG_LEVEL >= 4
-        #define LOG_DEBUG(...) Serial.println(__VA_ARGS__)
-        #define LOG_DEBUGF(...) Serial.printf(__VA_ARGS__)
+        #define LOG_DEBUG(...) LOG_RECORD(LOG_LEVEL_DEBUG, __VA_ARGS__ "\n")
+        #define LOG_DEBUGF(...) LOG_RECORD(LOG_LEVEL_DEBUG, __VA_ARGS__)
+        #define DEBUG_PRINT(...) LOG_RECORD(LOG_LEVEL_DEBUG, __VA_ARGS__)
     #else
         #define LOG_DEBUG(...) ((void)0)
         #define LOG_DEBUGF(...) ((void)0)
+        #define DEBUG_PRINT(...) ((void)0)
     #endif
     
     // Legacy macros - map to DEBUG level for backward compatibility
-    #define DEBUG_PRINT(...) Serial.print(__VA_ARGS__)
     #define DEBUG_PRINTLN(...) LOG_DEBUG(__VA_ARGS__)
     #define DEBUG_PRINTF(...) LOG_DEBUGF(__VA_ARGS__)
 #endif
@@ -106,16 +117,66 @@
 // Mapeo de pines separado en pins.h para facilitar variantes
 #include "pins.h"
 
+// ========== BANCO DE RELÉS ==========
+// Canales 0-3: relés GPIO de pins.h. Cada expansor I2C añade 16 canales a continuación.
+#define RELAY_EXPANDER_NONE             0
+#define RELAY_EXPANDER_MCP23017         1
+#define RELAY_EXPANDER_PCF8575          2
+#ifndef RELAY_EXPANDER_TYPE
+#define RELAY_EXPANDER_TYPE             RELAY_EXPANDER_NONE  // Expander chip (all expanders on the bus are the same type)
+#endif
+#ifndef RELAY_EXPANDER_COUNT
+#define RELAY_EXPANDER_COUNT            0       // Expanders at consecutive addresses (0-3)
+#endif
+#ifndef RELAY_EXPANDER_BASE_ADDRESS
+#define RELAY_EXPANDER_BASE_ADDRESS     0x20    // 7-bit address of the first expander (A2..A0 low)
+#endif
+#ifndef RELAY_EXPANDER_ACTIVE_LOW
+#if RELAY_EXPANDER_TYPE == RELAY_EXPANDER_PCF8575
+#define RELAY_EXPANDER_ACTIVE_LOW       1       // PCF8575 powers up high: only active-low boards start OFF
+#else
+#define RELAY_EXPANDER_ACTIVE_LOW       0       // 1 = relay board input energizes on a low pin
+#endif
+#endif
+#define I2C_CLOCK_HZ                    400000  // Fast mode: a 16-channel flush is ~100 us on the wire
+#define RELAY_BUS_RETRY_MS              1000    // Retry period for an expander that NACKed
+#define RELAY_BUS_REFRESH_MS            30000   // Rewrite config + outputs of every expander (brown-out recovery)
+#define RELAY_GPIO_COUNT                4
+#define RELAY_CHANNELS_PER_EXPANDER     16
+#define RELAY_COUNT                     (RELAY_GPIO_COUNT + RELAY_CHANNELS_PER_EXPANDER * RELAY_EXPANDER_COUNT)
+#define RELAY_MAX_COUNT                 64      // Backend caps relay_id at RELAY_MAX_COUNT - 1
+#define RELAY_NAME_MAX                  12      // Relay name, terminator included
+
+#if RELAY_EXPANDER_COUNT > 0 && RELAY_EXPANDER_TYPE == RELAY_EXPANDER_NONE
+#error "RELAY_EXPANDER_COUNT needs RELAY_EXPANDER_TYPE (MCP23017 or PCF8575)"
+#endif
+#if RELAY_COUNT > RELAY_MAX_COUNT
+#error "RELAY_COUNT exceeds RELAY_MAX_COUNT"
+#endif
+
 // ========== CONFIGURACIÓN DE SISTEMA ==========
 // WiFi credentials se definen solo en secrets.h
-#define WIFI_CONNECT_TIMEOUT_MS 15000
-#define WIFI_RETRY_BASE_MS      5000
+#define WIFI_CONNECT_TIMEOUT_MS         15000   // Full-scan join (scan + association + DHCP) before backing off
+#define WIFI_FAST_CONNECT_TIMEOUT_MS    4000    // Join on the cached BSSID/channel before falling back to a scan
+#define WIFI_RETRY_BASE_MS              5000    // First retry delay after a failed scan join (doubles per round)
+#define WIFI_RETRY_MAX_MS               30000   // Retry delay cap while the access point stays unreachable
+#ifndef WIFI_REUSE_LEASE
+#define WIFI_REUSE_LEASE                0       // 1 = reuse the cached DHCP lease as static config (skips DHCP;
+                                                //     only safe with a reservation on the router)
+#endif
 
 
 // NTP y tiempo
 #define NTP_SERVER          "pool.ntp.org"
 #define GMT_OFFSET_SEC      -10800
 #define DAYLIGHT_OFFSET_SEC 0
+#define NTP_VALID_EPOCH     1577836800  // Clock before 2020-01-01 = SNTP not synced yet
+#define TIME_SNTP_RESYNC_MS             3600000 // SNTP resync period; drift is estimated between syncs
+#define TIME_SNTP_RETRY_MS              60000   // Restart SNTP when a sync is this overdue
+#define TIME_DRIFT_MIN_SPAN_MS          600000  // Shortest span between syncs used for a drift estimate
+#define TIME_DRIFT_MAX_PPM              500     // Larger estimates are treated as a bad sync
+#define TIME_SERVER_PROBE_INTERVAL_MS   600000  // time:sync offset probe period while authenticated
+#define TIME_SERVER_SAMPLES             8       // Probes kept; the one with the lowest RTT is used
 
 // ========== LÍMITES DE SEGURIDAD ==========
 #define MAX_TEMP_CELSIUS        35.0f
@@ -147,6 +208,73 @@
 // Error handling
 #define SENSOR_MAX_CONSECUTIVE_ERRORS 3     // Max errors before marking sensor as faulty
 
+// ========== DETECCIÓN DE ANOMALÍAS (STREAMING) ==========
+// Detectores por canal sobre cada lectura: z-score EWMA, CUSUM y valor congelado (ver anomaly_detector.h)
+#define ANOMALY_WARMUP_SAMPLES          30      // Readings per channel before any detector may fire
+#define ANOMALY_FAST_TAU_S              60      // Time constant of the mean spikes are measured against
+#define ANOMALY_LEVEL_TAU_S             600     // Level time constant of the drift prediction
+#define ANOMALY_TREND_TAU_S             1800    // Trend time constant of the drift prediction
+#define ANOMALY_NOISE_TAU_S             600     // Time constant of the noise (sigma) estimate
+#define ANOMALY_Z_THRESHOLD             6.0f    // |z| that raises a spike
+#define ANOMALY_CUSUM_K                 1.0f    // CUSUM allowance per reading (sigmas)
+#define ANOMALY_CUSUM_H                 40.0f   // CUSUM decision threshold (sigmas)
+#define ANOMALY_SETTLE_MS               900000  // Drift held this long after a relay change (15 min)
+#define ANOMALY_REPEAT_MS               1800000 // Same channel and kind raised at most every 30 min
+#define ANOMALY_TEMP_NOISE_FLOOR        0.5f    // Sigma floor (°C); DHT11 temperature steps are 0.1 °C
+#define ANOMALY_HUMIDITY_NOISE_FLOOR    1.0f    // Sigma floor (%RH); DHT11 humidity steps are 1 %
+#define ANOMALY_SOIL_NOISE_FLOOR        1.0f    // Sigma floor (% soil moisture)
+#define ANOMALY_TEMP_STUCK_MS           7200000 // Identical temperature for 2 h
+#define ANOMALY_HUMIDITY_STUCK_MS       21600000 // Identical humidity for 6 h (whole-percent steps sit still for hours)
+#define ANOMALY_SOIL_STUCK_MS           3600000 // Identical soil reading for 1 h (ADC noise keeps a live probe moving)
+
+// ========== BLOQUES COMPRIMIDOS DE LECTURAS ==========
+// Lecturas tomadas sin conexión, comprimidas estilo Gorilla y subidas como sensor:block (ver sensor_block.h)
+#define SENSOR_BLOCK_MAX_BYTES          2048    // Encoded block buffer, header included (bytes)
+
+// ========== HISTÓRICO EN FLASH ==========
+// Log circular de lecturas sobre la partición spiffs, consultado con sensor:history (ver history_store.h)
+#define HISTORY_PARTITION_LABEL         "spiffs"
+#define HISTORY_MAX_SECTORS             384     // Sparse index entries (the 1.3 MB partition has 336 sectors)
+#define HISTORY_MIN_BLOCK_BYTES         256     // Less space left in a sector starts the next one (bytes)
+#ifndef HISTORY_SEAL_INTERVAL_MS
+#define HISTORY_SEAL_INTERVAL_MS        600000  // RAM block written to flash at least every 10 minutes (ms)
+#endif
+#define HISTORY_RETENTION_DAYS          30      // Older readings are not served (days; the ring may wrap sooner)
+#define HISTORY_MIN_STEP_MS             1000    // Smallest sensor:history bucket (ms)
+#define HISTORY_MAX_BUCKETS             4096    // Buckets per sensor:history query
+#define HISTORY_CHUNK_BUCKETS           32      // Buckets per sensor:history:chunk (44 bytes each)
+#define HISTORY_QUERY_BUDGET_READINGS   256     // Readings aggregated per loop iteration
+
+// ========== MÉTRICAS AGRONÓMICAS ==========
+// VPD, punto de rocío y humedad absoluta en cada sensor:data (ver psychrometrics.h)
+#define CLIMATE_OUTDOOR_MAX_AGE_MS      1800000 // sensor:climate outdoor values older than this are dropped (ms)
+
+// ========== CONTROL CLIMÁTICO ==========
+// Lazos en el dispositivo para calefactor y ventilador (ver climate_control.h); se ajustan con config:set
+#define CONTROL_HEATER_RELAY            3       // Relay driven by the heating loop
+#define CONTROL_FAN_RELAY               1       // Relay driven by the cooling loop
+#define CONTROL_PERIOD_MS               1000    // Controller tick (ms)
+#define CONTROL_MODE_OFF                0       // Loop disabled: the relay follows relay:command only
+#define CONTROL_MODE_HYSTERESIS         1       // On/off around the setpoint (± half of control_band)
+#define CONTROL_MODE_PID                2       // PI(D) duty cycle through time-proportioning windows
+#define CONTROL_HEATER_MODE             CONTROL_MODE_OFF
+#define CONTROL_HEATER_SETPOINT         17.5f   // °C
+#define CONTROL_HEATER_KP               0.4f    // Duty per °C of error
+#define CONTROL_HEATER_KI               0.02f   // Duty per °C·min of accumulated error
+#define CONTROL_HEATER_KD               0.0f    // Duty per °C/min of temperature change
+#define CONTROL_FAN_MODE                CONTROL_MODE_OFF
+#define CONTROL_FAN_SETPOINT            26.5f   // °C
+#define CONTROL_FAN_KP                  0.3f    // Duty per °C of error
+#define CONTROL_FAN_KI                  0.015f  // Duty per °C·min of accumulated error
+#define CONTROL_FAN_KD                  0.0f    // Duty per °C/min of temperature change
+#define CONTROL_FAN_HUMIDITY_MAX        85.0f   // Fan forced on above this unless the heater is below its setpoint (%RH; 100 = never)
+#define CONTROL_HUMIDITY_BAND           10.0f   // ...until humidity falls this far below it (%RH)
+#define CONTROL_BAND_C                  2.0f    // Hysteresis mode: width of the band around the setpoint (°C)
+#define CONTROL_WINDOW_MS               600000  // Time-proportioning window (ms): at most 144 relay cycles a day
+#define CONTROL_MIN_SWITCH_MS           60000   // Shortest on or off time of a controlled relay (ms)
+#define CONTROL_MAX_READING_AGE_MS      60000   // Older readings switch the loops off (ms)
+#define CONTROL_OVERRIDE_MS             1800000 // A relay:command on a controlled relay holds its loop (ms)
+
 // ========== CONFIGURACIÓN DE MÉTRICAS ==========
 #ifndef LOOP_EMA_ALPHA
 #define LOOP_EMA_ALPHA 0.05f
@@ -167,20 +295,14 @@
 #define SOIL_MOISTURE_WET_VALUE    1000
 
 // ========== TIMEOUTS Y DELAYS ==========
-// WiFi & Network
-#define WIFI_CONNECT_DELAY_MS           500     // Delay between WiFi connection attempts
-#define WIFI_FAILED_RESTART_DELAY_MS    5000    // Delay before restart on WiFi failure
-#define NTP_SYNC_RETRY_DELAY_MS         500     // Delay between NTP sync attempts
-
 // WebSocket Connection
 #define WS_HEARTBEAT_PING_INTERVAL_MS   15000   // WebSocket ping interval
 #define WS_HEARTBEAT_PONG_TIMEOUT_MS    3000    // WebSocket pong timeout
 #define WS_RECONNECT_INTERVAL_MS        5000    // WebSocket reconnection interval
-#define WS_PING_IDLE_THRESHOLD_MS       30000   // Send ping if no activity for 30s
-#define WS_REGISTRATION_TIMEOUT_MS      3000    // Device registration timeout
-#define WS_REGISTRATION_DELAY_MS        100     // Delay before registration
-#define WS_CONNECTION_CHECK_DELAY_MS    500     // Delay between connection checks
-#define WS_INITIAL_STATE_DELAY_MS       2000    // Delay after sending initial states
+#define WS_ENGINEIO_PING_INTERVAL_MS    25000   // Server ping period until the open packet gives pingInterval
+#define WS_ENGINEIO_PING_TIMEOUT_MS     20000   // Grace after a missed ping until the open packet gives pingTimeout
+#define WS_ENGINEIO_MIN_PING_MS         1000    // Open packet values are clamped to this range
+#define WS_ENGINEIO_MAX_PING_MS         600000
 
 // Authentication & Circuit Breaker
 #define AUTH_BACKOFF_BASE_MS            30000   // Base delay for auth retry (30s)
@@ -188,7 +310,7 @@
 #define AUTH_BACKOFF_JITTER_PERCENT     10      // ±10% jitter for backoff
 
 // Health Checks & Monitoring
-#define HEALTH_CHECK_INTERVAL_MS        60000   // Check VPS health every 60s
+#define HEALTH_CHECK_INTERVAL_MS        60000   // Check VPS health (one link recovery rung) every 60s
 #define METRICS_SEND_INTERVAL_MS        300000  // Send metrics every 5 minutes
 #define CIRCUIT_BREAKER_THRESHOLD       10      // Open circuit after 10 consecutive failures
 #define CIRCUIT_BREAKER_TIMEOUT_MS      300000  // Circuit breaker timeout (5 minutes)
@@ -197,15 +319,104 @@
 
 // Sensor Reading
 #define SENSOR_READ_MIN_INTERVAL_MS     2000    // Minimum interval between sensor reads
-#define DHT_INIT_STABILIZE_DELAY_MS     2000    // DHT stabilization delay on init
+#ifndef DHT_INIT_STABILIZE_DELAY_MS
+#define DHT_INIT_STABILIZE_DELAY_MS     2000    // DHT warm-up after begin() (reads skipped, not waited for)
+#endif
+#ifndef SOIL_MOISTURE_READ_DELAY_MS
 #define SOIL_MOISTURE_READ_DELAY_MS     10      // Delay between soil moisture samples
-
-// Relay Control
-#define RELAY_STATE_SEND_DELAY_MS       100     // Delay between relay state transmissions
+#endif
 
 // System Startup
-#define SYSTEM_STARTUP_DELAY_MS         1000    // Delay after serial init
+#define BOOT_REPORT_MAX_WAIT_MS         30000   // Send the boot report without a first reading after this
+#ifndef LOOP_ITERATION_DELAY_MS
 #define LOOP_ITERATION_DELAY_MS         10      // Delay in main loop iteration
+#endif
+
+// ========== FAILOVER DE ENDPOINTS ==========
+// Backend endpoints come from VPS_ENDPOINTS (vps_config.h); with a single one nothing is probed
+#define ENDPOINT_MAX                    4       // Entries of VPS_ENDPOINTS used, the rest are ignored
+#define ENDPOINT_HOST_MAX_LENGTH        48      // Per-endpoint host buffer, terminator included
+#ifndef ENDPOINT_PROBE_INTERVAL_MS
+#define ENDPOINT_PROBE_INTERVAL_MS      30000   // Each endpoint is probed this often while connected
+#endif
+#define ENDPOINT_PROBE_FAST_MS          1000    // Spacing between probes while disconnected
+#define ENDPOINT_PROBE_TIMEOUT_MS       2000    // A TCP connect slower than this fails the probe
+#define ENDPOINT_PROBE_FAILURES         2       // Consecutive failed probes that make an endpoint unhealthy
+#define ENDPOINT_RTT_EMA_ALPHA          0.3f    // Weight of the newest probe in the smoothed RTT
+#ifndef ENDPOINT_CONNECT_TIMEOUT_MS
+#define ENDPOINT_CONNECT_TIMEOUT_MS     8000    // No WebSocket on the active endpoint for this long: fail over
+#endif
+#ifndef ENDPOINT_FAILBACK_HOLD_MS
+#define ENDPOINT_FAILBACK_HOLD_MS       60000   // A better endpoint must stay healthy this long to be switched to
+#endif
+#define ENDPOINT_FAILBACK_HOLD_MAX_MS   960000  // Hold doubles per failed connection to the endpoint, up to this
+#define ENDPOINT_RANK_PENALTY_MS        50      // RTT handicap per position in the list (keeps to the primary)
+#define ENDPOINT_SWITCH_MARGIN_MS       20      // Extra advantage needed to leave a working endpoint
+#define ENDPOINT_DNS_REFRESH_MS         600000  // Endpoint names are re-resolved this often (asynchronous lookup)
+
+// ========== RECUPERACIÓN DEL ENLACE ==========
+// One rung (socket, TLS, reassociation, WiFi driver) per health_check_interval_ms without the backend
+#ifndef LINK_RECOVERY_REBOOT_AFTER_MS
+#define LINK_RECOVERY_REBOOT_AFTER_MS   1800000 // Outage before the last rung, a reboot (30 min)
+#endif
+#define LINK_RECOVERY_REBOOT_MAX_MS     14400000 // Doubles per reboot of the same outage, up to this (4 h)
+
+
+// ========== MONITOREO DE MEMORIA ==========
+#ifndef MEMORY_SAMPLE_INTERVAL_MS
+#define MEMORY_SAMPLE_INTERVAL_MS       5000    // Heap/stack sampling period
+#endif
+#define MEMORY_SERIES_BUCKETS           5       // Min/max buckets per metrics report (each metrics_interval_ms / 5 wide)
+#define MEMORY_MAX_TRACKED_TASKS        6       // Tasks included in the stack high-water report
+#ifndef ALLOC_COUNTER
+#define ALLOC_COUNTER                   0       // 1 = count loop-task heap allocations (needs the malloc --wrap link flags)
+#endif
+
+// Low-memory shedding: optional work (remote logs, backfill) is skipped below these values
+#ifndef LOW_MEMORY_FREE_THRESHOLD
+#define LOW_MEMORY_FREE_THRESHOLD       24576   // Free 8-bit heap in bytes
+#endif
+#ifndef LOW_MEMORY_BLOCK_THRESHOLD
+#define LOW_MEMORY_BLOCK_THRESHOLD      16384   // Largest free block (a TLS record buffer needs ~16 KB)
+#endif
+#define LOW_MEMORY_HYSTERESIS           4096    // Extra free bytes required to leave low-memory state
+
+
+// ========== REGISTRO DE MÉTRICAS ==========
+#define METRICS_HISTOGRAM_BUCKETS       20      // Power-of-two buckets: le=1 .. 2^18, plus +Inf
+#define METRICS_FULL_FRAME_EVERY        12      // Every Nth metrics frame carries all series (1 h at 5 min)
+#ifndef METRICS_HTTP_PORT
+#define METRICS_HTTP_PORT               9100    // Local Prometheus scrape endpoint (0 = disabled)
+#endif
+#define METRICS_HTTP_TIMEOUT_MS         250     // Max time for a scrape's request headers to arrive
+#define METRICS_JSON_CAPACITY           3072    // Bytes for a full metrics frame (document and payload)
+
+
+// ========== REENVÍO DE LOGS AL BACKEND ==========
+#ifndef LOG_FORWARD_LEVEL
+#define LOG_FORWARD_LEVEL               2       // Minimum level sent as log:batch (2 = WARN); changed at runtime with log:level
+#endif
+#define LOG_FORWARD_INTERVAL_MS         5000    // At most one log:batch frame per interval
+#define LOG_FORWARD_BATCH_MAX           8       // Entries per log:batch frame
+#define LOG_FORWARD_MESSAGE_MAX         96      // Bytes kept per forwarded message
+#define LOG_FORWARD_BUCKET_BURST        3       // Token bucket size per call site
+#define LOG_FORWARD_BUCKET_REFILL_MS    20000   // One token regained per call site every 20 s
+
+// ========== API LOCAL (LAN) ==========
+// Control UDP firmado (HMAC-SHA256) cuando el VPS no es alcanzable; ver local_api.h
+#if defined(FEATURE_DISABLE_LOCAL_API)
+#undef LOCAL_API_PORT
+#define LOCAL_API_PORT                  0
+#elif !defined(LOCAL_API_PORT)
+#define LOCAL_API_PORT                  4210    // UDP port of the LAN control API (0 = disabled)
+#endif
+#ifndef LOCAL_API_KEY
+#define LOCAL_API_KEY                   ""      // HMAC key; "" = derived from DEVICE_AUTH_TOKEN and the device ID
+#endif
+#define LOCAL_API_MAX_DATAGRAM          512     // Larger datagrams are dropped
+#define LOCAL_API_MAX_CLIENTS           8       // Client names tracked for replay protection (until reboot)
+#define LOCAL_API_CLIENT_NAME_MAX       16      // Client name, terminator included
+#define LOCAL_API_MAX_PER_LOOP          4       // Datagrams handled per loop iteration
 
 
 // ========== CONFIGURACIÓN DE WATCHDOG ==========
@@ -214,6 +425,18 @@
 // ========== CONFIGURACIÓN OTA ==========
 // OTA_PASSWORD se define solo en secrets.h
 #define OTA_PORT                3232
+// Delta OTA over the WebSocket (ota:offer / ota:pull / ota:chunk)
+#define OTA_CHUNK_SIZE          4096    // Patch bytes requested per ota:pull
+#define OTA_CHUNK_TIMEOUT_MS    15000   // Pull again if the chunk has not arrived by then
+#define OTA_CHUNK_RETRIES       5       // Pulls of the same offset before giving up
+#ifndef OTA_APPLY_BUDGET_BYTES
+#define OTA_APPLY_BUDGET_BYTES  16384   // Image bytes rebuilt per loop iteration
+#endif
+#define OTA_HASH_BUDGET_BYTES   32768   // Running-image bytes hashed per loop iteration
+#define OTA_STATUS_STEP_BYTES   65536   // ota:status progress report every N patch bytes
+#ifndef OTA_REBOOT_DELAY_MS
+#define OTA_REBOOT_DELAY_MS     3000    // Time to deliver the final ota:status before restarting
+#endif
 
 // ========== CONFIGURACIÓN DE ALERTAS ==========
 #define LED_BLINK_FAST_MS       250
@@ -254,15 +477,18 @@ struct SensorData {
     float humidity;
     float soil_moisture;
     unsigned long timestamp;
+    uint64_t acquired_ms;   // TimeBase::monotonicMs() at acquisition (converted to epoch when sent)
     bool valid;
 };
 
+#define RELAY_RULE_NAME_MAX 24    // Rule name kept per relay, terminator included
+
 struct RelayState {
     bool is_on;
     RelayMode mode;
     unsigned long last_change;
     unsigned long total_on_time;
-    String auto_rule;
+    char auto_rule[RELAY_RULE_NAME_MAX];  // Fixed buffer: copying the struct never touches the heap
 };
 
 struct SystemStats {
@@ -282,6 +508,8 @@ struct SystemStats {
 #ifndef CONFIG_SCHEMA_VERSION
 #define CONFIG_SCHEMA_VERSION 1
 #endif
+#define CONFIG_REJECTED_KEYS_MAX 8  // Rejected config:set keys listed in config:state (all are counted)
+#define CONFIG_STATE_FRAME_CAPACITY 1280  // Bytes for a config:state frame (every value plus the rejected keys)
 
 // ========== RATE LIMITER CONFIG ==========
 #ifndef RATE_LIMIT_SLOTS
@@ -0,0 +1,264 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// ========== CONFIGURACIÓN DEL LOGGER DIFERIDO ==========
+#ifndef LOG_RING_CAPACITY
+#define LOG_RING_CAPACITY       64      // Records in the ring (power of two)
+#endif
+#define LOG_RECORD_PAYLOAD      48      // Bytes of encoded arguments per record
+#define LOG_MAX_STRING_ARG      31      // Longest %s argument copied into a record
+#define LOG_LINE_MAX            192     // Longest formatted line produced by the drain
+#ifndef LOG_DRAIN_TASK
+#define LOG_DRAIN_TASK          1       // 1 = drain from a low-priority task, 0 = caller drains
+#endif
+#define LOG_DRAIN_PERIOD_MS     20      // Drain task wake-up period
+#define LOG_DRAIN_TASK_STACK    3072
+#define LOG_DRAIN_TASK_PRIORITY 1       // Just above idle: never competes with loop()
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+/**
+ * @brief Compile-time FNV-1a hash of a format string
+ *
+ * Used as the record identifier when LOG_STRIP_FORMATS is set so that the
+ * format literal itself never reaches flash; scripts/log_decode.py computes
+ * the same hash over the sources to map IDs back to text.
+ */
+constexpr uint32_t logFormatId(const char* s, uint32_t hash = 2166136261u) {
+    return *s ? logFormatId(s + 1, (hash ^ (uint8_t)*s) * 16777619u) : hash;
+}
+
+#ifdef LOG_STRIP_FORMATS
+#define LOG_FORMAT_REF(fmt) ((uintptr_t)std::integral_constant<uint32_t, logFormatId(fmt)>::value)
+#else
+#define LOG_FORMAT_REF(fmt) ((uintptr_t)(fmt))
+#endif
+
+// Argument tags stored in front of every encoded value
+#define LOG_ARG_INT32   'i'
+#define LOG_ARG_UINT32  'u'
+#define LOG_ARG_INT64   'I'
+#define LOG_ARG_UINT64  'U'
+#define LOG_ARG_FLOAT   'f'
+#define LOG_ARG_STRING  's'
+#define LOG_ARG_POINTER 'p'
+
+/**
+ * @class LogArgWriter
+ * @brief Packs printf arguments into a record payload without formatting them
+ *
+ * Every value is stored as a one-byte type tag followed by its raw bytes, so
+ * the drain (and the host decoder) never depends on the format string to
+ * know argument sizes. Integers keep their width and signedness, floating
+ * point values are narrowed to float, and C strings are copied
+ * (length-prefixed, truncated to LOG_MAX_STRING_ARG) because the caller's
+ * buffer may not outlive the call.
+ */
+class LogArgWriter {
+public:
+    LogArgWriter(uint8_t* buffer, size_t capacity) : _buffer(buffer), _capacity(capacity), _used(0), _truncated(false) {}
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, void>::type put(T value) {
+        bool isSigned = std::is_signed<T>::value;
+        if (sizeof(T) > 4) {
+            uint64_t wide = (uint64_t)value;
+            putValue(isSigned ? LOG_ARG_INT64 : LOG_ARG_UINT64, &wide, 8);
+        } else {
+            uint32_t word = (uint32_t)value;
+            putValue(isSigned ? LOG_ARG_INT32 : LOG_ARG_UINT32, &word, 4);
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, void>::type put(T value) {
+        float narrow = (float)value;
+        putValue(LOG_ARG_FLOAT, &narrow, 4);
+    }
+
+    void put(const char* str) {
+        if (str == nullptr) {
+            str = "(null)";
+        }
+        size_t len = 0;
+        while (len < LOG_MAX_STRING_ARG && str[len] != '\0') {
+            len++;
+        }
+        if (_truncated || _used + 2 + len > _capacity) {
+            _truncated = true;
+            return;
+        }
+        _buffer[_used++] = LOG_ARG_STRING;
+        _buffer[_used++] = (uint8_t)len;
+        memcpy(_buffer + _used, str, len);
+        _used += len;
+    }
+
+    void put(char* str) { put((const char*)str); }
+
+    void put(const void* ptr) {
+        uint64_t raw = (uint64_t)(uintptr_t)ptr;
+        putValue(LOG_ARG_POINTER, &raw, 8);
+    }
+
+    size_t used() const { return _used; }
+    bool truncated() const { return _truncated; }
+
+private:
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _used;
+    bool _truncated;
+
+    void putValue(uint8_t tag, const void* data, size_t len) {
+        // Once one argument is dropped, drop the rest too so they stay aligned with the format
+        if (_truncated || _used + 1 + len > _capacity) {
+            _truncated = true;
+            return;
+        }
+        _buffer[_used++] = tag;
+        memcpy(_buffer + _used, data, len);
+        _used += len;
+    }
+};
+
+/**
+ * @struct LogRecord
+ * @brief One fixed-size slot of the log ring
+ */
+struct LogRecord {
+    std::atomic<uint32_t> sequence;      ///< Slot ownership (bounded MPMC queue protocol)
+    uintptr_t format;                    ///< Format string address, or its hash when stripped
+    uint32_t timestamp;                  ///< millis() at record time
+    uint8_t level;                       ///< LOG_LEVEL_* value
+    uint8_t length;                      ///< Payload bytes in use
+    uint8_t truncated;                   ///< Arguments did not fit in the payload
+    uint8_t payload[LOG_RECORD_PAYLOAD];
+};
+
+/**
+ * @class DeferredLogger
+ * @brief Lock-free deferred logger behind the LOG_* / DEBUG_* macros
+ *
+ * The hot path only reserves a ring slot, stores the format reference, a
+ * timestamp and the raw arguments, then publishes the slot - no formatting
+ * and no UART wait. A low-priority task (or the caller, with
+ * LOG_DRAIN_TASK=0) formats records and writes them to Serial.
+ *
+ * Key Features:
+ * - Bounded multi-producer ring (safe from any task, no locks)
+ * - Overruns are counted and reported instead of blocking
+ * - Records at or above the remote level are handed to the log forwarder
+ * - LOG_STRIP_FORMATS: records carry a format hash and the drain emits
+ *   compact hex frames for scripts/log_decode.py, so format strings are not
+ *   stored in flash at all
+ */
+class DeferredLogger {
+public:
+    DeferredLogger();
+
+    /**
+     * @brief Start the drain task (no-op when LOG_DRAIN_TASK is 0)
+     */
+    void begin();
+
+    /**
+     * @brief Drain from the main loop when no drain task is running
+     * (LOG_DRAIN_TASK=0, or the task could not be created)
+     */
+    void loop();
+
+    /**
+     * @brief Record a log entry; never blocks
+     * @param level LOG_LEVEL_* value
+     * @param format LOG_FORMAT_REF() of the printf-style format literal
+     */
+    template <typename... Args>
+    void log(uint8_t level, uintptr_t format, const Args&... args) {
+        if (level > _captureLevel.load(std::memory_order_relaxed)) {
+            return;
+        }
+        uint32_t pos;
+        LogRecord* record = reserve(pos);
+        if (record == nullptr) {
+            return;
+        }
+        record->format = format;
+        record->timestamp = now();
+        record->level = level;
+        LogArgWriter writer(record->payload, sizeof(record->payload));
+        int expand[] = {0, (writer.put(args), 0)...};
+        (void)expand;
+        record->length = (uint8_t)writer.used();
+        record->truncated = writer.truncated() ? 1 : 0;
+        publish(record, pos);
+    }
+
+    /**
+     * @brief Format and output pending records
+     * @param maxRecords Upper bound for this call (0 = everything pending)
+     * @return Number of records written
+     */
+    size_t drain(size_t maxRecords = 0);
+
+    /**
+     * @brief Synchronously drain everything (before restart, in fatal paths)
+     */
+    void flush();
+
+    /**
+     * @brief Runtime verbosity (can only lower the compile-time LOG_LEVEL)
+     * @param serialLevel Highest level printed on Serial
+     * @param captureLevel Highest level recorded at all (serial or forwarded)
+     */
+    void setLevels(uint8_t serialLevel, uint8_t captureLevel);
+    uint8_t getSerialLevel() const { return _serialLevel.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Records dropped because the ring was full
+     */
+    uint32_t overruns() const { return _overruns.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Records written out by drain()
+     */
+    uint32_t written() const { return _written; }
+
+private:
+    static const uint32_t CAPACITY = LOG_RING_CAPACITY;
+    static_assert((LOG_RING_CAPACITY & (LOG_RING_CAPACITY - 1)) == 0, "LOG_RING_CAPACITY must be a power of two");
+
+    LogRecord _ring[LOG_RING_CAPACITY];
+    std::atomic<uint32_t> _enqueuePos;
+    uint32_t _dequeuePos;                 // Single consumer
+    std::atomic<uint32_t> _overruns;
+    uint32_t _reportedOverruns;
+    uint32_t _written;
+    std::atomic<bool> _draining;
+    std::atomic<uint8_t> _serialLevel;
+    std::atomic<uint8_t> _captureLevel;
+    bool _taskRunning;
+
+    LogRecord* reserve(uint32_t& pos);
+    void publish(LogRecord* record, uint32_t pos);
+    static uint32_t now();
+    void output(const LogRecord& record);
+    size_t format(const LogRecord& record, char* out, size_t capacity);
+
+#if LOG_DRAIN_TASK
+    static void drainTask(void* param);
+#endif
+};
+
+extern DeferredLogger deferredLog;
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,192 @@
+#ifndef DELTA_PATCH_H
+#define DELTA_PATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Delta patch format (produced by backend/lib/otaDelta.js)
+ *
+ *   header  16 bytes, uncompressed, little-endian:
+ *           magic "GHDP", format version, 3 reserved, source size, target size
+ *   body    LZSS stream (4 KB window): a flag byte precedes every 8 items,
+ *           bit set = literal byte, clear = 2-byte match
+ *           (12-bit distance - 1, 4-bit length - DELTA_MIN_MATCH)
+ *
+ * The decompressed body is a sequence of bsdiff-style operations:
+ *
+ *   0x01 ADD     zigzag varint seek, varint length, length diff bytes:
+ *                source position += seek, then target = source + diff (mod 256)
+ *   0x02 INSERT  varint length, length literal bytes
+ *   0x03 COPY    zigzag varint seek, varint length:
+ *                source position += seek, then copy length bytes unchanged
+ *   0x00 END
+ *
+ * Unchanged stretches become COPY, and code that moved or had its addresses
+ * shifted becomes ADD runs of mostly zero diff bytes, which the LZSS layer
+ * compresses well.
+ */
+
+#define DELTA_MAGIC             0x50444847  // "GHDP"
+#define DELTA_FORMAT_VERSION    1
+#define DELTA_HEADER_SIZE       16
+#define DELTA_WINDOW_BITS       12
+#define DELTA_WINDOW_SIZE       (1 << DELTA_WINDOW_BITS)
+#define DELTA_MIN_MATCH         3
+#define DELTA_MAX_MATCH         (DELTA_MIN_MATCH + 15)
+#define DELTA_OUTPUT_BUFFER     512     // Bytes handed to the sink per write
+#define DELTA_SOURCE_BUFFER     256     // Bytes read from the source per read
+
+/**
+ * @class DeltaSource
+ * @brief Random-access reader for the image the patch was made against
+ */
+class DeltaSource {
+public:
+    virtual ~DeltaSource() {}
+    virtual bool read(uint32_t offset, uint8_t* buffer, size_t length) = 0;
+};
+
+/**
+ * @class DeltaSink
+ * @brief Sequential writer for the rebuilt image
+ */
+class DeltaSink {
+public:
+    virtual ~DeltaSink() {}
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * @enum DeltaStatus
+ * @brief Patcher state; anything from DELTA_ERROR_HEADER on is final
+ */
+enum DeltaStatus {
+    DELTA_OK,               ///< More input expected
+    DELTA_DONE,             ///< END seen and the target size reached
+    DELTA_ERROR_HEADER,     ///< Bad magic, format version or sizes
+    DELTA_ERROR_FORMAT,     ///< Corrupt body (bad opcode, match distance, trailing data)
+    DELTA_ERROR_SOURCE,     ///< Read outside the source image or read failure
+    DELTA_ERROR_SINK,       ///< Sink refused a write
+    DELTA_ERROR_SIZE        ///< Output longer or shorter than the header says
+};
+
+/**
+ * @class DeltaPatcher
+ * @brief Streaming patch applier with fixed memory (no heap)
+ *
+ * Input can arrive in chunks of any size; output goes to the sink in
+ * DELTA_OUTPUT_BUFFER pieces as it is produced, so memory stays at the LZSS
+ * window plus two small buffers (about 5 KB) whatever the image size.
+ *
+ * Key Features:
+ * - Plain C++ without Arduino dependencies: the same code runs on the host
+ *   (bench/delta_apply.cpp) and on the device
+ * - feed() takes an output budget, so a highly compressed chunk can be
+ *   applied over several loop iterations instead of stalling one
+ * - Every read, length and size is bounds-checked against the header
+ */
+class DeltaPatcher {
+public:
+    DeltaPatcher();
+
+    /**
+     * @brief Reset and prepare for a new patch
+     * @param source Image the patch was made against (not owned)
+     * @param sink Destination of the rebuilt image (not owned)
+     */
+    void begin(DeltaSource* source, DeltaSink* sink);
+
+    /**
+     * @brief Apply the next piece of the patch
+     * @param data Patch bytes
+     * @param length Number of bytes available
+     * @param outputBudget Stop after producing about this many bytes (0 = no limit)
+     * @return Bytes consumed; less than length when the budget ran out or on error
+     *
+     * Output can lag the input consumed (a long COPY): while hasPendingOutput(),
+     * call again (length 0 is fine) to produce the rest.
+     */
+    size_t feed(const uint8_t* data, size_t length, size_t outputBudget = 0);
+
+    /**
+     * @brief True while consumed input still has output to produce (a COPY or LZSS match cut by the budget)
+     */
+    bool hasPendingOutput() const { return _status == DELTA_OK && (_op == OP_COPY_DATA || _matchRemaining > 0); }
+
+    /**
+     * @brief Flush buffered output and check the patch is complete
+     * @return DELTA_DONE on success, an error status otherwise
+     */
+    DeltaStatus finish();
+
+    DeltaStatus status() const { return _status; }
+    uint32_t sourceSize() const { return _sourceSize; }
+    uint32_t targetSize() const { return _targetSize; }
+    uint32_t produced() const { return _produced; }
+
+    static const char* statusName(DeltaStatus status);
+
+private:
+    enum OpState {
+        OP_TAG,
+        OP_ADD_SEEK,
+        OP_ADD_LENGTH,
+        OP_ADD_DATA,
+        OP_INSERT_LENGTH,
+        OP_INSERT_DATA,
+        OP_COPY_SEEK,
+        OP_COPY_LENGTH,
+        OP_COPY_DATA,
+        OP_END
+    };
+
+    DeltaSource* _source;
+    DeltaSink* _sink;
+    DeltaStatus _status;
+
+    uint8_t _header[DELTA_HEADER_SIZE];
+    uint8_t _headerLength;
+    uint32_t _sourceSize;
+    uint32_t _targetSize;
+    uint32_t _produced;
+
+    // LZSS layer
+    uint8_t _window[DELTA_WINDOW_SIZE];
+    uint16_t _windowPos;
+    uint32_t _decoded;          // Bytes decompressed so far (bounds match distances)
+    uint8_t _flags;
+    uint8_t _flagBits;          // Items left under the current flag byte
+    bool _haveMatchByte;
+    uint8_t _matchByte;
+    uint16_t _matchDistance;
+    uint8_t _matchRemaining;    // Bytes of the current match not decoded yet
+
+    // Operation layer
+    OpState _op;
+    uint32_t _varint;
+    uint8_t _varintShift;
+    uint32_t _remaining;
+    uint32_t _sourcePos;
+    uint8_t _sourceBuffer[DELTA_SOURCE_BUFFER];
+    uint16_t _sourceBufferPos;
+    uint16_t _sourceBufferLength;
+
+    uint8_t _output[DELTA_OUTPUT_BUFFER];
+    uint16_t _outputLength;
+
+    void fail(DeltaStatus status);
+    bool parseHeader();
+    void decodeByte(uint8_t byte);
+    void emitDecoded(uint8_t byte);
+    void applyOp(uint8_t byte);
+    bool readVarint(uint8_t byte);
+    void seekSource(uint32_t zigzag, OpState next);
+    bool startSourceRun(OpState next);
+    bool readSource(uint8_t* value);
+    void copyStep(uint32_t budgetEnd);
+    void output(uint8_t byte);
+    bool flush();
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef ENDPOINT_SELECTOR_H
+#define ENDPOINT_SELECTOR_H
+
+#include "config.h"
+#include <lwip/dns.h>
+#include <atomic>
+
+/**
+ * @struct BackendEndpoint
+ * @brief One entry of VPS_ENDPOINTS with its probe history
+ */
+struct BackendEndpoint {
+    char host[ENDPOINT_HOST_MAX_LENGTH];
+    uint16_t port;
+    uint32_t address;           ///< IPv4 in network order (0 = not resolved)
+    unsigned long resolvedAt;   ///< millis() when the last lookup started
+    int32_t rttUs;              ///< Smoothed TCP connect time (-1 = no successful probe yet)
+    uint8_t probeFailures;      ///< Consecutive failed probes
+    unsigned long healthySince; ///< millis() of the probe that made it healthy (0 = unhealthy)
+    uint32_t holdMs;            ///< Time it must stay healthy before it is switched to
+};
+
+/**
+ * @class EndpointSelector
+ * @brief Picks the backend endpoint the WebSocket client connects to
+ *
+ * Endpoints are probed one at a time with a non-blocking TCP connect (no TLS,
+ * no data: the server only sees a connection opened and closed), and the one
+ * with the lowest score wins: smoothed connect time plus
+ * ENDPOINT_RANK_PENALTY_MS per position in the list, so the primary is kept
+ * unless another endpoint is clearly faster. Owned by VPSWebSocketClient,
+ * which reconnects whenever loop() says so.
+ *
+ * Key Features:
+ * - Failover: the active endpoint is left after ENDPOINT_PROBE_FAILURES failed
+ *   probes, or when no WebSocket comes up on it within
+ *   ENDPOINT_CONNECT_TIMEOUT_MS while another endpoint is healthy
+ * - Fail back: a better endpoint is switched to once it has stayed healthy for
+ *   its hold (ENDPOINT_FAILBACK_HOLD_MS, doubled after every connection that
+ *   failed on it, so an endpoint that accepts TCP but not the WebSocket does
+ *   not pull the device back every minute)
+ * - Probes every ENDPOINT_PROBE_INTERVAL_MS per endpoint while connected, and
+ *   every ENDPOINT_PROBE_FAST_MS in turn while disconnected
+ * - Inert with a single endpoint: no probes, no sockets
+ * - ws_endpoint_selected, ws_endpoint_switches_total, probe failures and
+ *   ws_endpoint<N>_rtt_ms per endpoint in the metrics registry
+ * - Names are resolved at most every ENDPOINT_DNS_REFRESH_MS, one at a time
+ *   with lwIP's asynchronous resolver: probes keep using the previous address
+ *   until the answer arrives, so a dead name server never stalls the loop
+ *   (numeric addresses never touch DNS)
+ */
+class EndpointSelector {
+public:
+    EndpointSelector();
+    ~EndpointSelector();
+
+    /**
+     * @brief Parse the endpoint list and select the primary
+     * @param list "host:port" entries separated by commas; entries without a
+     *        port, past ENDPOINT_MAX or with a host that does not fit are skipped
+     * @param defaultHost Used when the list has no valid entry
+     * @param defaultPort Port of defaultHost
+     * @return Number of endpoints
+     */
+    uint8_t begin(const char* list, const char* defaultHost, uint16_t defaultPort);
+
+    /**
+     * @brief Advance the probe in flight and re-evaluate the choice
+     * Called every loop iteration
+     * @param connected WebSocket state on the active endpoint
+     * @return true when active() changed and the client must reconnect
+     */
+    bool loop(bool connected);
+
+    /// The WebSocket came up on the active endpoint
+    void connected();
+
+    /// The WebSocket on the active endpoint went down
+    void disconnected();
+
+    /// Forget lookups and probe timing (link recovery): names are resolved again on the next probes
+    void renew();
+
+    const BackendEndpoint& active() const { return _endpoints[_active]; }
+    uint8_t activeIndex() const { return _active; }
+    uint8_t count() const { return _count; }
+    const BackendEndpoint& endpoint(uint8_t index) const { return _endpoints[index]; }
+
+private:
+    BackendEndpoint _endpoints[ENDPOINT_MAX];
+    uint8_t _count;
+    uint8_t _active;
+    int _probeFd;                   ///< Connect in flight (-1 = none)
+    uint8_t _probeIndex;            ///< Endpoint being probed, or the next one to probe
+    unsigned long _probeStartUs;    ///< micros() when the probe started
+    unsigned long _lastProbeAt;     ///< millis() when the last probe finished
+    bool _probeNow;                 ///< Probe _probeIndex without waiting (set on disconnect)
+    unsigned long _waitingSince;    ///< millis() since the active endpoint has been without a WebSocket (0 = connected)
+    std::atomic<uint8_t> _lookupState;  ///< LOOKUP_IDLE, _PENDING or _DONE (set by the resolver callback)
+    uint8_t _lookupIndex;           ///< Endpoint the lookup in flight is for
+    uint32_t _lookupAddress;        ///< Its answer in network order (0 = not found), valid once DONE
+
+    bool addEndpoint(const char* host, size_t hostLength, uint16_t port);
+    void startProbe(unsigned long now);
+    void pollProbe(unsigned long now);
+    void finishProbe(bool ok, unsigned long now);
+    bool resolve(uint8_t index, unsigned long now);
+    void startLookup(uint8_t index, unsigned long now);
+    void pollLookup();
+    static void lookupDone(const char* name, const ip_addr_t* address, void* selector);
+    bool healthy(uint8_t index) const;
+    bool stable(uint8_t index, unsigned long now) const;
+    int32_t score(uint8_t index) const;
+    int best(bool stableOnly, unsigned long now) const;
+    void switchTo(uint8_t index, const char* reason);
+    void publishRtt(uint8_t index);
+};
+
+#endif // ENDPOINT_SELECTOR_H
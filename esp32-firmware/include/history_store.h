@@ -0,0 +1,167 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include "config.h"
+#include "sensor_block.h"
+#include <ArduinoJson.h>
+#include <esp_partition.h>
+
+class VPSWebSocketClient;
+
+#define HISTORY_SECTOR_MAGIC            0x31534847UL    // "GHS1", first word of every sector in use
+#define HISTORY_SECTOR_HEADER_BYTES     8               // magic, sequence number
+#define HISTORY_RECORD_MARKER           0xB10C          // First half-word of a record; 0xFFFF = free space
+#define HISTORY_RECORD_HEADER_BYTES     24              // marker, length, CRC-32, first and last epoch ms
+#define HISTORY_BUCKET_BYTES            44              // index u32, count u32, then min/mean/max f32 per channel
+#define HISTORY_REQUEST_ID_MAX_LENGTH   40
+
+/**
+ * @class HistoryStore
+ * @brief Log-structured store of sensor readings on the spiffs data partition
+ *
+ * The partition is used raw, as a ring of SPI_FLASH_SEC_SIZE sectors written
+ * in order. A sector starts with {magic, sequence} and holds records. Each
+ * record is a 24-byte header {marker, length, CRC-32, first and last epoch ms}
+ * followed by one SensorBlockEncoder block of readings with epoch-ms
+ * timestamps. Readings collect in a RAM block that is written out as a record
+ * when it fills the space left in the sector, or after
+ * HISTORY_SEAL_INTERVAL_MS. When the newest sector is full, the oldest is
+ * erased and reused.
+ *
+ * A sensor:history {request_id, from, to, step} query is answered with
+ * buckets of step ms: reading count and min/mean/max per channel. They are
+ * streamed as binary sensor:history:chunk events of HISTORY_CHUNK_BUCKETS,
+ * and the last chunk has done: true.
+ *
+ * Key Features:
+ * - Sparse index in RAM: the time span of every sector (8 bytes each), rebuilt
+ *   at boot from the record headers; a query only reads the sectors and
+ *   records that overlap it
+ * - Retention: the ring keeps as much as fits (about 12 days of 5 s readings
+ *   in 1.3 MB); readings older than HISTORY_RETENTION_DAYS are not served
+ * - Power-safe: a record is found by its header and checked by its CRC, so a
+ *   torn write loses that record only; a reboot loses at most the RAM block
+ * - Wear: every sector is erased once per trip around the ring
+ * - Non-blocking: queries advance HISTORY_QUERY_BUDGET_READINGS readings and
+ *   at most one chunk per loop iteration; one query at a time
+ * - Readings need an epoch clock; until the first time sync they are not stored
+ */
+class HistoryStore {
+public:
+    HistoryStore();
+
+    /**
+     * @brief Find the partition and rebuild the sector index
+     * @return false if there is no data partition (the store stays disabled)
+     */
+    bool begin();
+
+    /**
+     * @brief Add a reading
+     * @param epochMs Acquisition time, epoch ms
+     * @param values One value per channel (SENSOR_BLOCK_CHANNELS)
+     */
+    void append(uint64_t epochMs, const float values[SENSOR_BLOCK_CHANNELS]);
+
+    /**
+     * @brief Write the RAM block to flash now (normally done when full or old enough)
+     */
+    void flush();
+
+    /**
+     * @brief Start answering a sensor:history query
+     * @param client Connection the query arrived on (chunks are sent over it)
+     * @param query {request_id, from, to, step}; missing fields default to the last 24 h in 1 h steps
+     */
+    void handleQuery(VPSWebSocketClient& client, JsonObject& query);
+
+    /**
+     * @brief Seal an old RAM block and advance the running query; called every loop iteration
+     */
+    void loop();
+
+    bool isReady() const { return _partition != nullptr; }
+    bool isQueryActive() const { return _queryActive; }
+    uint16_t sectorCount() const { return _sectorCount; }
+    /// Sectors holding at least one record
+    uint16_t sectorsUsed() const;
+    /// Epoch ms of the oldest reading on flash (0 when empty)
+    uint64_t oldestMs() const;
+
+private:
+    enum QueryPhase {
+        QUERY_FLASH,            // Records on flash, oldest sector first
+        QUERY_RAM,              // The block not yet written
+        QUERY_END
+    };
+
+    struct SectorSpan {
+        uint32_t firstSec;      // Epoch seconds of the first and last reading (0 = no records)
+        uint32_t lastSec;
+    };
+
+    struct RecordHeader {
+        uint16_t marker;
+        uint16_t length;        // Block bytes after the header
+        uint32_t crc;
+        uint64_t firstMs;
+        uint64_t lastMs;
+    };
+
+    const esp_partition_t* _partition;
+    uint16_t _sectorCount;
+    SectorSpan _index[HISTORY_MAX_SECTORS];
+    uint16_t _head;             // Sector being written
+    uint32_t _headOffset;       // Next record offset in the head sector
+    uint32_t _sequence;         // Of the head sector
+
+    SensorBlockEncoder _open;   // Readings not yet on flash
+    unsigned long _openedAt;
+
+    // Running query
+    bool _queryActive;
+    VPSWebSocketClient* _client;
+    char _requestId[HISTORY_REQUEST_ID_MAX_LENGTH];
+    uint64_t _from;             // Bucket 0 starts here
+    uint64_t _to;               // Exclusive
+    uint64_t _notBefore;        // from, or the retention limit if later
+    uint32_t _step;
+    QueryPhase _phase;
+    uint16_t _sector;           // Cursor: sector and offset of the next record header
+    uint32_t _offset;
+    bool _decoding;             // _decoder is reading the block copied into _record
+    uint8_t _record[SENSOR_BLOCK_MAX_BYTES];
+    SensorBlockDecoder _decoder;
+    int64_t _bucket;            // Index of the bucket being filled, -1 before the first reading
+    uint32_t _bucketReadings;
+    float _min[SENSOR_BLOCK_CHANNELS];
+    float _max[SENSOR_BLOCK_CHANNELS];
+    double _sum[SENSOR_BLOCK_CHANNELS];
+    uint8_t _chunk[HISTORY_CHUNK_BUCKETS * HISTORY_BUCKET_BYTES];
+    uint16_t _chunkBuckets;
+    uint16_t _chunkSeq;
+    uint32_t _readings;         // Readings aggregated
+    uint32_t _recordsRead;
+    uint32_t _recordsSkipped;   // By the sector index or the record header, without reading them
+    uint64_t _queryStartUs;
+
+    uint16_t nextSector(uint16_t sector) const { return sector + 1 < _sectorCount ? sector + 1 : 0; }
+    uint32_t sectorAddress(uint16_t sector) const { return (uint32_t)sector * SPI_FLASH_SEC_SIZE; }
+    bool readRecordHeader(uint16_t sector, uint32_t offset, RecordHeader& header);
+    uint32_t scanSector(uint16_t sector);
+    bool startSector();
+    void startBlock();
+    bool seal();
+
+    void queryStep();
+    bool nextRecord();
+    void addReading(uint64_t t, const float values[SENSOR_BLOCK_CHANNELS]);
+    void closeBucket();
+    bool sendChunk(bool done);
+    void finishQuery();
+    void reject(VPSWebSocketClient& client, const char* requestId, const char* error);
+};
+
+extern HistoryStore historyStore;
+
+#endif // HISTORY_STORE_H
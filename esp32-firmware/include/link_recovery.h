@@ -0,0 +1,132 @@
+#ifndef LINK_RECOVERY_H
+#define LINK_RECOVERY_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+
+/**
+ * @enum RecoveryRung
+ * @brief Steps of the recovery ladder, cheapest first
+ */
+enum RecoveryRung {
+    RECOVERY_RUNG_NONE,             ///< Backend reachable (or not tried yet)
+    RECOVERY_RUNG_SOCKET,           ///< Close the WebSocket and reopen it on the same endpoint
+    RECOVERY_RUNG_TLS,              ///< New transport: endpoint names re-resolved, full TLS handshake
+    RECOVERY_RUNG_REASSOCIATE,      ///< Leave the access point and rejoin it
+    RECOVERY_RUNG_WIFI_RESTART,     ///< WiFi driver stopped and started, scan join
+    RECOVERY_RUNG_REBOOT,           ///< ESP.restart(): relay states, time and sensor warm-up are lost
+    RECOVERY_RUNG_COUNT
+};
+
+/**
+ * @struct RecoveryReport
+ * @brief How the last outage that needed the ladder ended
+ */
+struct RecoveryReport {
+    RecoveryRung rung;          ///< Highest rung taken before the backend came back
+    uint32_t recoveryMs;        ///< That rung's action to authenticated
+    uint32_t outageMs;          ///< Backend lost to authenticated (across the reboot for RECOVERY_RUNG_REBOOT)
+};
+
+/**
+ * @typedef RecoveryActionCallback
+ * @brief Performs one rung (main.cpp wires it to the WebSocket client and WiFiLink)
+ */
+typedef void (*RecoveryActionCallback)(RecoveryRung rung);
+
+/**
+ * @class LinkRecovery
+ * @brief Escalation ladder for a backend that stays unreachable
+ *
+ * Replaces the reboot after a few failed health checks. While WiFi is up
+ * and the backend is not authenticated, one rung is taken per health check
+ * interval: socket reset, TLS re-handshake, WiFi reassociation, WiFi driver
+ * restart. A reboot is the last resort, after LINK_RECOVERY_REBOOT_AFTER_MS
+ * of outage with every other rung tried.
+ *
+ * Key Features:
+ * - The ladder waits while WiFi is down (WiFiLink rejoins in place) and while
+ *   the backend rejects the token (no rung changes that); every rung gives
+ *   the link a full interval before the next one
+ * - Recovery time of the rung that ended the outage (action to
+ *   authenticated) as link_recovery_<rung>_ms, actions as
+ *   link_recovery_<rung>_total; reported once as a link:recovery event
+ * - A reboot is recorded in RTC memory, so its recovery is reported after
+ *   the restart; consecutive reboots of one outage double the wait (up to
+ *   LINK_RECOVERY_REBOOT_MAX_MS), so a long server outage does not turn
+ *   into a reboot loop
+ */
+class LinkRecovery {
+public:
+    LinkRecovery();
+
+    /**
+     * @brief Pick up a reboot taken by the ladder before this boot
+     */
+    void begin();
+
+    /**
+     * @brief Climb the ladder or close an outage
+     * Called every loop iteration
+     * @param wifiUp WiFi station holds an address
+     * @param backendUp WebSocket authenticated
+     * @param rejected The backend refused the token at the last attempt
+     */
+    void update(bool wifiUp, bool backendUp, bool rejected);
+
+    /**
+     * @brief Register the callback that performs a rung (RECOVERY_RUNG_REBOOT included)
+     * @param callback Function called with the rung to take
+     */
+    void onAction(RecoveryActionCallback callback);
+
+    /**
+     * @brief Highest rung taken in the current outage
+     * @return RECOVERY_RUNG_NONE while the backend is reachable
+     */
+    RecoveryRung rung() const { return _rung; }
+
+    /**
+     * @brief Check whether a recovery is waiting to be reported
+     * @return true from the reconnect that ended a laddered outage until markReported()
+     */
+    bool reportPending() const { return _reportPending; }
+
+    /**
+     * @brief Fill a link:recovery payload ({rung, recovery_ms, outage_ms})
+     * @param data Destination object
+     */
+    void appendTo(JsonObject data) const;
+
+    /**
+     * @brief Record that the report was delivered
+     */
+    void markReported() { _reportPending = false; }
+
+    /**
+     * @brief Short name of a rung as used in reports, logs and metric names
+     * @param rung Rung to name
+     * @return Static string
+     */
+    static const char* rungName(RecoveryRung rung);
+
+private:
+    RecoveryRung _rung;
+    bool _outage;               // Backend lost since _outageStart
+    unsigned long _outageStart;
+    unsigned long _rungAt;      // millis() of the last rung's action
+    unsigned long _nextRungAt;  // Earliest millis() for the next rung
+    uint32_t _priorOutageMs;    // Outage before the reboot that started this boot
+    uint8_t _reboots;           // Reboots taken in this outage (from RTC memory)
+    RecoveryReport _report;
+    bool _reportPending;
+    RecoveryActionCallback _actionCallback;
+
+    void climb(unsigned long now);
+    void recovered(unsigned long now);
+    unsigned long rebootAfterMs() const;
+};
+
+extern LinkRecovery linkRecovery;
+
+#endif
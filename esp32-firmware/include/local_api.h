@@ -0,0 +1,83 @@
+#ifndef LOCAL_API_H
+#define LOCAL_API_H
+
+#include "config.h"
+#include "vps_websocket.h"
+
+/**
+ * @class LocalApi
+ * @brief Signed UDP control endpoint on the LAN (relay commands, sensor reads)
+ *
+ * The VPS path (LAN → internet → backend → WebSocket) is slow on our uplink
+ * and gone during an outage. LocalApi takes the same relay:command and
+ * sensor:request events straight from the LAN, one datagram each way, polled
+ * from loop() like everything else.
+ *
+ * Datagrams in both directions are JSON, a newline, and the lowercase hex
+ * HMAC-SHA256 of the JSON bytes under the LAN key:
+ *
+ *   {"client":"ha","boot":"9f0c12ab","seq":42,"event":"relay:command","data":{"relay_id":2,"state":true}}
+ *
+ * A client sends "hello" first to learn the boot ID, then numbers its
+ * requests with a strictly increasing seq. Replies echo seq and carry the
+ * WebSocket payloads (relay:state, relay:error, sensor:data) or an error
+ * (stale_boot, stale_seq, too_many_clients, no_reading, unknown_event).
+ *
+ * Key Features:
+ * - Key is LOCAL_API_KEY, or HMAC-SHA256(DEVICE_AUTH_TOKEN, "ghlan1:" + device
+ *   ID), so LAN clients never hold the backend token
+ * - Replay protection without a clock (SNTP is out with the internet): random
+ *   boot ID plus a per-client seq high-water mark
+ * - Unsigned or mis-signed datagrams are dropped without a reply
+ * - Relay commands share VPSWebSocketClient's validation, callback path and
+ *   ack payloads, so a LAN command looks exactly like a backend one
+ * - Raw non-blocking sockets (lwIP on the device): WiFiUDP::parsePacket()
+ *   mallocs a receive buffer on every poll, even when nothing arrived
+ */
+class LocalApi {
+public:
+    LocalApi();
+
+    /**
+     * @brief Derive the key and bind LOCAL_API_PORT (call once an IP is up)
+     * @param deviceId Device ID the derived key is bound to
+     */
+    void begin(const char* deviceId);
+
+    /**
+     * @brief Handle up to LOCAL_API_MAX_PER_LOOP waiting datagrams
+     */
+    void loop();
+
+    /**
+     * @brief Register the relay command path (shared with VPSWebSocketClient::onRelayCommand)
+     */
+    void onRelayCommand(RelayCommandCallback callback);
+
+    bool isListening() const { return _socket >= 0; }
+
+private:
+    struct Client {
+        char name[LOCAL_API_CLIENT_NAME_MAX];
+        uint32_t lastSeq;
+    };
+
+    int _socket;
+    char _key[65];  // LOCAL_API_KEY or the derived key as hex; used as ASCII bytes either way
+    char _bootId[9];
+    Client _clients[LOCAL_API_MAX_CLIENTS];
+    uint8_t _clientCount;
+    RelayCommandCallback _relayCommandCallback;
+    char _request[LOCAL_API_MAX_DATAGRAM + 1];
+    char _reply[LOCAL_API_MAX_DATAGRAM + 1];
+
+    bool verify(const char* json, size_t jsonLength, const char* signature) const;
+    void sign(const char* json, size_t jsonLength, char* out) const;
+    void handleRequest(size_t length, const void* from, size_t fromLength);
+    void respond(JsonDocument& response, const void* to, size_t toLength);
+    Client* findClient(const char* name, bool create);
+};
+
+extern LocalApi localApi;
+
+#endif
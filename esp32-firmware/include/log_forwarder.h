@@ -0,0 +1,120 @@
+#ifndef LOG_FORWARDER_H
+#define LOG_FORWARDER_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+/**
+ * @class LogForwarder
+ * @brief Batches log records for the backend with per-callsite rate limiting
+ *
+ * The deferred logger hands every formatted record to capture(). Records at
+ * or above the remote level are filtered per call site (format string) by a
+ * token bucket, consecutive duplicates from the same site are folded into a
+ * single "repeated N times" entry, and the survivors are sent as one
+ * `log:batch` frame per flush interval.
+ *
+ * Key Features:
+ * - RATE_LIMIT_SLOTS token buckets, least recently used slot recycled
+ * - Duplicate suppression that does not spend tokens
+ * - Double-buffered fixed batches: capture() runs on the log task while the
+ *   loop task serializes the other buffer, no heap allocations
+ * - Drop counter reported with each batch
+ */
+class LogForwarder {
+public:
+    LogForwarder();
+
+    /**
+     * @brief Offer a formatted record for forwarding (log drain task)
+     * @param site Call site identity (format reference)
+     * @param level LOG_LEVEL_* value
+     * @param timestamp millis() when the record was created
+     * @param text Message without level prefix
+     * @param length Message length in bytes
+     */
+    void capture(uintptr_t site, uint8_t level, uint32_t timestamp, const char* text, size_t length);
+
+    /**
+     * @brief Queue a message directly, bypassing level filter and rate limits
+     * @param level LOG_LEVEL_* value
+     * @param text NUL-terminated message
+     */
+    void enqueue(uint8_t level, const char* text);
+
+    /**
+     * @brief Check whether a batch should be sent now
+     * @return true if records are pending and log_forward_interval_ms (LOG_FORWARD_INTERVAL_MS) elapsed
+     */
+    bool due();
+
+    /**
+     * @brief Move pending records into a log:batch payload
+     * @param logs Destination array; entries reference internal buffers that
+     *             stay valid until the next call
+     * @return Records dropped (rate limit or full batch) since the last batch
+     */
+    uint32_t takeBatch(JsonArray logs);
+
+    /**
+     * @brief Apply a runtime level change (log:level event)
+     * @param serialLevel Highest LOG_LEVEL_* printed on Serial, -1 = unchanged
+     * @param remoteLevel Highest LOG_LEVEL_* forwarded to the backend (0 = off), -1 = unchanged
+     */
+    void setLevels(int serialLevel, int remoteLevel);
+    uint8_t getLevel() const { return _level; }
+
+    /**
+     * @brief Map a level name ("error", "warning", "info", "debug", "none") or number
+     * @return LOG_LEVEL_* value, or -1 if not recognized
+     */
+    static int parseLevel(JsonVariantConst value);
+    static int parseLevel(const char* name);
+
+    /**
+     * @brief Backend level name for a LOG_LEVEL_* value
+     */
+    static const char* levelName(uint8_t level);
+
+private:
+    struct Entry {
+        uint8_t level;
+        uint16_t count;
+        uint32_t timestamp;
+        char text[LOG_FORWARD_MESSAGE_MAX];
+    };
+
+    struct Batch {
+        Entry entries[LOG_FORWARD_BATCH_MAX];
+        uint8_t size;
+        uint32_t dropped;
+    };
+
+    struct Site {
+        uintptr_t site;
+        uint32_t lastHash;
+        uint32_t lastUse;
+        uint32_t lastRefill;
+        uint16_t repeats;
+        uint8_t tokens;
+        uint8_t level;
+        uint32_t repeatTimestamp;
+        char lastText[LOG_FORWARD_MESSAGE_MAX];
+    };
+
+    Batch _batches[2];
+    volatile uint8_t _active;
+    Site _sites[RATE_LIMIT_SLOTS];
+    volatile uint8_t _level;
+    unsigned long _lastFlush;
+
+    Site& siteFor(uintptr_t site, uint32_t now);
+    void refill(Site& slot, uint32_t now);
+    void flushRepeats(Site& slot);
+    bool append(uint8_t level, uint32_t timestamp, uint16_t count, const char* text, size_t length);
+};
+
+extern LogForwarder logForwarder;
+
+#endif // LOG_FORWARDER_H
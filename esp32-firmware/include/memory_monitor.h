@@ -0,0 +1,143 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @enum AllocScope
+ * @brief Code regions whose heap usage is tracked separately
+ */
+enum AllocScope {
+    ALLOC_SCOPE_TLS_RECONNECT,  ///< WebSocket/TLS connection attempts
+    ALLOC_SCOPE_JSON_SEND,      ///< JSON frame serialization and transmission
+    ALLOC_SCOPE_COUNT
+};
+
+/**
+ * @class MemoryMonitor
+ * @brief Heap fragmentation and per-task stack headroom telemetry
+ *
+ * Periodically samples the 8-bit capable heap (free bytes and largest free
+ * block) plus the stack high-water mark of every registered task. Samples are
+ * folded into MEMORY_SERIES_BUCKETS time buckets that split the metrics
+ * interval, so each metrics report carries a compact min/max series of its
+ * own window instead of raw samples; the minimum-ever free comes from the
+ * allocator itself.
+ *
+ * Key Features:
+ * - Fixed-size storage (no allocations of its own)
+ * - Allocation tracking around TLS reconnects and JSON sends: heap drop from
+ *   free-size snapshots, plus allocation counts with ALLOC_COUNTER=1; no
+ *   heap walk on the send path
+ * - Low-memory state with hysteresis used to shed optional work
+ *   (remote logs, backfill) before allocations start failing
+ */
+class MemoryMonitor {
+public:
+    MemoryMonitor();
+
+    /**
+     * @brief Register the calling task and take the first sample
+     */
+    void begin();
+
+    /**
+     * @brief Add a task to the stack high-water mark report
+     * @param task FreeRTOS task handle
+     * @param name Short label used in reports (must outlive the monitor)
+     * @return false if the task table is full
+     */
+    bool registerTask(TaskHandle_t task, const char* name);
+
+    /**
+     * @brief Sample heap and stacks if memory_sample_interval_ms (MEMORY_SAMPLE_INTERVAL_MS) elapsed
+     * Called periodically from main loop
+     */
+    void update();
+
+    /**
+     * @brief Take a sample immediately
+     */
+    void sample();
+
+    /**
+     * @brief Check whether the heap is below the configured thresholds
+     * @return true while optional work should be skipped
+     */
+    bool isLowMemory() const { return _lowMemory; }
+
+    /**
+     * @brief Check low-memory state and count the skipped work item
+     * @return true if the caller should drop its optional work
+     */
+    bool shedOptionalWork();
+
+    /**
+     * @brief Mark the start of a tracked allocation scope
+     * @param scope Region being entered
+     */
+    void beginScope(AllocScope scope);
+
+    /**
+     * @brief Mark the end of a tracked allocation scope
+     * @param scope Region being left (must match beginScope)
+     */
+    void endScope(AllocScope scope);
+
+    /**
+     * @brief Serialize the current window into a metrics object and reset it
+     * @param obj Destination JSON object
+     */
+    void appendTo(JsonObject obj);
+
+private:
+    struct Bucket {
+        uint32_t freeMin;
+        uint32_t freeMax;
+        uint32_t blockMin;
+        uint32_t blockMax;
+        bool used;
+    };
+
+    struct TrackedTask {
+        TaskHandle_t handle;
+        const char* name;
+        uint32_t minHighWater;
+    };
+
+    struct ScopeStats {
+        uint32_t runs;
+        uint32_t maxAllocations;    // ALLOC_COUNTER builds only
+        uint32_t maxHeapDrop;
+        // In-flight values captured by beginScope()
+        uint32_t startAllocations;
+        uint32_t startFree;
+        bool active;
+    };
+
+    Bucket _buckets[MEMORY_SERIES_BUCKETS];
+    uint8_t _bucketIndex;
+    unsigned long _bucketStart;
+    unsigned long _lastSample;
+
+    TrackedTask _tasks[MEMORY_MAX_TRACKED_TASKS];
+    uint8_t _taskCount;
+
+    ScopeStats _scopes[ALLOC_SCOPE_COUNT];
+
+    uint32_t _lowMemoryEvents;
+    uint32_t _shedCount;
+    bool _lowMemory;
+
+    void resetWindow();
+    void advanceBucket(unsigned long now);
+    unsigned long bucketMs() const;
+    void updateLowMemoryState(uint32_t freeBytes, uint32_t largestBlock);
+};
+
+extern MemoryMonitor memoryMonitor;
+
+#endif // MEMORY_MONITOR_H
@@ -0,0 +1,162 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "config.h"
+#include <ArduinoJson.h>
+#include <atomic>
+
+/**
+ * @enum MetricType
+ * @brief Kind of series a metric exports
+ */
+enum MetricType {
+    METRIC_COUNTER,    ///< Monotonic count (wraps at 2^32)
+    METRIC_GAUGE,      ///< Instantaneous signed value
+    METRIC_HISTOGRAM   ///< Power-of-two bucketed distribution
+};
+
+/**
+ * @class Metric
+ * @brief Base of every registered series
+ *
+ * Metrics are declared as static objects next to the code that updates
+ * them; the constructor links the object into the global registry list,
+ * so registration costs no heap and needs no central table. Names must be
+ * string literals that follow Prometheus naming (snake_case, unit suffix).
+ */
+class Metric {
+public:
+    Metric(const char* name, const char* help, MetricType type);
+
+    const char* name() const { return _name; }
+    const char* help() const { return _help; }
+    MetricType type() const { return _type; }
+    Metric* next() const { return _next; }
+
+    /**
+     * @brief First registered metric (iteration start)
+     */
+    static Metric* first() { return _head; }
+
+protected:
+    friend class MetricsRegistry;
+
+    const char* _name;
+    const char* _help;
+    MetricType _type;
+    Metric* _next;
+    uint32_t _exported;   ///< Value (or sample count) at the last metrics frame; exporter task only
+
+    static Metric* _head;
+};
+
+/**
+ * @class Counter
+ * @brief Lock-free monotonic counter
+ */
+class Counter : public Metric {
+public:
+    Counter(const char* name, const char* help) : Metric(name, help, METRIC_COUNTER), _value(0) {}
+
+    void inc(uint32_t amount = 1) { _value.fetch_add(amount, std::memory_order_relaxed); }
+    uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> _value;
+};
+
+/**
+ * @class Gauge
+ * @brief Lock-free instantaneous value
+ */
+class Gauge : public Metric {
+public:
+    Gauge(const char* name, const char* help) : Metric(name, help, METRIC_GAUGE), _value(0) {}
+
+    void set(int32_t value) { _value.store(value, std::memory_order_relaxed); }
+    void add(int32_t delta) { _value.fetch_add(delta, std::memory_order_relaxed); }
+    int32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> _value;
+};
+
+/**
+ * @class Histogram
+ * @brief Distribution with power-of-two bucket bounds (le = 1, 2, 4, ... , +Inf)
+ *
+ * observe() is three relaxed atomic increments; bucket selection is a
+ * count-leading-zeros, so it is cheap enough for the loop hot path. The sum
+ * is 32-bit and wraps like a counter.
+ */
+class Histogram : public Metric {
+public:
+    Histogram(const char* name, const char* help);
+
+    void observe(uint32_t value);
+
+    uint32_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint32_t sum() const { return _sum.load(std::memory_order_relaxed); }
+    uint32_t bucket(uint8_t index) const { return _buckets[index].load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Inclusive upper bound of a finite bucket (2^index)
+     */
+    static uint32_t bucketBound(uint8_t index) { return 1UL << index; }
+
+private:
+    std::atomic<uint32_t> _buckets[METRICS_HISTOGRAM_BUCKETS];
+    std::atomic<uint32_t> _count;
+    std::atomic<uint32_t> _sum;
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Export side of the registry: delta JSON frames and Prometheus text
+ *
+ * Key Features:
+ * - Delta frames: only series that changed since the previous frame are
+ *   included (absolute values, so a lost frame heals on the next change)
+ * - Periodic full frames (every METRICS_FULL_FRAME_EVERY) and after
+ *   forceFull(), e.g. on reconnect, so the backend can rebuild its view
+ * - Prometheus text exposition format 0.0.4 for a local scrape
+ */
+class MetricsRegistry {
+public:
+    MetricsRegistry();
+
+    /**
+     * @brief Append changed series to a metrics frame
+     * @param obj Destination object; receives "seq", "full" and "series"
+     * @return Number of series written
+     */
+    size_t appendDelta(JsonObject obj);
+
+    /**
+     * @brief Make the next appendDelta() include every series
+     */
+    void forceFull() { _forceFull = true; }
+
+    /**
+     * @brief Write all series in Prometheus text format
+     * @param out Destination stream (e.g. a WiFiClient)
+     */
+    void writePrometheus(Print& out);
+
+    /**
+     * @brief Find a registered metric by name
+     * @return nullptr if not registered
+     */
+    static Metric* find(const char* name);
+
+private:
+    uint32_t _sequence;
+    bool _forceFull;
+
+    static bool changed(const Metric* metric);
+    static uint32_t current(const Metric* metric);
+};
+
+extern MetricsRegistry metricsRegistry;
+
+#endif // METRICS_H
@@ -3,7 +3,7 @@
 
 // OTA Configuration
 #define OTA_ENABLED 1
-#define OTA_HOSTNAME "ESP32_GREENHOUSE_01"
+// Hostname = device ID (runtimeConfig.deviceId()), unique per device
 #define OTA_PORT 3232
 
 // OTA Password - MUST be set in secrets.h
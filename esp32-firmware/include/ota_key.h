@@ -0,0 +1,17 @@
+#ifndef OTA_KEY_H
+#define OTA_KEY_H
+
+// Public half of the key that signs OTA release manifests (ECDSA P-256, PEM).
+// This is a development key: generate your own release key with
+//   node backend/scripts/ota-release.js --generate-key <dir>
+// and paste the printed public key here (or define OTA_SIGNING_PUBLIC_KEY in the build).
+// Offers whose signature does not verify against it are rejected.
+#ifndef OTA_SIGNING_PUBLIC_KEY
+#define OTA_SIGNING_PUBLIC_KEY \
+    "-----BEGIN PUBLIC KEY-----\n" \
+    "MFkwEwYHKoZIzj0CAQYIKoZIzj0DAQcDQgAECJCzP00XwbPKt43kpDD78O28C+eG\n" \
+    "AtdqqCk2TEx3cZBzts/TgGaJbQbLEZjKciqwMSRGHocKuS8nDaYPy6DFPQ==\n" \
+    "-----END PUBLIC KEY-----\n"
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include "config.h"
+#include "delta_patch.h"
+#include <ArduinoJson.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/md.h>
+
+class VPSWebSocketClient;
+
+#define OTA_ID_MAX_LENGTH       40
+#define OTA_VERSION_MAX_LENGTH  24
+
+/**
+ * @enum OtaState
+ * @brief Progress of a backend-driven update
+ */
+enum OtaState {
+    OTA_STATE_IDLE,
+    OTA_STATE_HASHING,      ///< Checking the running image against the offer's source hash
+    OTA_STATE_DOWNLOADING,  ///< Waiting for the next ota:chunk
+    OTA_STATE_APPLYING,     ///< Rebuilding the image from the chunk in the buffer
+    OTA_STATE_REBOOTING     ///< New image selected, restart pending
+};
+
+/**
+ * @class OtaUpdater
+ * @brief Pulls a signed delta patch over the Socket.IO connection into the inactive OTA slot
+ *
+ * The backend announces a release with ota:offer (version, sizes, SHA-256 of
+ * the source and target images and an ECDSA signature over the target). The
+ * device checks the signature and its own running image, then pulls the patch
+ * in OTA_CHUNK_SIZE pieces with ota:pull; each ota:chunk arrives as a binary
+ * attachment and is streamed through DeltaPatcher straight into esp_ota_write.
+ * The rebuilt image is only selected for boot when its hash matches the
+ * signed one.
+ *
+ * Key Features:
+ * - Bounded RAM: patcher window and buffers plus one chunk (about 9.5 KB,
+ *   static), whatever the image size
+ * - Non-blocking: source hashing and patch application are spread over loop
+ *   iterations (OTA_HASH_BUDGET_BYTES / OTA_APPLY_BUDGET_BYTES)
+ * - Pull-driven, so a dropped connection just resumes at the next offset
+ * - ota:status reports and ota_* metrics with transfer size and apply time
+ */
+class OtaUpdater {
+public:
+    OtaUpdater();
+
+    /**
+     * @brief Validate an ota:offer and start the update
+     * @param client Connection the offer arrived on (chunks are pulled over it)
+     * @param offer Event payload
+     */
+    void handleOffer(VPSWebSocketClient& client, JsonObject& offer);
+
+    /**
+     * @brief Take the binary attachment of an ota:chunk event
+     * Chunks for another update or offset (late duplicates after a re-pull) are ignored.
+     */
+    void handleChunk(VPSWebSocketClient& client, const char* id, uint32_t offset, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Advance the update (hash, pull, apply, finish); called every loop iteration
+     */
+    void loop();
+
+    OtaState state() const { return _state; }
+    bool isActive() const { return _state != OTA_STATE_IDLE; }
+
+private:
+    OtaState _state;
+    VPSWebSocketClient* _client;
+
+    char _id[OTA_ID_MAX_LENGTH];
+    char _version[OTA_VERSION_MAX_LENGTH];
+    uint32_t _patchSize;
+    uint32_t _targetSize;
+    uint32_t _sourceSize;
+    uint8_t _targetSha[32];
+    uint8_t _sourceSha[32];
+
+    // Running image hash, kept across offers (the image cannot change until a reboot)
+    bool _runningShaKnown;
+    uint32_t _runningShaSize;
+    uint8_t _runningSha[32];
+    uint32_t _hashed;
+
+    const esp_partition_t* _running;
+    const esp_partition_t* _target;
+    esp_ota_handle_t _handle;
+    bool _handleOpen;
+    mbedtls_md_context_t _md;
+    bool _mdActive;
+
+    DeltaPatcher _patcher;
+    uint8_t _chunk[OTA_CHUNK_SIZE];
+    size_t _chunkLength;
+    size_t _chunkPos;
+
+    uint32_t _received;
+    bool _pullSent;
+    unsigned long _pullAt;
+    uint8_t _pullAttempts;
+    uint32_t _nextStatusAt;
+    uint64_t _startUs;
+    uint64_t _applyUs;
+    unsigned long _rebootAt;
+
+    void hashStep();
+    void startDownload();
+    void pollDownload();
+    void applyStep();
+    void complete();
+    void fail(const char* error);
+    void reject(VPSWebSocketClient& client, const char* id, const char* error);
+    void sendPull();
+    void sendStatus(const char* state, const char* error = nullptr);
+    void releaseResources();
+    bool verifySignature(const char* signatureHex);
+
+    class PartitionSource : public DeltaSource {
+    public:
+        const esp_partition_t* partition;
+        bool read(uint32_t offset, uint8_t* buffer, size_t length) override;
+    };
+    class OtaSink : public DeltaSink {
+    public:
+        OtaUpdater* owner;
+        bool write(const uint8_t* data, size_t length) override;
+    };
+    PartitionSource _source;
+    OtaSink _sink;
+};
+
+extern OtaUpdater otaUpdater;
+
+#endif
@@ -7,6 +7,10 @@
 #define RELAY_BOMBA_PIN       18  // GPIO18
 #define RELAY_CALEFACTOR_PIN  19  // GPIO19
 
+// Bus I2C (expansores del banco de relés)
+#define I2C_SDA_PIN           21  // GPIO21
+#define I2C_SCL_PIN           22  // GPIO22
+
 // Sensores
 #define DHT_PIN               23  // GPIO23 → DHT11 sensor
 // External temperature sensor pins removed (NTC/DS18B20 not used)
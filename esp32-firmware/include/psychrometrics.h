@@ -0,0 +1,89 @@
+#ifndef PSYCHROMETRICS_H
+#define PSYCHROMETRICS_H
+
+#include "config.h"
+
+#define PSYCHRO_TABLE_MIN_C             -60     // Saturation table: one entry per °C from here...
+#define PSYCHRO_TABLE_MAX_C             60      // ...to here
+
+// Worst case against the Magnus formula with expf/logf for T in -40..60 °C and
+// RH in 1..100 % (checked by bench/psychrometrics_bench.cpp)
+#define PSYCHRO_MAX_SVP_ERROR           0.0015f // Saturation vapour pressure, relative
+#define PSYCHRO_MAX_DEW_POINT_ERROR_C   0.02f   // Dew point (°C)
+#define PSYCHRO_MAX_VPD_ERROR_KPA       0.005f  // Vapour pressure deficit (kPa)
+#define PSYCHRO_MAX_AH_ERROR            0.0015f // Absolute humidity, relative
+
+/**
+ * @struct ClimateMetrics
+ * @brief Derived values for one reading, as sent in sensor:data
+ */
+struct ClimateMetrics {
+    float vpd;                      ///< Vapour pressure deficit (kPa)
+    float dewPoint;                 ///< °C
+    float absoluteHumidity;         ///< g/m³
+    bool outdoor;                   ///< The outdoor fields below are set
+    float outdoorDewPoint;          ///< °C
+    float absoluteHumidityDelta;    ///< Indoor minus outdoor (g/m³); > 0: ventilating removes water
+};
+
+/**
+ * @class Psychrometrics
+ * @brief Agronomic metrics from temperature and relative humidity, without expf/logf
+ *
+ * Saturation vapour pressure follows the Magnus formula (Alduchov & Eskridge
+ * 1996, over water at every temperature): es = 0.61094 exp(17.625 T / (T + 243.04))
+ * kPa. It is tabulated per °C and interpolated linearly; the dew point is the
+ * same table searched backwards. Absolute humidity is the ideal-gas density of
+ * the vapour, 2167.4 e / (T + 273.15) g/m³.
+ *
+ * Key Features:
+ * - A table lookup and a 7-step binary search per reading instead of libm
+ *   exp/log, so every sensor:data frame and LAN reply carries the derived values
+ * - Accuracy bounds against the libm formula in the PSYCHRO_MAX_* defines,
+ *   enforced on the host by bench/psychrometrics_bench.cpp
+ * - Indoor/outdoor deltas from the outdoor temperature and humidity the backend
+ *   sends in sensor:climate, dropped after CLIMATE_OUTDOOR_MAX_AGE_MS
+ * - Temperatures outside the table are clamped to it; the dew point bottoms
+ *   out at PSYCHRO_TABLE_MIN_C (RH below about 1 %)
+ */
+class Psychrometrics {
+public:
+    Psychrometrics();
+
+    /// Saturation vapour pressure over water (kPa)
+    static float saturationVaporPressure(float temperature);
+    /// Temperature at which vapour pressure `vaporPressure` (kPa) saturates (°C)
+    static float dewPointFromVaporPressure(float vaporPressure);
+    static float dewPoint(float temperature, float humidity);
+    /// Vapour pressure deficit (kPa)
+    static float vaporPressureDeficit(float temperature, float humidity);
+    /// Water vapour density (g/m³)
+    static float absoluteHumidity(float temperature, float humidity);
+
+    /**
+     * @brief Derived values for a reading, with outdoor deltas when they are fresh
+     * @param temperature °C
+     * @param humidity Relative humidity (%)
+     * @param metrics Filled in
+     * @return false for a missing reading (NaN) or humidity outside 0..100 %
+     */
+    bool compute(float temperature, float humidity, ClimateMetrics& metrics) const;
+
+    /**
+     * @brief Outdoor conditions from sensor:climate
+     * @param temperature °C (NaN when the backend only has humidity: no outdoor deltas)
+     * @param humidity Relative humidity (%)
+     */
+    void setOutdoor(float temperature, float humidity);
+    bool hasOutdoor() const;
+
+private:
+    float _outdoorTemperature;
+    float _outdoorHumidity;
+    bool _outdoorValid;
+    unsigned long _outdoorAt;   ///< millis() of the last sensor:climate
+};
+
+extern Psychrometrics psychrometrics;
+
+#endif // PSYCHROMETRICS_H
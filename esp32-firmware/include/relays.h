@@ -5,84 +5,105 @@
 
 /**
  * @class RelayManager
- * @brief Controls 4-channel relay board for greenhouse actuators
- * 
- * Manages relay states, safety limits, and automated control for:
+ * @brief Controls the greenhouse relay bank (RELAY_COUNT channels)
+ *
+ * Channels 0-3 are the on-board GPIO relays:
  * - Lights (relay 0)
- * - Ventilation fan (relay 1) 
+ * - Ventilation fan (relay 1)
  * - Water pump (relay 2)
  * - Heating element (relay 3)
- * 
+ *
+ * Larger houses add RELAY_EXPANDER_COUNT I2C expanders (MCP23017 or PCF8575,
+ * RELAY_EXPANDER_TYPE), 16 channels each, numbered after the GPIO relays.
+ *
  * Features:
  * - PROGMEM storage for relay names (saves RAM)
- * - Safety timeout protection
- * - State persistence and recovery
- * - Automated control based on sensor thresholds
+ * - GPIO channels switch immediately; expander channels are shadowed and
+ *   flushed by update() as one write per changed expander per loop tick
+ * - Expanders that NACK are retried, and every expander is reconfigured
+ *   periodically so one that browned out on its own comes back
  */
 class RelayManager {
 private:
-    RelayState relayStates[4];
+    RelayState relayStates[RELAY_COUNT];
     unsigned long lastAutoCheck;
     bool safetyLimitsEnabled;
-    
+
     static const char relayName0[] PROGMEM;
     static const char relayName1[] PROGMEM;
     static const char relayName2[] PROGMEM;
     static const char relayName3[] PROGMEM;
-    static const char* const relayNames_P[4] PROGMEM;
+    static const char* const relayNames_P[RELAY_GPIO_COUNT] PROGMEM;
+
+#if RELAY_EXPANDER_COUNT > 0
+    char _expanderNames[RELAY_COUNT - RELAY_GPIO_COUNT][RELAY_NAME_MAX];
+    uint16_t _expanderOutputs[RELAY_EXPANDER_COUNT];  // Pin levels to drive (polarity applied)
+    uint8_t _expanderDirty;                            // Bit per expander: outputs not written yet
+    uint8_t _expanderNeedsConfig;                      // Bit per expander: direction/outputs unknown
+    uint8_t _expanderFailing;                          // Bit per expander: last transaction NACKed
+    unsigned long _lastBusFailure;
+    unsigned long _lastBusRefresh;
+
+    bool configureExpander(uint8_t expander);
+    bool writeExpander(uint8_t expander);
+#endif
 
 public:
     RelayManager();
-    
+
     /**
-     * @brief Initialize relay pins and load saved states
-     * @return true if initialization successful
+     * @brief Initialize relay pins and expanders (all channels OFF)
+     * @return true if every expander answered
      */
     bool begin();
-    
+
     /**
-     * @brief Update relay states based on automation rules
-     * Called periodically from main loop
+     * @brief Flush pending expander writes; called every loop iteration
      */
     void update();
-    
+
     /**
      * @brief Set specific relay to desired state
-     * @param relayIndex Relay number (0-3)
+     * @param relayIndex Relay number (0 to RELAY_COUNT - 1)
      * @param state true=on, false=off
-     * @return true if relay set successfully
+     * @return true if relay set successfully (expander channels reach the pin on the next update())
      */
     bool setRelay(int relayIndex, bool state);
-    
+
     /**
      * @brief Toggle relay state (on->off, off->on)
-     * @param relayIndex Relay number (0-3)
+     * @param relayIndex Relay number (0 to RELAY_COUNT - 1)
      * @return true if toggle successful
      */
     bool toggleRelay(int relayIndex);
-    
+
     /**
      * @brief Get current relay state
-     * @param relayIndex Relay number (0-3)
+     * @param relayIndex Relay number (0 to RELAY_COUNT - 1)
      * @return true if relay is on
      */
     bool getRelayState(int relayIndex);
-    
+
     /**
      * @brief Get complete relay state information
-     * @param relayIndex Relay number (0-3)
+     * @param relayIndex Relay number (0 to RELAY_COUNT - 1)
      * @return RelayState struct with full state info
      */
     RelayState getRelayStateStruct(int relayIndex);
-    
+
     /**
      * @brief Get human-readable relay name
-     * @param idx Relay index (0-3)
-     * @return String with relay description
+     * @param idx Relay index (0 to RELAY_COUNT - 1)
+     * @return Name in flash or RAM ("unknown" for a bad index); no copy is made
      */
-    String relayName(uint8_t idx) const;
-    
-    static const uint8_t relayPins[4];
+    const char* relayName(uint8_t idx) const;
+
+    /**
+     * @brief true while no expander write is pending or failing
+     */
+    bool busSettled() const;
+
+    static const uint8_t relayPins[RELAY_GPIO_COUNT];
 };
 
 extern RelayManager relays;
@@ -0,0 +1,115 @@
+#ifndef RUNTIME_CONFIG_H
+#define RUNTIME_CONFIG_H
+
+#include "config.h"
+#include "vps_config.h"
+#include <ArduinoJson.h>
+
+/**
+ * @struct RuntimeConfigValues
+ * @brief Settings that can be tuned per site without a rebuild
+ *
+ * Compiled defaults come from config.h. Fields are only ever appended: a
+ * blob written by an older build (shorter) is read over the defaults, so new
+ * fields keep their compiled value. Changing the meaning or unit of a field
+ * requires bumping CONFIG_SCHEMA_VERSION, which drops stored blobs.
+ */
+struct RuntimeConfigValues {
+    uint32_t sensorIntervalMs;          ///< SENSOR_READ_INTERVAL_MS
+    uint32_t metricsIntervalMs;         ///< METRICS_SEND_INTERVAL_MS
+    uint32_t healthCheckIntervalMs;     ///< HEALTH_CHECK_INTERVAL_MS
+    uint32_t unusedPingIdleMs;          ///< Was ping_idle_ms (app heartbeat, now Engine.IO's); keeps the blob layout
+    uint32_t reconnectIntervalMs;       ///< WS_RECONNECT_INTERVAL_MS
+    uint32_t authBackoffBaseMs;         ///< AUTH_BACKOFF_BASE_MS
+    uint32_t authBackoffMaxMs;          ///< AUTH_BACKOFF_MAX_MS
+    uint32_t logForwardIntervalMs;      ///< LOG_FORWARD_INTERVAL_MS
+    uint32_t timeProbeIntervalMs;       ///< TIME_SERVER_PROBE_INTERVAL_MS
+    uint32_t memorySampleIntervalMs;    ///< MEMORY_SAMPLE_INTERVAL_MS
+    float maxTempChange;                ///< MAX_TEMP_CHANGE_PER_READ
+    float maxHumidityChange;            ///< MAX_HUMIDITY_CHANGE_PER_READ
+    uint32_t heaterMode;                ///< CONTROL_HEATER_MODE
+    float heaterSetpoint;               ///< CONTROL_HEATER_SETPOINT
+    float heaterKp;                     ///< CONTROL_HEATER_KP
+    float heaterKi;                     ///< CONTROL_HEATER_KI
+    float heaterKd;                     ///< CONTROL_HEATER_KD
+    uint32_t fanMode;                   ///< CONTROL_FAN_MODE
+    float fanSetpoint;                  ///< CONTROL_FAN_SETPOINT
+    float fanKp;                        ///< CONTROL_FAN_KP
+    float fanKi;                        ///< CONTROL_FAN_KI
+    float fanKd;                        ///< CONTROL_FAN_KD
+    float fanHumidityMax;               ///< CONTROL_FAN_HUMIDITY_MAX
+    float controlBand;                  ///< CONTROL_BAND_C
+    uint32_t controlWindowMs;           ///< CONTROL_WINDOW_MS
+    uint32_t controlMinSwitchMs;        ///< CONTROL_MIN_SWITCH_MS
+};
+
+/**
+ * @class RuntimeConfig
+ * @brief Device identity plus the NVS-backed runtime configuration
+ *
+ * The identity is DEVICE_ID when a build pins one, otherwise derived from the
+ * factory MAC, so a single binary serves the whole fleet. The configuration
+ * is a versioned blob in NVS (CONFIG_SCHEMA_VERSION) updated by config:set
+ * from the backend; consumers read values() at the point of use, so a change
+ * takes effect on the next check without a reboot.
+ *
+ * Key Features:
+ * - Partial updates: only the keys present in config:set change; each one is
+ *   range-checked and rejected keys are reported back
+ * - Blob checked by schema, length and FNV-1a checksum; anything invalid
+ *   falls back to the compiled defaults
+ * - NVS is only written when a value actually changes
+ */
+class RuntimeConfig {
+public:
+    RuntimeConfig();
+
+    /**
+     * @brief Derive the device ID and load the stored configuration
+     */
+    void begin();
+
+    /**
+     * @brief Current values (compiled defaults until begin() or when nothing is stored)
+     */
+    const RuntimeConfigValues& values() const { return _values; }
+
+    /**
+     * @brief Device ID sent in device:register and every event
+     */
+    const char* deviceId() const { return _deviceId; }
+
+    /**
+     * @brief Incremented on every stored change (0 = compiled defaults)
+     */
+    uint32_t revision() const { return _revision; }
+
+    /**
+     * @brief Apply a config:set payload ({key: value, ...} or {reset: true})
+     * @param data Event payload
+     * @param rejected Receives the first CONFIG_REJECTED_KEYS_MAX keys that were unknown or out of range
+     * @param rejectedCount Receives the number of rejected keys, listed or not
+     * @return Number of values that changed
+     */
+    int apply(JsonObject& data, JsonArray rejected, int& rejectedCount);
+
+    /**
+     * @brief Write the current values as a config:state payload
+     */
+    void toJson(JsonObject& out) const;
+
+    static RuntimeConfigValues defaults();
+
+private:
+    RuntimeConfigValues _values;
+    uint32_t _revision;
+    char _deviceId[DEVICE_ID_MAX_LENGTH];
+
+    bool load();
+    void store();
+    void reset();
+};
+
+extern RuntimeConfig runtimeConfig;
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef SENSOR_BLOCK_H
+#define SENSOR_BLOCK_H
+
+#include "config.h"
+
+#define SENSOR_BLOCK_VERSION        1
+#define SENSOR_BLOCK_CHANNELS       3       // temperature, humidity, soil_moisture (in that order)
+#define SENSOR_BLOCK_HEADER_BYTES   12      // version, channels, count (LE16), first timestamp (LE64)
+// Largest reading: '1111' + 32-bit delta-of-delta, then per channel '11' + 5 + 5 + 32 bits
+#define SENSOR_BLOCK_MAX_READING_BITS (4 + 32 + SENSOR_BLOCK_CHANNELS * (2 + 5 + 5 + 32))
+
+/**
+ * @class SensorBlockEncoder
+ * @brief Packs timestamped readings into a Gorilla-style compressed block
+ *
+ * Block layout: a 12-byte header (version, channel count, reading count and
+ * the first timestamp, little-endian) followed by one bit stream, MSB first.
+ * The first reading's values are stored raw; after that every reading costs
+ * a timestamp code and one value code per channel:
+ *
+ * Timestamp (delta-of-delta, ms): '0' same interval as before;
+ * '10' + 7 bits for [-63, 64]; '110' + 9 bits for [-255, 256];
+ * '1110' + 12 bits for [-2047, 2048] (each stored plus 63, 255 or 2047);
+ * '1111' + 32 bits two's complement otherwise.
+ * Value (XOR with the previous float of the channel): '0' unchanged;
+ * '10' + the meaningful bits inside the previous leading/trailing-zero
+ * window; '11' + 5 bits leading zeros + 5 bits (length - 1) + the bits.
+ *
+ * Key Features:
+ * - Periodic readings compress to a couple of bits for the timestamp and one
+ *   bit per channel that did not change (a DHT11 sits on one value for minutes)
+ * - Appends are all-or-nothing: a reading that might not fit is refused, so
+ *   the block is always complete and can be sent as it is
+ * - Fixed buffer (SENSOR_BLOCK_MAX_BYTES), no heap use; a block can be capped
+ *   smaller to fit the space left in a flash sector (HistoryStore)
+ * - Decoded by SensorBlockDecoder (host tools) and backend lib/sensorBlock.js
+ */
+class SensorBlockEncoder {
+public:
+    SensorBlockEncoder();
+
+    /**
+     * @brief Empty the block (the next reading starts a new one)
+     * @param capacity Bytes the block may grow to, header included (at most
+     *        SENSOR_BLOCK_MAX_BYTES; raised to fit at least one reading)
+     */
+    void reset(size_t capacity = SENSOR_BLOCK_MAX_BYTES);
+
+    /**
+     * @brief Add a reading
+     * @param timestampMs Acquisition time; never before the previous reading's
+     * @param values One value per channel
+     * @return false if the block is full or the timestamp cannot follow the previous one
+     */
+    bool append(uint64_t timestampMs, const float values[SENSOR_BLOCK_CHANNELS]);
+
+    const uint8_t* data() const { return _buffer; }
+    /// Encoded bytes, header included (0 while empty)
+    size_t size() const { return _count ? SENSOR_BLOCK_HEADER_BYTES + (_bits + 7) / 8 : 0; }
+    uint16_t count() const { return _count; }
+    uint64_t firstMs() const { return _firstMs; }
+    uint64_t lastMs() const { return _lastMs; }
+
+private:
+    uint8_t _buffer[SENSOR_BLOCK_MAX_BYTES];
+    size_t _capacity;           // Bytes the block may use, header included
+    size_t _bits;               // Bits written after the header
+    uint16_t _count;
+    uint64_t _firstMs;
+    uint64_t _lastMs;
+    int64_t _lastDelta;
+    uint32_t _lastValue[SENSOR_BLOCK_CHANNELS];
+    uint8_t _leading[SENSOR_BLOCK_CHANNELS];    // Window of the last explicit value code
+    uint8_t _trailing[SENSOR_BLOCK_CHANNELS];
+
+    void writeBits(uint32_t value, uint8_t bits);
+    void writeTimestamp(int64_t deltaOfDelta);
+    void writeValue(uint8_t channel, uint32_t value);
+};
+
+/**
+ * @class SensorBlockDecoder
+ * @brief Reads a block written by SensorBlockEncoder back, reading by reading
+ */
+class SensorBlockDecoder {
+public:
+    /**
+     * @param data Encoded block (not copied; must outlive the decoder)
+     * @param length Bytes available
+     */
+    SensorBlockDecoder(const uint8_t* data, size_t length);
+
+    /// Header understood (version and channel count match)
+    bool valid() const { return _valid; }
+    uint16_t count() const { return _count; }
+
+    /**
+     * @brief Decode the next reading
+     * @return false after the last reading, or if the block is truncated
+     */
+    bool next(uint64_t& timestampMs, float values[SENSOR_BLOCK_CHANNELS]);
+
+private:
+    const uint8_t* _data;
+    size_t _lengthBits;
+    size_t _position;           // Bit position after the header
+    bool _valid;
+    uint16_t _count;
+    uint16_t _decoded;
+    uint64_t _lastMs;
+    int64_t _lastDelta;
+    uint32_t _lastValue[SENSOR_BLOCK_CHANNELS];
+    uint8_t _leading[SENSOR_BLOCK_CHANNELS];
+    uint8_t _trailing[SENSOR_BLOCK_CHANNELS];
+
+    bool readBits(uint8_t bits, uint32_t& value);
+    bool readTimestamp(int64_t& deltaOfDelta);
+    bool readValue(uint8_t channel);
+};
+
+/// Readings taken while the backend is unreachable; main.cpp uploads them as sensor:block
+extern SensorBlockEncoder sensorBacklog;
+
+#endif // SENSOR_BLOCK_H
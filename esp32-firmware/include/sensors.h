@@ -27,6 +27,7 @@ public:
     void clearExternalHumidity();
     std::unique_ptr<DHT> dht;  // Smart pointer prevents memory leaks
     unsigned long lastReadTime;
+    unsigned long warmupStart;  // millis() at begin(), DHT readings skipped for DHT_INIT_STABILIZE_DELAY_MS
     float soilMoisture1Offset;
     int readingIndex;
     bool bufferFull;
@@ -54,12 +55,17 @@ public:
     SensorManager();
     ~SensorManager();
     bool begin();
+    /**
+     * @brief Check whether the DHT warm-up window since begin() has elapsed
+     * @return true once readSensors() will actually sample the sensors
+     */
+    bool isWarmedUp() const;
     bool readSensors();
     SensorData getCurrentData();
     SensorData getLastValidData();
     void setSoilMoistureOffset(float offset);
     bool isDataValid(const SensorData& data);
-    String getLastError();
+    const char* getLastError();
     int getTempErrors() const { return consecutiveTempErrors; }
     int getHumidityErrors() const { return consecutiveHumidityErrors; }
     bool updateSoilSampling();
@@ -0,0 +1,117 @@
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#include "config.h"
+#include <esp_timer.h>
+
+/**
+ * @enum TimeSource
+ * @brief Where epoch timestamps currently come from, best last
+ */
+enum TimeSource {
+    TIME_SOURCE_NONE,       ///< No reference yet: readings go out without a timestamp
+    TIME_SOURCE_SERVER,     ///< Backend clock, from time:sync round trips
+    TIME_SOURCE_SNTP        ///< SNTP, corrected for the estimated crystal drift
+};
+
+/**
+ * @class TimeBase
+ * @brief 64-bit monotonic clock with an epoch mapping from SNTP or the backend
+ *
+ * Everything is stamped on esp_timer (microseconds since reset, never wraps)
+ * and converted to epoch milliseconds only when a frame is built, so a
+ * reading taken before the first sync still gets its real acquisition time
+ * once one lands. SNTP steps the mapping at each resync; between resyncs it
+ * is extrapolated with the drift measured across the previous ones.
+ *
+ * Key Features:
+ * - Non-blocking SNTP: completion is polled in update(), overdue syncs are
+ *   restarted, and the wall clock is never read before it is valid
+ * - Drift estimate (EWMA over resyncs) applied between syncs
+ * - Backend offset from time:sync (NTP-style midpoint, lowest RTT of the
+ *   last TIME_SERVER_SAMPLES probes), used until SNTP syncs
+ * - time_source, time_drift_ppb, time_sntp_step_ms and
+ *   time_server_offset_ms / time_server_rtt_ms in the metrics registry
+ */
+class TimeBase {
+public:
+    TimeBase();
+
+    /**
+     * @brief Start SNTP in the background (needs an IP address)
+     */
+    void begin();
+
+    /**
+     * @brief Take in a completed SNTP sync and restart overdue ones
+     * Called every loop iteration
+     */
+    void update();
+
+    /**
+     * @brief Microseconds since reset (esp_timer, 64-bit)
+     */
+    static uint64_t monotonicUs() { return (uint64_t)esp_timer_get_time(); }
+
+    /**
+     * @brief Milliseconds since reset (64-bit, unlike millis())
+     */
+    static uint64_t monotonicMs() { return monotonicUs() / 1000ULL; }
+
+    /**
+     * @brief Current time in epoch milliseconds
+     * @return 0 while no time source is available
+     */
+    uint64_t epochMs() const { return epochMsAt(monotonicMs()); }
+
+    /**
+     * @brief Convert a monotonicMs() stamp to epoch milliseconds
+     * @param monotonic Value of monotonicMs() at the instant to convert
+     * @return 0 while no time source is available
+     */
+    uint64_t epochMsAt(uint64_t monotonic) const;
+
+    /**
+     * @brief Record a time:sync round trip with the backend clock
+     * @param sentMs monotonicMs() when the request was sent (echoed back as t0)
+     * @param serverMs Backend epoch milliseconds in the reply
+     * @param receivedMs monotonicMs() when the reply arrived
+     */
+    void addServerSample(uint64_t sentMs, uint64_t serverMs, uint64_t receivedMs);
+
+    /**
+     * @brief Best time source available now
+     */
+    TimeSource source() const;
+
+    bool isSynced() const { return source() != TIME_SOURCE_NONE; }
+    bool isSntpSynced() const { return _sntpAnchored; }
+
+private:
+    struct ServerSample {
+        int64_t offsetMs;   // Backend epoch minus monotonicMs()
+        uint32_t rttMs;
+    };
+
+    bool _started;
+    uint64_t _sntpDeadlineMs;   // Restart SNTP if no sync lands before this
+
+    // SNTP mapping: epoch = _anchorEpochMs + elapsed * (1 + _driftPpm / 1e6)
+    bool _sntpAnchored;
+    uint64_t _anchorMonoMs;
+    uint64_t _anchorEpochMs;
+    float _driftPpm;
+    bool _driftKnown;
+
+    ServerSample _serverSamples[TIME_SERVER_SAMPLES];
+    uint8_t _serverSampleCount;
+    uint8_t _serverSampleNext;
+    int64_t _serverOffsetMs;
+
+    void applySntpSample(uint64_t monoMs, uint64_t epochMs);
+    uint64_t sntpEpochMsAt(uint64_t monotonic) const;
+};
+
+extern TimeBase timeBase;
+
+#endif
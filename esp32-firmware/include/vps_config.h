@@ -5,8 +5,13 @@
 
 // ...existing code...
 
-// Device identification
-#define DEVICE_ID                   "ESP32_GREENHOUSE_01"
+// Device identification: empty = derived from the factory MAC (DEVICE_ID_PREFIX + 12 hex
+// digits) so one binary serves every device; a build flag can still pin a fixed ID
+#ifndef DEVICE_ID
+#define DEVICE_ID                   ""
+#endif
+#define DEVICE_ID_PREFIX            "ESP32_GH_"
+#define DEVICE_ID_MAX_LENGTH        32      // Per-client ID buffer, terminator included
 // FIRMWARE_VERSION: Single source of truth (NOT defined in config.h)
 #define FIRMWARE_VERSION            "2.3-ota"
 
@@ -17,9 +22,22 @@
 #endif
 
 // ========== CONFIGURACIÓN DE WEBSOCKET ==========
+// Host/port/path can be overridden with build flags (the native env points them at a local server)
+#ifndef VPS_WEBSOCKET_HOST
 #define VPS_WEBSOCKET_HOST          "reimon.dev"
+#endif
+#ifndef VPS_WEBSOCKET_PORT
 #define VPS_WEBSOCKET_PORT          443
+#endif
+#ifndef VPS_WEBSOCKET_PATH
 #define VPS_WEBSOCKET_PATH          "/greenhouse/socket.io/?EIO=4&transport=websocket"
+#endif
 #define VPS_WEBSOCKET_USE_SSL       true
+// Ordered backend endpoints, "host:port,host:port" (first = primary, same path and TLS
+// setting for all); empty = VPS_WEBSOCKET_HOST:VPS_WEBSOCKET_PORT only
+#ifndef VPS_ENDPOINTS
+#define VPS_ENDPOINTS               ""
+#endif
+#define RELAY_COMMAND_EPOCH_MAX_LENGTH 17    // Backend epoch of sequenced relay:command (8 hex today), terminator included
 
 #endif // VPS_CONFIG_H
@@ -6,26 +6,15 @@
 #include <ArduinoJson.h>
 #include "secrets.h"      // MUST be included BEFORE vps_config.h for DEVICE_AUTH_TOKEN
 #include "vps_config.h"
+#include "ota_updater.h"
+#include "anomaly_detector.h"
+#include "sensor_block.h"
+#include "endpoint_selector.h"
 
 // Callback types
 typedef void (*RelayCommandCallback)(int relayId, bool state);
 typedef void (*SensorRequestCallback)();
 
-/**
- * @struct ConnectionMetrics
- * @brief Tracks WebSocket connection statistics for monitoring
- */
-struct ConnectionMetrics {
-    unsigned long totalConnections;      ///< Total successful connections
-    unsigned long authFailures;          ///< Authentication failure count
-    unsigned long reconnections;         ///< Automatic reconnection attempts
-    unsigned long messagesReceived;      ///< Incoming messages count
-    unsigned long messagesSent;          ///< Outgoing messages count
-    unsigned long uptimeSeconds;         ///< Total connection uptime
-    unsigned long lastConnectionTime;    ///< Timestamp of last connection
-    unsigned long totalDisconnections;   ///< Total disconnection events
-};
-
 /**
  * @class VPSWebSocketClient
  * @brief WebSocket client for real-time communication with VPS backend
@@ -40,7 +29,20 @@ struct ConnectionMetrics {
  * - Circuit breaker pattern for fault tolerance
  * - Authentication with token-based security
  * - Real-time sensor data transmission
- * - Remote relay control via WebSocket commands
+ * - Remote relay control via WebSocket commands; sequenced commands are
+ *   applied once and in order, and acked cumulatively (relay:ack)
+ * - Socket.IO binary events (ota:chunk attachments for the OTA updater,
+ *   sensor:block uploads of readings taken offline, sensor:history:chunk
+ *   answers from the flash history)
+ * - Liveness from the Engine.IO heartbeat: the server's pings are answered,
+ *   and none for pingInterval + pingTimeout (from the open packet) closes a
+ *   half-open connection; no heartbeat traffic of our own
+ * - Epoch-ms acquisition timestamps (TimeBase), with time:sync probes that
+ *   give the backend clock offset until SNTP syncs
+ * - Several backend endpoints (VPS_ENDPOINTS): EndpointSelector probes them
+ *   and the client reconnects to the one it picks (failover and fail back)
+ * - No shared state between instances (per-instance device ID and event
+ *   binding), so a host tool can run many clients in one process
  */
 class VPSWebSocketClient {
 public:
@@ -51,6 +53,38 @@ public:
     void loop();
     bool isConnected();
     
+    /**
+     * @brief True between device:auth_success and the next disconnect or auth failure
+     */
+    bool isAuthenticated() const { return _authenticated; }
+    
+    /**
+     * @brief True from a device:auth_failed until the next device:auth_success
+     */
+    bool isAuthRejected() const { return _authFailureCount > 0; }
+    
+    /**
+     * @brief Link recovery, socket rung: close the connection and let the client reopen it
+     * 
+     * A half-open socket goes, and an open circuit breaker no longer holds the retry.
+     */
+    void resetSocket();
+    
+    /**
+     * @brief Link recovery, TLS rung: start over on a new transport
+     * 
+     * Endpoint names are looked up again and the client is reconfigured, so the
+     * next attempt is a fresh connection and TLS handshake right away.
+     */
+    void restartTransport();
+    
+    /**
+     * @brief Set the ID sent in device:register and every event (default DEVICE_ID)
+     * @param deviceId Up to DEVICE_ID_MAX_LENGTH - 1 characters; longer IDs are truncated
+     */
+    void setDeviceId(const char* deviceId);
+    const char* getDeviceId() const { return _deviceId; }
+    
     // Send data to server
     /**
      * @brief Send sensor readings to backend server
@@ -59,13 +93,18 @@ public:
      * @param soilMoisture Soil moisture percentage (-1 if not available)
      * @param tempErrors Consecutive temperature sensor errors
      * @param humidityErrors Consecutive humidity sensor errors
+     * @param acquiredMs TimeBase::monotonicMs() when the reading was taken (0 = now);
+     *        sent as an epoch-ms timestamp once a time source is available
+     * VPD, dew point and absolute humidity (and outdoor deltas after a sensor:climate)
+     * are added from temperature and humidity (psychrometrics.h)
      * @return true if data sent successfully
      */
-    bool sendSensorData(float temperature, float humidity, float soilMoisture = -1, int tempErrors = 0, int humidityErrors = 0);
+    bool sendSensorData(float temperature, float humidity, float soilMoisture = -1, int tempErrors = 0, int humidityErrors = 0,
+                        uint64_t acquiredMs = 0);
     
     /**
      * @brief Send relay state change to backend
-     * @param relayId Relay number (0-3)
+     * @param relayId Relay number (0 to RELAY_COUNT - 1)
      * @param state New relay state (true=on, false=off)
      * @param mode Control mode ("manual", "auto", "rule")
      * @param changedBy Who initiated the change
@@ -74,19 +113,58 @@ public:
     bool sendRelayState(int relayId, bool state, const char* mode = "manual", const char* changedBy = "esp32");
     
     /**
-     * @brief Send log message to backend for remote monitoring
-     * @param level Log level ("DEBUG", "INFO", "WARN", "ERROR")
+     * @brief Send a streaming detector hit as a sensor:anomaly event
+     * @param event Detection from AnomalyDetector
+     * @return true if the event was sent
+     */
+    bool sendAnomaly(const AnomalyEvent& event);
+    
+    /**
+     * @brief Upload a compressed block of readings as a sensor:block binary event
+     * @param block Readings stamped with TimeBase::monotonicMs()
+     * @return false when not connected or empty, or before a time source exists
+     *         (the backend needs epoch times for the first and last reading)
+     */
+    bool sendSensorBlock(const SensorBlockEncoder& block);
+    
+    /**
+     * @brief Queue a log message for the next log:batch frame
+     * @param level Log level ("debug", "info", "warn"/"warning", "error")
      * @param message Log message content
-     * @return true if log sent successfully
+     * @return true if the message was queued
      */
     bool sendLog(const char* level, const char* message);
     
     /**
-     * @brief Send connection metrics to backend
-     * @param metrics ConnectionMetrics struct with statistics
+     * @brief Send a metrics frame (registry series changed since the last frame)
      * @return true if metrics sent successfully
      */
-    bool sendMetrics(const ConnectionMetrics& metrics);
+    bool sendMetrics();
+    
+    /**
+     * @brief Send the boot phase timeline as a device:boot event
+     * @return true if the report was sent
+     */
+    bool sendBootReport();
+    
+    /**
+     * @brief Emit an event for a module with its own protocol (e.g. ota:pull, ota:status)
+     * @param event Event name
+     * @param data Event payload
+     * @return false when not connected or the frame was not sent (too large or socket error)
+     */
+    bool emit(const char* event, JsonDocument& data);
+    
+    /**
+     * @brief Emit an event with one binary attachment (e.g. sensor:block, sensor:history:chunk)
+     * @param event Event name
+     * @param data Event payload; needs room for one more nested object, the placeholder set at key
+     * @param key Field of data that stands for the attachment
+     * @param attachment Bytes sent as the following binary frame
+     * @param length Attachment size
+     * @return false when not connected or the payload does not fit
+     */
+    bool emitBinary(const char* event, JsonDocument& data, const char* key, const uint8_t* attachment, size_t length);
     
     // Set callbacks for incoming commands
     /**
@@ -101,58 +179,115 @@ public:
      */
     void onSensorRequest(SensorRequestCallback callback);
     
+    // Payloads shared with the LAN API (local_api.cpp), so both paths validate and ack alike
+    /**
+     * @brief Validate a relay:command payload
+     * @param data Event payload ({relay_id, state})
+     * @param relayId Receives the relay number
+     * @param state Receives the requested state
+     * @return nullptr if the command can be applied, else the relay:error code
+     */
+    static const char* parseRelayCommand(JsonObject& data, int& relayId, bool& state);
+    
+    /**
+     * @brief Fill a relay:error payload for a code from parseRelayCommand()
+     */
+    static void fillRelayError(JsonObject error, const char* code, int relayId);
+    
+    /**
+     * @brief Fill a relay:state payload (see sendRelayState())
+     */
+    void fillRelayState(JsonObject data, int relayId, bool state, const char* mode, const char* changedBy);
+    
+    /**
+     * @brief Fill a sensor:data payload (see sendSensorData())
+     */
+    void fillSensorData(JsonObject data, float temperature, float humidity, float soilMoisture, int tempErrors,
+                        int humidityErrors, uint64_t acquiredMs);
+    
     // Get connection status
     /**
      * @brief Get human-readable connection status
-     * @return String describing current connection state
+     * @return Static string describing current connection state
      */
-    String getStatus();
+    const char* getStatus();
     
     /**
-     * @brief Get current connection metrics
-     * @return ConnectionMetrics struct with current statistics
+     * @brief Endpoint list with probe results; active() is the one in use
      */
-    ConnectionMetrics getMetrics();
+    const EndpointSelector& endpoints() const { return _endpoints; }
 
 private:
     WebSocketsClient _webSocket;
+    EndpointSelector _endpoints;
+    char _deviceId[DEVICE_ID_MAX_LENGTH];
     bool _connected;
+    bool _authenticated;
     unsigned long _lastReconnectAttempt;
-    unsigned long _lastPing;
-    unsigned long _lastActivity;  // Track last message sent/received for intelligent heartbeat
+    unsigned long _lastServerPing; // Last Engine.IO ping (or open packet / connect) from the server
+    uint32_t _pingIntervalMs;     // Server pingInterval / pingTimeout from the open packet
+    uint32_t _pingTimeoutMs;
+    unsigned long _lastTimeProbe; // Last time:sync carrying t0 for the backend clock offset
+    bool _timeProbeDue;           // Probe on the next loop (set at authentication)
+    
+    // Binary event whose attachment (next WStype_BIN frame) is still to come
+    bool _binaryPending;
+    char _binaryId[OTA_ID_MAX_LENGTH];
+    uint32_t _binaryOffset;
     
     // Authentication failure tracking
     bool _authFailed;
     int _authFailureCount;
     unsigned long _lastAuthAttempt;
+    unsigned long _authBackoffMs;  // Delay chosen (with jitter) at the last auth failure
     
     // Circuit breaker pattern
     int _consecutiveFailures;
     bool _circuitBreakerOpen;
     unsigned long _circuitBreakerOpenTime;
     
+    // Sequenced relay:command (backend lib/relayCommands.js): highest seq applied under _commandEpoch
+    char _commandEpoch[RELAY_COMMAND_EPOCH_MAX_LENGTH];
+    uint32_t _commandSeq;
+    bool _commandAckDue;   // relay:ack goes out once per loop(), covering every command since the last one
+    bool _commandGap;      // An out-of-order command was dropped: ask for a resend
+    
     // Callbacks
     RelayCommandCallback _relayCommandCallback;
     SensorRequestCallback _sensorRequestCallback;
     
-    // Connection metrics
-    ConnectionMetrics _metrics;
-    unsigned long _startTime;
-    
-    // WebSocket event handler
-    static void webSocketEvent(WStype_t type, uint8_t * payload, size_t length);
-    static VPSWebSocketClient* _instance;
+    // WebSocket event handler (bound to this instance in begin())
+    void webSocketEvent(WStype_t type, uint8_t * payload, size_t length);
     
     // Internal handlers
     void handleConnected();
     void handleDisconnected();
     void handleMessage(uint8_t * payload, size_t length);
+    void handleBinaryEvent(uint8_t * payload, size_t length);
+    void handleBinary(uint8_t * payload, size_t length);
     void handleRelayCommand(JsonObject& data);
+    bool acceptCommandSeq(JsonObject& data);
+    void sendRelayAck();
     void handleSensorRequest();
+    void handleLogLevel(JsonObject& data);
+    void handleConfigSet(JsonObject& data);
+    void sendConfigState(JsonDocument& response);
     
     // Helper methods
-    void sendEvent(const char* event, JsonDocument& data);
+    // Never inlined: its 768-byte frame buffer would land in every caller's stack frame,
+    // handleMessage() included
+    __attribute__((noinline)) bool sendEvent(const char* event, JsonDocument& data);
+    bool sendEventFrame(const char* event, JsonDocument& data, char* payload, size_t capacity);
+    void handleOpen(uint8_t * payload, size_t length);
+    void sendTimeProbe();
+    bool sendLogBatch();
+    bool sendFrame(const char* payload, size_t length = 0);
+    bool sendBinaryFrame(const uint8_t* payload, size_t length);
+    void connectEndpoint();
     bool reconnect();
+    
+    // Host microbenchmarks (bench/micro_bench.cpp) time the private handlers directly
+    friend class MicroBenchAccess;
 };
 
 #endif // VPS_WEBSOCKET_H
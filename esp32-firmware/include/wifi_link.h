@@ -0,0 +1,116 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include "config.h"
+#include <WiFi.h>
+#include <atomic>
+
+/**
+ * @struct WiFiLinkCache
+ * @brief Last good association, kept in RTC memory and mirrored to NVS
+ *
+ * RTC memory survives software and watchdog resets; NVS also survives a
+ * power loss (brownout). The lease is only used when WIFI_REUSE_LEASE is set.
+ */
+struct WiFiLinkCache {
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t hasLease;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t checksum;   ///< FNV-1a over the fields above
+};
+
+/**
+ * @enum WiFiLinkState
+ * @brief Station connection state as driven by WiFiLink::update()
+ */
+enum WiFiLinkState {
+    WIFI_LINK_IDLE,
+    WIFI_LINK_JOINING_CACHED,   ///< Targeted join on the cached BSSID/channel (no scan)
+    WIFI_LINK_JOINING_SCAN,     ///< Full scan join
+    WIFI_LINK_CONNECTED,
+    WIFI_LINK_BACKOFF           ///< Both joins failed, waiting to retry
+};
+
+/**
+ * @class WiFiLink
+ * @brief WiFi station management with fast reconnect and in-place recovery
+ *
+ * Joins the cached access point directly (BSSID + channel, optionally with
+ * the previous lease as static configuration) and falls back to a full scan
+ * only when that fails. Disconnects are handled in the loop: the link is
+ * rejoined with exponential backoff instead of restarting the device.
+ *
+ * Key Features:
+ * - Cache in RTC memory (survives resets) and NVS (survives power loss);
+ *   NVS is only written when the BSSID, channel or lease changes
+ * - Association and DHCP durations as histograms, plus connect, disconnect
+ *   and scan-fallback counters in the metrics registry
+ * - Non-blocking: update() only polls WiFi.status(); driver events just
+ *   record timestamps and reasons
+ */
+class WiFiLink {
+public:
+    WiFiLink();
+
+    /**
+     * @brief Load the cache and start the first join
+     */
+    void begin();
+
+    /**
+     * @brief Advance joins, detect disconnects and schedule retries
+     * Called every loop iteration
+     */
+    void update();
+
+    /**
+     * @brief Check whether the station is associated and has an address
+     * @return true in WIFI_LINK_CONNECTED
+     */
+    bool isConnected() const { return _state == WIFI_LINK_CONNECTED; }
+
+    /**
+     * @brief Current state (for logs and diagnostics)
+     * @return WiFiLinkState value
+     */
+    WiFiLinkState state() const { return _state; }
+
+    /**
+     * @brief Link recovery: leave the access point and rejoin it (cached join first)
+     */
+    void reassociate();
+
+    /**
+     * @brief Link recovery: stop and start the WiFi driver, then join with a full scan
+     */
+    void restartDriver();
+
+private:
+    WiFiLinkState _state;
+    WiFiLinkCache _cache;
+    bool _cacheValid;
+    unsigned long _attemptStart;
+    unsigned long _retryAt;
+    uint8_t _failedRounds;   // Consecutive rounds where both joins failed
+
+    // Written by the WiFi event task, read by the loop
+    std::atomic<uint32_t> _associatedAt;
+    std::atomic<uint8_t> _disconnectReason;
+
+    void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+    void join(bool useCache);
+    void handleConnected();
+    void handleJoinFailed();
+    bool loadCache();
+    void storeCache();
+    static uint32_t checksum(const WiFiLinkCache& cache);
+};
+
+extern WiFiLink wifiLink;
+
+#endif
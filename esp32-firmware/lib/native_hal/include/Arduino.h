@@ -0,0 +1,194 @@
+// Native (host) stand-in for the Arduino-ESP32 core.
+// Only the API surface used by the greenhouse firmware is provided.
+#ifndef NATIVE_HAL_ARDUINO_H
+#define NATIVE_HAL_ARDUINO_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+using std::abs;
+using std::isnan;
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define strcpy_P(dst, src) strcpy((dst), (src))
+#define strlen_P(s) strlen(s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_ptr(addr) (*(void* const*)(addr))
+
+// esp_attr.h placement attributes: plain globals on the host, so RTC memory
+// is lost on every process restart (like a power-on reset)
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+// ---------- Timing ----------
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// ---------- GPIO / ADC ----------
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+// ---------- Random ----------
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+/// Hardware RNG on the ESP32 (esp_random.h); the host's random_device here
+uint32_t esp_random();
+
+// ---------- Time (esp32-hal-time) ----------
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+// ---------- String ----------
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+    String(char c) : std::string(1, c) {}
+    String(int v) : std::string(std::to_string(v)) {}
+    String(unsigned int v) : std::string(std::to_string(v)) {}
+    String(long v) : std::string(std::to_string(v)) {}
+    String(unsigned long v) : std::string(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) : std::string(fmt(v, decimals)) {}
+    String(double v, unsigned int decimals = 2) : std::string(fmt(v, decimals)) {}
+
+    unsigned int length() const { return (unsigned int)size(); }
+    bool equals(const String& other) const { return *this == other; }
+    int toInt() const { return atoi(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+
+private:
+    static std::string fmt(double v, unsigned int decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        return buf;
+    }
+};
+
+// ---------- Print / Serial ----------
+class Printable;
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    virtual void flush() {}
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const std::string& s) { return write((const uint8_t*)s.data(), s.size()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t print(const Printable& p);
+    size_t print(const struct tm* timeinfo, const char* format = nullptr);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t println(const char* s) { size_t n = print(s); return n + println(); }
+    size_t println(const struct tm* timeinfo, const char* format = nullptr) {
+        size_t n = print(timeinfo, format);
+        return n + println();
+    }
+};
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+inline size_t Print::print(const Printable& p) { return p.printTo(*this); }
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void flush() override;
+    operator bool() const { return true; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// ---------- IPAddress ----------
+class IPAddress : public Printable {
+public:
+    IPAddress() { _addr = 0; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        _addr = (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+    }
+    IPAddress(uint32_t addr) : _addr(addr) {}
+    operator uint32_t() const { return _addr; }
+    uint8_t operator[](int index) const { return (uint8_t)(_addr >> (index * 8)); }
+    bool operator==(const IPAddress& other) const { return _addr == other._addr; }
+    bool operator!=(const IPAddress& other) const { return _addr != other._addr; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buf);
+    }
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+
+private:
+    uint32_t _addr;
+};
+
+// ---------- ESP ----------
+class EspClass {
+public:
+    void restart();
+    uint32_t getFreeHeap();
+    uint32_t getHeapSize();
+    uint64_t getEfuseMac();
+    const char* getSdkVersion() { return "native"; }
+};
+
+extern EspClass ESP;
+
+#endif // NATIVE_HAL_ARDUINO_H
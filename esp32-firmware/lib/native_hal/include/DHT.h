@@ -0,0 +1,23 @@
+// Native (host) stand-in for the Adafruit DHT library.
+// Readings come from the provider installed with hal::setDhtProvider() (hal_native.h).
+#ifndef NATIVE_HAL_DHT_H
+#define NATIVE_HAL_DHT_H
+
+#include "Arduino.h"
+
+#define DHT11 11
+#define DHT22 22
+
+class DHT {
+public:
+    DHT(uint8_t pin, uint8_t type, uint8_t count = 6) : _pin(pin), _type(type) { (void)count; }
+    void begin(uint8_t usec = 55) { (void)usec; }
+    float readTemperature(bool fahrenheit = false, bool force = false);
+    float readHumidity(bool force = false);
+
+private:
+    uint8_t _pin;
+    uint8_t _type;
+};
+
+#endif // NATIVE_HAL_DHT_H
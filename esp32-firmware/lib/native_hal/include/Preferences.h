@@ -0,0 +1,33 @@
+// Native (host) stand-in for the Arduino-ESP32 Preferences (NVS) API.
+// Entries live in process memory, or in a file when hal::setNvsPath() is set.
+#ifndef NATIVE_HAL_PREFERENCES_H
+#define NATIVE_HAL_PREFERENCES_H
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+    Preferences() : _open(false), _readOnly(false) {}
+    ~Preferences() { end(); }
+
+    bool begin(const char* name, bool readOnly = false, const char* partition_label = nullptr);
+    void end();
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+
+    size_t putUInt(const char* key, uint32_t value);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+
+private:
+    std::string _namespace;
+    bool _open;
+    bool _readOnly;
+};
+
+#endif // NATIVE_HAL_PREFERENCES_H
@@ -0,0 +1,84 @@
+// Native (host) stand-in for links2004/WebSockets' WebSocketsClient.
+// Speaks RFC 6455 over a plain non-blocking TCP socket; beginSSL() connects without TLS.
+// With hal::setWebSocketPeer() installed, frames go to an in-process server instead.
+#ifndef NATIVE_HAL_WEBSOCKETS_CLIENT_H
+#define NATIVE_HAL_WEBSOCKETS_CLIENT_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient {
+public:
+    typedef std::function<void(WStype_t type, uint8_t* payload, size_t length)> WebSocketClientEvent;
+
+    WebSocketsClient();
+    virtual ~WebSocketsClient();
+
+    void begin(const char* host, uint16_t port, const char* url = "/", const char* protocol = "arduino");
+    void beginSSL(const char* host, uint16_t port, const char* url = "/", const char* fingerprint = "",
+                  const char* protocol = "arduino");
+    void onEvent(WebSocketClientEvent cbEvent);
+    void loop();
+    void disconnect();
+    bool isConnected();
+
+    bool sendTXT(const uint8_t* payload, size_t length = 0);
+    bool sendTXT(const char* payload, size_t length = 0);
+    bool sendTXT(char* payload, size_t length = 0) { return sendTXT((const char*)payload, length); }
+    bool sendTXT(const String& payload) { return sendTXT(payload.c_str(), payload.length()); }
+    bool sendBIN(const uint8_t* payload, size_t length);
+    bool sendPing(const uint8_t* payload = nullptr, size_t length = 0);
+
+    void setReconnectInterval(unsigned long time) { _reconnectInterval = time; }
+    void enableHeartbeat(uint32_t pingInterval, uint32_t pongTimeout, uint8_t disconnectTimeoutCount) {
+        (void)pingInterval;
+        (void)pongTimeout;
+        (void)disconnectTimeoutCount;
+    }
+    void disableHeartbeat() {}
+
+private:
+    enum State { WS_IDLE, WS_CONNECTING, WS_HANDSHAKE, WS_CONNECTED };
+
+    std::string _host;
+    uint16_t _port;
+    std::string _url;
+    int _fd;
+    State _state;
+    bool _configured;
+    bool _connectNow;
+    unsigned long _reconnectInterval;
+    unsigned long _lastAttempt;
+    std::string _rx;
+    std::string _key;
+    WebSocketClientEvent _cbEvent;
+
+    void loopPeer();
+    bool attemptDue();
+    void startConnect();
+    void sendHandshake();
+    void processHandshake();
+    void processFrames();
+    bool readAvailable();
+    bool sendFrame(uint8_t opcode, const uint8_t* payload, size_t length);
+    void closeSocket(bool notify);
+    void emit(WStype_t type, uint8_t* payload, size_t length);
+};
+
+#endif // NATIVE_HAL_WEBSOCKETS_CLIENT_H
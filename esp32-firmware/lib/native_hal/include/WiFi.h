@@ -0,0 +1,129 @@
+// Native (host) stand-in for the Arduino-ESP32 WiFi station API.
+// The host network is always "associated"; association can be delayed or dropped via hal_native.h.
+#ifndef NATIVE_HAL_WIFI_H
+#define NATIVE_HAL_WIFI_H
+
+#include "Arduino.h"
+
+#include <functional>
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+// Station events delivered through WiFi.onEvent() (subset of arduino_event_id_t)
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_STOP = 3,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+    ARDUINO_EVENT_MAX = 40
+} arduino_event_id_t;
+
+// Disconnect reasons (wifi_err_reason_t) produced by the stand-in
+#define WIFI_REASON_ASSOC_LEAVE     8
+#define WIFI_REASON_BEACON_TIMEOUT  200
+#define WIFI_REASON_NO_AP_FOUND     201
+
+typedef union {
+    struct {
+        uint8_t ssid[33];
+        uint8_t ssid_len;
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint8_t authmode;
+        uint16_t aid;
+    } wifi_sta_connected;
+    struct {
+        uint8_t ssid[33];
+        uint8_t ssid_len;
+        uint8_t bssid[6];
+        uint8_t reason;
+    } wifi_sta_disconnected;
+    struct {
+        int if_index;
+        struct {
+            struct { uint32_t addr; } ip, netmask, gw;
+        } ip_info;
+        bool ip_changed;
+    } got_ip;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m);
+    wifi_mode_t getMode();
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = (uint32_t)0x00000000, IPAddress dns2 = (uint32_t)0x00000000);
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+    bool reconnect();
+    bool setAutoReconnect(bool autoReconnect);
+    bool getAutoReconnect();
+    void persistent(bool persistent) { (void)persistent; }
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    wifi_event_id_t onEvent(WiFiEventFuncCb cbEvent, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t dns_no = 0);
+    uint8_t* BSSID();
+    int32_t channel();
+    int8_t RSSI();
+    String macAddress();
+    uint8_t* macAddress(uint8_t* mac);
+};
+
+extern WiFiClass WiFi;
+
+// Minimal non-blocking TCP client/server over POSIX sockets (accepted connections only).
+class WiFiClient : public Print {
+public:
+    WiFiClient() : _fd(-1) {}
+    explicit WiFiClient(int fd) : _fd(fd) {}
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available();
+    int read();
+    bool connected();
+    void stop();
+    explicit operator bool() const { return _fd >= 0; }
+
+private:
+    int _fd;
+};
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port) : _port(port), _fd(-1) {}
+    void begin();
+    WiFiClient available();
+    WiFiClient accept() { return available(); }
+
+private:
+    uint16_t _port;
+    int _fd;
+};
+
+#endif // NATIVE_HAL_WIFI_H
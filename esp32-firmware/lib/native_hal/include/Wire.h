@@ -0,0 +1,39 @@
+// Native (host) stand-in for the Arduino-ESP32 Wire library.
+// The bus is simulated: only chips attached with hal::attachI2cDevice() (hal_native.h) answer.
+#ifndef NATIVE_HAL_WIRE_H
+#define NATIVE_HAL_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    TwoWire() : _address(0), _txLength(0), _rxLength(0), _rxIndex(0), _transmitting(false) {}
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency) { (void)frequency; }
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t length);
+    /// 0 = ACK, 2 = address NACK (nothing at that address), 4 = not transmitting
+    uint8_t endTransmission(bool sendStop = true);
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    int available() { return _rxLength - _rxIndex; }
+    int read() { return _rxIndex < _rxLength ? _rxBuffer[_rxIndex++] : -1; }
+
+    static const size_t BUFFER_LENGTH = 128;
+
+private:
+    uint8_t _address;
+    uint8_t _txBuffer[BUFFER_LENGTH];
+    size_t _txLength;
+    uint8_t _rxBuffer[BUFFER_LENGTH];
+    int _rxLength;
+    int _rxIndex;
+    bool _transmitting;
+};
+
+extern TwoWire Wire;
+
+#endif // NATIVE_HAL_WIRE_H
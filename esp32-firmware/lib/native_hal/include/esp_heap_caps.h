@@ -0,0 +1,34 @@
+// Native (host) stand-in for the ESP-IDF heap capabilities API.
+// Figures come from the HAL's global operator new/delete accounting.
+#ifndef NATIVE_HAL_ESP_HEAP_CAPS_H
+#define NATIVE_HAL_ESP_HEAP_CAPS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Size of the emulated internal heap (roughly what an ESP32 has free after WiFi starts)
+#ifndef NATIVE_HEAP_SIZE
+#define NATIVE_HEAP_SIZE (200 * 1024)
+#endif
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_32BIT (1 << 1)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+typedef struct {
+    size_t total_free_bytes;
+    size_t total_allocated_bytes;
+    size_t largest_free_block;
+    size_t minimum_free_bytes;
+    size_t allocated_blocks;
+    size_t free_blocks;
+    size_t total_blocks;
+} multi_heap_info_t;
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);
+
+#endif // NATIVE_HAL_ESP_HEAP_CAPS_H
@@ -0,0 +1,28 @@
+// Native (host) stand-in for the ESP-IDF OTA API over two in-memory app slots
+// (app0/app1 from partitions.csv). The running image and the one selected for
+// the next boot are exposed through hal::setRunningImage() / hal::bootImage().
+#ifndef NATIVE_HAL_ESP_OTA_OPS_H
+#define NATIVE_HAL_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN            0xffffffff
+#define OTA_WITH_SEQUENTIAL_WRITES  0xfffffffe
+#define ESP_IMAGE_HEADER_MAGIC      0xE9
+
+const esp_partition_t* esp_ota_get_running_partition();
+const esp_partition_t* esp_ota_get_boot_partition();
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from);
+
+/// Erases the slot; only one update can be open at a time
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+/// Fails with ESP_ERR_OTA_VALIDATE_FAILED unless the image starts with the ESP image magic
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
+esp_err_t esp_ota_mark_app_valid_cancel_rollback();
+
+#endif // NATIVE_HAL_ESP_OTA_OPS_H
@@ -0,0 +1,46 @@
+// Native (host) stand-in for the ESP-IDF partition API: the two OTA app slots and
+// the spiffs data partition from partitions.csv.
+#ifndef NATIVE_HAL_ESP_PARTITION_H
+#define NATIVE_HAL_ESP_PARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE  4096    // Erase unit
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_APP_OTA_0 = 0x10,
+    ESP_PARTITION_SUBTYPE_APP_OTA_1 = 0x11,
+    ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+    ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+/// Only the spiffs data partition can be found (label nullptr or "spiffs")
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label);
+
+/// Reads past the image written to a slot return 0xFF (erased flash)
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size);
+
+/// Data partition only. Like NOR flash, a write can only clear bits (the result is old AND new)
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size);
+
+/// Data partition only; offset and size must be multiples of SPI_FLASH_SEC_SIZE
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+
+#endif // NATIVE_HAL_ESP_PARTITION_H
@@ -0,0 +1,19 @@
+// Native (host) stand-in for the ESP32 ROM CRC routines.
+#ifndef NATIVE_HAL_ESP_ROM_CRC_H
+#define NATIVE_HAL_ESP_ROM_CRC_H
+
+#include <cstdint>
+
+/// CRC-32 (IEEE 802.3, reflected) like the ROM: pass 0, or the previous result to continue
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+#endif // NATIVE_HAL_ESP_ROM_CRC_H
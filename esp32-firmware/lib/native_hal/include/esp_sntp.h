@@ -0,0 +1,27 @@
+// Native (host) stand-in for the ESP-IDF SNTP client API.
+// configTime() starts it; syncs complete while WiFi is connected, see hal::setWallClock().
+#ifndef NATIVE_HAL_ESP_SNTP_H
+#define NATIVE_HAL_ESP_SNTP_H
+
+#include <cstdint>
+#include <sys/time.h>
+
+typedef enum {
+    SNTP_SYNC_STATUS_RESET,
+    SNTP_SYNC_STATUS_COMPLETED,
+    SNTP_SYNC_STATUS_IN_PROGRESS
+} sntp_sync_status_t;
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+void sntp_set_sync_interval(uint32_t interval_ms);
+uint32_t sntp_get_sync_interval();
+bool sntp_restart();
+bool sntp_enabled();
+
+/// COMPLETED once after each sync (then RESET again), like ESP-IDF.
+/// Also where the native client performs a sync that is due.
+sntp_sync_status_t sntp_get_sync_status();
+
+#endif // NATIVE_HAL_ESP_SNTP_H
@@ -0,0 +1,13 @@
+// Native (host) stand-in for the task watchdog: every call succeeds and does nothing.
+#ifndef NATIVE_HAL_ESP_TASK_WDT_H
+#define NATIVE_HAL_ESP_TASK_WDT_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+inline esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) { (void)timeout; (void)panic; return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif // NATIVE_HAL_ESP_TASK_WDT_H
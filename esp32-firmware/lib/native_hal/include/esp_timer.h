@@ -0,0 +1,12 @@
+// Native (host) stand-in for the ESP-IDF high-resolution timer: the HAL clock
+// (host or virtual), 64-bit microseconds, never wraps.
+#ifndef NATIVE_HAL_ESP_TIMER_H
+#define NATIVE_HAL_ESP_TIMER_H
+
+#include <cstdint>
+
+#include "hal_native.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)hal::clockUs(); }
+
+#endif // NATIVE_HAL_ESP_TIMER_H
@@ -0,0 +1,38 @@
+// Native (host) stand-in for the FreeRTOS kernel types used by the firmware.
+#ifndef NATIVE_HAL_FREERTOS_H
+#define NATIVE_HAL_FREERTOS_H
+
+#include <cstdint>
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define configMAX_PRIORITIES 25
+
+// All critical sections share one recursive host mutex; contention is not a concern here
+struct portMUX_TYPE {
+    int unused;
+};
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void nativeEnterCritical(portMUX_TYPE* mux);
+void nativeExitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux) nativeEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) nativeExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) nativeEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) nativeExitCritical(mux)
+
+#endif // NATIVE_HAL_FREERTOS_H
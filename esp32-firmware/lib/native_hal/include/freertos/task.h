@@ -0,0 +1,20 @@
+// Native (host) stand-in for the FreeRTOS task API (tasks run as host threads).
+#ifndef NATIVE_HAL_FREERTOS_TASK_H
+#define NATIVE_HAL_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+char* pcTaskGetName(TaskHandle_t task);
+
+#endif // NATIVE_HAL_FREERTOS_TASK_H
@@ -0,0 +1,196 @@
+// Control surface of the native HAL: lets host tools inspect pins and inject sensor values.
+#ifndef NATIVE_HAL_CONTROL_H
+#define NATIVE_HAL_CONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+/// Level last written to a GPIO with digitalWrite()
+int pinLevel(uint8_t pin);
+
+/// Value returned by analogRead() for a pin
+void setAnalog(uint8_t pin, uint16_t value);
+
+/// Source of DHT readings; defaults to a constant 22.0 °C / 55 %
+void setDhtProvider(std::function<float()> temperature, std::function<float()> humidity);
+
+/// Called by ESP.restart(); the default prints a message and exits the process
+void setRestartHandler(std::function<void()> handler);
+
+/// Number of calls to ESP.restart() so far
+uint32_t restartCount();
+
+/// Simulate WiFi association state
+void setWifiConnected(bool connected);
+
+/// Ask a callback for the association state on every WiFi.status() (overrides setWifiConnected)
+void setWifiLinkProvider(std::function<bool()> linkUp);
+
+/// Model association timing (all 0 by default: instant). A join without a
+/// BSSID/channel scans first; a join with them probes one channel only.
+/// DHCP is skipped when WiFi.config() set a static address.
+void setWifiTiming(uint32_t scanMs, uint32_t associateMs, uint32_t dhcpMs);
+
+/// BSSID and channel of the simulated access point (targeted joins must match)
+void setWifiAccessPoint(const uint8_t bssid[6], int32_t channel);
+
+/// Persist Preferences (NVS) entries to a file so they survive a process restart;
+/// nullptr keeps them in memory only (the default)
+void setNvsPath(const char* path);
+
+/// Contents of the running app slot (what esp_partition_read() returns for it)
+void setRunningImage(const uint8_t* data, size_t size);
+
+/// Image in the slot selected by esp_ota_set_boot_partition() (the running one until then)
+const std::vector<uint8_t>& bootImage();
+
+/// Back the spiffs data partition with a file, mapped so writes survive a process
+/// restart; nullptr keeps it in memory, erased at start (the default)
+void setFlashPath(const char* path);
+
+/// Data partition traffic since start (this process)
+struct FlashStats {
+    uint64_t bytesWritten;
+    uint64_t sectorErases;
+    uint32_t maxSectorErases;   ///< Erases of the most-worn sector
+    uint64_t lostBits;          ///< 0 -> 1 changes writes asked for: real flash cannot make them
+};
+FlashStats flashStats();
+
+/// Model the true (UTC) clock SNTP syncs against: epochUs is the true time at the
+/// current clock reading, driftPpm how much faster true time runs than the local
+/// clock, syncDelayMs the time from configTime()/sntp_restart() to the first sync.
+/// Default: the host wall clock, no drift, immediate sync.
+void setWallClock(uint64_t epochUs, int32_t driftPpm, uint32_t syncDelayMs);
+
+/// Switch millis()/micros()/delay() from the host clock to a virtual clock.
+/// Virtual time only moves in delay()/delayMicroseconds() and advanceClock(),
+/// so it must be driven from a single thread (build with LOG_DRAIN_TASK=0).
+void useVirtualClock(uint64_t startUs);
+
+/// Move the virtual clock forward (no-op on the host clock)
+void advanceClock(uint64_t us);
+
+/// Current clock in microseconds, 64-bit (never wraps)
+uint64_t clockUs();
+
+/**
+ * In-process server for WebSocketsClient. When installed, the client never
+ * opens a socket: connection attempts, text and binary frames and disconnects are
+ * routed through this interface instead (see setWebSocketPeer()).
+ */
+class WebSocketPeer {
+public:
+    virtual ~WebSocketPeer() {}
+    /// Connection attempt; return false to refuse it (treated like a failed TCP connect)
+    virtual bool open(const char* host, uint16_t port, const char* url) = 0;
+    /// Text frame sent by the client; return false to drop the connection
+    virtual bool receive(const char* payload, size_t length) = 0;
+    /// Binary frame sent by the client (a Socket.IO attachment); ignored unless overridden
+    virtual bool receiveBinary(const uint8_t* payload, size_t length) {
+        (void)payload;
+        (void)length;
+        return true;
+    }
+    /// Next text frame due for the client; return false when there is none
+    virtual bool poll(std::string& payload) = 0;
+    /// false once the server or the network has dropped the connection
+    virtual bool isOpen() = 0;
+    /// The client closed the connection
+    virtual void close() = 0;
+};
+
+/// Route every WebSocketsClient through an in-process peer (nullptr restores real sockets)
+void setWebSocketPeer(WebSocketPeer* peer);
+
+/**
+ * Told about every TCP socket a WebSocketsClient opens or closes, so a host
+ * event loop can wait on all clients at once (epoll) and call loop() only for
+ * the ones with work. Calls happen inside the client's loop().
+ */
+class SocketWatcher {
+public:
+    virtual ~SocketWatcher() {}
+    virtual void socketOpened(int fd) = 0;
+    virtual void socketClosed(int fd) = 0;
+};
+
+/// Install a socket watcher (nullptr removes it)
+void setSocketWatcher(SocketWatcher* watcher);
+
+/// Chips that can sit on the simulated I2C bus behind Wire
+enum I2cDeviceType {
+    I2C_MCP23017,  ///< 16-bit expander, IODIR/OLAT registers (IOCON.BANK = 0)
+    I2C_PCF8575    ///< 16-bit quasi-bidirectional expander, no registers
+};
+
+/// Put a chip on the bus at a 7-bit address, in its power-on state (nothing else answers)
+void attachI2cDevice(uint8_t address, I2cDeviceType type);
+
+/// Brown-out of one chip: registers back to their power-on values
+void resetI2cDevice(uint8_t address);
+
+/// A chip that stops responding NACKs its address (loose cable, hung bus) until restored
+void setI2cDeviceResponding(uint8_t address, bool responding);
+
+/// Pin levels a chip presents, bit n = pin n (port B / P1x in the high byte).
+/// MCP23017 pins still configured as inputs read high, as behind relay board pull-ups.
+uint16_t i2cPinLevels(uint8_t address);
+
+/// Bus traffic since start
+struct I2cStats {
+    uint64_t transactions;  ///< Writes and reads, acknowledged or not
+    uint64_t bytesWritten;  ///< Payload bytes of acknowledged writes
+    uint64_t nacks;         ///< Transactions nobody acknowledged
+};
+I2cStats i2cStats();
+
+/// Heap accounting from the global operator new/delete replacement
+struct HeapStats {
+    uint64_t allocations;     ///< Total allocations since start
+    uint64_t frees;           ///< Total frees since start
+    uint64_t bytesAllocated;  ///< Total bytes handed out since start (usable size)
+    size_t bytesInUse;        ///< Live bytes
+    size_t peakBytesInUse;    ///< High-water mark of live bytes
+};
+HeapStats heapStats();
+
+/// The calling thread's allocations outside any HostHeapScope: what the firmware
+/// itself asks the heap for, as a device build would count it
+struct FirmwareHeapStats {
+    uint64_t allocations;     ///< Allocations since the thread started
+    uint64_t bytesAllocated;  ///< Bytes handed out for them (usable size)
+};
+FirmwareHeapStats firmwareHeapStats();
+
+/// Marks heap use that only exists on the host (std::string buffers of the
+/// transport stand-in and the like) so firmwareHeapStats() leaves it out
+class HostHeapScope {
+public:
+    HostHeapScope();
+    ~HostHeapScope();
+    HostHeapScope(const HostHeapScope&) = delete;
+    HostHeapScope& operator=(const HostHeapScope&) = delete;
+};
+
+/// Inside a HostHeapScope, counts firmware allocations again: wraps callbacks
+/// from a stand-in into firmware code
+class FirmwareHeapScope {
+public:
+    FirmwareHeapScope();
+    ~FirmwareHeapScope();
+    FirmwareHeapScope(const FirmwareHeapScope&) = delete;
+    FirmwareHeapScope& operator=(const FirmwareHeapScope&) = delete;
+
+private:
+    uint32_t _hostDepth;
+};
+
+}  // namespace hal
+
+#endif // NATIVE_HAL_CONTROL_H
@@ -0,0 +1,37 @@
+// Native (host) stand-in for the ESP-IDF lwIP asynchronous resolver: dns_gethostbyname().
+// Numeric names answer at once; anything else is looked up on a detached host thread and
+// the callback runs there, as lwIP runs it on the tcpip task.
+#ifndef NATIVE_HAL_LWIP_DNS_H
+#define NATIVE_HAL_LWIP_DNS_H
+
+#include <cstdint>
+
+typedef int8_t err_t;
+#define ERR_OK          0
+#define ERR_INPROGRESS  -5
+#define ERR_ARG         -16
+
+typedef struct ip4_addr {
+    uint32_t addr;  ///< Network order
+} ip4_addr_t;
+
+#define IPADDR_TYPE_V4  0U
+#define IPADDR_TYPE_V6  6U
+
+typedef struct ip_addr {
+    union {
+        ip4_addr_t ip4;
+    } u_addr;
+    uint8_t type;
+} ip_addr_t;
+
+#define IP_IS_V4(ipaddr)  ((ipaddr)->type == IPADDR_TYPE_V4)
+#define ip_2_ip4(ipaddr)  (&((ipaddr)->u_addr.ip4))
+
+/// ipaddr is nullptr when the name could not be resolved
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+/// ERR_OK with addr filled in, ERR_INPROGRESS (found is called later) or ERR_ARG
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
+
+#endif // NATIVE_HAL_LWIP_DNS_H
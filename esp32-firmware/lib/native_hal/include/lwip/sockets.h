@@ -0,0 +1,13 @@
+// Native (host) stand-in for the ESP-IDF lwIP socket API: lwIP implements the
+// BSD calls (socket, connect, select, getsockopt, fcntl), so the host's own headers stand in.
+#ifndef NATIVE_HAL_LWIP_SOCKETS_H
+#define NATIVE_HAL_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif // NATIVE_HAL_LWIP_SOCKETS_H
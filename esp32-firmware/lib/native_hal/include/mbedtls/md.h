@@ -0,0 +1,36 @@
+// Native (host) stand-in for mbedtls message digests, backed by OpenSSL libcrypto.
+// SHA-256 digests and one-shot HMAC-SHA256, which is all the firmware uses.
+#ifndef NATIVE_HAL_MBEDTLS_MD_H
+#define NATIVE_HAL_MBEDTLS_MD_H
+
+#include <cstddef>
+
+#define MBEDTLS_ERR_MD_BAD_INPUT_DATA   -0x5100
+#define MBEDTLS_ERR_MD_ALLOC_FAILED     -0x5180
+
+typedef enum {
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 6
+} mbedtls_md_type_t;
+
+typedef struct mbedtls_md_info_t mbedtls_md_info_t;
+
+typedef struct {
+    const mbedtls_md_info_t* md_info;
+    void* md_ctx;       // EVP_MD_CTX
+} mbedtls_md_context_t;
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type);
+unsigned char mbedtls_md_get_size(const mbedtls_md_info_t* md_info);
+
+void mbedtls_md_init(mbedtls_md_context_t* ctx);
+void mbedtls_md_free(mbedtls_md_context_t* ctx);
+int mbedtls_md_setup(mbedtls_md_context_t* ctx, const mbedtls_md_info_t* md_info, int hmac);
+int mbedtls_md_starts(mbedtls_md_context_t* ctx);
+int mbedtls_md_update(mbedtls_md_context_t* ctx, const unsigned char* input, size_t ilen);
+int mbedtls_md_finish(mbedtls_md_context_t* ctx, unsigned char* output);
+int mbedtls_md(const mbedtls_md_info_t* md_info, const unsigned char* input, size_t ilen, unsigned char* output);
+int mbedtls_md_hmac(const mbedtls_md_info_t* md_info, const unsigned char* key, size_t keylen,
+                    const unsigned char* input, size_t ilen, unsigned char* output);
+
+#endif // NATIVE_HAL_MBEDTLS_MD_H
@@ -0,0 +1,213 @@
+// Native implementation of the Arduino core subset: clock (host or virtual), GPIO, ADC, Serial, ESP.
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <hal_native.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+const auto kStart = std::chrono::steady_clock::now();
+
+std::mutex gPinMutex;
+std::map<uint8_t, int> gPinLevels;
+std::map<uint8_t, uint16_t> gAnalogValues;
+
+std::mt19937 gRandom(12345);
+
+std::function<void()> gRestartHandler;
+uint32_t gRestartCount = 0;
+
+std::atomic<bool> gVirtualClock(false);
+std::atomic<uint64_t> gVirtualUs(0);
+
+}  // namespace
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(hal::clockUs() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)hal::clockUs();
+}
+
+void delay(uint32_t ms) {
+    if (gVirtualClock) {
+        gVirtualUs += (uint64_t)ms * 1000;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (gVirtualClock) {
+        gVirtualUs += us;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    if (!gVirtualClock) {
+        std::this_thread::yield();
+    }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    gPinLevels[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    auto it = gPinLevels.find(pin);
+    return it == gPinLevels.end() ? LOW : it->second;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    auto it = gAnalogValues.find(pin);
+    // Floating ADC input reads close to full scale on the ESP32
+    return it == gAnalogValues.end() ? 4095 : it->second;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) {
+        return 0;
+    }
+    return (long)(gRandom() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) {
+        return howsmall;
+    }
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    gRandom.seed((uint32_t)seed);
+}
+
+uint32_t esp_random() {
+    static std::random_device device;
+    return device();
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    (void)ms;
+    time_t now = time(nullptr);
+    localtime_r(&now, info);
+    return true;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+        return 0;
+    }
+    return write((const uint8_t*)buf, std::min((size_t)len, sizeof(buf) - 1));
+}
+
+size_t Print::print(const struct tm* timeinfo, const char* format) {
+    char buf[64];
+    size_t len = strftime(buf, sizeof(buf), format ? format : "%c", timeinfo);
+    return write((const uint8_t*)buf, len);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    size_t n = fwrite(buffer, 1, size, stdout);
+    fflush(stdout);
+    return n;
+}
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+void EspClass::restart() {
+    gRestartCount++;
+    if (gRestartHandler) {
+        gRestartHandler();
+        return;
+    }
+    fprintf(stderr, "[native] ESP.restart() called - exiting\n");
+    fflush(stdout);
+    exit(3);
+}
+
+uint32_t EspClass::getFreeHeap() {
+    hal::HeapStats stats = hal::heapStats();
+    return NATIVE_HEAP_SIZE > stats.bytesInUse ? (uint32_t)(NATIVE_HEAP_SIZE - stats.bytesInUse) : 0;
+}
+
+uint32_t EspClass::getHeapSize() {
+    return NATIVE_HEAP_SIZE;
+}
+
+uint64_t EspClass::getEfuseMac() {
+    // Locally administered address, stored little-endian like the eFuse value
+    return 0x0000563412EFCDABULL;
+}
+
+namespace hal {
+
+void useVirtualClock(uint64_t startUs) {
+    gVirtualUs = startUs;
+    gVirtualClock = true;
+}
+
+void advanceClock(uint64_t us) {
+    if (gVirtualClock) {
+        gVirtualUs += us;
+    }
+}
+
+uint64_t clockUs() {
+    if (gVirtualClock) {
+        return gVirtualUs;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - kStart;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+int pinLevel(uint8_t pin) {
+    return digitalRead(pin);
+}
+
+void setAnalog(uint8_t pin, uint16_t value) {
+    std::lock_guard<std::mutex> lock(gPinMutex);
+    gAnalogValues[pin] = value;
+}
+
+void setRestartHandler(std::function<void()> handler) {
+    gRestartHandler = handler;
+}
+
+uint32_t restartCount() {
+    return gRestartCount;
+}
+
+}  // namespace hal
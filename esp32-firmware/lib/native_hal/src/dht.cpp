@@ -0,0 +1,31 @@
+// Native DHT stand-in backed by a replaceable value provider.
+
+#include <DHT.h>
+#include <hal_native.h>
+
+namespace {
+
+std::function<float()> gTemperature = []() { return 22.0f; };
+std::function<float()> gHumidity = []() { return 55.0f; };
+
+}  // namespace
+
+float DHT::readTemperature(bool fahrenheit, bool force) {
+    (void)force;
+    float celsius = gTemperature();
+    return fahrenheit ? celsius * 1.8f + 32.0f : celsius;
+}
+
+float DHT::readHumidity(bool force) {
+    (void)force;
+    return gHumidity();
+}
+
+namespace hal {
+
+void setDhtProvider(std::function<float()> temperature, std::function<float()> humidity) {
+    gTemperature = temperature;
+    gHumidity = humidity;
+}
+
+}  // namespace hal
@@ -0,0 +1,41 @@
+// Native lwIP resolver: the host's blocking getaddrinfo() on a detached thread per lookup.
+
+#include <lwip/dns.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+    if (!hostname || !*hostname || !addr || !found) {
+        return ERR_ARG;
+    }
+    struct in_addr numeric;
+    if (inet_aton(hostname, &numeric)) {
+        addr->u_addr.ip4.addr = numeric.s_addr;
+        addr->type = IPADDR_TYPE_V4;
+        return ERR_OK;
+    }
+    std::string name(hostname);
+    std::thread([name, found, callback_arg]() {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* result = nullptr;
+        if (getaddrinfo(name.c_str(), nullptr, &hints, &result) != 0 || !result) {
+            found(name.c_str(), nullptr, callback_arg);
+            return;
+        }
+        ip_addr_t resolved;
+        resolved.u_addr.ip4.addr = ((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+        resolved.type = IPADDR_TYPE_V4;
+        freeaddrinfo(result);
+        found(name.c_str(), &resolved, callback_arg);
+    }).detach();
+    return ERR_INPROGRESS;
+}
@@ -0,0 +1,125 @@
+// Native FreeRTOS stand-in: tasks are detached host threads, critical sections share one mutex.
+
+#include <Arduino.h>
+#include <freertos/semphr.h>
+
+#include <mutex>
+#include <thread>
+
+namespace {
+
+std::recursive_mutex gCriticalMutex;
+
+struct NativeTask {
+    TaskFunction_t fn;
+    void* param;
+    char name[16];
+    uint32_t stackDepth;
+};
+
+NativeTask gLoopTask = {nullptr, nullptr, "loopTask", 8192};
+thread_local NativeTask* tCurrentTask = nullptr;
+
+}  // namespace
+
+void nativeEnterCritical(portMUX_TYPE* mux) {
+    (void)mux;
+    gCriticalMutex.lock();
+}
+
+void nativeExitCritical(portMUX_TYPE* mux) {
+    (void)mux;
+    gCriticalMutex.unlock();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t coreId) {
+    (void)priority;
+    (void)coreId;
+    NativeTask* handle = new NativeTask{task, param, {0}, stackDepth};
+    strncpy(handle->name, name ? name : "task", sizeof(handle->name) - 1);
+    if (created) {
+        *created = handle;
+    }
+    std::thread([handle]() {
+        tCurrentTask = handle;
+        handle->fn(handle->param);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(task, name, stackDepth, param, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    TickType_t wake = *previousWakeTime + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(wake - now) > 0) {
+        delay(wake - now);
+    }
+    *previousWakeTime = wake;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return tCurrentTask ? tCurrentTask : &gLoopTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    // Host threads have no measurable FreeRTOS stack; report the configured depth
+    NativeTask* native = static_cast<NativeTask*>(task ? task : xTaskGetCurrentTaskHandle());
+    return native->stackDepth;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    NativeTask* native = static_cast<NativeTask*>(task ? task : xTaskGetCurrentTaskHandle());
+    return native->name;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new std::recursive_timed_mutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return new std::recursive_timed_mutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    auto* mutex = static_cast<std::recursive_timed_mutex*>(sem);
+    if (ticks == portMAX_DELAY) {
+        mutex->lock();
+        return pdTRUE;
+    }
+    return mutex->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    static_cast<std::recursive_timed_mutex*>(sem)->unlock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks) {
+    return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete static_cast<std::recursive_timed_mutex*>(sem);
+}
@@ -0,0 +1,125 @@
+// Global operator new/delete replacement that feeds the heap_caps_* stand-ins.
+
+#include <esp_heap_caps.h>
+#include <hal_native.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> gAllocations(0);
+std::atomic<uint64_t> gFrees(0);
+std::atomic<uint64_t> gBytesAllocated(0);
+std::atomic<size_t> gBytesInUse(0);
+std::atomic<size_t> gPeakBytes(0);
+
+// Per thread, like the device counter that only follows the loop task
+thread_local uint32_t tHostDepth = 0;
+thread_local uint64_t tFirmwareAllocations = 0;
+thread_local uint64_t tFirmwareBytes = 0;
+
+void* trackedAlloc(size_t size) {
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    size_t usable = malloc_usable_size(ptr);
+    gAllocations++;
+    gBytesAllocated += usable;
+    if (tHostDepth == 0) {
+        tFirmwareAllocations++;
+        tFirmwareBytes += usable;
+    }
+    size_t inUse = gBytesInUse.fetch_add(usable) + usable;
+    size_t peak = gPeakBytes.load();
+    while (inUse > peak && !gPeakBytes.compare_exchange_weak(peak, inUse)) {
+    }
+    return ptr;
+}
+
+void trackedFree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    gFrees++;
+    gBytesInUse.fetch_sub(malloc_usable_size(ptr));
+    free(ptr);
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return trackedAlloc(size); }
+void* operator new[](size_t size) { return trackedAlloc(size); }
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+
+namespace hal {
+
+HeapStats heapStats() {
+    HeapStats stats;
+    stats.allocations = gAllocations.load();
+    stats.frees = gFrees.load();
+    stats.bytesAllocated = gBytesAllocated.load();
+    stats.bytesInUse = gBytesInUse.load();
+    stats.peakBytesInUse = gPeakBytes.load();
+    return stats;
+}
+
+FirmwareHeapStats firmwareHeapStats() {
+    FirmwareHeapStats stats;
+    stats.allocations = tFirmwareAllocations;
+    stats.bytesAllocated = tFirmwareBytes;
+    return stats;
+}
+
+HostHeapScope::HostHeapScope() {
+    tHostDepth++;
+}
+
+HostHeapScope::~HostHeapScope() {
+    tHostDepth--;
+}
+
+FirmwareHeapScope::FirmwareHeapScope() : _hostDepth(tHostDepth) {
+    tHostDepth = 0;
+}
+
+FirmwareHeapScope::~FirmwareHeapScope() {
+    tHostDepth = _hostDepth;
+}
+
+}  // namespace hal
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    size_t used = gBytesInUse.load();
+    return NATIVE_HEAP_SIZE > used ? NATIVE_HEAP_SIZE - used : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    // The host heap does not fragment in a way that maps onto the ESP32 allocator
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    (void)caps;
+    size_t peak = gPeakBytes.load();
+    return NATIVE_HEAP_SIZE > peak ? NATIVE_HEAP_SIZE - peak : 0;
+}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+    uint64_t allocations = gAllocations.load();
+    uint64_t frees = gFrees.load();
+    info->total_free_bytes = heap_caps_get_free_size(caps);
+    info->total_allocated_bytes = gBytesInUse.load();
+    info->largest_free_block = info->total_free_bytes;
+    info->minimum_free_bytes = heap_caps_get_minimum_free_size(caps);
+    info->allocated_blocks = (size_t)(allocations - frees);
+    info->free_blocks = 1;
+    info->total_blocks = info->allocated_blocks + 1;
+}
@@ -0,0 +1,15 @@
+// Entry point for native firmware builds: runs the Arduino setup()/loop() contract.
+// Host tools that need their own entry point simply define a strong main().
+
+#include <Arduino.h>
+
+void setup();
+void loop();
+
+__attribute__((weak)) int main() {
+    setup();
+    for (;;) {
+        loop();
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Native mbedtls subset (SHA-256 digests and HMAC, PEM public keys, signature checks) over
+// OpenSSL libcrypto, so the firmware's verification code runs unchanged on the host.
+
+#include <mbedtls/md.h>
+#include <mbedtls/pk.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+
+struct mbedtls_md_info_t {
+    mbedtls_md_type_t type;
+    unsigned char size;
+};
+
+namespace {
+
+const mbedtls_md_info_t gSha256Info = {MBEDTLS_MD_SHA256, 32};
+
+}  // namespace
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+    return md_type == MBEDTLS_MD_SHA256 ? &gSha256Info : nullptr;
+}
+
+unsigned char mbedtls_md_get_size(const mbedtls_md_info_t* md_info) {
+    return md_info ? md_info->size : 0;
+}
+
+void mbedtls_md_init(mbedtls_md_context_t* ctx) {
+    ctx->md_info = nullptr;
+    ctx->md_ctx = nullptr;
+}
+
+void mbedtls_md_free(mbedtls_md_context_t* ctx) {
+    if (ctx->md_ctx) {
+        EVP_MD_CTX_free((EVP_MD_CTX*)ctx->md_ctx);
+    }
+    mbedtls_md_init(ctx);
+}
+
+int mbedtls_md_setup(mbedtls_md_context_t* ctx, const mbedtls_md_info_t* md_info, int hmac) {
+    if (!md_info || hmac) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    ctx->md_ctx = EVP_MD_CTX_new();
+    if (!ctx->md_ctx) {
+        return MBEDTLS_ERR_MD_ALLOC_FAILED;
+    }
+    ctx->md_info = md_info;
+    return 0;
+}
+
+int mbedtls_md_starts(mbedtls_md_context_t* ctx) {
+    if (!ctx->md_ctx || EVP_DigestInit_ex((EVP_MD_CTX*)ctx->md_ctx, EVP_sha256(), nullptr) != 1) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    return 0;
+}
+
+int mbedtls_md_update(mbedtls_md_context_t* ctx, const unsigned char* input, size_t ilen) {
+    if (!ctx->md_ctx || EVP_DigestUpdate((EVP_MD_CTX*)ctx->md_ctx, input, ilen) != 1) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    return 0;
+}
+
+int mbedtls_md_finish(mbedtls_md_context_t* ctx, unsigned char* output) {
+    if (!ctx->md_ctx || EVP_DigestFinal_ex((EVP_MD_CTX*)ctx->md_ctx, output, nullptr) != 1) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    return 0;
+}
+
+int mbedtls_md(const mbedtls_md_info_t* md_info, const unsigned char* input, size_t ilen, unsigned char* output) {
+    if (!md_info || EVP_Digest(input, ilen, output, nullptr, EVP_sha256(), nullptr) != 1) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    return 0;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* md_info, const unsigned char* key, size_t keylen,
+                    const unsigned char* input, size_t ilen, unsigned char* output) {
+    if (!md_info || !HMAC(EVP_sha256(), key, (int)keylen, input, ilen, output, nullptr)) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    return 0;
+}
+
+void mbedtls_pk_init(mbedtls_pk_context* ctx) {
+    ctx->pk_ctx = nullptr;
+}
+
+void mbedtls_pk_free(mbedtls_pk_context* ctx) {
+    if (ctx->pk_ctx) {
+        EVP_PKEY_free((EVP_PKEY*)ctx->pk_ctx);
+    }
+    ctx->pk_ctx = nullptr;
+}
+
+int mbedtls_pk_parse_public_key(mbedtls_pk_context* ctx, const unsigned char* key, size_t keylen) {
+    if (!key || keylen == 0 || ctx->pk_ctx) {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    BIO* bio = BIO_new_mem_buf(key, (int)keylen);
+    if (!bio) {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    ctx->pk_ctx = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    return ctx->pk_ctx ? 0 : MBEDTLS_ERR_PK_KEY_INVALID_FORMAT;
+}
+
+int mbedtls_pk_verify(mbedtls_pk_context* ctx, mbedtls_md_type_t md_alg, const unsigned char* hash, size_t hash_len,
+                      const unsigned char* sig, size_t sig_len) {
+    if (!ctx->pk_ctx || md_alg != MBEDTLS_MD_SHA256 || hash_len != 32) {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    EVP_PKEY_CTX* verify = EVP_PKEY_CTX_new((EVP_PKEY*)ctx->pk_ctx, nullptr);
+    if (!verify) {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+    int result = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+    if (EVP_PKEY_verify_init(verify) == 1 && EVP_PKEY_CTX_set_signature_md(verify, EVP_sha256()) == 1 &&
+        EVP_PKEY_verify(verify, sig, sig_len, hash, hash_len) == 1) {
+        result = 0;
+    }
+    EVP_PKEY_CTX_free(verify);
+    return result;
+}
@@ -0,0 +1,5 @@
+// Native ArduinoOTA instance (no network listener).
+
+#include <ArduinoOTA.h>
+
+ArduinoOTAClass ArduinoOTA;
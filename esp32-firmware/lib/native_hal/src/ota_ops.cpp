@@ -0,0 +1,262 @@
+// Native OTA slots: app0/app1 as byte vectors with the sizes from partitions.csv.
+// Writes must be sequential (like OTA_WITH_SEQUENTIAL_WRITES on the device) and
+// the boot selection only changes which image hal::bootImage() returns.
+// The spiffs data partition is raw NOR flash: erased to 0xFF by sector, writes
+// only clear bits; in memory, or in a file mapped with hal::setFlashPath().
+
+#include <esp_ota_ops.h>
+#include <hal_native.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const esp_partition_t gPartitions[2] = {
+    {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x10000, 0x140000, "app0", false},
+    {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x150000, 0x140000, "app1", false},
+};
+
+const esp_partition_t gDataPartition = {ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, 0x2A0000,
+                                        0x150000, "spiffs", false};
+
+std::vector<uint8_t> gImages[2];
+int gRunning = 0;
+int gBoot = 0;
+int gOpenSlot = -1;         // Slot being written, -1 when no update is open
+esp_ota_handle_t gNextHandle = 1;
+esp_ota_handle_t gOpenHandle = 0;
+bool gWritten = false;      // Slot holds a complete, validated image
+
+// Data partition contents: gDataMemory, or the mapping of the setFlashPath() file
+std::vector<uint8_t> gDataMemory;
+uint8_t* gDataMap = nullptr;
+std::vector<uint32_t> gSectorErases;
+hal::FlashStats gFlashStats;
+
+uint8_t* dataFlash() {
+    if (gDataMap) {
+        return gDataMap;
+    }
+    if (gDataMemory.empty()) {
+        gDataMemory.assign(gDataPartition.size, 0xFF);
+    }
+    return gDataMemory.data();
+}
+
+int slotOf(const esp_partition_t* partition) {
+    if (partition == &gPartitions[0]) {
+        return 0;
+    }
+    if (partition == &gPartitions[1]) {
+        return 1;
+    }
+    return -1;
+}
+
+}  // namespace
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    if (type != ESP_PARTITION_TYPE_DATA ||
+        (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != gDataPartition.subtype) ||
+        (label && strcmp(label, gDataPartition.label) != 0)) {
+        return nullptr;
+    }
+    return &gDataPartition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    int slot = slotOf(partition);
+    if ((slot < 0 && partition != &gDataPartition) || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (src_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (slot < 0) {
+        memcpy(dst, dataFlash() + src_offset, size);
+        return ESP_OK;
+    }
+    const std::vector<uint8_t>& image = gImages[slot];
+    uint8_t* out = (uint8_t*)dst;
+    for (size_t i = 0; i < size; i++) {
+        size_t offset = src_offset + i;
+        out[i] = offset < image.size() ? image[offset] : 0xFF;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    if (partition != &gDataPartition || !src) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t* flash = dataFlash() + dst_offset;
+    const uint8_t* bytes = (const uint8_t*)src;
+    for (size_t i = 0; i < size; i++) {
+        gFlashStats.lostBits += __builtin_popcount(bytes[i] & ~flash[i]);
+        flash[i] &= bytes[i];
+    }
+    gFlashStats.bytesWritten += size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    if (partition != &gDataPartition || offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(dataFlash() + offset, 0xFF, size);
+    gSectorErases.resize(partition->size / SPI_FLASH_SEC_SIZE);
+    for (size_t sector = offset / SPI_FLASH_SEC_SIZE; sector < (offset + size) / SPI_FLASH_SEC_SIZE; sector++) {
+        gFlashStats.sectorErases++;
+        if (++gSectorErases[sector] > gFlashStats.maxSectorErases) {
+            gFlashStats.maxSectorErases = gSectorErases[sector];
+        }
+    }
+    return ESP_OK;
+}
+
+const esp_partition_t* esp_ota_get_running_partition() {
+    return &gPartitions[gRunning];
+}
+
+const esp_partition_t* esp_ota_get_boot_partition() {
+    return &gPartitions[gBoot];
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from) {
+    int slot = start_from ? slotOf(start_from) : gRunning;
+    return slot < 0 ? nullptr : &gPartitions[1 - slot];
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle) {
+    int slot = slotOf(partition);
+    if (slot < 0 || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (slot == gRunning) {
+        return ESP_ERR_OTA_PARTITION_CONFLICT;
+    }
+    if (image_size != OTA_SIZE_UNKNOWN && image_size != OTA_WITH_SEQUENTIAL_WRITES && image_size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (gOpenSlot >= 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gImages[slot].clear();
+    if (gBoot == slot) {
+        gBoot = gRunning;  // The erased slot can no longer boot
+    }
+    gOpenSlot = slot;
+    gOpenHandle = gNextHandle++;
+    gWritten = false;
+    *out_handle = gOpenHandle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    if (gOpenSlot < 0 || handle != gOpenHandle || !data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::vector<uint8_t>& image = gImages[gOpenSlot];
+    if (image.size() + size > gPartitions[gOpenSlot].size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const uint8_t* bytes = (const uint8_t*)data;
+    image.insert(image.end(), bytes, bytes + size);
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    if (gOpenSlot < 0 || handle != gOpenHandle) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    const std::vector<uint8_t>& image = gImages[gOpenSlot];
+    bool valid = !image.empty() && image[0] == ESP_IMAGE_HEADER_MAGIC;
+    gWritten = valid;
+    gOpenSlot = -1;
+    gOpenHandle = 0;
+    return valid ? ESP_OK : ESP_ERR_OTA_VALIDATE_FAILED;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle) {
+    if (gOpenSlot < 0 || handle != gOpenHandle) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    gImages[gOpenSlot].clear();
+    gOpenSlot = -1;
+    gOpenHandle = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    int slot = slotOf(partition);
+    if (slot < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (slot != gRunning && (!gWritten || slot == gOpenSlot)) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    gBoot = slot;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback() {
+    return ESP_OK;
+}
+
+namespace hal {
+
+void setRunningImage(const uint8_t* data, size_t size) {
+    gImages[gRunning].assign(data, data + size);
+}
+
+const std::vector<uint8_t>& bootImage() {
+    return gImages[gBoot];
+}
+
+void setFlashPath(const char* path) {
+    if (gDataMap) {
+        munmap(gDataMap, gDataPartition.size);
+        gDataMap = nullptr;
+    }
+    if (!path) {
+        return;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(path);
+        return;
+    }
+    // A new (or short) file reads as erased flash
+    off_t existing = lseek(fd, 0, SEEK_END);
+    if (existing < (off_t)gDataPartition.size) {
+        std::vector<uint8_t> erased(gDataPartition.size - existing, 0xFF);
+        if (write(fd, erased.data(), erased.size()) != (ssize_t)erased.size()) {
+            perror(path);
+        }
+    }
+    void* map = mmap(nullptr, gDataPartition.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return;
+    }
+    gDataMap = (uint8_t*)map;
+}
+
+FlashStats flashStats() {
+    return gFlashStats;
+}
+
+}  // namespace hal
@@ -0,0 +1,149 @@
+// Native Preferences: one flat key/value map ("namespace/key" -> bytes), optionally
+// mirrored to a text file so entries survive a process restart (simulated reboot).
+
+#include <Preferences.h>
+#include <hal_native.h>
+
+#include <map>
+#include <vector>
+
+namespace {
+
+std::map<std::string, std::vector<uint8_t>> gEntries;
+std::string gPath;
+
+void loadFile() {
+    gEntries.clear();
+    FILE* file = fopen(gPath.c_str(), "r");
+    if (!file) {
+        return;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), file)) {
+        char* space = strchr(line, ' ');
+        if (!space) {
+            continue;
+        }
+        *space = '\0';
+        std::vector<uint8_t> value;
+        for (const char* hex = space + 1; hex[0] && hex[1] && hex[0] != '\n'; hex += 2) {
+            char byteText[3] = {hex[0], hex[1], '\0'};
+            value.push_back((uint8_t)strtoul(byteText, nullptr, 16));
+        }
+        gEntries[line] = value;
+    }
+    fclose(file);
+}
+
+void saveFile() {
+    if (gPath.empty()) {
+        return;
+    }
+    FILE* file = fopen(gPath.c_str(), "w");
+    if (!file) {
+        return;
+    }
+    for (const auto& entry : gEntries) {
+        fprintf(file, "%s ", entry.first.c_str());
+        for (uint8_t b : entry.second) {
+            fprintf(file, "%02x", b);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+std::string fullKey(const std::string& ns, const char* key) {
+    return ns + "/" + key;
+}
+
+}  // namespace
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partition_label) {
+    (void)partition_label;
+    if (!name || strlen(name) > 15) {
+        return false;  // NVS namespace names are limited to 15 characters
+    }
+    _namespace = name;
+    _readOnly = readOnly;
+    _open = true;
+    return true;
+}
+
+void Preferences::end() {
+    _open = false;
+}
+
+bool Preferences::clear() {
+    if (!_open || _readOnly) {
+        return false;
+    }
+    std::string prefix = _namespace + "/";
+    for (auto it = gEntries.begin(); it != gEntries.end();) {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ? gEntries.erase(it) : std::next(it);
+    }
+    saveFile();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_open || _readOnly) {
+        return false;
+    }
+    bool removed = gEntries.erase(fullKey(_namespace, key)) > 0;
+    saveFile();
+    return removed;
+}
+
+bool Preferences::isKey(const char* key) {
+    return _open && gEntries.count(fullKey(_namespace, key)) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!_open || _readOnly || !key || (!value && len > 0)) {
+        return 0;
+    }
+    const uint8_t* bytes = (const uint8_t*)value;
+    gEntries[fullKey(_namespace, key)] = std::vector<uint8_t>(bytes, bytes + len);
+    saveFile();
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_open) {
+        return 0;
+    }
+    auto it = gEntries.find(fullKey(_namespace, key));
+    return it == gEntries.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = getBytesLength(key);
+    if (len == 0 || !buf || len > maxLen) {
+        return 0;  // Like NVS: a too-small buffer reads nothing
+    }
+    memcpy(buf, gEntries[fullKey(_namespace, key)].data(), len);
+    return len;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+namespace hal {
+
+void setNvsPath(const char* path) {
+    gPath = path ? path : "";
+    if (gPath.empty()) {
+        gEntries.clear();
+    } else {
+        loadFile();
+    }
+}
+
+}  // namespace hal
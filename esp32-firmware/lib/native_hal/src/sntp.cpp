@@ -0,0 +1,99 @@
+// Native SNTP client: configTime() starts it and syncs land against a modelled true
+// clock that can run off the local one by a fixed drift, so the firmware sees the
+// same small corrections at each resync as on a device with a real crystal.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_sntp.h>
+#include <hal_native.h>
+
+namespace {
+
+sntp_sync_time_cb_t gCallback = nullptr;
+uint32_t gIntervalMs = 3600000;  // CONFIG_LWIP_SNTP_UPDATE_DELAY default
+bool gEnabled = false;
+uint64_t gNextSyncUs = 0;
+
+// True UTC time = gEpochUs + (clock - gClockUs) * (1 + gDriftPpm / 1e6)
+bool gWallClockSet = false;
+uint64_t gEpochUs = 0;
+uint64_t gClockUs = 0;
+int32_t gDriftPpm = 0;
+uint32_t gSyncDelayMs = 0;
+
+uint64_t trueEpochUs(uint64_t clock) {
+    if (!gWallClockSet) {
+        struct timeval tv;
+        gettimeofday(&tv, nullptr);
+        gEpochUs = (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec;
+        gClockUs = clock;
+        gWallClockSet = true;
+    }
+    int64_t elapsed = (int64_t)(clock - gClockUs);
+    return gEpochUs + elapsed + (int64_t)((double)elapsed * gDriftPpm / 1e6);
+}
+
+}  // namespace
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1, const char* server2,
+                const char* server3) {
+    (void)gmtOffset_sec;
+    (void)daylightOffset_sec;
+    (void)server1;
+    (void)server2;
+    (void)server3;
+    gEnabled = true;
+    gNextSyncUs = hal::clockUs() + (uint64_t)gSyncDelayMs * 1000ULL;
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) {
+    gCallback = callback;
+}
+
+void sntp_set_sync_interval(uint32_t interval_ms) {
+    gIntervalMs = interval_ms < 15000 ? 15000 : interval_ms;  // ESP-IDF minimum
+}
+
+uint32_t sntp_get_sync_interval() {
+    return gIntervalMs;
+}
+
+bool sntp_restart() {
+    if (!gEnabled) {
+        return false;
+    }
+    gNextSyncUs = hal::clockUs() + (uint64_t)gSyncDelayMs * 1000ULL;
+    return true;
+}
+
+bool sntp_enabled() {
+    return gEnabled;
+}
+
+sntp_sync_status_t sntp_get_sync_status() {
+    uint64_t now = hal::clockUs();
+    if (!gEnabled || now < gNextSyncUs || WiFi.status() != WL_CONNECTED) {
+        return SNTP_SYNC_STATUS_RESET;
+    }
+    uint64_t epoch = trueEpochUs(now);
+    struct timeval tv;
+    tv.tv_sec = (time_t)(epoch / 1000000ULL);
+    tv.tv_usec = (suseconds_t)(epoch % 1000000ULL);
+    gNextSyncUs = now + (uint64_t)gIntervalMs * 1000ULL;
+    if (gCallback) {
+        gCallback(&tv);
+    }
+    return SNTP_SYNC_STATUS_COMPLETED;
+}
+
+namespace hal {
+
+void setWallClock(uint64_t epochUs, int32_t driftPpm, uint32_t syncDelayMs) {
+    gEpochUs = epochUs;
+    gClockUs = clockUs();
+    gDriftPpm = driftPpm;
+    gSyncDelayMs = syncDelayMs;
+    gWallClockSet = true;
+}
+
+}  // namespace hal
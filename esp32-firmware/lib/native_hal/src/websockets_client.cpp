@@ -0,0 +1,446 @@
+// Native WebSocketsClient: RFC 6455 client framing over a non-blocking POSIX socket,
+// or an in-process hal::WebSocketPeer when one is installed. Its buffers are host-only
+// heap use (hal::HostHeapScope); the event callback runs as firmware again.
+
+#include <WebSocketsClient.h>
+#include <hal_native.h>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+hal::WebSocketPeer* gPeer = nullptr;
+hal::SocketWatcher* gWatcher = nullptr;
+
+const char kBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string base64(const uint8_t* data, size_t len) {
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < len) chunk |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) chunk |= data[i + 2];
+        out += kBase64[(chunk >> 18) & 0x3F];
+        out += kBase64[(chunk >> 12) & 0x3F];
+        out += i + 1 < len ? kBase64[(chunk >> 6) & 0x3F] : '=';
+        out += i + 2 < len ? kBase64[chunk & 0x3F] : '=';
+    }
+    return out;
+}
+
+bool sendAll(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+}  // namespace
+
+WebSocketsClient::WebSocketsClient()
+    : _port(0), _fd(-1), _state(WS_IDLE), _configured(false), _connectNow(false), _reconnectInterval(500),
+      _lastAttempt(0) {}
+
+WebSocketsClient::~WebSocketsClient() {
+    closeSocket(false);
+}
+
+void WebSocketsClient::begin(const char* host, uint16_t port, const char* url, const char* protocol) {
+    (void)protocol;
+    hal::HostHeapScope hostOnly;
+    closeSocket(false);
+    _host = host;
+    _port = port;
+    _url = url ? url : "/";
+    _configured = true;
+    // Connect on the first loop() call, like the Arduino library (whatever
+    // setReconnectInterval() is called with afterwards)
+    _connectNow = true;
+}
+
+void WebSocketsClient::beginSSL(const char* host, uint16_t port, const char* url, const char* fingerprint,
+                                const char* protocol) {
+    (void)fingerprint;
+    begin(host, port, url, protocol);
+}
+
+void WebSocketsClient::onEvent(WebSocketClientEvent cbEvent) {
+    _cbEvent = cbEvent;
+}
+
+bool WebSocketsClient::isConnected() {
+    return _state == WS_CONNECTED;
+}
+
+void WebSocketsClient::disconnect() {
+    hal::HostHeapScope hostOnly;
+    if (_state == WS_CONNECTED) {
+        sendFrame(0x8, nullptr, 0);
+    }
+    closeSocket(true);
+}
+
+void WebSocketsClient::loop() {
+    if (!_configured) {
+        return;
+    }
+    hal::HostHeapScope hostOnly;
+    if (gPeer) {
+        loopPeer();
+        return;
+    }
+    switch (_state) {
+        case WS_IDLE:
+            if (attemptDue()) {
+                startConnect();
+            }
+            break;
+        case WS_CONNECTING: {
+            struct pollfd pfd = {_fd, POLLOUT, 0};
+            if (poll(&pfd, 1, 0) > 0) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(_fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) {
+                    closeSocket(false);
+                    return;
+                }
+                sendHandshake();
+            }
+            break;
+        }
+        case WS_HANDSHAKE:
+            if (!readAvailable()) {
+                closeSocket(false);
+                return;
+            }
+            processHandshake();
+            break;
+        case WS_CONNECTED:
+            if (!readAvailable()) {
+                closeSocket(true);
+                return;
+            }
+            processFrames();
+            break;
+    }
+}
+
+void WebSocketsClient::loopPeer() {
+    if (_state != WS_CONNECTED) {
+        if (attemptDue()) {
+            if (gPeer->open(_host.c_str(), _port, _url.c_str())) {
+                _state = WS_CONNECTED;
+                std::string url = _url;
+                emit(WStype_CONNECTED, (uint8_t*)&url[0], url.size());
+            }
+        }
+        return;
+    }
+    std::string payload;
+    while (_state == WS_CONNECTED) {
+        if (!gPeer->isOpen()) {
+            closeSocket(true);
+            return;
+        }
+        if (!gPeer->poll(payload)) {
+            return;
+        }
+        size_t length = payload.size();
+        payload.push_back('\0');
+        emit(WStype_TEXT, (uint8_t*)&payload[0], length);
+    }
+}
+
+bool WebSocketsClient::attemptDue() {
+    if (!_connectNow && millis() - _lastAttempt < _reconnectInterval) {
+        return false;
+    }
+    _connectNow = false;
+    _lastAttempt = millis();
+    return true;
+}
+
+void WebSocketsClient::startConnect() {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    char port[8];
+    snprintf(port, sizeof(port), "%u", _port);
+    if (getaddrinfo(_host.c_str(), port, &hints, &res) != 0 || !res) {
+        return;
+    }
+
+    _fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (_fd < 0) {
+        freeaddrinfo(res);
+        return;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+    if (gWatcher) {
+        gWatcher->socketOpened(_fd);
+    }
+    int one = 1;
+    setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int rc = ::connect(_fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc == 0) {
+        sendHandshake();
+    } else if (errno == EINPROGRESS) {
+        _state = WS_CONNECTING;
+    } else {
+        closeSocket(false);
+    }
+}
+
+void WebSocketsClient::sendHandshake() {
+    uint8_t nonce[16];
+    for (auto& b : nonce) {
+        b = (uint8_t)random(256);
+    }
+    _key = base64(nonce, sizeof(nonce));
+
+    char request[512];
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\n"
+                       "Host: %s:%u\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Sec-WebSocket-Version: 13\r\n"
+                       "Sec-WebSocket-Key: %s\r\n"
+                       "User-Agent: arduino-WebSocket-Client\r\n"
+                       "\r\n",
+                       _url.c_str(), _host.c_str(), _port, _key.c_str());
+    if (!sendAll(_fd, (const uint8_t*)request, (size_t)len)) {
+        closeSocket(false);
+        return;
+    }
+    _rx.clear();
+    _state = WS_HANDSHAKE;
+}
+
+void WebSocketsClient::processHandshake() {
+    size_t end = _rx.find("\r\n\r\n");
+    if (end == std::string::npos) {
+        return;
+    }
+    bool upgraded = _rx.compare(0, 12, "HTTP/1.1 101") == 0;
+    _rx.erase(0, end + 4);
+    if (!upgraded) {
+        closeSocket(false);
+        return;
+    }
+    _state = WS_CONNECTED;
+    std::string url = _url;
+    emit(WStype_CONNECTED, (uint8_t*)&url[0], url.size());
+    processFrames();
+}
+
+bool WebSocketsClient::readAvailable() {
+    uint8_t buf[4096];
+    for (;;) {
+        ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            _rx.append((const char*)buf, (size_t)n);
+            continue;
+        }
+        if (n == 0) {
+            return false;  // Orderly shutdown by peer
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+}
+
+void WebSocketsClient::processFrames() {
+    while (_state == WS_CONNECTED && _rx.size() >= 2) {
+        const uint8_t* p = (const uint8_t*)_rx.data();
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = (p[1] & 0x80) != 0;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            if (_rx.size() < 4) return;
+            length = ((uint64_t)p[2] << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (_rx.size() < 10) return;
+            length = 0;
+            for (int i = 0; i < 8; i++) {
+                length = (length << 8) | p[2 + i];
+            }
+            header = 10;
+        }
+        size_t maskOffset = header;
+        if (masked) {
+            header += 4;
+        }
+        if (_rx.size() < header + length) {
+            return;
+        }
+
+        std::string payload = _rx.substr(header, (size_t)length);
+        if (masked) {
+            for (size_t i = 0; i < payload.size(); i++) {
+                payload[i] ^= p[maskOffset + (i % 4)];
+            }
+        }
+        _rx.erase(0, header + (size_t)length);
+
+        // Keep a terminator after the payload, as the Arduino library does
+        payload.push_back('\0');
+        uint8_t* data = (uint8_t*)&payload[0];
+        size_t dataLen = payload.size() - 1;
+
+        switch (opcode) {
+            case 0x1:
+                emit(WStype_TEXT, data, dataLen);
+                break;
+            case 0x2:
+                emit(WStype_BIN, data, dataLen);
+                break;
+            case 0x8:
+                sendFrame(0x8, nullptr, 0);
+                closeSocket(true);
+                return;
+            case 0x9:
+                sendFrame(0xA, data, dataLen);
+                emit(WStype_PING, data, dataLen);
+                break;
+            case 0xA:
+                emit(WStype_PONG, data, dataLen);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+bool WebSocketsClient::sendFrame(uint8_t opcode, const uint8_t* payload, size_t length) {
+    hal::HostHeapScope hostOnly;
+    if (gPeer) {
+        if (_state != WS_CONNECTED) {
+            return false;
+        }
+        bool kept = true;
+        if (opcode == 0x1) {
+            kept = gPeer->receive((const char*)payload, length);
+        } else if (opcode == 0x2) {
+            kept = gPeer->receiveBinary(payload, length);
+        }
+        if (!kept) {
+            closeSocket(true);
+            return false;
+        }
+        return true;
+    }
+    if (_fd < 0 || _state != WS_CONNECTED) {
+        return false;
+    }
+    std::string frame;
+    frame.reserve(length + 14);
+    frame.push_back((char)(0x80 | opcode));
+    if (length < 126) {
+        frame.push_back((char)(0x80 | length));
+    } else if (length <= 0xFFFF) {
+        frame.push_back((char)(0x80 | 126));
+        frame.push_back((char)(length >> 8));
+        frame.push_back((char)(length & 0xFF));
+    } else {
+        frame.push_back((char)(0x80 | 127));
+        for (int i = 7; i >= 0; i--) {
+            frame.push_back((char)((uint64_t)length >> (8 * i)));
+        }
+    }
+    uint8_t mask[4];
+    for (auto& b : mask) {
+        b = (uint8_t)random(256);
+    }
+    frame.append((const char*)mask, 4);
+    for (size_t i = 0; i < length; i++) {
+        frame.push_back((char)(payload[i] ^ mask[i % 4]));
+    }
+    if (!sendAll(_fd, (const uint8_t*)frame.data(), frame.size())) {
+        closeSocket(true);
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketsClient::sendTXT(const uint8_t* payload, size_t length) {
+    if (length == 0) {
+        length = strlen((const char*)payload);
+    }
+    return sendFrame(0x1, payload, length);
+}
+
+bool WebSocketsClient::sendTXT(const char* payload, size_t length) {
+    return sendTXT((const uint8_t*)payload, length);
+}
+
+bool WebSocketsClient::sendBIN(const uint8_t* payload, size_t length) {
+    return sendFrame(0x2, payload, length);
+}
+
+bool WebSocketsClient::sendPing(const uint8_t* payload, size_t length) {
+    return sendFrame(0x9, payload, length);
+}
+
+void WebSocketsClient::closeSocket(bool notify) {
+    bool wasConnected = _state == WS_CONNECTED;
+    if (gPeer && wasConnected) {
+        gPeer->close();
+    }
+    if (_fd >= 0) {
+        if (gWatcher) {
+            gWatcher->socketClosed(_fd);
+        }
+        ::close(_fd);
+        _fd = -1;
+    }
+    _state = WS_IDLE;
+    _rx.clear();
+    _lastAttempt = millis();
+    if (notify && wasConnected) {
+        emit(WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+void WebSocketsClient::emit(WStype_t type, uint8_t* payload, size_t length) {
+    if (_cbEvent) {
+        hal::FirmwareHeapScope firmware;
+        _cbEvent(type, payload, length);
+    }
+}
+
+namespace hal {
+
+void setWebSocketPeer(WebSocketPeer* peer) {
+    gPeer = peer;
+}
+
+void setSocketWatcher(SocketWatcher* watcher) {
+    gWatcher = watcher;
+}
+
+}  // namespace hal
@@ -0,0 +1,291 @@
+// Native WiFi stand-in: the host network stack is always reachable unless a tool drops the link.
+
+#include <WiFi.h>
+#include <hal_native.h>
+
+#include <atomic>
+#include <vector>
+
+WiFiClass WiFi;
+
+namespace {
+
+// Join progress. Timers run from phaseStart; transitions (and the events they
+// raise) happen lazily on the next WiFi call, on the caller's thread.
+enum JoinPhase {
+    JOIN_IDLE,        // Not started, or left with disconnect()
+    JOIN_SEARCHING,   // Scanning (untargeted) or probing the given channel, then associating
+    JOIN_ASSOCIATED,  // Waiting for the DHCP lease
+    JOIN_CONNECTED,
+    JOIN_NOT_FOUND,   // Access point not found; stays here until the next begin()/reconnect()
+    JOIN_LOST         // Link dropped after connecting
+};
+
+std::atomic<bool> gLinkUp(true);
+std::function<bool()> gLinkProvider;
+wifi_mode_t gMode = WIFI_OFF;
+bool gAutoReconnect = true;
+
+JoinPhase gPhase = JOIN_IDLE;
+unsigned long gPhaseStart = 0;
+bool gTargeted = false;
+uint8_t gTargetBssid[6];
+int32_t gTargetChannel = 0;
+
+uint8_t gApBssid[6] = {0x24, 0x0A, 0xC4, 0x5E, 0x10, 0x01};
+int32_t gApChannel = 6;
+uint32_t gScanMs = 0;
+uint32_t gAssociateMs = 0;
+uint32_t gDhcpMs = 0;
+
+bool gStaticConfig = false;
+IPAddress gStaticIp;
+IPAddress gStaticGateway;
+IPAddress gStaticSubnet;
+IPAddress gStaticDns;
+
+struct EventHandler {
+    WiFiEventFuncCb callback;
+    arduino_event_id_t event;
+};
+std::vector<EventHandler> gHandlers;
+
+bool linkUp() {
+    return gLinkProvider ? gLinkProvider() : gLinkUp.load();
+}
+
+void fire(arduino_event_id_t event, const arduino_event_info_t& info) {
+    for (const EventHandler& handler : gHandlers) {
+        if (handler.event == ARDUINO_EVENT_MAX || handler.event == event) {
+            handler.callback(event, info);
+        }
+    }
+}
+
+void fireDisconnected(uint8_t reason) {
+    arduino_event_info_t info;
+    memset(&info, 0, sizeof(info));
+    memcpy(info.wifi_sta_disconnected.bssid, gApBssid, 6);
+    info.wifi_sta_disconnected.reason = reason;
+    fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+}
+
+void startJoin() {
+    gPhase = JOIN_SEARCHING;
+    gPhaseStart = millis();
+}
+
+void advance() {
+    unsigned long now = millis();
+    if (gPhase == JOIN_SEARCHING) {
+        uint32_t searchMs = (gTargeted ? 0 : gScanMs) + gAssociateMs;
+        if (now - gPhaseStart < searchMs) {
+            return;
+        }
+        bool found = linkUp() && (!gTargeted || (memcmp(gTargetBssid, gApBssid, 6) == 0 &&
+                                                 gTargetChannel == gApChannel));
+        if (!found) {
+            gPhase = JOIN_NOT_FOUND;
+            fireDisconnected(WIFI_REASON_NO_AP_FOUND);
+            return;
+        }
+        gPhase = JOIN_ASSOCIATED;
+        gPhaseStart = now;
+        arduino_event_info_t info;
+        memset(&info, 0, sizeof(info));
+        memcpy(info.wifi_sta_connected.bssid, gApBssid, 6);
+        info.wifi_sta_connected.channel = (uint8_t)gApChannel;
+        fire(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+    }
+    if (gPhase == JOIN_ASSOCIATED || gPhase == JOIN_CONNECTED) {
+        if (!linkUp()) {
+            gPhase = JOIN_LOST;
+            gPhaseStart = now;
+            fireDisconnected(WIFI_REASON_BEACON_TIMEOUT);
+            return;
+        }
+    }
+    if (gPhase == JOIN_ASSOCIATED) {
+        if (!gStaticConfig && now - gPhaseStart < gDhcpMs) {
+            return;
+        }
+        gPhase = JOIN_CONNECTED;
+        arduino_event_info_t info;
+        memset(&info, 0, sizeof(info));
+        info.got_ip.ip_info.ip.addr = (uint32_t)WiFi.localIP();
+        info.got_ip.ip_info.gw.addr = (uint32_t)WiFi.gatewayIP();
+        info.got_ip.ip_info.netmask.addr = (uint32_t)WiFi.subnetMask();
+        fire(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+        return;
+    }
+    if (gPhase == JOIN_LOST && gAutoReconnect && linkUp()) {
+        startJoin();  // The core's auto-reconnect repeats the last join
+        advance();
+    }
+}
+
+}  // namespace
+
+bool WiFiClass::mode(wifi_mode_t m) {
+    gMode = m;
+    return true;
+}
+
+wifi_mode_t WiFiClass::getMode() {
+    return gMode;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+    (void)ssid;
+    (void)passphrase;
+    gTargeted = bssid != nullptr && channel > 0;
+    if (gTargeted) {
+        memcpy(gTargetBssid, bssid, 6);
+        gTargetChannel = channel;
+    }
+    if (connect) {
+        startJoin();
+    } else {
+        gPhase = JOIN_IDLE;
+    }
+    return status();
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    (void)dns2;
+    // All zeros switches back to DHCP, as on the ESP32
+    gStaticConfig = (uint32_t)local_ip != 0;
+    gStaticIp = local_ip;
+    gStaticGateway = gateway;
+    gStaticSubnet = subnet;
+    gStaticDns = dns1;
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    (void)eraseap;
+    bool wasUp = gPhase == JOIN_ASSOCIATED || gPhase == JOIN_CONNECTED;
+    gPhase = JOIN_IDLE;
+    if (wasUp) {
+        fireDisconnected(WIFI_REASON_ASSOC_LEAVE);
+    }
+    if (wifioff) {
+        gMode = WIFI_OFF;
+    }
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    startJoin();
+    return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool autoReconnect) {
+    gAutoReconnect = autoReconnect;
+    return true;
+}
+
+bool WiFiClass::getAutoReconnect() {
+    return gAutoReconnect;
+}
+
+wl_status_t WiFiClass::status() {
+    advance();
+    switch (gPhase) {
+        case JOIN_CONNECTED:
+            return WL_CONNECTED;
+        case JOIN_NOT_FOUND:
+            return WL_NO_SSID_AVAIL;
+        case JOIN_SEARCHING:
+        case JOIN_ASSOCIATED:
+        case JOIN_LOST:
+            return WL_DISCONNECTED;
+        default:
+            return WL_IDLE_STATUS;
+    }
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cbEvent, arduino_event_id_t event) {
+    gHandlers.push_back({cbEvent, event});
+    return gHandlers.size();
+}
+
+IPAddress WiFiClass::localIP() {
+    if (gPhase != JOIN_CONNECTED) {
+        return IPAddress();
+    }
+    return gStaticConfig ? gStaticIp : IPAddress(127, 0, 0, 1);
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    if (gPhase != JOIN_CONNECTED) {
+        return IPAddress();
+    }
+    return gStaticConfig ? gStaticGateway : IPAddress(127, 0, 0, 1);
+}
+
+IPAddress WiFiClass::subnetMask() {
+    if (gPhase != JOIN_CONNECTED) {
+        return IPAddress();
+    }
+    return gStaticConfig ? gStaticSubnet : IPAddress(255, 0, 0, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t dns_no) {
+    if (gPhase != JOIN_CONNECTED || dns_no > 0) {
+        return IPAddress();
+    }
+    return gStaticConfig ? gStaticDns : IPAddress(127, 0, 0, 53);
+}
+
+uint8_t* WiFiClass::BSSID() {
+    return gPhase == JOIN_ASSOCIATED || gPhase == JOIN_CONNECTED ? gApBssid : nullptr;
+}
+
+int32_t WiFiClass::channel() {
+    return gPhase == JOIN_ASSOCIATED || gPhase == JOIN_CONNECTED ? gApChannel : 0;
+}
+
+int8_t WiFiClass::RSSI() {
+    return gPhase == JOIN_CONNECTED ? -55 : 0;
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    uint64_t efuse = ESP.getEfuseMac();
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t)(efuse >> (8 * i));
+    }
+    return mac;
+}
+
+String WiFiClass::macAddress() {
+    uint8_t mac[6];
+    macAddress(mac);
+    char buf[18];
+    snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(buf);
+}
+
+namespace hal {
+
+void setWifiConnected(bool connected) {
+    gLinkUp = connected;
+}
+
+void setWifiLinkProvider(std::function<bool()> linkUp) {
+    gLinkProvider = linkUp;
+}
+
+void setWifiTiming(uint32_t scanMs, uint32_t associateMs, uint32_t dhcpMs) {
+    gScanMs = scanMs;
+    gAssociateMs = associateMs;
+    gDhcpMs = dhcpMs;
+}
+
+void setWifiAccessPoint(const uint8_t bssid[6], int32_t channel) {
+    memcpy(gApBssid, bssid, 6);
+    gApChannel = channel;
+}
+
+}  // namespace hal
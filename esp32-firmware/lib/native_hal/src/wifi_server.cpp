@@ -0,0 +1,89 @@
+// Native WiFiServer/WiFiClient: accepted TCP connections over non-blocking POSIX sockets.
+
+#include <WiFi.h>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (_fd < 0) {
+        return 0;
+    }
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += (size_t)n;
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if (_fd < 0) {
+        return 0;
+    }
+    uint8_t c;
+    return ::recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) > 0 ? 1 : 0;
+}
+
+int WiFiClient::read() {
+    if (_fd < 0) {
+        return -1;
+    }
+    uint8_t c;
+    return ::recv(_fd, &c, 1, MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+bool WiFiClient::connected() {
+    if (_fd < 0) {
+        return false;
+    }
+    uint8_t c;
+    ssize_t n = ::recv(_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+void WiFiClient::stop() {
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+void WiFiServer::begin() {
+    _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) {
+        return;
+    }
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    // Loopback only: the native build is never meant to be reachable from the LAN
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(_fd, 4) < 0) {
+        ::close(_fd);
+        _fd = -1;
+        return;
+    }
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+WiFiClient WiFiServer::available() {
+    if (_fd < 0) {
+        return WiFiClient();
+    }
+    return WiFiClient(::accept(_fd, nullptr, nullptr));
+}
@@ -0,0 +1,184 @@
+// Native Wire: a simulated I2C bus with register-level MCP23017 and PCF8575 models.
+// Writes are applied when endTransmission() ends the transaction, as on the wire.
+
+#include <Wire.h>
+#include <hal_native.h>
+
+#include <map>
+
+TwoWire Wire;
+
+namespace {
+
+// MCP23017 registers (IOCON.BANK = 0, the power-on mapping)
+const uint8_t MCP_IODIRA = 0x00;
+const uint8_t MCP_GPIOA = 0x12;
+const uint8_t MCP_GPIOB = 0x13;
+const uint8_t MCP_OLATA = 0x14;
+const uint8_t MCP_OLATB = 0x15;
+const uint8_t MCP_REGISTER_COUNT = 0x16;
+
+struct SimDevice {
+    hal::I2cDeviceType type;
+    bool responding;
+    uint8_t pointer;                      // MCP23017 register pointer
+    uint8_t registers[MCP_REGISTER_COUNT];
+    uint16_t port;                        // PCF8575 quasi-bidirectional port
+};
+
+std::map<uint8_t, SimDevice> gDevices;
+hal::I2cStats gStats = {0, 0, 0};
+
+void powerOn(SimDevice& device) {
+    device.pointer = 0;
+    memset(device.registers, 0, sizeof(device.registers));
+    device.registers[MCP_IODIRA] = 0xFF;      // All pins inputs
+    device.registers[MCP_IODIRA + 1] = 0xFF;
+    device.port = 0xFFFF;                     // PCF8575 pins float high
+}
+
+void mcpWriteRegister(SimDevice& device, uint8_t reg, uint8_t value) {
+    if (reg == MCP_GPIOA || reg == MCP_GPIOB) {
+        reg += MCP_OLATA - MCP_GPIOA;  // Writing GPIO writes the output latch
+    }
+    device.registers[reg] = value;
+}
+
+SimDevice* responder(uint8_t address) {
+    std::map<uint8_t, SimDevice>::iterator it = gDevices.find(address);
+    if (it == gDevices.end() || !it->second.responding) {
+        gStats.nacks++;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+}  // namespace
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    (void)frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _address = address;
+    _txLength = 0;
+    _transmitting = true;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (!_transmitting || _txLength >= BUFFER_LENGTH) {
+        return 0;
+    }
+    _txBuffer[_txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+    size_t written = 0;
+    while (written < length && write(data[written])) {
+        written++;
+    }
+    return written;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    if (!_transmitting) {
+        return 4;
+    }
+    _transmitting = false;
+    gStats.transactions++;
+    SimDevice* device = responder(_address);
+    if (!device) {
+        return 2;
+    }
+    gStats.bytesWritten += _txLength;
+
+    if (device->type == hal::I2C_MCP23017) {
+        if (_txLength == 0) {
+            return 0;
+        }
+        // First byte sets the pointer; data bytes auto-increment (IOCON.SEQOP = 0)
+        device->pointer = _txBuffer[0] % MCP_REGISTER_COUNT;
+        for (size_t i = 1; i < _txLength; i++) {
+            mcpWriteRegister(*device, device->pointer, _txBuffer[i]);
+            device->pointer = (device->pointer + 1) % MCP_REGISTER_COUNT;
+        }
+    } else {
+        // PCF8575: byte pairs P07..P00 then P17..P10; the last complete pair wins
+        for (size_t i = 0; i + 1 < _txLength; i += 2) {
+            device->port = (uint16_t)(_txBuffer[i] | (_txBuffer[i + 1] << 8));
+        }
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+    (void)sendStop;
+    _rxLength = 0;
+    _rxIndex = 0;
+    gStats.transactions++;
+    SimDevice* device = responder(address);
+    if (!device) {
+        return 0;
+    }
+    uint16_t levels = hal::i2cPinLevels(address);
+    for (uint8_t i = 0; i < quantity && i < BUFFER_LENGTH; i++) {
+        if (device->type == hal::I2C_MCP23017) {
+            uint8_t reg = device->pointer;
+            device->pointer = (device->pointer + 1) % MCP_REGISTER_COUNT;
+            _rxBuffer[_rxLength++] = reg == MCP_GPIOA   ? (uint8_t)levels
+                                     : reg == MCP_GPIOB ? (uint8_t)(levels >> 8)
+                                                        : device->registers[reg];
+        } else {
+            _rxBuffer[_rxLength++] = (uint8_t)(levels >> ((i & 1) * 8));
+        }
+    }
+    return (uint8_t)_rxLength;
+}
+
+namespace hal {
+
+void attachI2cDevice(uint8_t address, I2cDeviceType type) {
+    SimDevice& device = gDevices[address];
+    device.type = type;
+    device.responding = true;
+    powerOn(device);
+}
+
+void resetI2cDevice(uint8_t address) {
+    std::map<uint8_t, SimDevice>::iterator it = gDevices.find(address);
+    if (it != gDevices.end()) {
+        powerOn(it->second);
+    }
+}
+
+void setI2cDeviceResponding(uint8_t address, bool responding) {
+    std::map<uint8_t, SimDevice>::iterator it = gDevices.find(address);
+    if (it != gDevices.end()) {
+        it->second.responding = responding;
+    }
+}
+
+uint16_t i2cPinLevels(uint8_t address) {
+    std::map<uint8_t, SimDevice>::iterator it = gDevices.find(address);
+    if (it == gDevices.end()) {
+        return 0xFFFF;
+    }
+    const SimDevice& device = it->second;
+    if (device.type == I2C_PCF8575) {
+        return device.port;
+    }
+    uint16_t inputs = (uint16_t)(device.registers[MCP_IODIRA] | (device.registers[MCP_IODIRA + 1] << 8));
+    uint16_t latch = (uint16_t)(device.registers[MCP_OLATA] | (device.registers[MCP_OLATB] << 8));
+    return (uint16_t)((latch & ~inputs) | inputs);  // Inputs float high (relay board pull-ups)
+}
+
+I2cStats i2cStats() {
+    return gStats;
+}
+
+}  // namespace hal
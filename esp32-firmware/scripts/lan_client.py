@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Client for the firmware's signed UDP control API (include/local_api.h).
+
+Sends "hello" to learn the boot ID, then relay:command / sensor:request
+datagrams signed with HMAC-SHA256, and prints each reply with its round-trip
+time. Replies whose signature does not verify are reported and ignored.
+
+The key is --key (the device's LOCAL_API_KEY), or derived like the firmware
+does from the device token and ID: HMAC-SHA256(token, "ghlan1:" + device_id),
+as lowercase hex. The token is read from --token or $DEVICE_AUTH_TOKEN.
+
+Usage:
+  scripts/lan_client.py --device-id greenhouse-a1b2c3 relay 2 on
+  scripts/lan_client.py --host 192.168.1.40 --key <hex> sensor
+  scripts/lan_client.py --device-id greenhouse-a1b2c3 bench --count 1000   # latency over loopback
+"""
+
+import argparse
+import hashlib
+import hmac
+import json
+import os
+import socket
+import statistics
+import sys
+import time
+
+SIGNATURE_HEX_LENGTH = 64
+
+
+def derive_key(token, device_id):
+    return hmac.new(token.encode(), ("ghlan1:" + device_id).encode(), hashlib.sha256).hexdigest()
+
+
+class LanClient:
+    def __init__(self, host, port, key, name, timeout):
+        self.address = (host, port)
+        self.key = key.encode()
+        self.name = name
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.boot = ""
+        self.seq = 0
+
+    def sign(self, body):
+        return hmac.new(self.key, body, hashlib.sha256).hexdigest().encode()
+
+    def request(self, event, data=None, hello=False):
+        if not hello:
+            self.seq += 1
+        message = {"client": self.name, "boot": self.boot, "seq": self.seq, "event": event}
+        if data is not None:
+            message["data"] = data
+        body = json.dumps(message, separators=(",", ":")).encode()
+        started = time.perf_counter()
+        self.sock.sendto(body + b"\n" + self.sign(body), self.address)
+        while True:
+            datagram, _ = self.sock.recvfrom(2048)
+            body, _, signature = datagram.rpartition(b"\n")
+            if len(signature) != SIGNATURE_HEX_LENGTH or not hmac.compare_digest(signature, self.sign(body)):
+                print("reply with a bad signature ignored", file=sys.stderr)
+                continue
+            reply = json.loads(body)
+            if reply.get("seq") == self.seq:
+                return reply, time.perf_counter() - started
+
+    def hello(self):
+        reply, _ = self.request("hello", hello=True)
+        self.boot = reply["boot"]
+        self.seq = reply.get("last_seq", 0)
+        return reply
+
+    def command(self, event, data=None):
+        reply, elapsed = self.request(event, data)
+        if reply.get("error") == "stale_boot":
+            # Device rebooted since hello: start over on its new boot ID
+            self.hello()
+            reply, elapsed = self.request(event, data)
+        return reply, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--key", help="LOCAL_API_KEY of the device (default: derived)")
+    parser.add_argument("--token", default=os.environ.get("DEVICE_AUTH_TOKEN"), help="device token for the derived key")
+    parser.add_argument("--device-id", help="device ID for the derived key")
+    parser.add_argument("--client", default="lan-cli", help="client name (replay protection is per name)")
+    parser.add_argument("--timeout", type=float, default=1.0)
+    sub = parser.add_subparsers(dest="action", required=True)
+    relay = sub.add_parser("relay", help="switch a relay")
+    relay.add_argument("relay_id", type=int)
+    relay.add_argument("state", choices=["on", "off"])
+    sub.add_parser("sensor", help="read the latest sensor values")
+    bench = sub.add_parser("bench", help="round-trip latency of alternating relay commands")
+    bench.add_argument("--count", type=int, default=500)
+    bench.add_argument("--relay", type=int, default=0)
+    args = parser.parse_args()
+
+    key = args.key
+    if key is None:
+        if not args.token or not args.device_id:
+            parser.error("give --key, or --device-id with --token / $DEVICE_AUTH_TOKEN")
+        key = derive_key(args.token, args.device_id)
+
+    client = LanClient(args.host, args.port, key, args.client, args.timeout)
+    try:
+        hello = client.hello()
+    except socket.timeout:
+        sys.exit("no reply to hello (wrong key, host or port?)")
+    print("device %s, boot %s, %d relays" % (hello["device_id"], hello["boot"], hello["relay_count"]))
+
+    if args.action == "relay":
+        reply, elapsed = client.command("relay:command", {"relay_id": args.relay_id, "state": args.state == "on"})
+        print("%s in %.2f ms" % (json.dumps(reply), elapsed * 1000))
+    elif args.action == "sensor":
+        reply, elapsed = client.command("sensor:request")
+        print("%s in %.2f ms" % (json.dumps(reply), elapsed * 1000))
+    else:
+        samples = []
+        lost = 0
+        for i in range(args.count):
+            try:
+                reply, elapsed = client.command("relay:command", {"relay_id": args.relay, "state": i % 2 == 0})
+            except socket.timeout:
+                lost += 1
+                continue
+            if reply.get("event") != "relay:state":
+                sys.exit("unexpected reply: %s" % json.dumps(reply))
+            samples.append(elapsed * 1000)
+        samples.sort()
+        print("%d commands, %d lost" % (args.count, lost))
+        if samples:
+            print("round trip ms: median %.2f  p95 %.2f  p99 %.2f  max %.2f" % (
+                statistics.median(samples), samples[int(len(samples) * 0.95) - 1],
+                samples[int(len(samples) * 0.99) - 1], samples[-1]))
+
+
+if __name__ == "__main__":
+    main()
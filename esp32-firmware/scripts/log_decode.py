@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""Decode compact serial logs from firmware built with -D LOG_STRIP_FORMATS.
+
+With format stripping enabled the firmware prints one line per log record:
+
+    ~<format id:8 hex><millis:8 hex><level:1 hex><payload hex>
+
+The format id is the FNV-1a hash of the format literal. This script scans the
+firmware sources for LOG_* / DEBUG_* call sites, rebuilds the same literals the
+macros record and maps ids back to text. Other lines pass through unchanged.
+
+Usage:
+  scripts/log_decode.py [logfile]            # defaults to stdin
+  pio device monitor | scripts/log_decode.py
+  scripts/log_decode.py --src path/to/esp32-firmware capture.txt
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+# Macro -> suffix appended by config.h (LOG_X(msg) records msg "\n")
+MACRO_SUFFIX = {
+    "LOG_ERROR": "\n", "LOG_WARN": "\n", "LOG_INFO": "\n", "LOG_DEBUG": "\n",
+    "DEBUG_PRINTLN": "\n",
+    "LOG_ERRORF": "", "LOG_WARNF": "", "LOG_INFOF": "", "LOG_DEBUGF": "",
+    "DEBUG_PRINTF": "", "DEBUG_PRINT": "",
+}
+
+LEVEL_PREFIXES = {1: "❌ ERROR: ", 2: "⚠ WARN: ", 3: "ℹ INFO: ", 4: ""}
+
+CALL_RE = re.compile(r"\b(" + "|".join(sorted(MACRO_SUFFIX, key=len, reverse=True)) + r")\s*\(")
+DEFINE_RE = re.compile(r'^\s*#\s*define\s+(\w+)\s+((?:"(?:[^"\\]|\\.)*"\s*)+)\s*(?://.*)?$', re.M)
+STRING_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+TOKEN_RE = re.compile(r'\s*(?:"((?:[^"\\]|\\.)*)"|(\w+))')
+SPEC_RE = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(?:hh|h|ll|l|j|z|t|L|q)?([diouxXcsfFeEgGaAp%])")
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def unescape(literal):
+    """Turn the body of a C string literal into the bytes the compiler emits."""
+    out = bytearray()
+    raw = literal.encode("utf-8")
+    i = 0
+    simple = {ord("n"): 10, ord("t"): 9, ord("r"): 13, ord("0"): 0, ord("\\"): 92,
+              ord('"'): 34, ord("'"): 39, ord("a"): 7, ord("b"): 8, ord("f"): 12, ord("v"): 11}
+    while i < len(raw):
+        c = raw[i]
+        if c != 0x5C:
+            out.append(c)
+            i += 1
+            continue
+        n = raw[i + 1]
+        if n == ord("x"):
+            j = i + 2
+            while j < len(raw) and chr(raw[j]) in "0123456789abcdefABCDEF":
+                j += 1
+            out.append(int(raw[i + 2:j], 16) & 0xFF)
+            i = j
+        elif ord("0") <= n <= ord("7"):
+            j = i + 1
+            while j < len(raw) and j < i + 4 and ord("0") <= raw[j] <= ord("7"):
+                j += 1
+            out.append(int(raw[i + 1:j], 8) & 0xFF)
+            i = j
+        else:
+            out.append(simple.get(n, n))
+            i += 2
+    return bytes(out)
+
+
+def scan_sources(root):
+    """Return {format id: format bytes} for every log call site under root."""
+    files = []
+    for sub in ("src", "include"):
+        for dirpath, _, names in os.walk(os.path.join(root, sub)):
+            files.extend(os.path.join(dirpath, n) for n in names if n.endswith((".cpp", ".h", ".c")))
+
+    texts = {}
+    defines = {}
+    for path in files:
+        with open(path, encoding="utf-8", errors="replace") as f:
+            texts[path] = f.read()
+        for name, body in DEFINE_RE.findall(texts[path]):
+            defines[name] = b"".join(unescape(s) for s in STRING_RE.findall(body))
+
+    formats = {}
+    for text in texts.values():
+        for match in CALL_RE.finditer(text):
+            pos = match.end()
+            pieces = []
+            # Format argument: adjacent string literals and #define'd literals
+            while True:
+                token = TOKEN_RE.match(text, pos)
+                if not token:
+                    break
+                if token.group(1) is not None:
+                    pieces.append(unescape(token.group(1)))
+                elif token.group(2) in defines:
+                    pieces.append(defines[token.group(2)])
+                else:
+                    break
+                pos = token.end()
+            if not pieces and text[pos:].lstrip()[:1] != ")":
+                continue
+            fmt = b"".join(pieces) + MACRO_SUFFIX[match.group(1)].encode()
+            formats[fnv1a(fmt)] = fmt
+    return formats
+
+
+def read_args(payload):
+    args = []
+    i = 0
+    while i < len(payload):
+        tag = chr(payload[i])
+        i += 1
+        if tag in "iu":
+            fmt = "<i" if tag == "i" else "<I"
+            args.append(struct.unpack_from(fmt, payload, i)[0])
+            i += 4
+        elif tag in "IUp":
+            fmt = "<q" if tag == "I" else "<Q"
+            args.append(struct.unpack_from(fmt, payload, i)[0])
+            i += 8
+        elif tag == "f":
+            args.append(struct.unpack_from("<f", payload, i)[0])
+            i += 4
+        elif tag == "s":
+            length = payload[i]
+            args.append(payload[i + 1:i + 1 + length].decode("utf-8", errors="replace"))
+            i += 1 + length
+        else:
+            break
+    return args
+
+
+def render(fmt, args):
+    args = list(args)
+    out = []
+    pos = 0
+    for spec in SPEC_RE.finditer(fmt):
+        out.append(fmt[pos:spec.start()])
+        pos = spec.end()
+        flags, width, precision, conv = spec.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(args.pop(0)) if args else ""
+        if precision == "*":
+            precision = str(args.pop(0)) if args else ""
+        if not args:
+            out.append("?")
+            continue
+        value = args.pop(0)
+        if conv == "p":
+            conv, flags = "x", flags + "#"
+        elif conv in "aA":
+            conv = "e"
+        elif conv == "u":
+            conv = "d"
+        if conv in "diouxXc" and isinstance(value, float):
+            value = int(value)
+        elif conv in "fFeEgG" and isinstance(value, str):
+            value = float("nan")
+        elif conv == "s" and not isinstance(value, str):
+            value = str(value)
+        py = "%" + flags + (width or "") + ("." + precision if precision is not None else "") + conv
+        out.append(py % value)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode_line(line, formats, state):
+    body = line.rstrip("\r\n")
+    if not body.startswith("~") or len(body) < 18:
+        return line
+    try:
+        fmt_id = int(body[1:9], 16)
+        millis = int(body[9:17], 16)
+        level = int(body[17], 16)
+        payload = bytes.fromhex(body[18:])
+    except ValueError:
+        return line
+    truncated = level & 0x8
+    level &= 0x7
+    fmt = formats.get(fmt_id)
+    if fmt is None:
+        state["line_start"] = True
+        return "[%10.3f] <unknown format %08x> %s\n" % (millis / 1000.0, fmt_id, payload.hex())
+    text = render(fmt.decode("utf-8", errors="replace"), read_args(payload))
+    if truncated:
+        text = text.rstrip("\n") + " [truncated]\n"
+    # DEBUG_PRINT fragments continue the current line without a new timestamp
+    stamp = "[%10.3f] " % (millis / 1000.0) if state["line_start"] else ""
+    state["line_start"] = text.endswith("\n")
+    return stamp + LEVEL_PREFIXES.get(level, "") + text
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("logfile", nargs="?", help="captured serial output (default: stdin)")
+    parser.add_argument("--src", default=os.path.dirname(here), help="firmware directory with src/ and include/")
+    opts = parser.parse_args()
+
+    formats = scan_sources(opts.src)
+    stream = open(opts.logfile, encoding="utf-8", errors="replace") if opts.logfile else sys.stdin
+    state = {"line_start": True}
+    with stream:
+        for line in stream:
+            sys.stdout.write(decode_line(line, formats, state))
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,365 @@
+#!/usr/bin/env python3
+"""Minimal Socket.IO (Engine.IO v4, websocket transport) stand-in for the native build.
+
+Speaks just enough of the backend protocol for the firmware to connect,
+authenticate and exchange events, with no dependencies beyond the standard
+library. Every device:register is accepted unless --reject-auth is given.
+Optionally pushes relay:command / sensor:request events at a fixed rate to
+load the receive path, and prints per-event counts every --report seconds.
+
+Like the backend, a relay:command from a client that has not registered (a
+dashboard) is forwarded to every authenticated device, and every relay:state
+is broadcast to all clients as relay:changed. bench/fleet_loadgen.cpp relies
+on this to time command round trips.
+
+Commands to a device carry {epoch, seq} like the backend's lib/relayCommands.js,
+with a fresh epoch per session (to the device, every reconnect looks like a
+backend restart), so the firmware acks them with relay:ack. Acks are counted;
+nothing is resent.
+
+With --ota-release and --ota-patch, every device is sent an ota:offer after
+authenticating and its ota:pull requests are answered with binary ota:chunk
+events (--ota-drop-at closes the connection once mid-download to exercise
+resume); ota:status reports are printed. --config-set pushes a config:set
+payload after authentication and prints the config:state reply.
+
+Usage:
+  scripts/socketio_standin.py                          # listen on 127.0.0.1:8080
+  scripts/socketio_standin.py --commands-per-sec 50    # drive relay commands
+  scripts/socketio_standin.py --port 9000 --verbose
+  scripts/socketio_standin.py --quiet --report 5       # behind bench/fleet_loadgen.cpp
+  scripts/socketio_standin.py --ota-release ota-releases/1.1.0.json --ota-patch full.ghdp
+"""
+
+import argparse
+import asyncio
+import base64
+import collections
+import hashlib
+import json
+import os
+import struct
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC11B85"
+
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xA
+
+
+class Stats:
+    def __init__(self):
+        self.received = collections.Counter()
+        self.sent = collections.Counter()
+        self.bytes_received = 0
+        self.connections = 0
+
+    def report(self, interval):
+        if not self.received and not self.sent:
+            return
+        rx = ", ".join(f"{name}={count}" for name, count in sorted(self.received.items()))
+        tx = ", ".join(f"{name}={count}" for name, count in sorted(self.sent.items()))
+        print(f"[{time.strftime('%H:%M:%S')}] {interval}s  rx: {rx or '-'} ({self.bytes_received} B)  tx: {tx or '-'}",
+              flush=True)
+        self.received.clear()
+        self.sent.clear()
+        self.bytes_received = 0
+
+
+def load_ota_offer(args):
+    """ota:offer for --ota-release (a manifest written by ota-release.js) and --ota-patch."""
+    with open(args.ota_release) as file:
+        manifest = json.load(file)
+    with open(args.ota_patch, "rb") as file:
+        patch = file.read()
+    source = b""
+    if args.ota_source:
+        with open(args.ota_source, "rb") as file:
+            source = file.read()
+    offer = {
+        "id": "standin-" + hashlib.sha256(patch).hexdigest()[:12],
+        "version": manifest["version"],
+        "patch_size": len(patch),
+        "target_size": manifest["size"],
+        "target_sha256": manifest["sha256"],
+        "source_size": len(source),
+        "source_sha256": hashlib.sha256(source).hexdigest() if source else "",
+        "signature": manifest["signature"],
+    }
+    return offer, patch
+
+
+def encode_frame(opcode, payload):
+    """Server-to-client frames are never masked."""
+    header = bytes([0x80 | opcode])
+    length = len(payload)
+    if length < 126:
+        header += bytes([length])
+    elif length <= 0xFFFF:
+        header += bytes([126]) + struct.pack(">H", length)
+    else:
+        header += bytes([127]) + struct.pack(">Q", length)
+    return header + payload
+
+
+async def read_frame(reader):
+    first, second = await reader.readexactly(2)
+    opcode = first & 0x0F
+    masked = second & 0x80
+    length = second & 0x7F
+    if length == 126:
+        (length,) = struct.unpack(">H", await reader.readexactly(2))
+    elif length == 127:
+        (length,) = struct.unpack(">Q", await reader.readexactly(8))
+    mask = await reader.readexactly(4) if masked else b"\0\0\0\0"
+    payload = bytearray(await reader.readexactly(length))
+    for i in range(length):
+        payload[i] ^= mask[i % 4]
+    return opcode, bytes(payload)
+
+
+class Session:
+    def __init__(self, args, stats, sessions, reader, writer):
+        self.args = args
+        self.stats = stats
+        self.sessions = sessions
+        self.reader = reader
+        self.writer = writer
+        self.sid = base64.urlsafe_b64encode(os.urandom(12)).decode()
+        self.device_id = None
+        self.authenticated = False
+        self.command_epoch = os.urandom(4).hex()
+        self.command_seq = 0
+
+    def send_text(self, text):
+        self.writer.write(encode_frame(OP_TEXT, text.encode()))
+
+    def emit(self, event, data):
+        self.stats.sent[event] += 1
+        self.send_text("42" + json.dumps([event, data], separators=(",", ":")))
+
+    def send_command(self, command):
+        self.command_seq += 1
+        self.emit("relay:command", dict(command, epoch=self.command_epoch, seq=self.command_seq))
+
+    async def handshake(self):
+        try:
+            request = await self.reader.readuntil(b"\r\n\r\n")
+        except (asyncio.IncompleteReadError, ConnectionError):
+            return False  # Opened and closed without a request: a firmware endpoint probe
+        headers = {}
+        for line in request.decode(errors="replace").split("\r\n")[1:]:
+            if ":" in line:
+                name, value = line.split(":", 1)
+                headers[name.strip().lower()] = value.strip()
+        key = headers.get("sec-websocket-key")
+        if not key:
+            self.writer.write(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n")
+            return False
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        self.writer.write(("HTTP/1.1 101 Switching Protocols\r\n"
+                           "Upgrade: websocket\r\n"
+                           "Connection: Upgrade\r\n"
+                           f"Sec-WebSocket-Accept: {accept}\r\n\r\n").encode())
+        # Engine.IO open packet
+        self.send_text("0" + json.dumps({
+            "sid": self.sid,
+            "upgrades": [],
+            "pingInterval": self.args.ping_interval,
+            "pingTimeout": self.args.ping_timeout,
+            "maxPayload": 1000000,
+        }))
+        return True
+
+    def handle_packet(self, text):
+        if text == "3":
+            return  # Engine.IO pong
+        if text == "2":
+            self.send_text("3")
+            return
+        if text.startswith("40"):
+            self.send_text("40" + json.dumps({"sid": self.sid}))
+            return
+        if not text.startswith("42"):
+            return
+        try:
+            event = json.loads(text[2:])
+        except ValueError:
+            print(f"[standin] malformed event: {text[:80]}", flush=True)
+            return
+        name = event[0] if event else "?"
+        data = event[1] if len(event) > 1 else None
+        self.stats.received[name] += 1
+        if self.args.verbose:
+            print(f"[standin] <- {text[:200]}", flush=True)
+
+        if name == "device:register":
+            self.device_id = (data or {}).get("device_id")
+            if self.args.reject_auth:
+                self.emit("device:auth_failed", {"error": "Invalid authentication token",
+                                                 "device_id": self.device_id})
+            else:
+                self.authenticated = True
+                self.emit("device:auth_success", {"device_id": self.device_id,
+                                                  "message": "Authentication successful"})
+                if self.args.config_set:
+                    self.emit("config:set", self.args.config_set)
+                if self.args.ota:
+                    self.emit("ota:offer", self.args.ota[0])
+        elif name == "time:sync":
+            reply = {"server_time": int(time.time() * 1000)}
+            if isinstance((data or {}).get("t0"), int):
+                reply["t0"] = data["t0"]
+            self.emit("time:sync", reply)
+        elif name == "relay:command" and not self.authenticated:
+            command = data or {}
+            forwarded = {"relay_id": command.get("relay_id"), "state": command.get("state"),
+                         "mode": command.get("mode", "manual")}
+            for session in list(self.sessions):
+                if session.authenticated:
+                    session.send_command(forwarded)
+            self.emit("relay:command", {"success": True})
+        elif name == "relay:state" and self.authenticated:
+            state = data or {}
+            changed = {"relay_id": state.get("relay_id"), "state": state.get("state"),
+                       "mode": state.get("mode", "manual"), "changed_by": state.get("changed_by", "esp32")}
+            for session in list(self.sessions):
+                session.emit("relay:changed", changed)
+
+        elif name == "ota:pull" and self.authenticated and self.args.ota:
+            self.send_chunk(data or {})
+        elif name == "config:state":
+            print(f"[standin] config:state {json.dumps(data, separators=(',', ':'))}", flush=True)
+        elif name == "ota:status":
+            status = data or {}
+            print(f"[standin] ota:status {status.get('state')} {status.get('bytes_received')}/"
+                  f"{status.get('patch_size')} B" + (f" error={status['error']}" if status.get("error") else "") +
+                  (f" apply={status['apply_ms']}ms transfer={status['transfer_ms']}ms"
+                   if status.get("state") == "applied" else ""), flush=True)
+
+    def send_chunk(self, pull):
+        offer, patch = self.args.ota
+        offset = pull.get("offset")
+        length = pull.get("length")
+        if pull.get("id") != offer["id"] or not isinstance(offset, int) or not isinstance(length, int):
+            return
+        if offset < 0 or offset >= len(patch) or length <= 0:
+            return
+        if self.args.ota_drop_at and offset >= self.args.ota_drop_at:
+            self.args.ota_drop_at = 0  # Only once
+            print(f"[standin] dropping {self.device_id} at offset {offset}", flush=True)
+            self.writer.close()
+            return
+        chunk = patch[offset:offset + length]
+        # Socket.IO binary event: placeholder packet, then the attachment as a binary frame
+        self.stats.sent["ota:chunk"] += 1
+        self.send_text("451-" + json.dumps(["ota:chunk", {"id": offer["id"], "offset": offset,
+                                                          "data": {"_placeholder": True, "num": 0}}],
+                                           separators=(",", ":")))
+        self.writer.write(encode_frame(OP_BINARY, chunk))
+
+    async def engine_ping(self):
+        while True:
+            await asyncio.sleep(self.args.ping_interval / 1000)
+            self.send_text("2")
+
+    async def push(self, send, rate, make_data):
+        if rate <= 0:
+            return
+        period = 1.0 / rate
+        n = 0
+        next_at = time.monotonic()
+        while True:
+            next_at += period
+            await asyncio.sleep(max(0.0, next_at - time.monotonic()))
+            if self.authenticated:
+                send(make_data(n))
+                n += 1
+
+    async def run(self):
+        if not await self.handshake():
+            return
+        self.stats.connections += 1
+        self.sessions.add(self)
+        if not self.args.quiet:
+            print(f"[standin] connection {self.stats.connections} from {self.writer.get_extra_info('peername')}",
+                  flush=True)
+        tasks = [
+            asyncio.ensure_future(self.engine_ping()),
+            asyncio.ensure_future(self.push(self.send_command, self.args.commands_per_sec,
+                                            lambda n: {"relay_id": n % 4, "state": (n // 4) % 2 == 0})),
+            asyncio.ensure_future(self.push(lambda data: self.emit("sensor:request", data),
+                                            self.args.sensor_requests_per_sec, lambda n: {})),
+        ]
+        try:
+            while True:
+                opcode, payload = await read_frame(self.reader)
+                self.stats.bytes_received += len(payload)
+                if opcode == OP_TEXT:
+                    self.handle_packet(payload.decode(errors="replace"))
+                elif opcode == OP_PING:
+                    self.writer.write(encode_frame(OP_PONG, payload))
+                elif opcode == OP_CLOSE:
+                    self.writer.write(encode_frame(OP_CLOSE, b""))
+                    break
+                await self.writer.drain()
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.sessions.discard(self)
+            for task in tasks:
+                task.cancel()
+            self.writer.close()
+            if not self.args.quiet:
+                print(f"[standin] {self.device_id or 'client'} disconnected", flush=True)
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--ping-interval", type=int, default=25000, help="Engine.IO pingInterval (ms)")
+    parser.add_argument("--ping-timeout", type=int, default=20000, help="Engine.IO pingTimeout (ms)")
+    parser.add_argument("--commands-per-sec", type=float, default=0, help="relay:command events pushed per second")
+    parser.add_argument("--sensor-requests-per-sec", type=float, default=0,
+                        help="sensor:request events pushed per second")
+    parser.add_argument("--ota-release", help="release manifest (<version>.json) to offer every device")
+    parser.add_argument("--ota-patch", help="patch file served for --ota-release")
+    parser.add_argument("--ota-source", help="image the patch was made against (omit for a full-image patch)")
+    parser.add_argument("--ota-drop-at", type=int, default=0,
+                        help="close the connection once when a pull reaches this patch offset")
+    parser.add_argument("--config-set", type=json.loads, help="config:set payload (JSON) sent after authentication")
+    parser.add_argument("--reject-auth", action="store_true", help="answer device:register with auth_failed")
+    parser.add_argument("--report", type=int, default=10, help="seconds between event count reports (0 = off)")
+    parser.add_argument("--verbose", action="store_true", help="print every received event")
+    parser.add_argument("--quiet", action="store_true", help="no per-connection lines (fleet load tests)")
+    args = parser.parse_args()
+    args.ota = load_ota_offer(args) if args.ota_release and args.ota_patch else None
+
+    stats = Stats()
+    sessions = set()
+
+    async def on_client(reader, writer):
+        await Session(args, stats, sessions, reader, writer).run()
+
+    # A deep accept queue so a fleet connecting at once is not throttled by SYN retries
+    server = await asyncio.start_server(on_client, args.host, args.port, backlog=4096)
+    print(f"[standin] listening on ws://{args.host}:{args.port}/", flush=True)
+
+    async def reporter():
+        while args.report > 0:
+            await asyncio.sleep(args.report)
+            stats.report(args.report)
+
+    async with server:
+        await asyncio.gather(server.serve_forever(), reporter())
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,622 @@
+// Simulated backend: Socket.IO session, rule engine and measurements
+
+#include "backend_peer.h"
+
+#include <ArduinoJson.h>
+#include <cstring>
+
+#include "anomaly_detector.h"
+#include "history_store.h"
+#include "link_recovery.h"
+#include "plant_model.h"
+#include "sensor_block.h"
+
+namespace {
+
+// Rule engine thresholds (hysteresis pairs)
+const float HEATER_ON_BELOW = 16.0f;
+const float HEATER_OFF_ABOVE = 19.0f;
+const float FAN_ON_TEMP = 28.0f;
+const float FAN_OFF_TEMP = 25.0f;
+const float FAN_ON_HUMIDITY = 85.0f;
+const float FAN_OFF_HUMIDITY = 75.0f;
+const float PUMP_ON_BELOW = 30.0f;
+const float PUMP_OFF_ABOVE = 60.0f;
+const float LIGHTS_ON_HOUR = 6.0f;
+const float LIGHTS_OFF_HOUR = 20.0f;
+
+bool startsWith(const std::string& text, const char* prefix) {
+    return text.compare(0, strlen(prefix), prefix) == 0;
+}
+
+}  // namespace
+
+SimulatedBackend::SimulatedBackend(const FaultScript& script, uint32_t baseLatencyMs, bool deviceControl)
+    : _script(script), _baseLatencyMs(baseLatencyMs), _deviceControl(deviceControl), _lastTickUs(simNowUs()),
+      _clientOpen(false), _serverSession(false), _authenticated(false), _authenticatedAtUs(0), _closeAtUs(0),
+      _nextPingUs(0), _pongDeadlineUs(0), _framesExchanged(0),
+      _temperature(0), _humidity(0), _soil(0), _haveReadings(false), _nextSeq(1), _lastCommandUs(0),
+      _blockPending(false), _blockCount(0), _historyPending(false), _historyBuckets(0), _historyDone(false),
+      _historyReported(0), _historyReadings(0) {
+    _faults = _script.stateAt(_lastTickUs);
+    for (int i = 0; i < 4; i++) {
+        // A reboot switches every relay off (RelayManager::begin)
+        _believed[i] = false;
+        _pending[i] = false;
+        _pendingState[i] = false;
+        _pendingSinceUs[i] = 0;
+    }
+}
+
+uint64_t SimulatedBackend::latencyUs() const {
+    return (uint64_t)(_baseLatencyMs + _faults.extraLatencyMs) * 1000ULL;
+}
+
+bool SimulatedBackend::open(const char* host, uint16_t port, const char* url) {
+    (void)host;
+    (void)port;
+    (void)url;
+    tick();
+    if (_faults.wifiDown || _faults.serverDown || _faults.blackhole) {
+        sim->stats.refusedConnects++;
+        return false;
+    }
+
+    uint64_t now = simNowUs();
+    _clientOpen = true;
+    _serverSession = true;
+    _authenticated = false;
+    _closeAtUs = 0;
+    _toClient.clear();
+    _toServer.clear();
+    _blockPending = false;
+    _historyPending = false;
+    _nextPingUs = now + SIM_PING_INTERVAL_US;
+    _pongDeadlineUs = 0;
+    sim->stats.connections++;
+
+    sendToClient("0{\"sid\":\"sim\",\"upgrades\":[],\"pingInterval\":25000,\"pingTimeout\":20000,\"maxPayload\":1000000}");
+    return true;
+}
+
+bool SimulatedBackend::receive(const char* payload, size_t length) {
+    return queueToServer(payload, length, false);
+}
+
+bool SimulatedBackend::receiveBinary(const uint8_t* payload, size_t length) {
+    return queueToServer((const char*)payload, length, true);
+}
+
+bool SimulatedBackend::queueToServer(const char* payload, size_t length, bool binary) {
+    tick();
+    if (!_clientOpen) {
+        return false;
+    }
+    if (_faults.blackhole) {
+        return true;  // Swallowed; the device cannot tell
+    }
+    if (!_serverSession) {
+        // Half-open link that came back: the server answers with a reset
+        _clientOpen = false;
+        return false;
+    }
+    Frame frame;
+    frame.dueUs = simNowUs() + latencyUs();
+    frame.text.assign(payload, length);
+    frame.binary = binary;
+    _toServer.push_back(frame);
+    _framesExchanged++;
+    return true;
+}
+
+bool SimulatedBackend::poll(std::string& payload) {
+    tick();
+    if (!_clientOpen || _toClient.empty() || _toClient.front().dueUs > simNowUs()) {
+        return false;
+    }
+    payload.swap(_toClient.front().text);
+    _toClient.pop_front();
+    return true;
+}
+
+bool SimulatedBackend::isOpen() {
+    tick();
+    return _clientOpen;
+}
+
+void SimulatedBackend::close() {
+    _clientOpen = false;
+    if (_serverSession) {
+        endSession(false);
+    }
+}
+
+void SimulatedBackend::tick() {
+    uint64_t now = simNowUs();
+    _faults = _script.stateAt(now);
+
+    if (_script.resetBetween(_lastTickUs, now) >= 0 || _faults.serverDown || _faults.wifiDown) {
+        if (_serverSession) {
+            endSession(true);
+        }
+        _clientOpen = false;
+    }
+    _lastTickUs = now;
+
+    if (_faults.blackhole) {
+        _toClient.clear();
+        _toServer.clear();
+    }
+
+    while (_serverSession && !_toServer.empty() && _toServer.front().dueUs <= now) {
+        std::string text;
+        text.swap(_toServer.front().text);
+        bool binary = _toServer.front().binary;
+        _toServer.pop_front();
+        if (binary && _historyPending) {
+            handleHistoryBuckets(text);
+        } else if (binary) {
+            handleSensorBlock(text);
+        } else {
+            handleClientText(text);
+        }
+    }
+
+    if (_serverSession && _closeAtUs != 0 && now >= _closeAtUs) {
+        endSession(true);
+    }
+
+    if (_serverSession) {
+        if (_pongDeadlineUs != 0 && now >= _pongDeadlineUs) {
+            sim->stats.pingTimeouts++;
+            endSession(!_faults.blackhole);
+        } else if (now >= _nextPingUs) {
+            sendToClient("2");
+            _pongDeadlineUs = now + SIM_PING_TIMEOUT_US;
+            _nextPingUs = now + SIM_PING_INTERVAL_US;
+        }
+    }
+
+    if (_serverSession && _authenticated) {
+        markRecovered();
+        if (!_unacked.empty() && now - _lastCommandUs >= SIM_COMMAND_RETRY_US) {
+            resendUnacked();
+        }
+    }
+}
+
+uint64_t SimulatedBackend::nextEventUs() const {
+    uint64_t next = _script.nextBoundary(_lastTickUs);
+    if (!_toClient.empty() && _toClient.front().dueUs < next) {
+        next = _toClient.front().dueUs;
+    }
+    if (!_toServer.empty() && _toServer.front().dueUs < next) {
+        next = _toServer.front().dueUs;
+    }
+    if (_serverSession) {
+        uint64_t timer = _pongDeadlineUs != 0 ? _pongDeadlineUs : _nextPingUs;
+        if (timer < next) {
+            next = timer;
+        }
+        if (_closeAtUs != 0 && _closeAtUs < next) {
+            next = _closeAtUs;
+        }
+    }
+    return next;
+}
+
+void SimulatedBackend::finish() {
+    if (_serverSession) {
+        endSession(false);
+    }
+}
+
+void SimulatedBackend::sendToClient(const std::string& text) {
+    if (_faults.blackhole) {
+        return;
+    }
+    Frame frame;
+    frame.dueUs = simNowUs() + latencyUs();
+    frame.text = text;
+    frame.binary = false;
+    _toClient.push_back(frame);
+    _framesExchanged++;
+}
+
+void SimulatedBackend::emit(const char* event, const char* json) {
+    std::string text = "42[\"";
+    text += event;
+    text += "\",";
+    text += json;
+    text += "]";
+    sendToClient(text);
+}
+
+void SimulatedBackend::handleClientText(const std::string& text) {
+    if (text == "3") {
+        _pongDeadlineUs = 0;
+    } else if (text == "2") {
+        sendToClient("3");
+    } else if (text == "40") {
+        sendToClient("40{\"sid\":\"sim\"}");
+    } else if (startsWith(text, "42[\"device:register\"")) {
+        handleRegister(text.c_str() + 2);
+    } else if (!_authenticated) {
+        return;  // The real backend ignores device events before authentication
+    } else if (startsWith(text, "42[\"sensor:data\"")) {
+        handleSensorData(text.c_str() + 2);
+    } else if (startsWith(text, "42[\"relay:state\"")) {
+        handleRelayState(text.c_str() + 2);
+    } else if (startsWith(text, "42[\"relay:ack\"")) {
+        handleRelayAck(text.c_str() + 2);
+    } else if (startsWith(text, "42[\"time:sync\"")) {
+        handleTimeSync(text.c_str() + 2);
+    } else if (startsWith(text, "42[\"sensor:anomaly\"")) {
+        handleAnomaly(text.c_str() + 2);
+    } else if (startsWith(text, "42[\"link:recovery\"")) {
+        handleLinkRecovery(text.c_str() + 2);
+    } else if (startsWith(text, "451-[\"sensor:block\"")) {
+        StaticJsonDocument<256> doc;
+        _blockPending = deserializeJson(doc, text.c_str() + 4) == DeserializationError::Ok;
+        _blockCount = doc[1]["count"] | 0;
+    } else if (startsWith(text, "451-[\"sensor:history:chunk\"")) {
+        handleHistoryChunk(text.c_str() + 4, true);
+    } else if (startsWith(text, "42[\"sensor:history:chunk\"")) {
+        handleHistoryChunk(text.c_str() + 2, false);
+    }
+}
+
+void SimulatedBackend::handleSensorBlock(const std::string& block) {
+    if (!_blockPending) {
+        return;
+    }
+    _blockPending = false;
+    SensorBlockDecoder decoder((const uint8_t*)block.data(), block.size());
+    uint64_t t;
+    float values[SENSOR_BLOCK_CHANNELS];
+    uint32_t decoded = 0;
+    while (decoder.next(t, values)) {
+        decoded++;
+    }
+    SimStats& stats = sim->stats;
+    stats.backfillBlocks++;
+    stats.backfillReadings += decoded;
+    stats.backfillBytes += block.size();
+    if (!decoder.valid() || decoded != _blockCount) {
+        stats.backfillCorrupt++;
+    }
+}
+
+void SimulatedBackend::requestHistory() {
+    uint64_t to = serverTimeMs();
+    char json[160];
+    snprintf(json, sizeof(json), "{\"request_id\":\"sim-%llu\",\"from\":%llu,\"to\":%llu,\"step\":3600000}",
+             (unsigned long long)sim->stats.historyQueries, (unsigned long long)(to - 86400000ULL),
+             (unsigned long long)to);
+    emit("sensor:history", json);
+    sim->stats.historyQueries++;
+    _historyDone = false;
+    _historyReadings = 0;
+}
+
+void SimulatedBackend::handleHistoryChunk(const char* json, bool attachment) {
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    JsonObject data = doc[1];
+    sim->stats.historyChunks++;
+    _historyBuckets = data["buckets"] | 0;
+    _historyPending = attachment;
+    if (data["done"] | false) {
+        _historyDone = true;
+        _historyReported = data["readings"] | 0;
+        if (!attachment) {
+            finishHistory();
+        }
+    }
+}
+
+void SimulatedBackend::handleHistoryBuckets(const std::string& buckets) {
+    _historyPending = false;
+    SimStats& stats = sim->stats;
+    if (buckets.size() != (size_t)_historyBuckets * HISTORY_BUCKET_BYTES) {
+        stats.historyMismatched++;
+    } else {
+        for (uint16_t i = 0; i < _historyBuckets; i++) {
+            uint32_t count;
+            memcpy(&count, buckets.data() + i * HISTORY_BUCKET_BYTES + 4, sizeof(count));
+            _historyReadings += count;
+            stats.historyReadings += count;
+        }
+        stats.historyBuckets += _historyBuckets;
+    }
+    if (_historyDone) {
+        finishHistory();
+    }
+}
+
+void SimulatedBackend::finishHistory() {
+    sim->stats.historyAnswered++;
+    if (_historyReadings != _historyReported) {
+        sim->stats.historyMismatched++;
+    }
+    _historyDone = false;
+    _historyReadings = 0;
+}
+
+void SimulatedBackend::handleRegister(const char* json) {
+    uint64_t now = simNowUs();
+    if (_faults.authReject) {
+        sim->stats.authFailures++;
+        emit("device:auth_failed", "{\"error\":\"Invalid authentication token\"}");
+        // socket.disconnect(true) right after the emit; the close travels
+        // behind the event, so the device sees auth_failed first
+        _closeAtUs = now + latencyUs() + 1;
+        return;
+    }
+    sim->stats.authSuccesses++;
+    _authenticated = true;
+    _authenticatedAtUs = now;
+    emit("device:auth_success", "{\"message\":\"Authentication successful\"}");
+    markRecovered();
+
+    // Commands lost with the previous session: drop what the device applied, resend the rest
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, json) == DeserializationError::Ok) {
+        const char* epoch = doc[1]["command_epoch"] | "";
+        uint32_t ack = doc[1]["command_ack"] | 0;
+        while (strcmp(epoch, SIM_COMMAND_EPOCH) == 0 && !_unacked.empty() && _unacked.front().seq <= ack) {
+            _unacked.pop_front();
+        }
+    }
+    if (!_unacked.empty()) {
+        resendUnacked();
+    }
+    // What a dashboard opening the device's chart asks for
+    requestHistory();
+    if (_deviceControl) {
+        enableDeviceControl();
+    }
+}
+
+void SimulatedBackend::enableDeviceControl() {
+    // Stored in NVS by the device: only the first push of a run changes anything
+    char json[128];
+    snprintf(json, sizeof(json), "{\"heater_mode\":%d,\"heater_setpoint\":%.1f,\"fan_mode\":%d,\"fan_setpoint\":%.1f}",
+             CONTROL_MODE_PID, SIM_HEAT_TARGET, CONTROL_MODE_PID, SIM_COOL_TARGET);
+    emit("config:set", json);
+}
+
+void SimulatedBackend::markRecovered() {
+    // A fault counts as recovered at the first moment after its end with an
+    // authenticated session (immediately, if the session survived the fault)
+    uint64_t now = simNowUs();
+    for (size_t i = 0; i < _script.count() && i < SIM_MAX_FAULTS; i++) {
+        if (sim->stats.recoveredAtUs[i] == 0 && now >= _script.fault(i).endUs) {
+            sim->stats.recoveredAtUs[i] = now;
+        }
+    }
+}
+
+void SimulatedBackend::handleSensorData(const char* json) {
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    JsonObject data = doc[1];
+    if (data.isNull()) {
+        return;
+    }
+
+    uint64_t now = simNowUs();
+    SimStats& stats = sim->stats;
+    uint64_t gap = now - stats.lastSensorUs;
+    if (gap > stats.maxSensorGapUs) {
+        stats.maxSensorGapUs = gap;
+    }
+    if (gap > SIM_STALE_THRESHOLD_US) {
+        stats.staleUs += gap - SIM_STALE_THRESHOLD_US;
+    }
+    stats.lastSensorUs = now;
+    stats.sensorFrames++;
+
+    uint64_t stampMs = data["timestamp"] | (uint64_t)0;
+    if (stampMs != 0) {
+        int64_t lagMs = (int64_t)serverTimeMs() - (int64_t)stampMs;
+        if (stats.stampedFrames == 0 || lagMs < stats.stampLagMinMs) {
+            stats.stampLagMinMs = lagMs;
+        }
+        if (stats.stampedFrames == 0 || lagMs > stats.stampLagMaxMs) {
+            stats.stampLagMaxMs = lagMs;
+        }
+        if (stampMs <= stats.lastStampMs) {
+            stats.stampOutOfOrder++;
+        }
+        stats.lastStampMs = stampMs;
+        stats.stampedFrames++;
+    }
+
+    _temperature = data["temperature"] | 0.0f;
+    _humidity = data["humidity"] | 0.0f;
+    _soil = data["soil_moisture"] | 0.0f;
+    _haveReadings = true;
+    runRules();
+}
+
+void SimulatedBackend::handleTimeSync(const char* json) {
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    StaticJsonDocument<128> reply;
+    reply["server_time"] = serverTimeMs();
+    uint64_t sentMs = doc[1]["t0"] | (uint64_t)0;
+    if (sentMs != 0) {
+        reply["t0"] = sentMs;
+    }
+    char text[128];
+    serializeJson(reply, text, sizeof(text));
+    emit("time:sync", text);
+}
+
+void SimulatedBackend::handleAnomaly(const char* json) {
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    const char* kind = doc[1]["kind"] | "";
+    for (int k = 0; k < ANOMALY_KIND_COUNT; k++) {
+        if (strcmp(kind, AnomalyDetector::kindName((AnomalyKind)k)) == 0) {
+            sim->stats.anomalies[k]++;
+        }
+    }
+}
+
+static_assert(sizeof(SimStats::linkRecoveries) / sizeof(uint64_t) == RECOVERY_RUNG_COUNT, "one slot per rung");
+
+void SimulatedBackend::handleLinkRecovery(const char* json) {
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    const char* rung = doc[1]["rung"] | "";
+    for (int r = RECOVERY_RUNG_SOCKET; r < RECOVERY_RUNG_COUNT; r++) {
+        if (strcmp(rung, LinkRecovery::rungName((RecoveryRung)r)) == 0) {
+            sim->stats.linkRecoveries[r]++;
+            sim->stats.linkRecoveryMs[r] += doc[1]["recovery_ms"] | 0u;
+        }
+    }
+}
+
+void SimulatedBackend::handleRelayState(const char* json) {
+    StaticJsonDocument<512> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    JsonObject data = doc[1];
+    int relay = data["relay_id"] | -1;
+    if (relay < 0 || relay >= 4) {
+        return;
+    }
+    confirmRelay(relay, data["state"] | false);
+}
+
+void SimulatedBackend::handleRelayAck(const char* json) {
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, json) != DeserializationError::Ok) {
+        return;
+    }
+    JsonObject data = doc[1];
+    if (strcmp(data["epoch"] | "", SIM_COMMAND_EPOCH) != 0) {
+        return;
+    }
+    uint32_t ack = data["ack"] | 0;
+    bool progress = false;
+    while (!_unacked.empty() && _unacked.front().seq <= ack) {
+        // Applied, or a resend the device already had: its relay:state may never come
+        confirmRelay(_unacked.front().relay, _unacked.front().state);
+        _unacked.pop_front();
+        progress = true;
+    }
+    if (data["gap"] | false) {
+        resendUnacked();
+    } else if (progress) {
+        _lastCommandUs = simNowUs();
+    }
+}
+
+void SimulatedBackend::confirmRelay(int relay, bool state) {
+    _believed[relay] = state;
+    if (_pending[relay] && _pendingState[relay] == state) {
+        SimStats& stats = sim->stats;
+        uint64_t latency = simNowUs() - _pendingSinceUs[relay];
+        uint64_t ms = latency / 1000;
+        stats.commandLatencyMs[ms < SIM_LATENCY_BUCKETS ? ms : SIM_LATENCY_BUCKETS]++;
+        stats.commandLatencySumUs += latency;
+        if (latency > stats.commandLatencyMaxUs) {
+            stats.commandLatencyMaxUs = latency;
+        }
+        stats.commandsAcked++;
+        _pending[relay] = false;
+    }
+}
+
+void SimulatedBackend::runRules() {
+    if (!_haveReadings) {
+        return;
+    }
+    bool desired[4];
+    float hour = PlantModel::hourOfDay(simNowUs());
+    desired[SIM_RELAY_LIGHTS] = hour >= LIGHTS_ON_HOUR && hour < LIGHTS_OFF_HOUR;
+
+    bool heater = _believed[SIM_RELAY_HEATER];
+    desired[SIM_RELAY_HEATER] = heater ? _temperature < HEATER_OFF_ABOVE : _temperature < HEATER_ON_BELOW;
+
+    bool fan = _believed[SIM_RELAY_FAN];
+    desired[SIM_RELAY_FAN] = fan ? (_temperature > FAN_OFF_TEMP || _humidity > FAN_OFF_HUMIDITY)
+                                 : (_temperature > FAN_ON_TEMP || _humidity > FAN_ON_HUMIDITY);
+
+    bool pump = _believed[SIM_RELAY_PUMP];
+    desired[SIM_RELAY_PUMP] = pump ? _soil < PUMP_OFF_ABOVE : _soil < PUMP_ON_BELOW;
+
+    for (int i = 0; i < 4; i++) {
+        if (_deviceControl && (i == SIM_RELAY_HEATER || i == SIM_RELAY_FAN)) {
+            continue;  // A command would override the device's loop
+        }
+        bool target = _pending[i] ? _pendingState[i] : _believed[i];
+        if (desired[i] != target) {
+            sendCommand(i, desired[i]);
+        }
+    }
+}
+
+void SimulatedBackend::sendCommand(int relay, bool state) {
+    Command command = {_nextSeq++, relay, state};
+    _unacked.push_back(command);
+    emitCommand(command);
+    _pending[relay] = true;
+    _pendingState[relay] = state;
+    _pendingSinceUs[relay] = simNowUs();
+    _lastCommandUs = simNowUs();
+    sim->stats.commandsSent++;
+}
+
+void SimulatedBackend::emitCommand(const Command& command) {
+    char json[96];
+    snprintf(json, sizeof(json), "{\"relay_id\":%d,\"state\":%s,\"epoch\":\"%s\",\"seq\":%u}", command.relay,
+             command.state ? "true" : "false", SIM_COMMAND_EPOCH, (unsigned)command.seq);
+    emit("relay:command", json);
+}
+
+void SimulatedBackend::resendUnacked() {
+    // Go-back-N: everything from the oldest unacked seq, in order
+    for (const Command& command : _unacked) {
+        emitCommand(command);
+        // Latency of a resent command counts from the resend (the outage is in the availability figures)
+        _pending[command.relay] = true;
+        _pendingState[command.relay] = command.state;
+        _pendingSinceUs[command.relay] = simNowUs();
+        sim->stats.commandsResent++;
+    }
+    _lastCommandUs = simNowUs();
+}
+
+void SimulatedBackend::endSession(bool notifyClient) {
+    if (_authenticated) {
+        sim->stats.authenticatedUs += simNowUs() - _authenticatedAtUs;
+    }
+    _serverSession = false;
+    _authenticated = false;
+    _closeAtUs = 0;
+    _pongDeadlineUs = 0;
+    _toServer.clear();
+    _toClient.clear();
+    _blockPending = false;
+    for (int i = 0; i < 4; i++) {
+        _pending[i] = false;
+    }
+    if (notifyClient) {
+        _clientOpen = false;
+    }
+}
@@ -0,0 +1,163 @@
+// In-process stand-in for the backend, reached through hal::WebSocketPeer.
+#ifndef BACKEND_PEER_H
+#define BACKEND_PEER_H
+
+#include <hal_native.h>
+
+#include <deque>
+#include <string>
+
+#include "fault_script.h"
+
+#define SIM_PING_INTERVAL_US        (25ULL * 1000000ULL)  // Engine.IO pingInterval (backend default)
+#define SIM_PING_TIMEOUT_US         (20ULL * 1000000ULL)  // Engine.IO pingTimeout
+#define SIM_COMMAND_RETRY_US        (30ULL * 1000000ULL)  // Resend unacked relay commands without progress this long
+#define SIM_COMMAND_EPOCH           "sim"                 // relay:command epoch (backend lib/relayCommands.js)
+
+/**
+ * @class SimulatedBackend
+ * @brief Socket.IO server, rule engine and measurement point of the simulator
+ *
+ * Key Features:
+ * - Engine.IO open/ping/pong and Socket.IO connect, with server-side ping timeout
+ * - device:register handling (accepts, or rejects during an auth fault)
+ * - Hysteresis rules on the reported readings that send relay:command, like the
+ *   real backend's rule engine, and time the relay:state acknowledgement; with
+ *   device control the heater and fan are left to the firmware's PID loops
+ *   (heater_mode/fan_mode pushed with config:set) and only lights and pump are ruled
+ * - Commands are sequenced like lib/relayCommands.js: kept until relay:ack
+ *   covers them and resent on register, on a gap ack or after SIM_COMMAND_RETRY_US
+ * - Every frame crosses a link with base plus scripted latency; wifi, server,
+ *   blackhole and reset faults act on the session as described in fault_script.h
+ * - Decodes sensor:block backfills (SensorBlockDecoder) and counts their readings
+ * - Asks for the last 24 h of the flash history (sensor:history, 1 h steps) after
+ *   every authentication and checks the buckets against the reported totals
+ * - Answers time:sync with the true clock (SIM_EPOCH_MS based) and checks the
+ *   acquisition timestamps on sensor:data against it
+ * - Records availability, freshness and latency into sim->stats
+ */
+class SimulatedBackend : public hal::WebSocketPeer {
+public:
+    /**
+     * @param deviceControl Heater and fan run by the firmware's loops (config:set after
+     *        every authentication) instead of by the backend rules
+     */
+    SimulatedBackend(const FaultScript& script, uint32_t baseLatencyMs, bool deviceControl);
+
+    // hal::WebSocketPeer
+    bool open(const char* host, uint16_t port, const char* url) override;
+    bool receive(const char* payload, size_t length) override;
+    bool receiveBinary(const uint8_t* payload, size_t length) override;
+    bool poll(std::string& payload) override;
+    bool isOpen() override;
+    void close() override;
+
+    /**
+     * @brief Advance server-side timers and apply faults up to the current time
+     */
+    void tick();
+
+    /**
+     * @brief Earliest time the backend has something to do (frame due, ping, fault edge)
+     */
+    uint64_t nextEventUs() const;
+
+    /**
+     * @brief Frames that crossed the link in either direction (for idle detection)
+     */
+    uint64_t framesExchanged() const { return _framesExchanged; }
+
+    /**
+     * @brief Close the books at a reboot or at the end of the run
+     */
+    void finish();
+
+private:
+    struct Frame {
+        uint64_t dueUs;
+        std::string text;
+        bool binary;
+    };
+
+    struct Command {
+        uint32_t seq;
+        int relay;
+        bool state;
+    };
+
+    const FaultScript& _script;
+    uint32_t _baseLatencyMs;
+    bool _deviceControl;
+    FaultState _faults;
+    uint64_t _lastTickUs;
+
+    // Client view: the device believes the connection is up
+    bool _clientOpen;
+    // Server view: a Socket.IO session exists
+    bool _serverSession;
+    bool _authenticated;
+    uint64_t _authenticatedAtUs;
+    uint64_t _closeAtUs;        ///< Pending server-initiated close (after auth_failed), 0 = none
+
+    uint64_t _nextPingUs;
+    uint64_t _pongDeadlineUs;   ///< 0 = no ping outstanding
+
+    std::deque<Frame> _toClient;
+    std::deque<Frame> _toServer;
+    uint64_t _framesExchanged;
+
+    // Rule engine
+    float _temperature;
+    float _humidity;
+    float _soil;
+    bool _haveReadings;
+    bool _believed[4];
+    bool _pending[4];
+    bool _pendingState[4];
+    uint64_t _pendingSinceUs[4];
+    std::deque<Command> _unacked;
+    uint32_t _nextSeq;
+    uint64_t _lastCommandUs;    ///< Last send, resend or ack progress
+
+    // sensor:block whose attachment (the next binary frame) is still to come
+    bool _blockPending;
+    uint16_t _blockCount;
+
+    // sensor:history:chunk whose bucket attachment is still to come, and the running answer
+    bool _historyPending;
+    uint16_t _historyBuckets;
+    bool _historyDone;          ///< Final chunk seen (its attachment may still be pending)
+    uint64_t _historyReported;  ///< Readings the final chunk reports
+    uint64_t _historyReadings;  ///< Sum of the bucket counts received
+
+    uint64_t latencyUs() const;
+    void sendToClient(const std::string& text);
+    void emit(const char* event, const char* json);
+    bool queueToServer(const char* payload, size_t length, bool binary);
+    void handleClientText(const std::string& text);
+    void handleSensorBlock(const std::string& block);
+    void requestHistory();
+    void enableDeviceControl();
+    void handleHistoryChunk(const char* json, bool attachment);
+    void handleHistoryBuckets(const std::string& buckets);
+    void finishHistory();
+    void handleRegister(const char* json);
+    void markRecovered();
+    void handleSensorData(const char* json);
+    void handleRelayState(const char* json);
+    void handleRelayAck(const char* json);
+    void confirmRelay(int relay, bool state);
+    void handleAnomaly(const char* json);
+    void handleLinkRecovery(const char* json);
+    void handleTimeSync(const char* json);
+
+    /// Backend wall clock: true time, epoch milliseconds
+    static uint64_t serverTimeMs() { return simTrueTimeUs(simNowUs()) / 1000ULL; }
+    void runRules();
+    void sendCommand(int relay, bool state);
+    void emitCommand(const Command& command);
+    void resendUnacked();
+    void endSession(bool notifyClient);
+};
+
+#endif // BACKEND_PEER_H
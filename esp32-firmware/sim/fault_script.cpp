@@ -0,0 +1,174 @@
+// Fault script parsing and evaluation
+
+#include "fault_script.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+FaultScript::FaultScript() : _count(0) {}
+
+const char* FaultScript::kindName(FaultKind kind) {
+    switch (kind) {
+        case FAULT_WIFI: return "wifi";
+        case FAULT_SERVER: return "server";
+        case FAULT_AUTH: return "auth";
+        case FAULT_BLACKHOLE: return "blackhole";
+        case FAULT_LATENCY: return "latency";
+        case FAULT_RESET: return "reset";
+    }
+    return "?";
+}
+
+bool FaultScript::parseDuration(const char* text, uint64_t& us) {
+    us = 0;
+    const char* p = text;
+    if (!*p) {
+        return false;
+    }
+    while (*p) {
+        if (!isdigit((unsigned char)*p)) {
+            return false;
+        }
+        char* end = nullptr;
+        double value = strtod(p, &end);
+        uint64_t unitUs;
+        if (strncmp(end, "ms", 2) == 0) {
+            unitUs = 1000ULL;
+            end += 2;
+        } else if (*end == 's') {
+            unitUs = 1000000ULL;
+            end++;
+        } else if (*end == 'm') {
+            unitUs = 60ULL * 1000000ULL;
+            end++;
+        } else if (*end == 'h') {
+            unitUs = 3600ULL * 1000000ULL;
+            end++;
+        } else if (*end == 'd') {
+            unitUs = 86400ULL * 1000000ULL;
+            end++;
+        } else {
+            return false;
+        }
+        us += (uint64_t)(value * unitUs);
+        p = end;
+    }
+    return true;
+}
+
+bool FaultScript::parseLine(const char* line, int lineNumber) {
+    char buffer[256];
+    strncpy(buffer, line, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    char* comment = strchr(buffer, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+
+    char* fields[4] = {nullptr, nullptr, nullptr, nullptr};
+    int fieldCount = 0;
+    for (char* token = strtok(buffer, " \t\r\n"); token && fieldCount < 4; token = strtok(nullptr, " \t\r\n")) {
+        fields[fieldCount++] = token;
+    }
+    if (fieldCount == 0) {
+        return true;
+    }
+    if (fieldCount < 3) {
+        fprintf(stderr, "fault script line %d: expected <start> <duration> <kind> [argument]\n", lineNumber);
+        return false;
+    }
+    if (_count >= SIM_MAX_FAULTS) {
+        fprintf(stderr, "fault script line %d: more than %d faults\n", lineNumber, SIM_MAX_FAULTS);
+        return false;
+    }
+
+    Fault fault;
+    uint64_t durationUs;
+    if (!parseDuration(fields[0], fault.startUs) || !parseDuration(fields[1], durationUs)) {
+        fprintf(stderr, "fault script line %d: bad time '%s %s'\n", lineNumber, fields[0], fields[1]);
+        return false;
+    }
+    fault.endUs = fault.startUs + durationUs;
+    fault.argument = fields[3] ? (uint32_t)strtoul(fields[3], nullptr, 10) : 0;
+
+    static const FaultKind kinds[] = {FAULT_WIFI, FAULT_SERVER, FAULT_AUTH, FAULT_BLACKHOLE, FAULT_LATENCY, FAULT_RESET};
+    bool known = false;
+    for (FaultKind kind : kinds) {
+        if (strcmp(fields[2], kindName(kind)) == 0) {
+            fault.kind = kind;
+            known = true;
+        }
+    }
+    if (!known) {
+        fprintf(stderr, "fault script line %d: unknown fault '%s'\n", lineNumber, fields[2]);
+        return false;
+    }
+    if (fault.kind == FAULT_LATENCY && !fields[3]) {
+        fprintf(stderr, "fault script line %d: latency needs a value in ms\n", lineNumber);
+        return false;
+    }
+    if (fault.kind == FAULT_RESET) {
+        fault.endUs = fault.startUs;  // Instantaneous; recovery is timed from the drop
+    }
+
+    _faults[_count++] = fault;
+    return true;
+}
+
+bool FaultScript::load(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open fault script %s\n", path);
+        return false;
+    }
+    char line[256];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        ok = parseLine(line, ++lineNumber);
+    }
+    fclose(file);
+    return ok;
+}
+
+FaultState FaultScript::stateAt(uint64_t nowUs) const {
+    FaultState state = {false, false, false, false, 0};
+    for (size_t i = 0; i < _count; i++) {
+        const Fault& fault = _faults[i];
+        if (nowUs < fault.startUs || nowUs >= fault.endUs) {
+            continue;
+        }
+        switch (fault.kind) {
+            case FAULT_WIFI: state.wifiDown = true; break;
+            case FAULT_SERVER: state.serverDown = true; break;
+            case FAULT_AUTH: state.authReject = true; break;
+            case FAULT_BLACKHOLE: state.blackhole = true; break;
+            case FAULT_LATENCY: state.extraLatencyMs += fault.argument; break;
+            case FAULT_RESET: break;
+        }
+    }
+    return state;
+}
+
+uint64_t FaultScript::nextBoundary(uint64_t nowUs) const {
+    uint64_t next = UINT64_MAX;
+    for (size_t i = 0; i < _count; i++) {
+        if (_faults[i].startUs > nowUs && _faults[i].startUs < next) {
+            next = _faults[i].startUs;
+        }
+        if (_faults[i].endUs > nowUs && _faults[i].endUs < next) {
+            next = _faults[i].endUs;
+        }
+    }
+    return next;
+}
+
+int FaultScript::resetBetween(uint64_t fromUs, uint64_t toUs) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (_faults[i].kind == FAULT_RESET && _faults[i].startUs > fromUs && _faults[i].startUs <= toUs) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,96 @@
+// Scripted network faults for the simulator.
+//
+// Script format: one fault per line, '#' starts a comment.
+//
+//     <start> <duration> <kind> [argument]
+//
+// Times are a number with a unit (ms, s, m, h, d) and units can be chained:
+// "1d6h", "90s", "2h30m". Kinds:
+//
+//     wifi       Association lost: WiFi reports disconnected, sessions drop
+//     server     Backend down: sessions drop, connection attempts are refused
+//     auth       Backend rejects device:register (auth_failed + disconnect)
+//     blackhole  Half-open link: nothing is delivered either way and the device
+//                is not told; the server times the session out on missing pongs
+//     latency    Adds <argument> ms of one-way delay to every frame
+//     reset      Drops the current session once at <start> (duration ignored)
+#ifndef FAULT_SCRIPT_H
+#define FAULT_SCRIPT_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "sim_state.h"
+
+enum FaultKind {
+    FAULT_WIFI,
+    FAULT_SERVER,
+    FAULT_AUTH,
+    FAULT_BLACKHOLE,
+    FAULT_LATENCY,
+    FAULT_RESET
+};
+
+struct Fault {
+    uint64_t startUs;
+    uint64_t endUs;
+    FaultKind kind;
+    uint32_t argument;
+};
+
+/**
+ * @struct FaultState
+ * @brief Combined effect of every fault active at one instant
+ */
+struct FaultState {
+    bool wifiDown;
+    bool serverDown;
+    bool authReject;
+    bool blackhole;
+    uint32_t extraLatencyMs;
+};
+
+class FaultScript {
+public:
+    FaultScript();
+
+    /**
+     * @brief Parse a script file
+     * @return false (with a message on stderr) on a syntax error
+     */
+    bool load(const char* path);
+
+    /**
+     * @brief Parse one script line (exposed for the built-in default scenario)
+     */
+    bool parseLine(const char* line, int lineNumber);
+
+    FaultState stateAt(uint64_t nowUs) const;
+
+    /**
+     * @brief Earliest fault start or end strictly after nowUs (UINT64_MAX if none)
+     */
+    uint64_t nextBoundary(uint64_t nowUs) const;
+
+    /**
+     * @brief Index of a reset fault that starts in (fromUs, toUs], or -1
+     */
+    int resetBetween(uint64_t fromUs, uint64_t toUs) const;
+
+    size_t count() const { return _count; }
+    const Fault& fault(size_t index) const { return _faults[index]; }
+
+    static const char* kindName(FaultKind kind);
+
+    /**
+     * @brief Parse "1d6h30m" style durations
+     * @return false if the text is not a valid duration
+     */
+    static bool parseDuration(const char* text, uint64_t& us);
+
+private:
+    Fault _faults[SIM_MAX_FAULTS];
+    size_t _count;
+};
+
+#endif // FAULT_SCRIPT_H
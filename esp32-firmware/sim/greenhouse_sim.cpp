@@ -0,0 +1,450 @@
+// Discrete-event simulator: runs the real firmware setup()/loop() on a virtual clock
+// against a simulated backend, a greenhouse plant model and scripted network faults.
+//
+//   pio run -e native-sim
+//   .pio/build/native-sim/program --days 30 --script sim/scenarios/default.txt
+//   .pio/build/native-sim/program --days 30 --control device
+//
+// --control device runs the heater and fan from the firmware's PID loops
+// (climate_control.h) instead of the backend's hysteresis rules; compare the
+// "climate" and "relay cycles" lines of the two runs to check a tuning.
+//
+// Each boot runs in a fork()ed child, so an ESP.restart() starts the firmware with
+// fresh globals just like a reset; time, plant and statistics live in shared memory.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <hal_native.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "backend_peer.h"
+#include "fault_script.h"
+#include "link_recovery.h"
+#include "plant_model.h"
+#include "pins.h"
+#include "sim_state.h"
+
+#if LOG_DRAIN_TASK
+#error "The simulator drives a virtual clock from one thread: build with -D LOG_DRAIN_TASK=0"
+#endif
+
+void setup();
+void loop();
+
+SimShared* sim = nullptr;
+
+namespace {
+
+const int EXIT_REBOOT = 75;
+const uint64_t BOOT_TIME_US = 1500000ULL;  // ROM bootloader + app start before setup()
+
+// Station join timing: full scan of all channels, association, DHCP
+const uint32_t WIFI_SCAN_MS = 2200;
+const uint32_t WIFI_ASSOCIATE_MS = 120;
+const uint32_t WIFI_DHCP_MS = 600;
+
+// NVS and data-partition contents shared by every boot of one run (RTC memory does not survive the fork)
+char nvsPath[] = "/tmp/greenhouse-sim-nvs-XXXXXX";
+char flashPath[] = "/tmp/greenhouse-sim-flash-XXXXXX";
+
+// A few hours of ordinary trouble; replaced by --script
+const char* const DEFAULT_SCENARIO[] = {
+    "2h      0s    reset",
+    "6h      5m    server",
+    "12h     2m    wifi",
+    "20h     90s   blackhole",
+    "1d2h    0s    reset",
+    "1d2h    10m   auth",
+    "1d8h    1h    latency 800",
+};
+
+struct Options {
+    double days = 30.0;
+    const char* scriptPath = nullptr;
+    const char* logPath = "/dev/null";
+    uint32_t latencyMs = 40;
+    uint32_t idleSkipMs = 250;
+    uint32_t millisStart = 0xFFFFFFFFUL - 10UL * 60UL * 1000UL;  // Every boot crosses the millis() wrap
+    uint32_t seed = 1;
+    bool deviceControl = false;
+};
+
+Options options;
+
+// Virtual clock value at the start of this boot and the simulated time it maps to
+uint64_t bootClockUs = 0;
+uint64_t bootSimUs = 0;
+
+const uint8_t RELAY_PINS[4] = {RELAY_LUCES_PIN, RELAY_VENTILADOR_PIN, RELAY_BOMBA_PIN, RELAY_CALEFACTOR_PIN};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--days N] [--script FILE] [--log FILE] [--latency-ms N]\n"
+            "          [--idle-skip-ms N] [--millis-start N] [--seed N] [--control backend|device]\n",
+            argv0);
+}
+
+bool parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (strcmp(arg, "--days") == 0) {
+            options.days = atof(value);
+        } else if (strcmp(arg, "--script") == 0) {
+            options.scriptPath = value;
+        } else if (strcmp(arg, "--log") == 0) {
+            options.logPath = value;
+        } else if (strcmp(arg, "--latency-ms") == 0) {
+            options.latencyMs = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--idle-skip-ms") == 0) {
+            options.idleSkipMs = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--millis-start") == 0) {
+            options.millisStart = (uint32_t)strtoul(value, nullptr, 0);
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = (uint32_t)strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--control") == 0) {
+            if (strcmp(value, "device") != 0 && strcmp(value, "backend") != 0) {
+                return false;
+            }
+            options.deviceControl = strcmp(value, "device") == 0;
+        } else {
+            return false;
+        }
+        i++;
+    }
+    return options.days > 0;
+}
+
+void readRelays(bool relays[4]) {
+    for (int i = 0; i < 4; i++) {
+        relays[i] = hal::pinLevel(RELAY_PINS[i]) == HIGH;  // Active HIGH (RelayManager::begin)
+    }
+}
+
+void stepPlant(uint64_t nowUs, const bool relays[4]) {
+    PlantState& plant = sim->plant;
+    SimStats& stats = sim->stats;
+    uint64_t dt = nowUs - plant.lastStepUs;
+    for (int i = 0; i < 4; i++) {
+        if (plant.relays[i]) {
+            stats.relayOnUs[i] += dt;
+        }
+        if (relays[i] && !plant.relays[i]) {
+            stats.relayCycles[i]++;
+        }
+    }
+    if (plant.temperature < SIM_TEMP_BAND_LOW || plant.temperature > SIM_TEMP_BAND_HIGH) {
+        stats.tempOutOfBandUs += dt;
+    }
+    if (plant.temperature < SIM_HEAT_TARGET) {
+        stats.underHeatTargetCs += (SIM_HEAT_TARGET - plant.temperature) * (dt / 1e6);
+    } else if (plant.temperature > SIM_COOL_TARGET) {
+        stats.overCoolTargetCs += (plant.temperature - SIM_COOL_TARGET) * (dt / 1e6);
+    }
+    PlantModel::step(plant, nowUs, relays);
+    stats.tempMin = fminf(stats.tempMin, plant.temperature);
+    stats.tempMax = fmaxf(stats.tempMax, plant.temperature);
+    stats.soilMin = fminf(stats.soilMin, plant.soil);
+}
+
+/**
+ * @brief One firmware boot; runs in the child process and never returns
+ */
+[[noreturn]] void runBoot(const FaultScript& script) {
+    int logFd = open(options.logPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (logFd >= 0) {
+        dup2(logFd, STDOUT_FILENO);
+        close(logFd);
+    }
+
+    bootSimUs = sim->nowUs;
+    bootClockUs = (uint64_t)options.millisStart * 1000ULL;
+    hal::useVirtualClock(bootClockUs);
+    randomSeed(options.seed * 7919UL + sim->stats.boots);
+
+    std::mt19937 noise(options.seed + sim->stats.boots);
+    std::normal_distribution<float> sensorNoise(0.0f, 0.15f);
+    hal::setDhtProvider([&]() { return sim->plant.temperature + sensorNoise(noise); },
+                        [&]() { return sim->plant.humidity + sensorNoise(noise); });
+
+    SimulatedBackend backend(script, options.latencyMs, options.deviceControl);
+    hal::setWebSocketPeer(&backend);
+    hal::setRestartHandler([&]() {
+        backend.finish();
+        sim->nowUs = simNowUs();
+        fflush(stdout);
+        _exit(EXIT_REBOOT);
+    });
+
+    hal::setWifiLinkProvider([&]() { return !script.stateAt(simNowUs()).wifiDown; });
+    hal::setWifiTiming(WIFI_SCAN_MS, WIFI_ASSOCIATE_MS, WIFI_DHCP_MS);
+    hal::setWallClock(simTrueTimeUs(bootSimUs), SIM_CLOCK_DRIFT_PPM, SIM_SNTP_DELAY_MS);
+    hal::setNvsPath(nvsPath);
+    hal::setFlashPath(flashPath);
+
+    // The soil probe follows the plant between loop iterations
+    auto syncInputs = [&]() {
+        hal::setAnalog(SOIL_MOISTURE_1_PIN, PlantModel::soilToAdc(sim->plant.soil));
+    };
+
+    syncInputs();
+    setup();
+
+    bool relays[4];
+    while (simNowUs() < sim->endUs) {
+        uint64_t now = simNowUs();
+        readRelays(relays);
+        stepPlant(now, relays);
+        syncInputs();
+        backend.tick();
+
+        uint64_t framesBefore = backend.framesExchanged();
+        loop();
+        sim->nowUs = simNowUs();
+
+        // Discrete-event step: if nothing crossed the link, jump ahead to the next
+        // backend event (at most idle-skip). Firmware timers fire up to that late.
+        if (backend.framesExchanged() == framesBefore) {
+            uint64_t afterLoop = simNowUs();
+            uint64_t skipUs = (uint64_t)options.idleSkipMs * 1000ULL;
+            uint64_t next = backend.nextEventUs();
+            if (next > afterLoop && next - afterLoop < skipUs) {
+                skipUs = next - afterLoop;
+            } else if (next <= afterLoop) {
+                skipUs = 0;
+            }
+            hal::advanceClock(skipUs);
+        }
+    }
+
+    readRelays(relays);
+    stepPlant(simNowUs(), relays);
+    backend.finish();
+    sim->nowUs = simNowUs();
+    fflush(stdout);
+    _exit(0);
+}
+
+uint32_t latencyPercentile(double p) {
+    const SimStats& stats = sim->stats;
+    uint64_t target = (uint64_t)(p * stats.commandsAcked);
+    uint64_t seen = 0;
+    for (uint32_t ms = 0; ms <= SIM_LATENCY_BUCKETS; ms++) {
+        seen += stats.commandLatencyMs[ms];
+        if (seen > target) {
+            return ms;
+        }
+    }
+    return SIM_LATENCY_BUCKETS;
+}
+
+void formatDuration(uint64_t us, char* out, size_t size) {
+    double s = us / 1e6;
+    if (s < 120) {
+        snprintf(out, size, "%.1f s", s);
+    } else if (s < 7200) {
+        snprintf(out, size, "%.1f min", s / 60);
+    } else {
+        snprintf(out, size, "%.1f h", s / 3600);
+    }
+}
+
+void report(const FaultScript& script, double wallSeconds) {
+    const SimStats& stats = sim->stats;
+    double total = (double)sim->endUs;
+    char a[32];
+    char b[32];
+
+    printf("\n=== Greenhouse simulation: %.1f days in %.1f s (%.0fx) ===\n", total / 86400e6, wallSeconds,
+           wallSeconds > 0 ? total / 1e6 / wallSeconds : 0.0);
+    formatDuration(stats.bootDowntimeUs, a, sizeof(a));
+    printf("boots              %u (%u reboots, %s in reset)\n", stats.boots, stats.boots - 1, a);
+    printf("connections        %llu accepted, %llu refused, %llu ping timeouts\n",
+           (unsigned long long)stats.connections, (unsigned long long)stats.refusedConnects,
+           (unsigned long long)stats.pingTimeouts);
+    printf("authentication     %llu ok, %llu rejected\n", (unsigned long long)stats.authSuccesses,
+           (unsigned long long)stats.authFailures);
+    printf("availability       %.3f%% authenticated, %.3f%% fresh sensor data (<= %llu s old)\n",
+           100.0 * stats.authenticatedUs / total, 100.0 * (1.0 - stats.staleUs / total),
+           (unsigned long long)(SIM_STALE_THRESHOLD_US / 1000000ULL));
+    formatDuration(stats.maxSensorGapUs, a, sizeof(a));
+    printf("sensor frames      %llu, longest gap %s\n", (unsigned long long)stats.sensorFrames, a);
+    if (stats.stampedFrames > 0) {
+        printf("timestamps         %llu of %llu stamped, arrival lag ms min %lld max %lld, %llu out of order\n",
+               (unsigned long long)stats.stampedFrames, (unsigned long long)stats.sensorFrames,
+               (long long)stats.stampLagMinMs, (long long)stats.stampLagMaxMs,
+               (unsigned long long)stats.stampOutOfOrder);
+    }
+    printf("backfill           %llu blocks, %llu readings in %llu bytes (%.1f B/reading), %llu corrupt\n",
+           (unsigned long long)stats.backfillBlocks, (unsigned long long)stats.backfillReadings,
+           (unsigned long long)stats.backfillBytes,
+           stats.backfillReadings ? (double)stats.backfillBytes / stats.backfillReadings : 0.0,
+           (unsigned long long)stats.backfillCorrupt);
+    printf("history queries    %llu sent, %llu answered in %llu chunks, %llu buckets of %llu readings, %llu mismatched\n",
+           (unsigned long long)stats.historyQueries, (unsigned long long)stats.historyAnswered,
+           (unsigned long long)stats.historyChunks, (unsigned long long)stats.historyBuckets,
+           (unsigned long long)stats.historyReadings, (unsigned long long)stats.historyMismatched);
+    printf("relay commands     %llu sent, %llu acknowledged, %llu resent\n", (unsigned long long)stats.commandsSent,
+           (unsigned long long)stats.commandsAcked, (unsigned long long)stats.commandsResent);
+    if (stats.commandsAcked > 0) {
+        printf("command latency ms mean %.0f  p50 %u  p90 %u  p99 %u  max %.0f\n",
+               stats.commandLatencySumUs / 1000.0 / stats.commandsAcked, latencyPercentile(0.50),
+               latencyPercentile(0.90), latencyPercentile(0.99), stats.commandLatencyMaxUs / 1000.0);
+    }
+    printf("plant              temperature %.1f..%.1f C (%.2f%% outside %.0f..%.0f), soil min %.0f%%\n",
+           stats.tempMin, stats.tempMax, 100.0 * stats.tempOutOfBandUs / total, SIM_TEMP_BAND_LOW,
+           SIM_TEMP_BAND_HIGH, stats.soilMin);
+    printf("sensor anomalies   %llu spike, %llu drift up, %llu drift down, %llu stuck\n",
+           (unsigned long long)stats.anomalies[0], (unsigned long long)stats.anomalies[1],
+           (unsigned long long)stats.anomalies[2], (unsigned long long)stats.anomalies[3]);
+    // Recoveries the ladder ended, with the mean time from the rung's action to authenticated
+    printf("link recovery      ");
+    for (int r = RECOVERY_RUNG_SOCKET; r < RECOVERY_RUNG_COUNT; r++) {
+        printf("%s%s %llu", r == RECOVERY_RUNG_SOCKET ? "" : "  ", LinkRecovery::rungName((RecoveryRung)r),
+               (unsigned long long)stats.linkRecoveries[r]);
+        if (stats.linkRecoveries[r] > 0) {
+            printf(" (%.1f s)", stats.linkRecoveryMs[r] / 1000.0 / stats.linkRecoveries[r]);
+        }
+    }
+    printf("\n");
+    printf("climate            %s control: %.2f C·h/day below %.1f C, %.2f C·h/day above %.1f C\n",
+           options.deviceControl ? "device" : "backend", stats.underHeatTargetCs / 3600.0 / (total / 86400e6),
+           SIM_HEAT_TARGET, stats.overCoolTargetCs / 3600.0 / (total / 86400e6), SIM_COOL_TARGET);
+    printf("relay duty         lights %.0f%%  fan %.0f%%  pump %.1f%%  heater %.0f%%\n",
+           100.0 * stats.relayOnUs[SIM_RELAY_LIGHTS] / total, 100.0 * stats.relayOnUs[SIM_RELAY_FAN] / total,
+           100.0 * stats.relayOnUs[SIM_RELAY_PUMP] / total, 100.0 * stats.relayOnUs[SIM_RELAY_HEATER] / total);
+    printf("relay cycles/day   lights %.1f  fan %.1f  pump %.1f  heater %.1f\n",
+           stats.relayCycles[SIM_RELAY_LIGHTS] / (total / 86400e6), stats.relayCycles[SIM_RELAY_FAN] / (total / 86400e6),
+           stats.relayCycles[SIM_RELAY_PUMP] / (total / 86400e6), stats.relayCycles[SIM_RELAY_HEATER] / (total / 86400e6));
+
+    if (script.count() > 0) {
+        printf("\nfault              window                    recovered after end\n");
+    }
+    for (size_t i = 0; i < script.count(); i++) {
+        const Fault& fault = script.fault(i);
+        formatDuration(fault.startUs, a, sizeof(a));
+        formatDuration(fault.endUs - fault.startUs, b, sizeof(b));
+        char recovered[32] = "not recovered";
+        if (fault.startUs >= sim->endUs) {
+            snprintf(recovered, sizeof(recovered), "after end of run");
+        } else if (stats.recoveredAtUs[i] != 0) {
+            formatDuration(stats.recoveredAtUs[i] - fault.endUs, recovered, sizeof(recovered));
+        }
+        printf("%-9s %-6u   at %-10s for %-10s %s\n", FaultScript::kindName(fault.kind), fault.argument, a, b,
+               recovered);
+    }
+}
+
+}  // namespace
+
+uint64_t simNowUs() {
+    return bootSimUs + (hal::clockUs() - bootClockUs);
+}
+
+int main(int argc, char** argv) {
+    if (!parseOptions(argc, argv)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FaultScript script;
+    if (options.scriptPath) {
+        if (!script.load(options.scriptPath)) {
+            return 2;
+        }
+    } else {
+        int line = 0;
+        for (const char* text : DEFAULT_SCENARIO) {
+            script.parseLine(text, ++line);
+        }
+    }
+
+    sim = static_cast<SimShared*>(
+        mmap(nullptr, sizeof(SimShared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (sim == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    memset(sim, 0, sizeof(SimShared));
+    sim->endUs = (uint64_t)(options.days * 86400e6);
+    PlantModel::reset(sim->plant, 0);
+    sim->stats.tempMin = sim->stats.tempMax = sim->plant.temperature;
+    sim->stats.soilMin = sim->plant.soil;
+
+    // Every boot appends to the firmware log; start it empty
+    int logFd = open(options.logPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (logFd >= 0) {
+        close(logFd);
+    }
+
+    int nvsFd = mkstemp(nvsPath);
+    if (nvsFd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(nvsFd);
+    int flashFd = mkstemp(flashPath);
+    if (flashFd < 0) {
+        perror("mkstemp");
+        unlink(nvsPath);
+        return 1;
+    }
+    close(flashFd);
+
+    uint64_t wallStart = hal::clockUs();
+    fflush(stdout);
+    while (sim->nowUs < sim->endUs) {
+        sim->stats.boots++;
+        pid_t child = fork();
+        if (child < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (child == 0) {
+            runBoot(script);
+        }
+
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0 && WEXITSTATUS(status) != EXIT_REBOOT)) {
+            fprintf(stderr, "firmware process died at %.3f h (status 0x%x)\n", sim->nowUs / 3.6e9, status);
+            unlink(nvsPath);
+            unlink(flashPath);
+            return 1;
+        }
+        if (WEXITSTATUS(status) == EXIT_REBOOT) {
+            // Relays drop out while the chip resets
+            bool off[4] = {false, false, false, false};
+            uint64_t resumeUs = sim->nowUs + BOOT_TIME_US;
+            stepPlant(resumeUs, off);
+            sim->stats.bootDowntimeUs += BOOT_TIME_US;
+            sim->nowUs = resumeUs;
+        }
+    }
+
+    // Sensor data still stale at the end of the run
+    uint64_t gap = sim->endUs - sim->stats.lastSensorUs;
+    if (gap > SIM_STALE_THRESHOLD_US) {
+        sim->stats.staleUs += gap - SIM_STALE_THRESHOLD_US;
+    }
+    if (gap > sim->stats.maxSensorGapUs) {
+        sim->stats.maxSensorGapUs = gap;
+    }
+
+    unlink(nvsPath);
+    unlink(flashPath);
+    report(script, (hal::clockUs() - wallStart) / 1e6);
+    return 0;
+}
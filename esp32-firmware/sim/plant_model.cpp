@@ -0,0 +1,106 @@
+// Greenhouse plant model
+
+#include "plant_model.h"
+
+#include <cmath>
+
+namespace {
+
+const float PI_F = 3.14159265f;
+
+// Rates per second
+const float EXCHANGE_RATE = 1.0f / 3600.0f;       // Passive air exchange (1/h)
+const float FAN_EXCHANGE_FACTOR = 4.0f;           // Extra exchange while the fan runs
+const float HEATER_GAIN = 0.004f;                 // °C/s (~14 °C/h into a closed house)
+const float LIGHTS_GAIN = 0.0008f;                // °C/s
+const float SOLAR_GAIN = 0.002f;                  // °C/s at solar noon
+const float TRANSPIRATION = 0.0015f;              // %RH/s under full light
+const float PUMP_HUMIDITY = 0.005f;               // %RH/s while irrigating
+const float SOIL_DRY_BASE = 0.3f / 3600.0f;       // %/s at night
+const float SOIL_DRY_SOLAR = 0.9f / 3600.0f;      // Extra %/s at solar noon
+const float SOIL_DRY_HEAT = 0.03f / 3600.0f;      // Extra %/s per °C above 20
+const float PUMP_SOIL = 0.05f;                    // %/s while irrigating (3 %/min)
+
+// Must match SensorManager::convertSoilMoistureToPercentage()
+const float SOIL_ADC_DRY = 4095.0f;
+const float SOIL_ADC_WET = 1500.0f;
+
+float clampf(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+float dayPhase(uint64_t nowUs) {
+    // Peak of outside temperature at 15:00
+    return 2.0f * PI_F * (PlantModel::hourOfDay(nowUs) - 9.0f) / 24.0f;
+}
+
+}  // namespace
+
+float PlantModel::hourOfDay(uint64_t nowUs) {
+    double hours = nowUs / 3.6e9 + START_HOUR;
+    return (float)std::fmod(hours, 24.0);
+}
+
+float PlantModel::outsideTemperature(uint64_t nowUs) {
+    return 14.0f + 8.0f * std::sin(dayPhase(nowUs));
+}
+
+float PlantModel::outsideHumidity(uint64_t nowUs) {
+    return 70.0f - 20.0f * std::sin(dayPhase(nowUs));
+}
+
+float PlantModel::solar(uint64_t nowUs) {
+    float hour = hourOfDay(nowUs);
+    if (hour < 6.0f || hour > 18.0f) {
+        return 0.0f;
+    }
+    return std::sin(PI_F * (hour - 6.0f) / 12.0f);
+}
+
+uint16_t PlantModel::soilToAdc(float percent) {
+    return (uint16_t)(SOIL_ADC_DRY - clampf(percent, 0.0f, 100.0f) / 100.0f * (SOIL_ADC_DRY - SOIL_ADC_WET));
+}
+
+void PlantModel::reset(PlantState& state, uint64_t nowUs) {
+    state.temperature = outsideTemperature(nowUs);
+    state.humidity = outsideHumidity(nowUs);
+    state.soil = 55.0f;
+    for (int i = 0; i < 4; i++) {
+        state.relays[i] = false;
+    }
+    state.lastStepUs = nowUs;
+}
+
+void PlantModel::step(PlantState& state, uint64_t nowUs, const bool relays[4]) {
+    for (int i = 0; i < 4; i++) {
+        state.relays[i] = relays[i];
+    }
+    while (state.lastStepUs < nowUs) {
+        uint64_t remainingUs = nowUs - state.lastStepUs;
+        float dt = remainingUs > (uint64_t)(MAX_STEP_S * 1e6f) ? MAX_STEP_S : remainingUs / 1e6f;
+        uint64_t t = state.lastStepUs;
+
+        float sun = solar(t);
+        float exchange = EXCHANGE_RATE * (1.0f + (relays[SIM_RELAY_FAN] ? FAN_EXCHANGE_FACTOR : 0.0f));
+        float light = relays[SIM_RELAY_LIGHTS] ? 1.0f : sun;
+
+        float dTemp = exchange * (outsideTemperature(t) - state.temperature)
+                    + (relays[SIM_RELAY_HEATER] ? HEATER_GAIN : 0.0f)
+                    + (relays[SIM_RELAY_LIGHTS] ? LIGHTS_GAIN : 0.0f)
+                    + SOLAR_GAIN * sun;
+        float dHum = exchange * (outsideHumidity(t) - state.humidity)
+                   + TRANSPIRATION * light * (state.soil / 100.0f)
+                   + (relays[SIM_RELAY_PUMP] ? PUMP_HUMIDITY : 0.0f);
+        float dSoil = -(SOIL_DRY_BASE + SOIL_DRY_SOLAR * light
+                        + SOIL_DRY_HEAT * std::fmax(0.0f, state.temperature - 20.0f))
+                    + (relays[SIM_RELAY_PUMP] ? PUMP_SOIL : 0.0f);
+
+        state.temperature += dTemp * dt;
+        state.humidity = clampf(state.humidity + dHum * dt, 5.0f, 99.0f);
+        state.soil = clampf(state.soil + dSoil * dt, 0.0f, 100.0f);
+        state.lastStepUs += (uint64_t)(dt * 1e6f);
+        if (dt < MAX_STEP_S) {
+            state.lastStepUs = nowUs;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+// Lumped greenhouse plant: air temperature, relative humidity and soil moisture
+// driven by the weather and by the four relays (lights, fan, pump, heater).
+#ifndef PLANT_MODEL_H
+#define PLANT_MODEL_H
+
+#include <cstdint>
+
+#define SIM_TEMP_BAND_LOW           15.0f   // Comfort band used for the out-of-band statistic (°C)
+#define SIM_TEMP_BAND_HIGH          30.0f
+#define SIM_HEAT_TARGET             17.5f   // Heating target: midpoint of the rules' 16/19 °C pair, heater_setpoint on the device
+#define SIM_COOL_TARGET             26.5f   // Cooling target: midpoint of the rules' 25/28 °C pair, fan_setpoint on the device
+
+enum SimRelay {
+    SIM_RELAY_LIGHTS = 0,
+    SIM_RELAY_FAN = 1,
+    SIM_RELAY_PUMP = 2,
+    SIM_RELAY_HEATER = 3
+};
+
+/**
+ * @struct PlantState
+ * @brief Plant state; POD so it can live in shared memory across reboots
+ */
+struct PlantState {
+    float temperature;      ///< Air temperature (°C)
+    float humidity;         ///< Relative humidity (%)
+    float soil;             ///< Soil moisture (%)
+    bool relays[4];         ///< Actuator state during the last step
+    uint64_t lastStepUs;    ///< Simulated time of the last step
+};
+
+/**
+ * @class PlantModel
+ * @brief First-order thermal and moisture model
+ *
+ * Key Features:
+ * - Diurnal outside temperature/humidity and solar gain (sinusoids, fixed day length)
+ * - Air exchange with outside; the fan multiplies the exchange rate
+ * - Heater and lights add heat; transpiration and the pump add humidity
+ * - Soil dries with evapotranspiration and is refilled by the pump
+ *
+ * Integration is explicit Euler with sub-steps of at most MAX_STEP_S, which is
+ * stable because every time constant is minutes to hours.
+ */
+class PlantModel {
+public:
+    static void reset(PlantState& state, uint64_t nowUs);
+
+    /**
+     * @brief Advance the plant to nowUs with the given relay states
+     */
+    static void step(PlantState& state, uint64_t nowUs, const bool relays[4]);
+
+    /// Outside conditions at a simulated time
+    static float outsideTemperature(uint64_t nowUs);
+    static float outsideHumidity(uint64_t nowUs);
+    static float solar(uint64_t nowUs);
+
+    /// Hour of the simulated day (0..24); the run starts at START_HOUR
+    static float hourOfDay(uint64_t nowUs);
+
+    /// ADC counts the firmware's soil conversion maps back to the given percentage
+    static uint16_t soilToAdc(float percent);
+
+    static constexpr float START_HOUR = 6.0f;
+    static constexpr float MAX_STEP_S = 10.0f;
+};
+
+#endif // PLANT_MODEL_H
@@ -0,0 +1,116 @@
+// Simulation state shared between the supervisor process and the per-boot firmware process.
+//
+// Every firmware boot runs in a fresh fork()ed child so globals start clean, exactly
+// like a reset on hardware. Everything that must survive a reboot (simulated time,
+// the plant and the statistics) lives in this POD block in MAP_SHARED memory.
+#ifndef SIM_STATE_H
+#define SIM_STATE_H
+
+#include <cstdint>
+
+#include "plant_model.h"
+
+#define SIM_MAX_FAULTS              64
+#define SIM_LATENCY_BUCKETS         65536   // 1 ms buckets for relay command round trips
+#define SIM_STALE_THRESHOLD_US      (15ULL * 1000000ULL)  // Sensor data older than this counts as stale
+#define SIM_EPOCH_MS                1767225600000ULL      // True (UTC) time at the start of the run: 2026-01-01
+#define SIM_CLOCK_DRIFT_PPM         20                    // Device crystal error against true time
+#define SIM_SNTP_DELAY_MS           800                   // configTime() to the first SNTP reply
+
+struct SimStats {
+    // Sessions as seen by the simulated backend
+    uint64_t connections;           ///< WebSocket connections accepted
+    uint64_t refusedConnects;       ///< Attempts refused (server down, WiFi down, blackhole)
+    uint64_t authSuccesses;
+    uint64_t authFailures;
+    uint64_t pingTimeouts;          ///< Sessions closed by the server for missing Engine.IO pongs
+    uint64_t authenticatedUs;       ///< Total time with an authenticated session
+
+    // Sensor data freshness at the backend
+    uint64_t sensorFrames;
+    uint64_t lastSensorUs;
+    uint64_t maxSensorGapUs;
+    uint64_t staleUs;               ///< Time the latest reading was older than SIM_STALE_THRESHOLD_US
+
+    // Device acquisition timestamps against the backend clock at arrival
+    uint64_t stampedFrames;         ///< Sensor frames carrying a timestamp
+    int64_t stampLagMinMs;          ///< Arrival minus timestamp; below the link latency = clock error
+    int64_t stampLagMaxMs;
+    uint64_t stampOutOfOrder;       ///< Timestamps not after the previous one (duplicates included)
+    uint64_t lastStampMs;
+
+    // sensor:block uploads of readings the device took while it could not send them
+    uint64_t backfillBlocks;
+    uint64_t backfillReadings;
+    uint64_t backfillBytes;
+    uint64_t backfillCorrupt;       ///< Blocks that did not decode to the announced count
+
+    // sensor:history queries (last 24 h in hours) the backend sends after each authentication
+    uint64_t historyQueries;
+    uint64_t historyAnswered;       ///< Final chunks received
+    uint64_t historyChunks;
+    uint64_t historyBuckets;
+    uint64_t historyReadings;       ///< Sum of the bucket counts
+    uint64_t historyMismatched;     ///< Answers whose bucket counts do not add up to the readings reported
+
+    // Relay command round trips (relay:command -> matching relay:state or covering relay:ack)
+    uint64_t commandsSent;
+    uint64_t commandsAcked;
+    uint64_t commandsResent;        ///< Go-back-N resends of unacked commands (reconnect, gap, timeout)
+    uint64_t commandLatencySumUs;
+    uint64_t commandLatencyMaxUs;
+    uint32_t commandLatencyMs[SIM_LATENCY_BUCKETS + 1];   ///< Last bucket: >= 65.5 s
+
+    // sensor:anomaly events by kind (spike, drift_up, drift_down, stuck); the plant has no faults, so all are false alarms
+    uint64_t anomalies[4];
+
+    // link:recovery reports by rung (RecoveryRung order) and their rung-to-authenticated times
+    uint64_t linkRecoveries[6];
+    uint64_t linkRecoveryMs[6];
+
+    // Device
+    uint32_t boots;
+    uint64_t bootDowntimeUs;        ///< Time spent in simulated resets
+
+    // Recovery: first authentication after the end of each scripted fault
+    uint64_t recoveredAtUs[SIM_MAX_FAULTS];
+
+    // Plant envelope
+    float tempMin;
+    float tempMax;
+    float soilMin;
+    uint64_t tempOutOfBandUs;       ///< Time outside SIM_TEMP_BAND_LOW..SIM_TEMP_BAND_HIGH
+    double underHeatTargetCs;       ///< Integral of SIM_HEAT_TARGET - temperature while below it (°C·s)
+    double overCoolTargetCs;        ///< Integral of temperature - SIM_COOL_TARGET while above it (°C·s)
+    uint64_t relayOnUs[4];
+    uint64_t relayCycles[4];        ///< Off-to-on switches seen by the plant
+};
+
+struct SimShared {
+    uint64_t nowUs;                 ///< Simulated time since the start of the run
+    uint64_t endUs;
+    PlantState plant;
+    SimStats stats;
+};
+
+extern SimShared* sim;
+
+/**
+ * @brief Simulated time since the start of the run, in microseconds
+ *
+ * Unlike millis(), which restarts at every boot and wraps, this is monotonic
+ * over the whole run.
+ */
+uint64_t simNowUs();
+
+/**
+ * @brief True (UTC) time at a simulated instant, in epoch microseconds
+ *
+ * Simulated time is the device's own clock; true time, which SNTP and the
+ * backend report, runs SIM_CLOCK_DRIFT_PPM faster.
+ */
+inline uint64_t simTrueTimeUs(uint64_t simUs) {
+    return SIM_EPOCH_MS * 1000ULL + simUs + simUs / 1000000ULL * SIM_CLOCK_DRIFT_PPM;
+}
+
+#endif // SIM_STATE_H
@@ -0,0 +1,87 @@
+// Loop-task heap allocation counter (ALLOC_COUNTER=1 debug builds)
+
+#include "alloc_counter.h"
+
+#if ALLOC_COUNTER
+
+#include "metrics.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifdef NATIVE_BUILD
+#include <hal_native.h>
+#endif
+
+// Global instance
+AllocCounter allocCounter;
+
+static Counter loopAllocationsMetric("loop_allocations_total", "Heap allocations by the loop task once booted");
+static Counter allocatingIterationsMetric("loop_allocating_iterations_total",
+                                          "Loop iterations that allocated once booted");
+
+#ifndef NATIVE_BUILD
+// Link with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc: every reference to
+// malloc in the image (IDF and Arduino core included) lands here first
+static TaskHandle_t countedTask = nullptr;
+static volatile uint32_t countedAllocations = 0;  // Written by the counted task only
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    if (countedTask && xTaskGetCurrentTaskHandle() == countedTask) {
+        countedAllocations++;
+    }
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if (countedTask && xTaskGetCurrentTaskHandle() == countedTask) {
+        countedAllocations++;
+    }
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    if (countedTask && xTaskGetCurrentTaskHandle() == countedTask) {
+        countedAllocations++;  // A realloc that grows in place still counts: it is heap work
+    }
+    return __real_realloc(ptr, size);
+}
+}
+#endif
+
+AllocCounter::AllocCounter() {
+    _mark = 0;
+    _lastIteration = 0;
+}
+
+void AllocCounter::begin() {
+#ifndef NATIVE_BUILD
+    countedTask = xTaskGetCurrentTaskHandle();
+#endif
+    _mark = total();
+    DEBUG_PRINTLN("[MEM] Counting loop-task heap allocations");
+}
+
+uint32_t AllocCounter::total() const {
+#ifdef NATIVE_BUILD
+    return (uint32_t)hal::firmwareHeapStats().allocations;
+#else
+    return countedAllocations;
+#endif
+}
+
+void AllocCounter::endIteration(bool steady) {
+    uint32_t now = total();
+    _lastIteration = now - _mark;
+    _mark = now;
+    if (steady && _lastIteration > 0) {
+        loopAllocationsMetric.inc(_lastIteration);
+        allocatingIterationsMetric.inc();
+    }
+}
+
+#endif
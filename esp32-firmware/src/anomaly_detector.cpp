@@ -0,0 +1,218 @@
+// Streaming anomaly detection on the sensor channels (EWMA z-score, CUSUM, stuck value)
+
+#include "anomaly_detector.h"
+#include "metrics.h"
+#include <math.h>
+
+// Global instance
+AnomalyDetector anomalyDetector;
+
+static Counter anomaliesMetric("sensor_anomalies_total", "Anomalies raised by the streaming sensor detectors");
+static Counter anomaliesSuppressedMetric("sensor_anomalies_suppressed_total",
+                                         "Detections not raised again within ANOMALY_REPEAT_MS");
+
+static const char* const CHANNEL_NAMES[ANOMALY_CHANNEL_COUNT] = {"temperature", "humidity", "soil_moisture"};
+static const char* const KIND_NAMES[ANOMALY_KIND_COUNT] = {"spike", "drift_up", "drift_down", "stuck"};
+static const float NOISE_FLOORS[ANOMALY_CHANNEL_COUNT] = {ANOMALY_TEMP_NOISE_FLOOR, ANOMALY_HUMIDITY_NOISE_FLOOR,
+                                                          ANOMALY_SOIL_NOISE_FLOOR};
+static const uint32_t STUCK_WINDOWS_MS[ANOMALY_CHANNEL_COUNT] = {ANOMALY_TEMP_STUCK_MS, ANOMALY_HUMIDITY_STUCK_MS,
+                                                                 ANOMALY_SOIL_STUCK_MS};
+
+// Weight of a new reading in an EWMA with time constant tauS, dtS after the previous one
+static float ewmaWeight(float dtS, float tauS) {
+    return 1.0f - expf(-dtS / tauS);
+}
+
+ChannelDetector::ChannelDetector() {
+    reset();
+}
+
+void ChannelDetector::reset() {
+    _fastMean = 0.0f;
+    _level = 0.0f;
+    _trend = 0.0f;
+    _diffVariance = 0.0f;
+    _cusumHigh = 0.0f;
+    _cusumLow = 0.0f;
+    _last = 0.0f;
+    _lastMs = 0;
+    _stuckSinceMs = 0;
+    _samples = 0;
+    _latched = 0;
+}
+
+float ChannelDetector::sigma(float noiseFloor) const {
+    float estimate = sqrtf(_diffVariance);
+    return estimate > noiseFloor ? estimate : noiseFloor;
+}
+
+uint8_t ChannelDetector::update(float value, uint64_t nowMs, float noiseFloor, uint32_t stuckMs, bool settling,
+                                AnomalyEvent events[ANOMALY_KIND_COUNT]) {
+    if (_samples == 0) {
+        _fastMean = value;
+        _level = value;
+        _trend = 0.0f;
+        _last = value;
+        _lastMs = nowMs;
+        _stuckSinceMs = nowMs;
+        _samples = 1;
+        return 0;
+    }
+
+    float dtS = nowMs > _lastMs ? (nowMs - _lastMs) / 1000.0f : 0.001f;
+    bool armed = _samples >= ANOMALY_WARMUP_SAMPLES;
+    float s = sigma(noiseFloor);
+    uint8_t fired = 0;
+
+    // Spike: scored against the mean and sigma from before this reading
+    float z = (value - _fastMean) / s;
+    const uint8_t spikeBit = 1 << ANOMALY_SPIKE;
+    if (fabsf(z) > ANOMALY_Z_THRESHOLD) {
+        if (armed && !(_latched & spikeBit)) {
+            fired |= spikeBit;
+            events[ANOMALY_SPIKE].baseline = _fastMean;
+            events[ANOMALY_SPIKE].score = fabsf(z);
+        }
+        _latched |= spikeBit;
+    } else if (fabsf(z) < ANOMALY_Z_THRESHOLD / 2) {
+        _latched &= ~spikeBit;
+    }
+
+    // Drift: two-sided CUSUM of the error of the level + trend prediction
+    float predicted = _level + _trend * dtS;
+    if (settling) {
+        // An actuator is moving the reading on purpose: the prediction follows it
+        _cusumHigh = 0.0f;
+        _cusumLow = 0.0f;
+    } else {
+        float r = (value - predicted) / s;
+        _cusumHigh = fmaxf(0.0f, _cusumHigh + r - ANOMALY_CUSUM_K);
+        _cusumLow = fmaxf(0.0f, _cusumLow - r - ANOMALY_CUSUM_K);
+        AnomalyKind drift = ANOMALY_KIND_COUNT;
+        float sum = 0.0f;
+        if (_cusumHigh > ANOMALY_CUSUM_H) {
+            drift = ANOMALY_DRIFT_UP;
+            sum = _cusumHigh;
+        } else if (_cusumLow > ANOMALY_CUSUM_H) {
+            drift = ANOMALY_DRIFT_DOWN;
+            sum = _cusumLow;
+        }
+        if (drift != ANOMALY_KIND_COUNT) {
+            if (armed) {
+                fired |= 1 << drift;
+                events[drift].baseline = predicted;
+                events[drift].score = sum;
+            }
+            // Start over from the current level: a continuing drift is raised again
+            _level = value;
+            predicted = value;
+            _cusumHigh = 0.0f;
+            _cusumLow = 0.0f;
+        }
+    }
+
+    // Stuck: bit-identical readings (NaN never gets here)
+    if (value != _last) {
+        _stuckSinceMs = nowMs;
+    }
+    const uint8_t stuckBit = 1 << ANOMALY_STUCK;
+    if (stuckMs && nowMs - _stuckSinceMs >= stuckMs) {
+        if (!(_latched & stuckBit)) {
+            fired |= stuckBit;
+            events[ANOMALY_STUCK].baseline = predicted;
+            events[ANOMALY_STUCK].score = stuckSeconds(nowMs);
+        }
+        _latched |= stuckBit;
+    } else {
+        _latched &= ~stuckBit;
+    }
+
+    // Estimates last; a difference is clipped so one spike cannot blind the detectors for a noise time constant
+    float diff = value - _last;
+    float clip = ANOMALY_Z_THRESHOLD * s;
+    diff = diff > clip ? clip : (diff < -clip ? -clip : diff);
+    _diffVariance += ewmaWeight(dtS, ANOMALY_NOISE_TAU_S) * (diff * diff / 2.0f - _diffVariance);
+    _fastMean += ewmaWeight(dtS, ANOMALY_FAST_TAU_S) * (value - _fastMean);
+    // Holt smoothing: a smooth diurnal swing is predicted, a change of course is not
+    if (settling) {
+        // Track the reading without learning the actuator's slope, which ends with the settling
+        _level = _fastMean;
+        _trend = 0.0f;
+    } else {
+        float level = predicted + ewmaWeight(dtS, ANOMALY_LEVEL_TAU_S) * (value - predicted);
+        _trend += ewmaWeight(dtS, ANOMALY_TREND_TAU_S) * ((level - _level) / dtS - _trend);
+        _level = level;
+    }
+    _last = value;
+    _lastMs = nowMs;
+    _samples++;
+
+    for (uint8_t kind = 0; kind < ANOMALY_KIND_COUNT; kind++) {
+        if (fired & (1 << kind)) {
+            events[kind].kind = (AnomalyKind)kind;
+            events[kind].value = value;
+            events[kind].sigma = s;
+            events[kind].acquiredMs = nowMs;
+        }
+    }
+    return fired;
+}
+
+AnomalyDetector::AnomalyDetector() {
+    memset(_lastRaisedMs, 0, sizeof(_lastRaisedMs));
+    _lastAcquiredMs = 0;
+    _settleUntilMs = 0;
+    _raised = 0;
+    _callback = nullptr;
+}
+
+void AnomalyDetector::onAnomaly(AnomalyCallback callback) {
+    _callback = callback;
+}
+
+void AnomalyDetector::actuatorChanged(uint64_t nowMs) {
+    _settleUntilMs = nowMs + ANOMALY_SETTLE_MS;
+}
+
+void AnomalyDetector::observe(const SensorData& data) {
+    if (data.acquired_ms == 0 || data.acquired_ms == _lastAcquiredMs) {
+        return;  // No new reading since the last call
+    }
+    _lastAcquiredMs = data.acquired_ms;
+    if (data.valid) {
+        feed(ANOMALY_CHANNEL_TEMPERATURE, data.temperature, data.acquired_ms);
+        feed(ANOMALY_CHANNEL_HUMIDITY, data.humidity, data.acquired_ms);
+    }
+    feed(ANOMALY_CHANNEL_SOIL, data.soil_moisture, data.acquired_ms);
+}
+
+void AnomalyDetector::feed(AnomalyChannel channel, float value, uint64_t nowMs) {
+    AnomalyEvent events[ANOMALY_KIND_COUNT];
+    uint8_t fired = _channels[channel].update(value, nowMs, NOISE_FLOORS[channel], STUCK_WINDOWS_MS[channel],
+                                              nowMs < _settleUntilMs, events);
+    for (uint8_t kind = 0; fired && kind < ANOMALY_KIND_COUNT; kind++) {
+        if (!(fired & (1 << kind))) {
+            continue;
+        }
+        uint64_t& last = _lastRaisedMs[channel][kind];
+        if (last != 0 && nowMs - last < ANOMALY_REPEAT_MS) {
+            anomaliesSuppressedMetric.inc();
+            continue;
+        }
+        last = nowMs;
+        _raised++;
+        anomaliesMetric.inc();
+        events[kind].channel = channel;
+        if (_callback) {
+            _callback(events[kind]);
+        }
+    }
+}
+
+const char* AnomalyDetector::channelName(AnomalyChannel channel) {
+    return channel < ANOMALY_CHANNEL_COUNT ? CHANNEL_NAMES[channel] : "unknown";
+}
+
+const char* AnomalyDetector::kindName(AnomalyKind kind) {
+    return kind < ANOMALY_KIND_COUNT ? KIND_NAMES[kind] : "unknown";
+}
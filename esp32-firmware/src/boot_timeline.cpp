@@ -0,0 +1,60 @@
+// Boot phase timestamps for the non-blocking boot pipeline
+
+#include "boot_timeline.h"
+#include "metrics.h"
+
+// Global instance
+BootTimeline bootTimeline;
+
+static Gauge bootFirstReadingMetric("boot_first_reading_ms", "Milliseconds from reset to the first valid sensor reading");
+static Gauge bootReadyMetric("boot_ready_ms", "Milliseconds from reset to registered with initial state published");
+
+static const char* const BOOT_PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "hardware",
+    "first_reading",
+    "wifi",
+    "time",
+    "ws_connected",
+    "registered",
+    "ready"
+};
+
+BootTimeline::BootTimeline() {
+    memset(_at, 0, sizeof(_at));
+    memset(_reached, 0, sizeof(_reached));
+    _reported = false;
+}
+
+void BootTimeline::mark(BootPhase phase) {
+    if (_reached[phase]) {
+        return;
+    }
+    _at[phase] = millis();
+    _reached[phase] = true;
+
+    if (phase == BOOT_PHASE_FIRST_READING) {
+        bootFirstReadingMetric.set(_at[phase]);
+    } else if (phase == BOOT_PHASE_READY) {
+        bootReadyMetric.set(_at[phase]);
+    }
+    LOG_INFOF("[BOOT] %s at %lu ms\n", phaseName(phase), (unsigned long)_at[phase]);
+}
+
+bool BootTimeline::reportPending() const {
+    if (_reported || !_reached[BOOT_PHASE_READY]) {
+        return false;
+    }
+    return _reached[BOOT_PHASE_FIRST_READING] || millis() - _at[BOOT_PHASE_READY] >= BOOT_REPORT_MAX_WAIT_MS;
+}
+
+void BootTimeline::appendTo(JsonObject phases) const {
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (_reached[i]) {
+            phases[BOOT_PHASE_NAMES[i]] = _at[i];
+        }
+    }
+}
+
+const char* BootTimeline::phaseName(BootPhase phase) {
+    return phase < BOOT_PHASE_COUNT ? BOOT_PHASE_NAMES[phase] : "unknown";
+}
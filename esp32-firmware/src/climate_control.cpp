@@ -0,0 +1,256 @@
+// On-device heater and fan loops: PID through time-proportioning windows, or hysteresis
+
+#include "climate_control.h"
+#include "relays.h"
+#include "runtime_config.h"
+#include "time_base.h"
+#include "metrics.h"
+#include <math.h>
+
+// Global instance
+ClimateController climateControl;
+
+static Gauge heaterDutyMetric("control_heater_duty_permille", "Heater loop requested duty cycle (per mille)");
+static Gauge heaterErrorMetric("control_heater_error_millicelsius", "Heater setpoint minus temperature (m°C)");
+static Counter heaterCyclesMetric("control_heater_cycles_total", "Heater relay switched on by its loop");
+static Gauge fanDutyMetric("control_fan_duty_permille", "Fan loop requested duty cycle (per mille)");
+static Gauge fanErrorMetric("control_fan_error_millicelsius", "Temperature minus fan setpoint (m°C)");
+static Counter fanCyclesMetric("control_fan_cycles_total", "Fan relay switched on by its loop");
+static Counter ticksSkippedMetric("control_ticks_skipped_total", "Controller ticks dropped after a stalled loop");
+
+static Gauge* const DUTY_METRICS[CONTROL_LOOP_COUNT] = {&heaterDutyMetric, &fanDutyMetric};
+static Gauge* const ERROR_METRICS[CONTROL_LOOP_COUNT] = {&heaterErrorMetric, &fanErrorMetric};
+static Counter* const CYCLE_METRICS[CONTROL_LOOP_COUNT] = {&heaterCyclesMetric, &fanCyclesMetric};
+
+static const char* const LOOP_NAMES[CONTROL_LOOP_COUNT] = {"heater", "fan"};
+static const int LOOP_RELAYS[CONTROL_LOOP_COUNT] = {CONTROL_HEATER_RELAY, CONTROL_FAN_RELAY};
+
+static const float PERIOD_MIN = CONTROL_PERIOD_MS / 60000.0f;
+static const uint64_t PERIOD_US = CONTROL_PERIOD_MS * 1000ULL;
+static const uint32_t MAX_CATCH_UP_TICKS = 10;    // More late ticks than this are dropped, not replayed
+static const float SLOPE_TAU_S = 60.0f;           // Derivative filter; DHT11 steps are 0.1 °C
+
+/**
+ * Runtime settings of one loop
+ */
+struct LoopSettings {
+    uint32_t mode;
+    float setpoint;
+    float kp;
+    float ki;
+    float kd;
+};
+
+static LoopSettings settingsFor(ControlLoop loop) {
+    const RuntimeConfigValues& values = runtimeConfig.values();
+    LoopSettings settings;
+    if (loop == CONTROL_LOOP_HEATER) {
+        settings.mode = values.heaterMode;
+        settings.setpoint = values.heaterSetpoint;
+        settings.kp = values.heaterKp;
+        settings.ki = values.heaterKi;
+        settings.kd = values.heaterKd;
+    } else {
+        settings.mode = values.fanMode;
+        settings.setpoint = values.fanSetpoint;
+        settings.kp = values.fanKp;
+        settings.ki = values.fanKi;
+        settings.kd = values.fanKd;
+    }
+    return settings;
+}
+
+static float clampf(float value, float low, float high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+ClimateController::ClimateController() {
+    memset(_loops, 0, sizeof(_loops));
+    _switchCallback = nullptr;
+    _nextTickUs = 0;
+    _readingMs = 0;
+    _temperature = NAN;
+    _humidity = NAN;
+    _slope = 0.0f;
+}
+
+const char* ClimateController::loopName(ControlLoop loop) {
+    return loop < CONTROL_LOOP_COUNT ? LOOP_NAMES[loop] : "unknown";
+}
+
+void ClimateController::loop(const SensorData& reading) {
+    take(reading);
+
+    uint64_t now = TimeBase::monotonicUs();
+    if (_nextTickUs == 0) {
+        _nextTickUs = now;
+    }
+    if (now > _nextTickUs && now - _nextTickUs >= PERIOD_US * MAX_CATCH_UP_TICKS) {
+        // A stalled loop (flash erase, TLS handshake): resume on the current period
+        uint64_t skipped = (now - _nextTickUs) / PERIOD_US;
+        ticksSkippedMetric.inc((uint32_t)skipped);
+        _nextTickUs += skipped * PERIOD_US;
+    }
+    while (now >= _nextTickUs) {
+        tick(now);
+        _nextTickUs += PERIOD_US;
+    }
+}
+
+void ClimateController::take(const SensorData& reading) {
+    if (!reading.valid || reading.acquired_ms == _readingMs || isnan(reading.temperature)) {
+        return;
+    }
+    if (_readingMs != 0 && reading.acquired_ms - _readingMs <= CONTROL_MAX_READING_AGE_MS) {
+        float dtS = (reading.acquired_ms - _readingMs) / 1000.0f;
+        float slope = (reading.temperature - _temperature) * 60.0f / dtS;
+        _slope += (slope - _slope) * dtS / (SLOPE_TAU_S + dtS);
+    } else {
+        _slope = 0.0f;  // First reading, or after a gap: no trend to trust
+    }
+    _temperature = reading.temperature;
+    _humidity = reading.humidity;
+    _readingMs = reading.acquired_ms;
+}
+
+void ClimateController::tick(uint64_t nowUs) {
+    bool fresh = _readingMs != 0 && nowUs / 1000ULL - _readingMs <= CONTROL_MAX_READING_AGE_MS;
+    for (int i = 0; i < CONTROL_LOOP_COUNT; i++) {
+        runLoop((ControlLoop)i, nowUs, fresh);
+    }
+}
+
+void ClimateController::runLoop(ControlLoop loop, uint64_t nowUs, bool fresh) {
+    ControlLoopState& state = _loops[loop];
+    LoopSettings settings = settingsFor(loop);
+
+    if (settings.mode != state.mode) {
+        // New mode starts from scratch; leaving control switches off what the loop switched on
+        bool loopHeldOn = state.mode != CONTROL_MODE_OFF && state.output && state.overrideUntilUs == 0;
+        uint64_t lastSwitchUs = state.lastSwitchUs;
+        memset(&state, 0, sizeof(state));
+        state.mode = (uint8_t)settings.mode;
+        state.lastSwitchUs = lastSwitchUs;
+        state.output = relays.getRelayState(LOOP_RELAYS[loop]);
+        if (settings.mode == CONTROL_MODE_OFF && loopHeldOn) {
+            drive(loop, false, nowUs);
+        }
+    }
+    if (state.mode == CONTROL_MODE_OFF) {
+        DUTY_METRICS[loop]->set(0);
+        ERROR_METRICS[loop]->set(0);
+        return;
+    }
+
+    if (state.overrideUntilUs != 0) {
+        if (nowUs < state.overrideUntilUs) {
+            return;
+        }
+        // Take the relay back as the manual command left it
+        state.overrideUntilUs = 0;
+        state.output = relays.getRelayState(LOOP_RELAYS[loop]);
+        state.windowStartUs = 0;
+    }
+
+    if (!fresh) {
+        state.duty = 0.0f;
+        state.windowStartUs = 0;
+        DUTY_METRICS[loop]->set(0);
+        if (state.output) {
+            drive(loop, false, nowUs);  // Fail safe: no minimum on time
+        }
+        return;
+    }
+
+    state.error = loop == CONTROL_LOOP_HEATER ? settings.setpoint - _temperature : _temperature - settings.setpoint;
+    bool on = state.mode == CONTROL_MODE_PID ? runPid(state, loop, nowUs) : runHysteresis(state, loop);
+
+    if (loop == CONTROL_LOOP_FAN) {
+        const RuntimeConfigValues& values = runtimeConfig.values();
+        state.humidityHold = state.humidityHold ? _humidity > values.fanHumidityMax - CONTROL_HUMIDITY_BAND
+                                                : _humidity > values.fanHumidityMax;
+        // Venting out humidity must not undo the heater: cold nights are humid
+        const ControlLoopState& heater = _loops[CONTROL_LOOP_HEATER];
+        bool heaterCalling = heater.mode != CONTROL_MODE_OFF && heater.duty > 0.0f;
+        if (state.humidityHold && !heaterCalling) {
+            on = true;
+            state.duty = 1.0f;
+        }
+    }
+    if (state.mode == CONTROL_MODE_HYSTERESIS && !state.humidityHold) {
+        state.duty = on ? 1.0f : 0.0f;
+    }
+
+    if (on != state.output) {
+        uint64_t minSwitchUs = runtimeConfig.values().controlMinSwitchMs * 1000ULL;
+        if (state.lastSwitchUs == 0 || nowUs - state.lastSwitchUs >= minSwitchUs) {
+            drive(loop, on, nowUs);
+        }
+    }
+    DUTY_METRICS[loop]->set((int32_t)(state.duty * 1000.0f + 0.5f));
+    ERROR_METRICS[loop]->set((int32_t)(state.error * 1000.0f));
+}
+
+bool ClimateController::runPid(ControlLoopState& state, ControlLoop loop, uint64_t nowUs) {
+    LoopSettings settings = settingsFor(loop);
+    // Derivative of the error from the measurement alone (setpoint steps do not kick)
+    float errorSlope = loop == CONTROL_LOOP_HEATER ? -_slope : _slope;
+    float proportional = settings.kp * state.error;
+    float derivative = settings.kd * errorSlope;
+    float unclamped = proportional + state.integral + derivative;
+    // Conditional integration: never push further into saturation
+    if ((unclamped < 1.0f || state.error < 0.0f) && (unclamped > 0.0f || state.error > 0.0f)) {
+        state.integral = clampf(state.integral + settings.ki * state.error * PERIOD_MIN, 0.0f, 1.0f);
+    }
+    state.duty = clampf(proportional + state.integral + derivative, 0.0f, 1.0f);
+
+    const RuntimeConfigValues& values = runtimeConfig.values();
+    uint64_t windowUs = values.controlWindowMs * 1000ULL;
+    if (state.windowStartUs == 0 || nowUs - state.windowStartUs >= windowUs) {
+        // Next window, aligned to the previous one unless the loop was away
+        state.windowStartUs = (state.windowStartUs == 0 || nowUs - state.windowStartUs >= 2 * windowUs)
+                                  ? nowUs
+                                  : state.windowStartUs + windowUs;
+        int32_t window = (int32_t)values.controlWindowMs;
+        int32_t minSwitch = (int32_t)values.controlMinSwitchMs;
+        int32_t request = (int32_t)(state.duty * window) + state.carryMs;
+        int32_t onTime = request < minSwitch ? 0 : (request > window - minSwitch ? window : request);
+        state.carryMs = request - onTime;
+        if (state.carryMs > window) {
+            state.carryMs = window;
+        } else if (state.carryMs < -window) {
+            state.carryMs = -window;
+        }
+        state.onTimeMs = (uint32_t)onTime;
+    }
+    return nowUs - state.windowStartUs < state.onTimeMs * 1000ULL;
+}
+
+bool ClimateController::runHysteresis(ControlLoopState& state, ControlLoop loop) {
+    (void)loop;
+    float half = runtimeConfig.values().controlBand * 0.5f;
+    return state.output ? state.error > -half : state.error > half;
+}
+
+void ClimateController::drive(ControlLoop loop, bool on, uint64_t nowUs) {
+    ControlLoopState& state = _loops[loop];
+    relays.setRelay(LOOP_RELAYS[loop], on);
+    state.output = on;
+    state.lastSwitchUs = nowUs;
+    if (on) {
+        CYCLE_METRICS[loop]->inc();
+    }
+    if (_switchCallback) {
+        _switchCallback(LOOP_RELAYS[loop], on);
+    }
+}
+
+bool ClimateController::overrideRelay(int relayId) {
+    for (int i = 0; i < CONTROL_LOOP_COUNT; i++) {
+        if (LOOP_RELAYS[i] == relayId && _loops[i].mode != CONTROL_MODE_OFF) {
+            _loops[i].overrideUntilUs = TimeBase::monotonicUs() + CONTROL_OVERRIDE_MS * 1000ULL;
+            return true;
+        }
+    }
+    return false;
+}
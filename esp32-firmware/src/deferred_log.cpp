@@ -0,0 +1,393 @@
+// Deferred binary logger: lock-free record ring drained by a low-priority task
+
+#include "config.h"
+#include "deferred_log.h"
+#include "memory_monitor.h"
+#include "log_forwarder.h"
+
+// Global instance
+DeferredLogger deferredLog;
+
+namespace {
+
+/**
+ * @brief One decoded argument from a record payload
+ */
+struct LogArg {
+    uint8_t tag;
+    uint64_t bits;
+    float real;
+    char text[LOG_MAX_STRING_ARG + 1];
+};
+
+/**
+ * @brief Sequential reader over a record payload
+ */
+class LogArgReader {
+public:
+    LogArgReader(const uint8_t* data, size_t length) : _data(data), _length(length), _pos(0) {}
+
+    bool next(LogArg& arg) {
+        if (_pos >= _length) {
+            return false;
+        }
+        arg.tag = _data[_pos++];
+        arg.bits = 0;
+        arg.real = 0.0f;
+        arg.text[0] = '\0';
+        switch (arg.tag) {
+            case LOG_ARG_INT32:
+            case LOG_ARG_UINT32: {
+                uint32_t word;
+                if (!take(&word, 4)) return false;
+                arg.bits = word;
+                arg.real = arg.tag == LOG_ARG_INT32 ? (float)(int32_t)word : (float)word;
+                return true;
+            }
+            case LOG_ARG_INT64:
+            case LOG_ARG_UINT64:
+            case LOG_ARG_POINTER:
+                if (!take(&arg.bits, 8)) return false;
+                arg.real = arg.tag == LOG_ARG_INT64 ? (float)(int64_t)arg.bits : (float)arg.bits;
+                return true;
+            case LOG_ARG_FLOAT:
+                if (!take(&arg.real, 4)) return false;
+                arg.bits = (uint64_t)(int64_t)arg.real;
+                return true;
+            case LOG_ARG_STRING: {
+                if (_pos >= _length) return false;
+                uint8_t len = _data[_pos++];
+                if (len > LOG_MAX_STRING_ARG || !take(arg.text, len)) return false;
+                arg.text[len] = '\0';
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+private:
+    const uint8_t* _data;
+    size_t _length;
+    size_t _pos;
+
+    bool take(void* out, size_t len) {
+        if (_pos + len > _length) {
+            _pos = _length;
+            return false;
+        }
+        memcpy(out, _data + _pos, len);
+        _pos += len;
+        return true;
+    }
+};
+
+// Same prefixes the synchronous Serial macros used to print
+const char* const LEVEL_PREFIXES[] = {
+    "",
+    "❌ ERROR: ",
+    "⚠ WARN: ",
+    "ℹ INFO: ",
+    ""
+};
+
+/**
+ * @brief Append formatted text to a bounded line buffer
+ */
+void appendText(char* out, size_t capacity, size_t& used, const char* text, size_t len) {
+    if (used >= capacity - 1) {
+        return;
+    }
+    if (len > capacity - 1 - used) {
+        len = capacity - 1 - used;
+    }
+    memcpy(out + used, text, len);
+    used += len;
+    out[used] = '\0';
+}
+
+/**
+ * @brief Render one printf conversion with a decoded argument
+ * @param spec Conversion without length modifiers (e.g. "%-5" plus the conversion char)
+ * @param conversion Conversion character
+ */
+int renderSpec(char* out, size_t capacity, const char* spec, char conversion, int width, int precision,
+               bool hasWidthArg, bool hasPrecisionArg, const LogArg& arg) {
+    char full[24];
+    bool is32 = arg.tag == LOG_ARG_INT32 || arg.tag == LOG_ARG_UINT32;
+    bool isInteger = strchr("diouxX", conversion) != nullptr;
+    // Integer conversions are always rendered through the 64-bit variants
+    snprintf(full, sizeof(full), "%s%s%c", spec, isInteger ? "ll" : "", conversion);
+
+#define LOG_RENDER(value)                                                                   \
+    (hasWidthArg && hasPrecisionArg ? snprintf(out, capacity, full, width, precision, value) \
+     : hasWidthArg                  ? snprintf(out, capacity, full, width, value)            \
+     : hasPrecisionArg              ? snprintf(out, capacity, full, precision, value)        \
+                                    : snprintf(out, capacity, full, value))
+
+    if (conversion == 'd' || conversion == 'i') {
+        long long value = is32 ? (long long)(int32_t)arg.bits : (long long)(int64_t)arg.bits;
+        return LOG_RENDER(value);
+    }
+    if (isInteger) {
+        unsigned long long value = is32 ? (unsigned long long)(uint32_t)arg.bits : (unsigned long long)arg.bits;
+        return LOG_RENDER(value);
+    }
+    if (conversion == 'c') {
+        return LOG_RENDER((int)arg.bits);
+    }
+    if (strchr("fFeEgGaA", conversion) != nullptr) {
+        double value = (double)arg.real;
+        return LOG_RENDER(value);
+    }
+    if (conversion == 's') {
+        const char* value = arg.tag == LOG_ARG_STRING ? arg.text : "?";
+        return LOG_RENDER(value);
+    }
+    if (conversion == 'p') {
+        void* value = (void*)(uintptr_t)arg.bits;
+        return LOG_RENDER(value);
+    }
+#undef LOG_RENDER
+    return snprintf(out, capacity, "%s", full);
+}
+
+}  // namespace
+
+DeferredLogger::DeferredLogger() {
+    for (uint32_t i = 0; i < CAPACITY; i++) {
+        _ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    _enqueuePos.store(0, std::memory_order_relaxed);
+    _dequeuePos = 0;
+    _overruns.store(0, std::memory_order_relaxed);
+    _reportedOverruns = 0;
+    _written = 0;
+    _draining.store(false, std::memory_order_relaxed);
+    _taskRunning = false;
+    _serialLevel.store(LOG_LEVEL, std::memory_order_relaxed);
+    _captureLevel.store(LOG_LEVEL > LOG_FORWARD_LEVEL ? LOG_LEVEL : LOG_FORWARD_LEVEL, std::memory_order_relaxed);
+}
+
+void DeferredLogger::setLevels(uint8_t serialLevel, uint8_t captureLevel) {
+    _serialLevel.store(serialLevel, std::memory_order_relaxed);
+    _captureLevel.store(captureLevel, std::memory_order_relaxed);
+}
+
+void DeferredLogger::begin() {
+#if LOG_DRAIN_TASK
+    TaskHandle_t handle = nullptr;
+    if (xTaskCreate(drainTask, "log", LOG_DRAIN_TASK_STACK, this, LOG_DRAIN_TASK_PRIORITY, &handle) != pdPASS) {
+        // loop() keeps draining from the main task instead
+        Serial.println("❌ ERROR: log drain task could not be created");
+        return;
+    }
+    _taskRunning = true;
+    memoryMonitor.registerTask(handle, "log");
+#endif
+}
+
+void DeferredLogger::loop() {
+    if (!_taskRunning) {
+        drain(0);
+    }
+}
+
+#if LOG_DRAIN_TASK
+void DeferredLogger::drainTask(void* param) {
+    DeferredLogger* logger = static_cast<DeferredLogger*>(param);
+    for (;;) {
+        logger->drain();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+}
+#endif
+
+uint32_t DeferredLogger::now() {
+    return (uint32_t)millis();
+}
+
+LogRecord* DeferredLogger::reserve(uint32_t& pos) {
+    pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        LogRecord* record = &_ring[pos & (CAPACITY - 1)];
+        uint32_t sequence = record->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(sequence - pos);
+        if (diff == 0) {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return record;
+            }
+        } else if (diff < 0) {
+            // Ring full: drop the newest record rather than block the caller
+            _overruns.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void DeferredLogger::publish(LogRecord* record, uint32_t pos) {
+    record->sequence.store(pos + 1, std::memory_order_release);
+}
+
+size_t DeferredLogger::drain(size_t maxRecords) {
+    // Single consumer: the drain task and flush() must not interleave
+    if (_draining.exchange(true, std::memory_order_acquire)) {
+        return 0;
+    }
+
+    size_t count = 0;
+    while (maxRecords == 0 || count < maxRecords) {
+        LogRecord* record = &_ring[_dequeuePos & (CAPACITY - 1)];
+        uint32_t sequence = record->sequence.load(std::memory_order_acquire);
+        if ((int32_t)(sequence - (_dequeuePos + 1)) < 0) {
+            break;  // Empty
+        }
+        output(*record);
+        record->sequence.store(_dequeuePos + CAPACITY, std::memory_order_release);
+        _dequeuePos++;
+        _written++;
+        count++;
+    }
+
+    uint32_t overruns = _overruns.load(std::memory_order_relaxed);
+    if (overruns != _reportedOverruns) {
+        Serial.printf("%s[log] %u records dropped\n", LEVEL_PREFIXES[LOG_LEVEL_WARN],
+                      (unsigned)(overruns - _reportedOverruns));
+        _reportedOverruns = overruns;
+    }
+
+    _draining.store(false, std::memory_order_release);
+    return count;
+}
+
+void DeferredLogger::flush() {
+    // The drain task may be mid-batch; wait for it briefly, then take over
+    for (int attempt = 0; attempt < 50 && _draining.load(std::memory_order_acquire); attempt++) {
+        delay(1);
+    }
+    drain(0);
+    Serial.flush();
+}
+
+void DeferredLogger::output(const LogRecord& record) {
+    bool toSerial = record.level <= _serialLevel.load(std::memory_order_relaxed);
+#ifdef LOG_STRIP_FORMATS
+    // Compact frame for scripts/log_decode.py: ~<id><timestamp><level><payload>
+    char line[2 + 8 + 8 + 1 + LOG_RECORD_PAYLOAD * 2 + 2];
+    int used = snprintf(line, sizeof(line), "~%08x%08x%x", (unsigned)record.format, (unsigned)record.timestamp,
+                        (unsigned)(record.level | (record.truncated ? 0x8 : 0)));
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < record.length; i++) {
+        line[used++] = HEX_DIGITS[record.payload[i] >> 4];
+        line[used++] = HEX_DIGITS[record.payload[i] & 0x0F];
+    }
+    line[used++] = '\n';
+    if (toSerial) {
+        Serial.write((const uint8_t*)line, used);
+    }
+    // The backend stores the frame as-is; decode it offline like the serial capture
+    logForwarder.capture(record.format, record.level, record.timestamp, line, used);
+#else
+    char line[LOG_LINE_MAX];
+    size_t length = format(record, line, sizeof(line));
+    if (toSerial) {
+        Serial.write((const uint8_t*)line, length);
+    }
+    size_t prefix = strlen(LEVEL_PREFIXES[record.level <= LOG_LEVEL_DEBUG ? record.level : LOG_LEVEL_DEBUG]);
+    if (length > prefix) {
+        logForwarder.capture(record.format, record.level, record.timestamp, line + prefix, length - prefix);
+    }
+#endif
+}
+
+size_t DeferredLogger::format(const LogRecord& record, char* out, size_t capacity) {
+    size_t used = 0;
+    out[0] = '\0';
+    uint8_t level = record.level <= LOG_LEVEL_DEBUG ? record.level : LOG_LEVEL_DEBUG;
+    appendText(out, capacity, used, LEVEL_PREFIXES[level], strlen(LEVEL_PREFIXES[level]));
+
+    LogArgReader reader(record.payload, record.length);
+    const char* p = (const char*)record.format;
+    while (*p) {
+        const char* literal = p;
+        while (*p && *p != '%') {
+            p++;
+        }
+        appendText(out, capacity, used, literal, p - literal);
+        if (!*p) {
+            break;
+        }
+
+        // Parse "%[flags][width][.precision][length]conversion"
+        char spec[16];
+        size_t specLen = 0;
+        spec[specLen++] = *p++;
+        if (*p == '%') {
+            appendText(out, capacity, used, "%", 1);
+            p++;
+            continue;
+        }
+        bool hasWidthArg = false;
+        bool hasPrecisionArg = false;
+        int width = 0;
+        int precision = 0;
+        LogArg arg;
+        while (*p && strchr("-+ #0", *p) && specLen < sizeof(spec) - 4) {
+            spec[specLen++] = *p++;
+        }
+        if (*p == '*') {
+            hasWidthArg = true;
+            spec[specLen++] = *p++;
+            width = reader.next(arg) ? (int)(int32_t)arg.bits : 0;
+        }
+        while (*p >= '0' && *p <= '9' && specLen < sizeof(spec) - 4) {
+            spec[specLen++] = *p++;
+        }
+        if (*p == '.') {
+            spec[specLen++] = *p++;
+            if (*p == '*') {
+                hasPrecisionArg = true;
+                spec[specLen++] = *p++;
+                precision = reader.next(arg) ? (int)(int32_t)arg.bits : 0;
+            }
+            while (*p >= '0' && *p <= '9' && specLen < sizeof(spec) - 4) {
+                spec[specLen++] = *p++;
+            }
+        }
+        // Argument widths come from the record tags, so length modifiers are dropped
+        while (*p && strchr("hljztLq", *p)) {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        char conversion = *p++;
+        spec[specLen] = '\0';
+
+        if (!reader.next(arg)) {
+            appendText(out, capacity, used, "?", 1);
+            continue;
+        }
+        if (used < capacity - 1) {
+            int n = renderSpec(out + used, capacity - used, spec, conversion, width, precision, hasWidthArg,
+                               hasPrecisionArg, arg);
+            if (n > 0) {
+                used += (size_t)n < capacity - used ? (size_t)n : capacity - 1 - used;
+            }
+        }
+    }
+
+    if (record.truncated) {
+        if (used > 0 && out[used - 1] == '\n') {
+            used--;
+        }
+        appendText(out, capacity, used, " [truncated]\n", 13);
+    }
+    // Keep the line terminated even when it was clipped to the buffer
+    if (used == capacity - 1 && out[used - 1] != '\n') {
+        out[used - 1] = '\n';
+    }
+    return used;
+}
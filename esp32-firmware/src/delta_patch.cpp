@@ -0,0 +1,337 @@
+// Streaming delta patch applier (LZSS + bsdiff-style operations), see delta_patch.h
+
+#include "delta_patch.h"
+#include <string.h>
+
+static const uint8_t OP_CODE_END = 0x00;
+static const uint8_t OP_CODE_ADD = 0x01;
+static const uint8_t OP_CODE_INSERT = 0x02;
+static const uint8_t OP_CODE_COPY = 0x03;
+
+static uint32_t readLe32(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+DeltaPatcher::DeltaPatcher() {
+    begin(nullptr, nullptr);
+}
+
+void DeltaPatcher::begin(DeltaSource* source, DeltaSink* sink) {
+    _source = source;
+    _sink = sink;
+    _status = DELTA_OK;
+    _headerLength = 0;
+    _sourceSize = 0;
+    _targetSize = 0;
+    _produced = 0;
+    memset(_window, 0, sizeof(_window));
+    _windowPos = 0;
+    _decoded = 0;
+    _flags = 0;
+    _flagBits = 0;
+    _haveMatchByte = false;
+    _matchByte = 0;
+    _matchDistance = 0;
+    _matchRemaining = 0;
+    _op = OP_TAG;
+    _varint = 0;
+    _varintShift = 0;
+    _remaining = 0;
+    _sourcePos = 0;
+    _sourceBufferPos = 0;
+    _sourceBufferLength = 0;
+    _outputLength = 0;
+}
+
+size_t DeltaPatcher::feed(const uint8_t* data, size_t length, size_t outputBudget) {
+    uint32_t budgetEnd = outputBudget ? _produced + (uint32_t)outputBudget : UINT32_MAX;
+    size_t consumed = 0;
+    for (;;) {
+        if (_status != DELTA_OK) {
+            if (_status == DELTA_DONE && (consumed < length || _matchRemaining > 0)) {
+                fail(DELTA_ERROR_FORMAT);  // Data after END
+            }
+            break;
+        }
+        if (_op == OP_COPY_DATA) {
+            copyStep(budgetEnd);
+            if (_op == OP_COPY_DATA) {
+                break;  // Budget used up (or failed)
+            }
+            continue;
+        }
+        if (_produced >= budgetEnd) {
+            break;
+        }
+        if (_matchRemaining > 0) {
+            // Byte by byte: a match may overlap the bytes it produces (runs),
+            // and an operation decoded from it may need to pause it (COPY)
+            _matchRemaining--;
+            emitDecoded(_window[(_windowPos - _matchDistance) & (DELTA_WINDOW_SIZE - 1)]);
+            continue;
+        }
+        if (consumed >= length) {
+            break;
+        }
+        uint8_t byte = data[consumed++];
+        if (_headerLength < DELTA_HEADER_SIZE) {
+            _header[_headerLength++] = byte;
+            if (_headerLength == DELTA_HEADER_SIZE && !parseHeader()) {
+                fail(DELTA_ERROR_HEADER);
+            }
+            continue;
+        }
+        decodeByte(byte);
+    }
+    return consumed;
+}
+
+DeltaStatus DeltaPatcher::finish() {
+    if (hasPendingOutput()) {
+        feed(nullptr, 0);
+    }
+    if (_status == DELTA_OK) {
+        // Input ended before END
+        fail(_headerLength < DELTA_HEADER_SIZE ? DELTA_ERROR_HEADER : DELTA_ERROR_SIZE);
+    }
+    if (_status == DELTA_DONE && !flush()) {
+        fail(DELTA_ERROR_SINK);
+    }
+    return _status;
+}
+
+const char* DeltaPatcher::statusName(DeltaStatus status) {
+    switch (status) {
+        case DELTA_OK: return "ok";
+        case DELTA_DONE: return "done";
+        case DELTA_ERROR_HEADER: return "bad header";
+        case DELTA_ERROR_FORMAT: return "corrupt patch";
+        case DELTA_ERROR_SOURCE: return "source read";
+        case DELTA_ERROR_SINK: return "write failed";
+        case DELTA_ERROR_SIZE: return "size mismatch";
+    }
+    return "unknown";
+}
+
+void DeltaPatcher::fail(DeltaStatus status) {
+    if (_status == DELTA_OK || _status == DELTA_DONE) {
+        _status = status;
+    }
+}
+
+bool DeltaPatcher::parseHeader() {
+    if (readLe32(_header) != DELTA_MAGIC || _header[4] != DELTA_FORMAT_VERSION) {
+        return false;
+    }
+    _sourceSize = readLe32(_header + 8);
+    _targetSize = readLe32(_header + 12);
+    return _targetSize > 0 && (_sourceSize == 0 || _source != nullptr) && _sink != nullptr;
+}
+
+void DeltaPatcher::decodeByte(uint8_t byte) {
+    if (_flagBits == 0) {
+        _flags = byte;
+        _flagBits = 8;
+        return;
+    }
+
+    if (_flags & 0x01) {
+        _flags >>= 1;
+        _flagBits--;
+        emitDecoded(byte);
+        return;
+    }
+
+    if (!_haveMatchByte) {
+        _matchByte = byte;
+        _haveMatchByte = true;
+        return;
+    }
+    _haveMatchByte = false;
+    _flags >>= 1;
+    _flagBits--;
+
+    _matchDistance = (uint16_t)(((uint16_t)_matchByte << 4) | (byte >> 4)) + 1;
+    if (_matchDistance > _decoded) {
+        fail(DELTA_ERROR_FORMAT);  // Reaches back before the start of the stream
+        return;
+    }
+    _matchRemaining = (byte & 0x0F) + DELTA_MIN_MATCH;  // Produced by feed()
+}
+
+void DeltaPatcher::emitDecoded(uint8_t byte) {
+    _window[_windowPos] = byte;
+    _windowPos = (_windowPos + 1) & (DELTA_WINDOW_SIZE - 1);
+    _decoded++;
+    applyOp(byte);
+}
+
+void DeltaPatcher::applyOp(uint8_t byte) {
+    switch (_op) {
+        case OP_TAG:
+            if (byte == OP_CODE_ADD) {
+                _op = OP_ADD_SEEK;
+            } else if (byte == OP_CODE_INSERT) {
+                _op = OP_INSERT_LENGTH;
+            } else if (byte == OP_CODE_COPY) {
+                _op = OP_COPY_SEEK;
+            } else if (byte == OP_CODE_END) {
+                _op = OP_END;
+                if (_produced != _targetSize) {
+                    fail(DELTA_ERROR_SIZE);
+                } else {
+                    _status = DELTA_DONE;
+                }
+            } else {
+                fail(DELTA_ERROR_FORMAT);
+            }
+            break;
+
+        case OP_ADD_SEEK:
+            if (readVarint(byte)) {
+                seekSource(_varint, OP_ADD_LENGTH);
+            }
+            break;
+
+        case OP_ADD_LENGTH:
+            if (readVarint(byte)) {
+                startSourceRun(OP_ADD_DATA);
+            }
+            break;
+
+        case OP_ADD_DATA: {
+            uint8_t value;
+            if (!readSource(&value)) {
+                break;
+            }
+            output((uint8_t)(value + byte));
+            if (--_remaining == 0) {
+                _op = OP_TAG;
+            }
+            break;
+        }
+
+        case OP_INSERT_LENGTH:
+            if (readVarint(byte)) {
+                _remaining = _varint;
+                _op = _remaining ? OP_INSERT_DATA : OP_TAG;
+            }
+            break;
+
+        case OP_INSERT_DATA:
+            output(byte);
+            if (--_remaining == 0) {
+                _op = OP_TAG;
+            }
+            break;
+
+        case OP_COPY_SEEK:
+            if (readVarint(byte)) {
+                seekSource(_varint, OP_COPY_LENGTH);
+            }
+            break;
+
+        case OP_COPY_LENGTH:
+            if (readVarint(byte)) {
+                startSourceRun(OP_COPY_DATA);  // Produced by copyStep() from feed()
+            }
+            break;
+
+        case OP_COPY_DATA:  // Not reached: feed() finishes a COPY before decoding more
+        case OP_END:
+            fail(DELTA_ERROR_FORMAT);  // Operations after END
+            break;
+    }
+}
+
+bool DeltaPatcher::readVarint(uint8_t byte) {
+    if (_varintShift == 0) {
+        _varint = 0;
+    }
+    if (_varintShift > 28 || (_varintShift == 28 && (byte & 0x70))) {
+        fail(DELTA_ERROR_FORMAT);  // Does not fit 32 bits
+        return false;
+    }
+    _varint |= (uint32_t)(byte & 0x7F) << _varintShift;
+    if (byte & 0x80) {
+        _varintShift += 7;
+        return false;
+    }
+    _varintShift = 0;
+    return true;
+}
+
+void DeltaPatcher::seekSource(uint32_t zigzag, OpState next) {
+    // Zigzag: 0, -1, 1, -2, ...
+    int64_t seek = (zigzag & 1) ? -(int64_t)(zigzag >> 1) - 1 : (int64_t)(zigzag >> 1);
+    int64_t position = (int64_t)_sourcePos + seek;
+    if (position < 0 || position > (int64_t)_sourceSize) {
+        fail(DELTA_ERROR_SOURCE);
+        return;
+    }
+    _sourcePos = (uint32_t)position;
+    _sourceBufferPos = 0;
+    _sourceBufferLength = 0;
+    _op = next;
+}
+
+bool DeltaPatcher::startSourceRun(OpState next) {
+    _remaining = _varint;
+    if ((uint64_t)_sourcePos + _remaining > _sourceSize) {
+        fail(DELTA_ERROR_SOURCE);
+        return false;
+    }
+    _op = _remaining ? next : OP_TAG;
+    return true;
+}
+
+bool DeltaPatcher::readSource(uint8_t* value) {
+    if (_sourceBufferPos == _sourceBufferLength) {
+        // Runs were bounds-checked against the source size when they started
+        uint16_t chunk = _remaining < DELTA_SOURCE_BUFFER ? (uint16_t)_remaining : DELTA_SOURCE_BUFFER;
+        if (!_source->read(_sourcePos, _sourceBuffer, chunk)) {
+            fail(DELTA_ERROR_SOURCE);
+            return false;
+        }
+        _sourceBufferPos = 0;
+        _sourceBufferLength = chunk;
+    }
+    *value = _sourceBuffer[_sourceBufferPos++];
+    _sourcePos++;
+    return true;
+}
+
+void DeltaPatcher::copyStep(uint32_t budgetEnd) {
+    while (_remaining > 0 && _produced < budgetEnd && _status == DELTA_OK) {
+        uint8_t value;
+        if (!readSource(&value)) {
+            return;
+        }
+        output(value);
+        _remaining--;
+    }
+    if (_remaining == 0 && _status == DELTA_OK) {
+        _op = OP_TAG;
+    }
+}
+
+void DeltaPatcher::output(uint8_t byte) {
+    if (_produced >= _targetSize) {
+        fail(DELTA_ERROR_SIZE);
+        return;
+    }
+    _output[_outputLength++] = byte;
+    _produced++;
+    if (_outputLength == DELTA_OUTPUT_BUFFER && !flush()) {
+        fail(DELTA_ERROR_SINK);
+    }
+}
+
+bool DeltaPatcher::flush() {
+    if (_outputLength == 0) {
+        return true;
+    }
+    bool written = _sink->write(_output, _outputLength);
+    _outputLength = 0;
+    return written;
+}
@@ -0,0 +1,362 @@
+// Backend endpoint choice: TCP connect probes, failover and fail back
+
+#include "endpoint_selector.h"
+#include "metrics.h"
+#include <lwip/sockets.h>
+#include <errno.h>
+
+static Gauge selectedMetric("ws_endpoint_selected", "Index in VPS_ENDPOINTS of the backend endpoint in use");
+static Counter switchesMetric("ws_endpoint_switches_total", "Changes of backend endpoint (failover and fail back)");
+static Counter probeFailuresMetric("ws_endpoint_probe_failures_total", "Endpoint probes that did not connect in time");
+static Gauge rtt0Metric("ws_endpoint0_rtt_ms", "Smoothed TCP connect time to endpoint 0 (-1 = unhealthy)");
+static Gauge rtt1Metric("ws_endpoint1_rtt_ms", "Smoothed TCP connect time to endpoint 1 (-1 = unhealthy)");
+static Gauge rtt2Metric("ws_endpoint2_rtt_ms", "Smoothed TCP connect time to endpoint 2 (-1 = unhealthy)");
+static Gauge rtt3Metric("ws_endpoint3_rtt_ms", "Smoothed TCP connect time to endpoint 3 (-1 = unhealthy)");
+
+static Gauge* const RTT_METRICS[] = {&rtt0Metric, &rtt1Metric, &rtt2Metric, &rtt3Metric};
+static_assert(sizeof(RTT_METRICS) / sizeof(RTT_METRICS[0]) >= ENDPOINT_MAX, "one RTT gauge per endpoint");
+
+// Score of an endpoint nobody could measure yet: as bad as a probe that timed out
+static const int32_t UNKNOWN_RTT_US = ENDPOINT_PROBE_TIMEOUT_MS * 1000;
+
+enum : uint8_t { LOOKUP_IDLE, LOOKUP_PENDING, LOOKUP_DONE };
+
+EndpointSelector::EndpointSelector() {
+    memset(_endpoints, 0, sizeof(_endpoints));
+    _count = 0;
+    _active = 0;
+    _probeFd = -1;
+    _probeIndex = 0;
+    _probeStartUs = 0;
+    _lastProbeAt = 0;
+    _probeNow = true;
+    _waitingSince = 0;
+    _lookupState.store(LOOKUP_IDLE);
+    _lookupIndex = 0;
+    _lookupAddress = 0;
+}
+
+EndpointSelector::~EndpointSelector() {
+    if (_probeFd >= 0) {
+        close(_probeFd);
+    }
+}
+
+uint8_t EndpointSelector::begin(const char* list, const char* defaultHost, uint16_t defaultPort) {
+    _count = 0;
+    _active = 0;
+    const char* entry = list;
+    while (entry && *entry) {
+        while (*entry == ' ') {
+            entry++;
+        }
+        const char* end = strchr(entry, ',');
+        size_t length = end ? (size_t)(end - entry) : strlen(entry);
+        const char* colon = nullptr;
+        for (size_t i = 0; i < length; i++) {
+            if (entry[i] == ':') {
+                colon = entry + i;
+            }
+        }
+        long port = colon ? strtol(colon + 1, nullptr, 10) : 0;
+        if (length > 0 && (port <= 0 || port > 65535 || !addEndpoint(entry, (size_t)(colon - entry), (uint16_t)port))) {
+            char rejected[ENDPOINT_HOST_MAX_LENGTH];
+            size_t shown = min(length, sizeof(rejected) - 1);
+            memcpy(rejected, entry, shown);
+            rejected[shown] = '\0';
+            LOG_WARNF("Ignoring backend endpoint \"%s\"\n", rejected);
+        }
+        entry = end ? end + 1 : nullptr;
+    }
+    if (_count == 0) {
+        addEndpoint(defaultHost, strlen(defaultHost), defaultPort);
+    }
+    selectedMetric.set(0);
+    for (uint8_t i = 0; i < _count; i++) {
+        publishRtt(i);
+    }
+    if (_count > 1) {
+        LOG_INFOF("Backend endpoints: %u, primary %s:%u\n", (unsigned)_count, _endpoints[0].host,
+                  (unsigned)_endpoints[0].port);
+    }
+    return _count;
+}
+
+bool EndpointSelector::addEndpoint(const char* host, size_t hostLength, uint16_t port) {
+    if (_count >= ENDPOINT_MAX || hostLength == 0 || hostLength >= ENDPOINT_HOST_MAX_LENGTH) {
+        return false;
+    }
+    BackendEndpoint& endpoint = _endpoints[_count++];
+    memset(&endpoint, 0, sizeof(endpoint));
+    memcpy(endpoint.host, host, hostLength);
+    endpoint.host[hostLength] = '\0';
+    endpoint.port = port;
+    endpoint.rttUs = -1;
+    endpoint.holdMs = ENDPOINT_FAILBACK_HOLD_MS;
+    return true;
+}
+
+bool EndpointSelector::loop(bool connected) {
+    if (_count < 2) {
+        return false;  // Nothing to choose between
+    }
+    unsigned long now = millis();
+    pollLookup();
+
+    if (_probeFd >= 0) {
+        pollProbe(now);
+    } else {
+        // Each endpoint once per interval while connected; back to back while not
+        unsigned long spacing = connected ? ENDPOINT_PROBE_INTERVAL_MS / _count : ENDPOINT_PROBE_FAST_MS;
+        if (_probeNow || now - _lastProbeAt >= spacing) {
+            startProbe(now);
+            if (_probeFd >= 0) {
+                pollProbe(now);  // Nearby endpoints answer before the next iteration
+            }
+        }
+    }
+
+    if (connected) {
+        _waitingSince = 0;
+        if (!healthy(_active)) {
+            // Probes fail but the socket has not noticed yet (half-open): leave now
+            int candidate = best(false, now);
+            if (candidate >= 0) {
+                switchTo((uint8_t)candidate, "probes failing");
+                return true;
+            }
+            return false;
+        }
+        // Fail back (or move to a clearly faster endpoint) once the candidate has held up
+        int candidate = best(true, now);
+        if (candidate >= 0 && score((uint8_t)candidate) + ENDPOINT_SWITCH_MARGIN_MS * 1000 < score(_active)) {
+            switchTo((uint8_t)candidate, candidate < _active ? "fail back" : "faster");
+            return true;
+        }
+        return false;
+    }
+
+    if (_waitingSince == 0) {
+        _waitingSince = now;
+    }
+    bool timedOut = now - _waitingSince >= ENDPOINT_CONNECT_TIMEOUT_MS;
+    if (!timedOut && healthy(_active)) {
+        return false;
+    }
+    int candidate = best(false, now);
+    if (candidate < 0) {
+        return false;  // Everything is down: keep retrying where we are
+    }
+    if (timedOut) {
+        // Reachable or not, no WebSocket came up here: make coming back slower each time
+        BackendEndpoint& endpoint = _endpoints[_active];
+        endpoint.holdMs = min((uint32_t)(endpoint.holdMs * 2), (uint32_t)ENDPOINT_FAILBACK_HOLD_MAX_MS);
+        if (endpoint.healthySince != 0) {
+            endpoint.healthySince = now;
+        }
+    }
+    switchTo((uint8_t)candidate, timedOut ? "no connection" : "probes failing");
+    return true;
+}
+
+void EndpointSelector::connected() {
+    _waitingSince = 0;
+    _endpoints[_active].holdMs = ENDPOINT_FAILBACK_HOLD_MS;
+}
+
+void EndpointSelector::disconnected() {
+    _waitingSince = millis();
+    if (_probeFd < 0) {
+        // Find out right away whether the endpoint itself is gone
+        _probeIndex = _active;
+        _probeNow = true;
+    }
+}
+
+void EndpointSelector::renew() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < _count; i++) {
+        // Due for a lookup; the address is kept in case the name server is what failed
+        _endpoints[i].resolvedAt = now - ENDPOINT_DNS_REFRESH_MS;
+    }
+    if (_probeFd < 0) {
+        _probeIndex = _active;
+        _probeNow = true;
+    }
+}
+
+void EndpointSelector::startProbe(unsigned long now) {
+    _probeNow = false;
+    BackendEndpoint& endpoint = _endpoints[_probeIndex];
+    if (!resolve(_probeIndex, now)) {
+        if (_lookupState.load(std::memory_order_acquire) == LOOKUP_PENDING && _lookupIndex == _probeIndex) {
+            // First answer still on its way: not a failure, move on to the next endpoint
+            _probeIndex = (uint8_t)((_probeIndex + 1) % _count);
+            _lastProbeAt = now;
+        } else {
+            finishProbe(false, now);
+        }
+        return;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        finishProbe(false, now);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(endpoint.port);
+    address.sin_addr.s_addr = endpoint.address;
+    _probeFd = fd;
+    _probeStartUs = micros();
+    int rc = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    if (rc == 0) {
+        finishProbe(true, now);
+    } else if (errno != EINPROGRESS) {
+        finishProbe(false, now);
+    }
+}
+
+void EndpointSelector::pollProbe(unsigned long now) {
+    // Polled once per loop iteration, so the RTT resolution is one iteration
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(_probeFd, &writable);
+    struct timeval immediate = {0, 0};
+    int ready = select(_probeFd + 1, nullptr, &writable, nullptr, &immediate);
+    if (ready > 0) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(_probeFd, SOL_SOCKET, SO_ERROR, &error, &length);
+        finishProbe(error == 0, now);
+    } else if (ready < 0 || micros() - _probeStartUs >= ENDPOINT_PROBE_TIMEOUT_MS * 1000UL) {
+        finishProbe(false, now);
+    }
+}
+
+void EndpointSelector::finishProbe(bool ok, unsigned long now) {
+    uint32_t elapsedUs = (uint32_t)(micros() - _probeStartUs);
+    if (_probeFd >= 0) {
+        close(_probeFd);
+        _probeFd = -1;
+    }
+    BackendEndpoint& endpoint = _endpoints[_probeIndex];
+    if (ok) {
+        endpoint.rttUs = endpoint.rttUs < 0
+                             ? (int32_t)elapsedUs
+                             : endpoint.rttUs + (int32_t)(ENDPOINT_RTT_EMA_ALPHA * ((int32_t)elapsedUs - endpoint.rttUs));
+        if (endpoint.healthySince == 0) {
+            endpoint.healthySince = now ? now : 1;
+        }
+        endpoint.probeFailures = 0;
+    } else {
+        probeFailuresMetric.inc();
+        if (endpoint.probeFailures < 255) {
+            endpoint.probeFailures++;
+        }
+        if (endpoint.probeFailures >= ENDPOINT_PROBE_FAILURES) {
+            endpoint.healthySince = 0;
+        }
+    }
+    publishRtt(_probeIndex);
+    _probeIndex = (uint8_t)((_probeIndex + 1) % _count);
+    _lastProbeAt = now;
+}
+
+bool EndpointSelector::resolve(uint8_t index, unsigned long now) {
+    BackendEndpoint& endpoint = _endpoints[index];
+    bool tried = endpoint.resolvedAt != 0;
+    bool due = endpoint.address != 0 ? now - endpoint.resolvedAt >= ENDPOINT_DNS_REFRESH_MS
+                                     : !tried || now - endpoint.resolvedAt >= ENDPOINT_PROBE_INTERVAL_MS;
+    if (due && _lookupState.load(std::memory_order_acquire) == LOOKUP_IDLE) {
+        startLookup(index, now);
+    }
+    // The probe goes to the previous address until the answer is in
+    return endpoint.address != 0;
+}
+
+void EndpointSelector::startLookup(uint8_t index, unsigned long now) {
+    BackendEndpoint& endpoint = _endpoints[index];
+    endpoint.resolvedAt = now ? now : 1;
+    _lookupIndex = index;
+    _lookupState.store(LOOKUP_PENDING, std::memory_order_release);
+    // Same call WiFi.hostByName() makes, without its wait for the answer
+    ip_addr_t address;
+    err_t err = dns_gethostbyname(endpoint.host, &address, &EndpointSelector::lookupDone, this);
+    if (err == ERR_OK) {
+        // Numeric or cached: no callback follows
+        if (IP_IS_V4(&address)) {
+            endpoint.address = ip_2_ip4(&address)->addr;
+        }
+        _lookupState.store(LOOKUP_IDLE, std::memory_order_release);
+    } else if (err != ERR_INPROGRESS) {
+        _lookupState.store(LOOKUP_IDLE, std::memory_order_release);
+        LOG_WARNF("Cannot resolve backend endpoint %s\n", endpoint.host);
+    }
+}
+
+void EndpointSelector::lookupDone(const char* name, const ip_addr_t* address, void* selector) {
+    // Runs on the tcpip task: hand the answer over, the loop task applies it
+    (void)name;
+    EndpointSelector* self = static_cast<EndpointSelector*>(selector);
+    self->_lookupAddress = address && IP_IS_V4(address) ? ip_2_ip4(address)->addr : 0;
+    self->_lookupState.store(LOOKUP_DONE, std::memory_order_release);
+}
+
+void EndpointSelector::pollLookup() {
+    if (_lookupState.load(std::memory_order_acquire) != LOOKUP_DONE) {
+        return;
+    }
+    BackendEndpoint& endpoint = _endpoints[_lookupIndex];
+    if (_lookupAddress != 0) {
+        endpoint.address = _lookupAddress;
+    } else {
+        // Keep the previous address: the name server may be the thing that is down
+        LOG_WARNF("Cannot resolve backend endpoint %s\n", endpoint.host);
+    }
+    _lookupState.store(LOOKUP_IDLE, std::memory_order_release);
+}
+
+bool EndpointSelector::healthy(uint8_t index) const {
+    return _endpoints[index].probeFailures < ENDPOINT_PROBE_FAILURES;
+}
+
+bool EndpointSelector::stable(uint8_t index, unsigned long now) const {
+    const BackendEndpoint& endpoint = _endpoints[index];
+    return endpoint.rttUs >= 0 && endpoint.healthySince != 0 && now - endpoint.healthySince >= endpoint.holdMs;
+}
+
+int32_t EndpointSelector::score(uint8_t index) const {
+    const BackendEndpoint& endpoint = _endpoints[index];
+    int32_t rtt = endpoint.rttUs >= 0 ? endpoint.rttUs : UNKNOWN_RTT_US;
+    return rtt + index * ENDPOINT_RANK_PENALTY_MS * 1000;
+}
+
+int EndpointSelector::best(bool stableOnly, unsigned long now) const {
+    int candidate = -1;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (i == _active || !healthy(i) || (stableOnly && !stable(i, now))) {
+            continue;
+        }
+        if (candidate < 0 || score(i) < score((uint8_t)candidate)) {
+            candidate = i;
+        }
+    }
+    return candidate;
+}
+
+void EndpointSelector::switchTo(uint8_t index, const char* reason) {
+    LOG_WARNF("Backend endpoint %s:%u -> %s:%u (%s)\n", _endpoints[_active].host, (unsigned)_endpoints[_active].port,
+              _endpoints[index].host, (unsigned)_endpoints[index].port, reason);
+    _active = index;
+    _waitingSince = 0;
+    selectedMetric.set(index);
+    switchesMetric.inc();
+}
+
+void EndpointSelector::publishRtt(uint8_t index) {
+    const BackendEndpoint& endpoint = _endpoints[index];
+    RTT_METRICS[index]->set(healthy(index) && endpoint.rttUs >= 0 ? (endpoint.rttUs + 500) / 1000 : -1);
+}
@@ -0,0 +1,475 @@
+// Log-structured sensor history on the spiffs data partition, queried with sensor:history
+
+#include "history_store.h"
+#include "vps_websocket.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "time_base.h"
+#include <esp_rom_crc.h>
+
+// Global instance
+HistoryStore historyStore;
+
+static Counter historyReadingsMetric("history_readings_total", "Readings added to the flash history");
+static Counter historyRecordsMetric("history_records_total", "History blocks written to flash");
+static Counter historyErasesMetric("history_sector_erases_total", "History sectors erased for reuse");
+static Counter historyWriteErrorsMetric("history_write_errors_total",
+                                        "History blocks lost to a flash erase or write error");
+static Counter historyCorruptMetric("history_corrupt_records_total", "History records skipped for a bad CRC");
+static Counter historyQueriesMetric("history_queries_total", "sensor:history queries started");
+static Gauge historyQueryMetric("history_query_ms", "Duration of the last sensor:history query");
+static Gauge historySectorsMetric("history_sectors_used", "Flash sectors holding history");
+
+static const uint64_t RETENTION_MS = (uint64_t)HISTORY_RETENTION_DAYS * 86400000ULL;
+static const uint64_t DEFAULT_SPAN_MS = 86400000ULL;
+static const uint32_t DEFAULT_STEP_MS = 3600000UL;
+
+// Flash bytes taken by a record: header and block, padded to a word
+static uint32_t recordBytes(uint16_t length) {
+    return (HISTORY_RECORD_HEADER_BYTES + length + 3) & ~3u;
+}
+
+// Little-endian, whatever the host
+static uint8_t* putU32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+    return out + 4;
+}
+
+static uint8_t* putFloat(uint8_t* out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return putU32(out, bits);
+}
+
+HistoryStore::HistoryStore() : _decoder(nullptr, 0) {
+    _partition = nullptr;
+    _sectorCount = 0;
+    memset(_index, 0, sizeof(_index));
+    _head = 0;
+    _headOffset = 0;
+    _sequence = 0;
+    _openedAt = 0;
+    _queryActive = false;
+    _client = nullptr;
+    _requestId[0] = '\0';
+    _from = 0;
+    _to = 0;
+    _notBefore = 0;
+    _step = 0;
+    _phase = QUERY_END;
+    _sector = 0;
+    _offset = 0;
+    _decoding = false;
+    _bucket = -1;
+    _bucketReadings = 0;
+    _chunkBuckets = 0;
+    _chunkSeq = 0;
+    _readings = 0;
+    _recordsRead = 0;
+    _recordsSkipped = 0;
+    _queryStartUs = 0;
+}
+
+bool HistoryStore::begin() {
+    static_assert(sizeof(RecordHeader) == HISTORY_RECORD_HEADER_BYTES, "RecordHeader layout");
+    _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTORY_PARTITION_LABEL);
+    if (!_partition) {
+        LOG_WARNF("[HISTORY] No \"%s\" partition, flash history disabled\n", HISTORY_PARTITION_LABEL);
+        return false;
+    }
+    uint32_t sectors = _partition->size / SPI_FLASH_SEC_SIZE;
+    _sectorCount = sectors < HISTORY_MAX_SECTORS ? sectors : HISTORY_MAX_SECTORS;
+
+    // Nothing written yet: the first record goes to sector 0
+    _head = _sectorCount - 1;
+    _headOffset = SPI_FLASH_SEC_SIZE;
+    _sequence = 0;
+    bool found = false;
+    for (uint16_t sector = 0; sector < _sectorCount; sector++) {
+        uint32_t header[2];
+        _index[sector].firstSec = 0;
+        _index[sector].lastSec = 0;
+        if (esp_partition_read(_partition, sectorAddress(sector), header, sizeof(header)) != ESP_OK ||
+            header[0] != HISTORY_SECTOR_MAGIC) {
+            continue;  // Erased, foreign or torn by a reset during its erase: reused when the ring gets there
+        }
+        uint32_t end = scanSector(sector);
+        // The newest sector is the head; the ring runs in sequence order from the one after it
+        if (!found || header[1] > _sequence) {
+            found = true;
+            _sequence = header[1];
+            _head = sector;
+            _headOffset = end;
+        }
+    }
+    _open.reset();
+
+    historySectorsMetric.set(sectorsUsed());
+    LOG_INFOF("[HISTORY] %u of %u sectors in use\n", (unsigned)sectorsUsed(), (unsigned)_sectorCount);
+    return true;
+}
+
+// Header of the record at offset; false at free space (marker 0xFFFF), past the end of the sector or on a damaged header
+bool HistoryStore::readRecordHeader(uint16_t sector, uint32_t offset, RecordHeader& header) {
+    header.marker = 0;
+    if (offset + HISTORY_RECORD_HEADER_BYTES > SPI_FLASH_SEC_SIZE ||
+        esp_partition_read(_partition, sectorAddress(sector) + offset, &header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    return header.marker == HISTORY_RECORD_MARKER && header.length >= SENSOR_BLOCK_HEADER_BYTES &&
+           header.length <= SENSOR_BLOCK_MAX_BYTES && offset + recordBytes(header.length) <= SPI_FLASH_SEC_SIZE &&
+           header.firstMs != 0 && header.firstMs <= header.lastMs;
+}
+
+// Rebuild the index entry of a sector from its record headers; returns where the free space starts
+uint32_t HistoryStore::scanSector(uint16_t sector) {
+    SectorSpan& span = _index[sector];
+    uint32_t offset = HISTORY_SECTOR_HEADER_BYTES;
+    RecordHeader header;
+    while (readRecordHeader(sector, offset, header)) {
+        if (span.firstSec == 0) {
+            span.firstSec = (uint32_t)(header.firstMs / 1000ULL);
+        }
+        if (header.lastMs / 1000ULL > span.lastSec) {
+            span.lastSec = (uint32_t)(header.lastMs / 1000ULL);
+        }
+        offset += recordBytes(header.length);
+    }
+    // A damaged header (reset during a write) closes the sector: nothing is written after it
+    return header.marker == 0xFFFF ? offset : SPI_FLASH_SEC_SIZE;
+}
+
+// Move the head to the next sector: erase it (its readings are the oldest) and write its header
+bool HistoryStore::startSector() {
+    uint16_t sector = nextSector(_head);
+    uint32_t header[2] = {HISTORY_SECTOR_MAGIC, _sequence + 1};
+    if (esp_partition_erase_range(_partition, sectorAddress(sector), SPI_FLASH_SEC_SIZE) != ESP_OK ||
+        esp_partition_write(_partition, sectorAddress(sector), header, sizeof(header)) != ESP_OK) {
+        return false;
+    }
+    historyErasesMetric.inc();
+    _index[sector].firstSec = 0;
+    _index[sector].lastSec = 0;
+    _head = sector;
+    _headOffset = HISTORY_SECTOR_HEADER_BYTES;
+    _sequence++;
+    historySectorsMetric.set(sectorsUsed());
+
+    // A query still on the erased (oldest) sector moves on to the new oldest one
+    if (_queryActive && _phase == QUERY_FLASH && _sector == sector) {
+        _sector = nextSector(sector);
+        _offset = HISTORY_SECTOR_HEADER_BYTES;
+    }
+    return true;
+}
+
+// New RAM block, sized to fill the head sector (or a fresh one if little is left)
+void HistoryStore::startBlock() {
+    uint32_t room = SPI_FLASH_SEC_SIZE - _headOffset;
+    if (room < HISTORY_RECORD_HEADER_BYTES + HISTORY_MIN_BLOCK_BYTES) {
+        room = SPI_FLASH_SEC_SIZE - HISTORY_SECTOR_HEADER_BYTES;
+    }
+    _open.reset(room - HISTORY_RECORD_HEADER_BYTES);
+    _openedAt = millis();
+}
+
+// Write the RAM block as a record and empty it; false if it was lost
+bool HistoryStore::seal() {
+    if (_open.count() == 0) {
+        return true;
+    }
+    uint32_t bytes = recordBytes(_open.size());
+    bool ok = SPI_FLASH_SEC_SIZE - _headOffset >= bytes || startSector();
+    if (ok) {
+        RecordHeader header;
+        header.marker = HISTORY_RECORD_MARKER;
+        header.length = (uint16_t)_open.size();
+        header.crc = esp_rom_crc32_le(0, _open.data(), _open.size());
+        header.firstMs = _open.firstMs();
+        header.lastMs = _open.lastMs();
+        // Header first: a record cut short by a reset is still skipped over, and fails its CRC
+        uint32_t address = sectorAddress(_head) + _headOffset;
+        ok = esp_partition_write(_partition, address, &header, sizeof(header)) == ESP_OK &&
+             esp_partition_write(_partition, address + sizeof(header), _open.data(), _open.size()) == ESP_OK;
+        _headOffset += bytes;
+    }
+    if (ok) {
+        SectorSpan& span = _index[_head];
+        if (span.firstSec == 0) {
+            span.firstSec = (uint32_t)(_open.firstMs() / 1000ULL);
+        }
+        if (_open.lastMs() / 1000ULL > span.lastSec) {
+            span.lastSec = (uint32_t)(_open.lastMs() / 1000ULL);
+        }
+        historyRecordsMetric.inc();
+    } else {
+        historyWriteErrorsMetric.inc();
+        LOG_WARNF("[HISTORY] Flash write failed, %u readings lost\n", (unsigned)_open.count());
+    }
+    _open.reset();
+    return ok;
+}
+
+void HistoryStore::append(uint64_t epochMs, const float values[SENSOR_BLOCK_CHANNELS]) {
+    if (!_partition || epochMs == 0) {
+        return;
+    }
+    if (_open.count() == 0) {
+        startBlock();
+    }
+    if (!_open.append(epochMs, values)) {
+        // Block full, or the clock stepped back: write it out and start the next one with this reading
+        seal();
+        startBlock();
+        _open.append(epochMs, values);
+    }
+    historyReadingsMetric.inc();
+}
+
+void HistoryStore::flush() {
+    if (_partition) {
+        seal();
+    }
+}
+
+void HistoryStore::loop() {
+    if (_open.count() > 0 && millis() - _openedAt >= HISTORY_SEAL_INTERVAL_MS) {
+        seal();
+    }
+    if (_queryActive) {
+        queryStep();
+    }
+}
+
+uint16_t HistoryStore::sectorsUsed() const {
+    uint16_t used = 0;
+    for (uint16_t sector = 0; sector < _sectorCount; sector++) {
+        if (_index[sector].firstSec != 0) {
+            used++;
+        }
+    }
+    return used;
+}
+
+uint64_t HistoryStore::oldestMs() const {
+    for (uint16_t i = 0, sector = nextSector(_head); i < _sectorCount; i++, sector = nextSector(sector)) {
+        if (_index[sector].firstSec != 0) {
+            return (uint64_t)_index[sector].firstSec * 1000ULL;
+        }
+    }
+    return 0;
+}
+
+void HistoryStore::handleQuery(VPSWebSocketClient& client, JsonObject& query) {
+    const char* requestId = query["request_id"] | "";
+    if (!_partition) {
+        reject(client, requestId, "no history partition");
+        return;
+    }
+    if (_queryActive) {
+        reject(client, requestId, "busy");
+        return;
+    }
+    uint64_t now = timeBase.epochMs();
+    uint64_t to = query["to"] | now;
+    uint64_t from = query["from"] | (to > DEFAULT_SPAN_MS ? to - DEFAULT_SPAN_MS : (uint64_t)0);
+    uint32_t step = query["step"] | DEFAULT_STEP_MS;
+    if (to <= from || step < HISTORY_MIN_STEP_MS) {
+        reject(client, requestId, "bad range");
+        return;
+    }
+    if ((to - from - 1) / step + 1 > HISTORY_MAX_BUCKETS) {
+        reject(client, requestId, "too many buckets");
+        return;
+    }
+
+    strncpy(_requestId, requestId, sizeof(_requestId) - 1);
+    _requestId[sizeof(_requestId) - 1] = '\0';
+    _client = &client;
+    _from = from;
+    _to = to;
+    _step = step;
+    _notBefore = now > RETENTION_MS && now - RETENTION_MS > from ? now - RETENTION_MS : from;
+    _phase = QUERY_FLASH;
+    _sector = nextSector(_head);  // Oldest first
+    _offset = HISTORY_SECTOR_HEADER_BYTES;
+    _decoding = false;
+    _bucket = -1;
+    _bucketReadings = 0;
+    _chunkBuckets = 0;
+    _chunkSeq = 0;
+    _readings = 0;
+    _recordsRead = 0;
+    _recordsSkipped = 0;
+    _queryStartUs = TimeBase::monotonicUs();
+    _queryActive = true;
+    historyQueriesMetric.inc();
+}
+
+void HistoryStore::reject(VPSWebSocketClient& client, const char* requestId, const char* error) {
+    LOG_WARNF("[HISTORY] Query %s rejected: %s\n", requestId, error);
+    StaticJsonDocument<JSON_OBJECT_SIZE(6)> data;
+    data["device_id"] = client.getDeviceId();
+    data["request_id"] = requestId;
+    data["seq"] = 0;
+    data["buckets"] = 0;
+    data["done"] = true;
+    data["error"] = error;
+    client.emit("sensor:history:chunk", data);
+}
+
+// Aggregate up to HISTORY_QUERY_BUDGET_READINGS readings; send at most one chunk
+void HistoryStore::queryStep() {
+    if (!_client->isConnected()) {
+        LOG_WARNF("[HISTORY] Query %s dropped: disconnected\n", _requestId);
+        _queryActive = false;
+        return;
+    }
+    uint64_t t;
+    float values[SENSOR_BLOCK_CHANNELS];
+    for (uint16_t budget = HISTORY_QUERY_BUDGET_READINGS; budget > 0;) {
+        if (_chunkBuckets == HISTORY_CHUNK_BUCKETS) {
+            if (!sendChunk(false)) {
+                _queryActive = false;
+            }
+            return;
+        }
+        if (!_decoding) {
+            if (!nextRecord()) {
+                closeBucket();
+                finishQuery();
+                return;
+            }
+            _decoding = true;
+        }
+        if (!_decoder.next(t, values)) {
+            _decoding = false;
+            continue;
+        }
+        addReading(t, values);
+        budget--;
+    }
+}
+
+// Copy the next block that overlaps the query into _record and point _decoder at it; false when none is left
+bool HistoryStore::nextRecord() {
+    while (_phase == QUERY_FLASH) {
+        const SectorSpan& span = _index[_sector];
+        bool overlaps = span.firstSec != 0 && (uint64_t)span.lastSec * 1000ULL + 999 >= _notBefore &&
+                        (uint64_t)span.firstSec * 1000ULL < _to;
+        RecordHeader header;
+        if (overlaps && readRecordHeader(_sector, _offset, header)) {
+            uint32_t address = sectorAddress(_sector) + _offset + HISTORY_RECORD_HEADER_BYTES;
+            _offset += recordBytes(header.length);
+            if (header.lastMs < _notBefore || header.firstMs >= _to) {
+                _recordsSkipped++;
+                continue;
+            }
+            if (esp_partition_read(_partition, address, _record, header.length) != ESP_OK ||
+                esp_rom_crc32_le(0, _record, header.length) != header.crc) {
+                historyCorruptMetric.inc();
+                continue;
+            }
+            _recordsRead++;
+            _decoder = SensorBlockDecoder(_record, header.length);
+            return true;
+        }
+        if (!overlaps && span.firstSec != 0) {
+            _recordsSkipped++;
+        }
+        if (_sector == _head) {
+            _phase = QUERY_RAM;
+        } else {
+            _sector = nextSector(_sector);
+            _offset = HISTORY_SECTOR_HEADER_BYTES;
+        }
+    }
+    if (_phase == QUERY_RAM) {
+        _phase = QUERY_END;
+        // Copied: the RAM block keeps growing (or is sealed) while the query runs
+        if (_open.count() > 0 && _open.lastMs() >= _notBefore && _open.firstMs() < _to) {
+            memcpy(_record, _open.data(), _open.size());
+            _decoder = SensorBlockDecoder(_record, _open.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+void HistoryStore::addReading(uint64_t t, const float values[SENSOR_BLOCK_CHANNELS]) {
+    if (t < _notBefore || t >= _to) {
+        return;
+    }
+    int64_t bucket = (int64_t)((t - _from) / _step);
+    if (bucket > _bucket) {
+        closeBucket();
+        _bucket = bucket;
+    }
+    // A reading older than the open bucket (the clock stepped back between records) is counted in it
+    for (uint8_t channel = 0; channel < SENSOR_BLOCK_CHANNELS; channel++) {
+        float value = values[channel];
+        if (_bucketReadings == 0) {
+            _min[channel] = value;
+            _max[channel] = value;
+            _sum[channel] = value;
+        } else {
+            _min[channel] = value < _min[channel] ? value : _min[channel];
+            _max[channel] = value > _max[channel] ? value : _max[channel];
+            _sum[channel] += value;
+        }
+    }
+    _bucketReadings++;
+    _readings++;
+}
+
+// Append the bucket being filled to the chunk
+void HistoryStore::closeBucket() {
+    if (_bucketReadings == 0) {
+        return;
+    }
+    uint8_t* out = _chunk + _chunkBuckets * HISTORY_BUCKET_BYTES;
+    out = putU32(out, (uint32_t)_bucket);
+    out = putU32(out, _bucketReadings);
+    for (uint8_t channel = 0; channel < SENSOR_BLOCK_CHANNELS; channel++) {
+        out = putFloat(out, _min[channel]);
+        out = putFloat(out, (float)(_sum[channel] / _bucketReadings));
+        out = putFloat(out, _max[channel]);
+    }
+    _chunkBuckets++;
+    _bucketReadings = 0;
+}
+
+bool HistoryStore::sendChunk(bool done) {
+    StaticJsonDocument<JSON_OBJECT_SIZE(11) + JSON_OBJECT_SIZE(2)> data;  // + the attachment placeholder
+    data["device_id"] = _client->getDeviceId();
+    data["request_id"] = (const char*)_requestId;
+    data["seq"] = _chunkSeq;
+    data["from"] = _from;
+    data["step"] = _step;
+    data["buckets"] = _chunkBuckets;
+    data["done"] = done;
+    if (done) {
+        data["readings"] = _readings;
+        data["records"] = _recordsRead;
+        data["skipped"] = _recordsSkipped;
+    }
+    bool sent = _chunkBuckets > 0
+        ? _client->emitBinary("sensor:history:chunk", data, "data", _chunk, _chunkBuckets * HISTORY_BUCKET_BYTES)
+        : _client->emit("sensor:history:chunk", data);
+    _chunkSeq++;
+    _chunkBuckets = 0;
+    return sent;
+}
+
+void HistoryStore::finishQuery() {
+    sendChunk(true);
+    _queryActive = false;
+    uint32_t ms = (uint32_t)((TimeBase::monotonicUs() - _queryStartUs) / 1000ULL);
+    historyQueryMetric.set((int32_t)ms);
+    LOG_INFOF("[HISTORY] Query %s: %lu readings in %u chunks, %lu records read, %lu skipped, %lu ms\n", _requestId,
+              (unsigned long)_readings, (unsigned)_chunkSeq, (unsigned long)_recordsRead,
+              (unsigned long)_recordsSkipped, (unsigned long)ms);
+}
@@ -0,0 +1,174 @@
+// Graduated recovery of the backend link: socket, TLS, WiFi, driver, reboot
+
+#include "link_recovery.h"
+#include "metrics.h"
+#include "runtime_config.h"
+
+// Global instance
+LinkRecovery linkRecovery;
+
+/**
+ * Written just before a reboot taken by the ladder; survives the restart (not
+ * a power loss) so the next boot can report the recovery and keep counting
+ */
+struct LinkRecoveryRecord {
+    uint32_t magic;
+    uint32_t outageMs;      // Outage up to the reboot
+    uint32_t reboots;       // Ladder reboots in this outage
+    uint32_t check;         // ~(magic ^ outageMs ^ reboots)
+};
+
+RTC_NOINIT_ATTR static LinkRecoveryRecord rtcRecord;
+
+static Counter socketActionsMetric("link_recovery_socket_total", "Socket resets taken by the link recovery ladder");
+static Counter tlsActionsMetric("link_recovery_tls_total", "TLS re-handshakes taken by the link recovery ladder");
+static Counter reassociateActionsMetric("link_recovery_reassociate_total", "WiFi reassociations taken by the link recovery ladder");
+static Counter wifiRestartActionsMetric("link_recovery_wifi_restart_total", "WiFi driver restarts taken by the link recovery ladder");
+static Counter rebootActionsMetric("link_recovery_reboot_total", "Reboots taken by the link recovery ladder (counted after the restart)");
+static Gauge socketRecoveryMetric("link_recovery_socket_ms", "Socket reset to authenticated, last outage it ended");
+static Gauge tlsRecoveryMetric("link_recovery_tls_ms", "TLS re-handshake to authenticated, last outage it ended");
+static Gauge reassociateRecoveryMetric("link_recovery_reassociate_ms", "WiFi reassociation to authenticated, last outage it ended");
+static Gauge wifiRestartRecoveryMetric("link_recovery_wifi_restart_ms", "WiFi driver restart to authenticated, last outage it ended");
+static Gauge rebootRecoveryMetric("link_recovery_reboot_ms", "Reset to authenticated, last outage a reboot ended");
+
+static Counter* const ACTION_METRICS[RECOVERY_RUNG_COUNT] = {
+    nullptr, &socketActionsMetric, &tlsActionsMetric, &reassociateActionsMetric, &wifiRestartActionsMetric,
+    &rebootActionsMetric
+};
+static Gauge* const RECOVERY_METRICS[RECOVERY_RUNG_COUNT] = {
+    nullptr, &socketRecoveryMetric, &tlsRecoveryMetric, &reassociateRecoveryMetric, &wifiRestartRecoveryMetric,
+    &rebootRecoveryMetric
+};
+
+static const char* const RUNG_NAMES[RECOVERY_RUNG_COUNT] = {
+    "none",
+    "socket",
+    "tls",
+    "reassociate",
+    "wifi_restart",
+    "reboot"
+};
+
+static const uint32_t RECOVERY_RECORD_MAGIC = 0x4C4E4B31;  // "LNK1"
+
+LinkRecovery::LinkRecovery() {
+    _rung = RECOVERY_RUNG_NONE;
+    _outage = false;
+    _outageStart = 0;
+    _rungAt = 0;
+    _nextRungAt = 0;
+    _priorOutageMs = 0;
+    _reboots = 0;
+    memset(&_report, 0, sizeof(_report));
+    _reportPending = false;
+    _actionCallback = nullptr;
+}
+
+void LinkRecovery::begin() {
+    if (rtcRecord.magic != RECOVERY_RECORD_MAGIC ||
+        rtcRecord.check != ~(rtcRecord.magic ^ rtcRecord.outageMs ^ rtcRecord.reboots)) {
+        return;  // Not restarted by the ladder (or power-on: RTC memory is garbage)
+    }
+    // The outage goes on from the reset; the reboot is the rung being measured
+    _rung = RECOVERY_RUNG_REBOOT;
+    _rungAt = 0;
+    _outage = true;
+    _outageStart = millis();
+    _nextRungAt = _outageStart + runtimeConfig.values().healthCheckIntervalMs;
+    _priorOutageMs = rtcRecord.outageMs;
+    _reboots = (uint8_t)min(rtcRecord.reboots, (uint32_t)255);
+    rebootActionsMetric.inc();
+    LOG_WARNF("Restarted by link recovery after %u s without the backend (reboot %u)\n",
+              (unsigned)(_priorOutageMs / 1000), (unsigned)_reboots);
+}
+
+void LinkRecovery::update(bool wifiUp, bool backendUp, bool rejected) {
+    unsigned long now = millis();
+    if (backendUp) {
+        if (_outage) {
+            recovered(now);
+        }
+        return;
+    }
+
+    uint32_t interval = runtimeConfig.values().healthCheckIntervalMs;
+    if (!_outage) {
+        _outage = true;
+        _outageStart = now;
+        _nextRungAt = now + interval;
+    }
+    if (!wifiUp || rejected) {
+        // WiFiLink rejoins in place and no rung helps against a refused token:
+        // the link gets a full interval once it is back
+        _nextRungAt = now + interval;
+        return;
+    }
+    if ((long)(now - _nextRungAt) >= 0) {
+        climb(now);
+    }
+}
+
+void LinkRecovery::onAction(RecoveryActionCallback callback) {
+    _actionCallback = callback;
+}
+
+void LinkRecovery::appendTo(JsonObject data) const {
+    data["rung"] = rungName(_report.rung);
+    data["recovery_ms"] = _report.recoveryMs;
+    data["outage_ms"] = _report.outageMs;
+}
+
+const char* LinkRecovery::rungName(RecoveryRung rung) {
+    return rung < RECOVERY_RUNG_COUNT ? RUNG_NAMES[rung] : "unknown";
+}
+
+void LinkRecovery::climb(unsigned long now) {
+    // After a reboot the ladder starts over from the socket
+    RecoveryRung next = _rung == RECOVERY_RUNG_REBOOT ? RECOVERY_RUNG_SOCKET : (RecoveryRung)(_rung + 1);
+    unsigned long outageMs = now - _outageStart;
+    if (next == RECOVERY_RUNG_REBOOT && outageMs < rebootAfterMs()) {
+        // Every cheaper rung failed; the client keeps retrying until the reboot is due
+        _nextRungAt = _outageStart + rebootAfterMs();
+        return;
+    }
+
+    _rung = next;
+    _rungAt = now;
+    _nextRungAt = now + runtimeConfig.values().healthCheckIntervalMs;
+    LOG_WARNF("Backend unreachable for %u s: link recovery %s\n", (unsigned)(outageMs / 1000), rungName(next));
+
+    if (next == RECOVERY_RUNG_REBOOT) {
+        rtcRecord.magic = RECOVERY_RECORD_MAGIC;
+        rtcRecord.outageMs = _priorOutageMs + outageMs;
+        rtcRecord.reboots = _reboots + 1;
+        rtcRecord.check = ~(rtcRecord.magic ^ rtcRecord.outageMs ^ rtcRecord.reboots);
+    } else {
+        ACTION_METRICS[next]->inc();
+    }
+    if (_actionCallback) {
+        _actionCallback(next);
+    }
+}
+
+void LinkRecovery::recovered(unsigned long now) {
+    if (_rung != RECOVERY_RUNG_NONE) {
+        _report.rung = _rung;
+        _report.recoveryMs = now - _rungAt;
+        _report.outageMs = _priorOutageMs + (now - _outageStart);
+        _reportPending = true;
+        RECOVERY_METRICS[_rung]->set(_report.recoveryMs);
+        LOG_INFOF("[OK] Backend back %u ms after link recovery %s (outage %u s)\n", (unsigned)_report.recoveryMs,
+                  rungName(_rung), (unsigned)(_report.outageMs / 1000));
+    }
+    _rung = RECOVERY_RUNG_NONE;
+    _outage = false;
+    _priorOutageMs = 0;
+    _reboots = 0;
+    rtcRecord.magic = 0;
+}
+
+unsigned long LinkRecovery::rebootAfterMs() const {
+    // Each reboot of the same outage doubles the wait: a server that is down stays down
+    return min((unsigned long)LINK_RECOVERY_REBOOT_AFTER_MS << min((int)_reboots, 8),
+               (unsigned long)LINK_RECOVERY_REBOOT_MAX_MS);
+}
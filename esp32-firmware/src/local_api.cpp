@@ -0,0 +1,250 @@
+// Signed UDP control endpoint for the LAN (relay commands and sensor reads without the VPS)
+
+#include "local_api.h"
+#include "sensors.h"
+#include "metrics.h"
+#include <mbedtls/md.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Global instance
+LocalApi localApi;
+
+extern VPSWebSocketClient vpsWebSocket;  // Defined in main.cpp
+
+static Counter requestsMetric("local_api_requests_total", "Signed LAN API requests handled");
+static Counter rejectedMetric("local_api_rejected_total", "LAN API datagrams dropped (unsigned, malformed or replayed)");
+
+static const char KEY_DERIVATION_PREFIX[] = "ghlan1:";  // Bumped if the derivation ever changes
+static const size_t SIGNATURE_HEX_LENGTH = 64;           // HMAC-SHA256, lowercase hex
+
+static void formatHex(const uint8_t* bytes, size_t length, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+    out[2 * length] = '\0';
+}
+
+LocalApi::LocalApi() {
+    _socket = -1;
+    _key[0] = '\0';
+    _bootId[0] = '\0';
+    _clientCount = 0;
+    _relayCommandCallback = nullptr;
+}
+
+void LocalApi::onRelayCommand(RelayCommandCallback callback) {
+    _relayCommandCallback = callback;
+}
+
+void LocalApi::begin(const char* deviceId) {
+#if LOCAL_API_PORT
+    if (_socket >= 0) {
+        return;  // Bound at the first association; the socket survives reconnects
+    }
+
+    if (LOCAL_API_KEY[0] != '\0') {
+        strncpy(_key, LOCAL_API_KEY, sizeof(_key) - 1);
+        _key[sizeof(_key) - 1] = '\0';
+    } else {
+        // Per-device key the backend can hand out without revealing its own token
+        char label[sizeof(KEY_DERIVATION_PREFIX) + DEVICE_ID_MAX_LENGTH];
+        int labelLength = snprintf(label, sizeof(label), "%s%s", KEY_DERIVATION_PREFIX, deviceId);
+        uint8_t derived[32];
+        mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*)DEVICE_AUTH_TOKEN,
+                        strlen(DEVICE_AUTH_TOKEN), (const uint8_t*)label, (size_t)labelLength, derived);
+        formatHex(derived, sizeof(derived), _key);
+    }
+    // Requests signed for an earlier boot carry another ID: seq counters restart safely
+    snprintf(_bootId, sizeof(_bootId), "%08lx", (unsigned long)esp_random());
+    _clientCount = 0;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("[LAN] Could not create the UDP socket");
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(LOCAL_API_PORT);
+#ifdef NATIVE_BUILD
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // Host builds stay off the real LAN
+#else
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+#endif
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LOG_ERRORF("[LAN] Could not bind UDP port %d\n", LOCAL_API_PORT);
+        close(fd);
+        return;
+    }
+    _socket = fd;
+    LOG_INFOF("[LAN] Control API on UDP %d (boot %s)\n", LOCAL_API_PORT, _bootId);
+#else
+    (void)deviceId;
+#endif
+}
+
+void LocalApi::loop() {
+    if (_socket < 0) {
+        return;
+    }
+    for (int i = 0; i < LOCAL_API_MAX_PER_LOOP; i++) {
+        struct sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+        // One byte more than accepted, so an oversized datagram is detected rather than cut
+        int received = recvfrom(_socket, _request, LOCAL_API_MAX_DATAGRAM + 1, MSG_DONTWAIT, (struct sockaddr*)&from,
+                                &fromLength);
+        if (received < 0) {
+            return;  // Nothing waiting
+        }
+        if (received == 0 || received > LOCAL_API_MAX_DATAGRAM) {
+            rejectedMetric.inc();
+            continue;
+        }
+        handleRequest((size_t)received, &from, fromLength);
+    }
+}
+
+void LocalApi::sign(const char* json, size_t jsonLength, char* out) const {
+    uint8_t mac[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*)_key, strlen(_key),
+                    (const uint8_t*)json, jsonLength, mac);
+    formatHex(mac, sizeof(mac), out);
+}
+
+bool LocalApi::verify(const char* json, size_t jsonLength, const char* signature) const {
+    char expected[SIGNATURE_HEX_LENGTH + 1];
+    sign(json, jsonLength, expected);
+    // Constant time: how far a forgery matches must not show in the timing
+    uint8_t diff = 0;
+    for (size_t i = 0; i < SIGNATURE_HEX_LENGTH; i++) {
+        diff |= (uint8_t)(expected[i] ^ signature[i]);
+    }
+    return diff == 0;
+}
+
+LocalApi::Client* LocalApi::findClient(const char* name, bool create) {
+    for (uint8_t i = 0; i < _clientCount; i++) {
+        if (strcmp(_clients[i].name, name) == 0) {
+            return &_clients[i];
+        }
+    }
+    // No eviction: a forgotten client could have its old datagrams replayed
+    if (!create || _clientCount >= LOCAL_API_MAX_CLIENTS || name[0] == '\0' ||
+        strlen(name) >= LOCAL_API_CLIENT_NAME_MAX) {
+        return nullptr;
+    }
+    Client* client = &_clients[_clientCount++];
+    strcpy(client->name, name);
+    client->lastSeq = 0;
+    return client;
+}
+
+void LocalApi::handleRequest(size_t length, const void* from, size_t fromLength) {
+    // <json>\n<64 hex>
+    if (length < SIGNATURE_HEX_LENGTH + 2 || _request[length - SIGNATURE_HEX_LENGTH - 1] != '\n') {
+        rejectedMetric.inc();
+        return;
+    }
+    size_t jsonLength = length - SIGNATURE_HEX_LENGTH - 1;
+    if (!verify(_request, jsonLength, _request + jsonLength + 1)) {
+        rejectedMetric.inc();
+        return;  // No reply: an unauthenticated sender learns nothing and cannot reflect traffic
+    }
+
+    StaticJsonDocument<384> request;
+    if (deserializeJson(request, _request, jsonLength)) {
+        rejectedMetric.inc();
+        return;
+    }
+    const char* event = request["event"] | "";
+    const char* clientName = request["client"] | "";
+    uint32_t seq = request["seq"] | 0;
+
+    StaticJsonDocument<384> response;
+    response["seq"] = seq;
+
+    if (strcmp(event, "hello") == 0) {
+        Client* client = findClient(clientName, false);
+        response["event"] = "hello";
+        response["boot"] = _bootId;
+        response["device_id"] = vpsWebSocket.getDeviceId();
+        response["relay_count"] = RELAY_COUNT;
+        response["last_seq"] = client ? client->lastSeq : 0;
+        requestsMetric.inc();
+        respond(response, from, fromLength);
+        return;
+    }
+
+    const char* boot = request["boot"] | "";
+    Client* client = strcmp(boot, _bootId) == 0 ? findClient(clientName, true) : nullptr;
+    if (!client || seq <= client->lastSeq) {
+        rejectedMetric.inc();
+        response["event"] = "error";
+        if (strcmp(boot, _bootId) != 0) {
+            response["error"] = "stale_boot";
+            response["boot"] = _bootId;
+        } else if (!client) {
+            response["error"] = "too_many_clients";
+        } else {
+            response["error"] = "stale_seq";
+            response["last_seq"] = client->lastSeq;
+        }
+        respond(response, from, fromLength);
+        return;
+    }
+    client->lastSeq = seq;
+    requestsMetric.inc();
+
+    if (strcmp(event, "relay:command") == 0) {
+        JsonObject data = request["data"];
+        JsonObject payload = response.createNestedObject("data");
+        int relayId;
+        bool state;
+        const char* rejected = VPSWebSocketClient::parseRelayCommand(data, relayId, state);
+        if (rejected) {
+            response["event"] = "relay:error";
+            VPSWebSocketClient::fillRelayError(payload, rejected, relayId);
+        } else {
+            if (_relayCommandCallback) {
+                _relayCommandCallback(relayId, state);
+            }
+            response["event"] = "relay:state";
+            vpsWebSocket.fillRelayState(payload, relayId, state, "remote", "lan");
+        }
+    } else if (strcmp(event, "sensor:request") == 0) {
+        // Latest reading: a fresh DHT sample would cost more than the whole round trip
+        SensorData reading = sensors.getCurrentData();
+        if (!reading.valid) {
+            response["event"] = "error";
+            response["error"] = "no_reading";
+        } else {
+            response["event"] = "sensor:data";
+            vpsWebSocket.fillSensorData(response.createNestedObject("data"), reading.temperature, reading.humidity,
+                                        reading.soil_moisture, sensors.getTempErrors(), sensors.getHumidityErrors(),
+                                        reading.acquired_ms);
+        }
+    } else {
+        response["event"] = "error";
+        response["error"] = "unknown_event";
+    }
+    respond(response, from, fromLength);
+}
+
+void LocalApi::respond(JsonDocument& response, const void* to, size_t toLength) {
+    size_t jsonLength = measureJson(response);
+    if (jsonLength + 1 + SIGNATURE_HEX_LENGTH > LOCAL_API_MAX_DATAGRAM) {
+        LOG_WARN("[LAN] Reply too large, dropped");
+        return;
+    }
+    serializeJson(response, _reply, sizeof(_reply));
+    _reply[jsonLength] = '\n';
+    sign(_reply, jsonLength, _reply + jsonLength + 1);
+    sendto(_socket, _reply, jsonLength + 1 + SIGNATURE_HEX_LENGTH, 0, (const struct sockaddr*)to, (socklen_t)toLength);
+}
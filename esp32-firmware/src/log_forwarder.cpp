@@ -0,0 +1,246 @@
+// Remote log forwarding: per-callsite token buckets, duplicate folding, batching
+
+#include "log_forwarder.h"
+#include "runtime_config.h"
+
+// Global instance
+LogForwarder logForwarder;
+
+// Shared between the log drain task (capture) and the loop task (takeBatch)
+static portMUX_TYPE forwarderMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const LEVEL_NAMES[] = {"none", "error", "warning", "info", "debug"};
+
+static uint32_t messageHash(const char* text, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    }
+    return hash;
+}
+
+LogForwarder::LogForwarder() {
+    memset(_batches, 0, sizeof(_batches));
+    memset(_sites, 0, sizeof(_sites));
+    _active = 0;
+    _level = LOG_FORWARD_LEVEL;
+    _lastFlush = 0;
+}
+
+void LogForwarder::capture(uintptr_t site, uint8_t level, uint32_t timestamp, const char* text, size_t length) {
+    if (level == 0 || level > _level) {
+        return;
+    }
+    // Forward single lines: drop the trailing newline the LOG_* macros add
+    while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r')) {
+        length--;
+    }
+    if (length == 0) {
+        return;
+    }
+    if (length > LOG_FORWARD_MESSAGE_MAX - 1) {
+        length = LOG_FORWARD_MESSAGE_MAX - 1;
+    }
+    uint32_t hash = messageHash(text, length);
+
+    portENTER_CRITICAL(&forwarderMux);
+    Site& slot = siteFor(site, timestamp);
+    slot.lastUse = timestamp;
+
+    if (slot.lastHash == hash && slot.lastText[0] != '\0') {
+        // Same message again from the same place: count it, send it later once
+        if (slot.repeats < UINT16_MAX) {
+            slot.repeats++;
+        }
+        slot.repeatTimestamp = timestamp;
+        portEXIT_CRITICAL(&forwarderMux);
+        return;
+    }
+
+    flushRepeats(slot);
+    slot.lastHash = hash;
+    slot.level = level;
+    memcpy(slot.lastText, text, length);
+    slot.lastText[length] = '\0';
+
+    refill(slot, timestamp);
+    if (slot.tokens == 0) {
+        _batches[_active].dropped++;
+    } else {
+        slot.tokens--;
+        append(level, timestamp, 1, text, length);
+    }
+    portEXIT_CRITICAL(&forwarderMux);
+}
+
+void LogForwarder::enqueue(uint8_t level, const char* text) {
+    uint32_t now = millis();
+    size_t length = strlen(text);
+    portENTER_CRITICAL(&forwarderMux);
+    append(level, now, 1, text, length);
+    portEXIT_CRITICAL(&forwarderMux);
+}
+
+bool LogForwarder::due() {
+    if (millis() - _lastFlush < runtimeConfig.values().logForwardIntervalMs) {
+        return false;
+    }
+    bool pending = false;
+    portENTER_CRITICAL(&forwarderMux);
+    const Batch& batch = _batches[_active];
+    pending = batch.size > 0 || batch.dropped > 0;
+    for (uint8_t i = 0; i < RATE_LIMIT_SLOTS && !pending; i++) {
+        pending = _sites[i].repeats > 0;
+    }
+    portEXIT_CRITICAL(&forwarderMux);
+    return pending;
+}
+
+uint32_t LogForwarder::takeBatch(JsonArray logs) {
+    _lastFlush = millis();
+
+    portENTER_CRITICAL(&forwarderMux);
+    for (uint8_t i = 0; i < RATE_LIMIT_SLOTS; i++) {
+        flushRepeats(_sites[i]);
+    }
+    uint8_t full = _active;
+    Batch& next = _batches[full ^ 1];
+    next.size = 0;
+    next.dropped = 0;
+    _active = full ^ 1;
+    portEXIT_CRITICAL(&forwarderMux);
+
+    // The captured buffer is now owned by this task until the next swap
+    const Batch& batch = _batches[full];
+    for (uint8_t i = 0; i < batch.size; i++) {
+        const Entry& entry = batch.entries[i];
+        JsonObject obj = logs.createNestedObject();
+        obj["level"] = levelName(entry.level);
+        obj["message"] = (const char*)entry.text;
+        obj["ts"] = entry.timestamp;
+        if (entry.count > 1) {
+            obj["count"] = entry.count;
+        }
+    }
+    return batch.dropped;
+}
+
+void LogForwarder::setLevels(int serialLevel, int remoteLevel) {
+    if (remoteLevel >= 0) {
+        _level = (uint8_t)remoteLevel;
+    }
+    uint8_t serial = serialLevel >= 0 ? (uint8_t)serialLevel : deferredLog.getSerialLevel();
+    // Records must still be captured when only the backend wants them
+    deferredLog.setLevels(serial, serial > _level ? serial : _level);
+    LOG_INFOF("Log levels: serial=%s remote=%s\n", levelName(serial), levelName(_level));
+}
+
+int LogForwarder::parseLevel(JsonVariantConst value) {
+    if (value.is<int>()) {
+        int level = value.as<int>();
+        return level >= 0 && level <= LOG_LEVEL_DEBUG ? level : -1;
+    }
+    return parseLevel(value.as<const char*>());
+}
+
+int LogForwarder::parseLevel(const char* name) {
+    if (name == nullptr) {
+        return -1;
+    }
+    for (uint8_t i = 0; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcasecmp(name, LEVEL_NAMES[i]) == 0) {
+            return i;
+        }
+    }
+    if (strcasecmp(name, "warn") == 0) {
+        return LOG_LEVEL_WARN;
+    }
+    return -1;
+}
+
+const char* LogForwarder::levelName(uint8_t level) {
+    return level <= LOG_LEVEL_DEBUG ? LEVEL_NAMES[level] : "debug";
+}
+
+LogForwarder::Site& LogForwarder::siteFor(uintptr_t site, uint32_t now) {
+    Site* oldest = &_sites[0];
+    for (uint8_t i = 0; i < RATE_LIMIT_SLOTS; i++) {
+        if (_sites[i].site == site) {
+            return _sites[i];
+        }
+        if (_sites[i].site == 0) {
+            oldest = &_sites[i];
+            break;
+        }
+        if ((int32_t)(_sites[i].lastUse - oldest->lastUse) < 0) {
+            oldest = &_sites[i];
+        }
+    }
+
+    // Recycle the least recently used bucket, reporting its pending repeats first
+    flushRepeats(*oldest);
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->site = site;
+    oldest->tokens = LOG_FORWARD_BUCKET_BURST;
+    oldest->lastRefill = now;
+    return *oldest;
+}
+
+void LogForwarder::refill(Site& slot, uint32_t now) {
+    uint32_t earned = (now - slot.lastRefill) / LOG_FORWARD_BUCKET_REFILL_MS;
+    if (earned == 0) {
+        return;
+    }
+    uint32_t tokens = slot.tokens + earned;
+    slot.tokens = tokens > LOG_FORWARD_BUCKET_BURST ? LOG_FORWARD_BUCKET_BURST : (uint8_t)tokens;
+    slot.lastRefill += earned * LOG_FORWARD_BUCKET_REFILL_MS;
+}
+
+void LogForwarder::flushRepeats(Site& slot) {
+    if (slot.repeats == 0) {
+        return;
+    }
+    // Built by hand: this runs inside the critical section, where printf is off limits
+    static const char SUFFIX_START[] = " (repeated ";
+    static const char SUFFIX_END[] = " times)";
+    char digits[6];
+    size_t digitCount = 0;
+    for (uint16_t n = slot.repeats; n > 0; n /= 10) {
+        digits[digitCount++] = (char)('0' + n % 10);
+    }
+    size_t suffixLength = sizeof(SUFFIX_START) - 1 + digitCount + sizeof(SUFFIX_END) - 1;
+
+    char text[LOG_FORWARD_MESSAGE_MAX];
+    size_t length = strlen(slot.lastText);
+    if (length > sizeof(text) - 1 - suffixLength) {
+        length = sizeof(text) - 1 - suffixLength;
+    }
+    memcpy(text, slot.lastText, length);
+    memcpy(text + length, SUFFIX_START, sizeof(SUFFIX_START) - 1);
+    length += sizeof(SUFFIX_START) - 1;
+    while (digitCount > 0) {
+        text[length++] = digits[--digitCount];
+    }
+    memcpy(text + length, SUFFIX_END, sizeof(SUFFIX_END) - 1);
+    length += sizeof(SUFFIX_END) - 1;
+    append(slot.level, slot.repeatTimestamp, slot.repeats, text, length);
+    slot.repeats = 0;
+}
+
+bool LogForwarder::append(uint8_t level, uint32_t timestamp, uint16_t count, const char* text, size_t length) {
+    Batch& batch = _batches[_active];
+    if (batch.size >= LOG_FORWARD_BATCH_MAX) {
+        batch.dropped += count;
+        return false;
+    }
+    if (length > LOG_FORWARD_MESSAGE_MAX - 1) {
+        length = LOG_FORWARD_MESSAGE_MAX - 1;
+    }
+    Entry& entry = batch.entries[batch.size++];
+    entry.level = level;
+    entry.count = count;
+    entry.timestamp = timestamp;
+    memcpy(entry.text, text, length);
+    entry.text[length] = '\0';
+    return true;
+}
@@ -2,16 +2,29 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <time.h>
 #include <esp_task_wdt.h>
 #include <ArduinoOTA.h>
 #include "config.h"
 #include "vps_config.h"
-#include "vps_client.h"
 #include "vps_websocket.h"
+#include "local_api.h"
+#include "anomaly_detector.h"
+#include "sensor_block.h"
+#include "history_store.h"
+#include "climate_control.h"
 #include "ota.h"
+#include "ota_updater.h"
 #include "sensors.h"
 #include "relays.h"
+#include "memory_monitor.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "boot_timeline.h"
+#include "wifi_link.h"
+#include "link_recovery.h"
+#include "time_base.h"
+#include "runtime_config.h"
+#include "alloc_counter.h"
 #include "secrets.h"
 
 // Watchdog configuration
@@ -21,26 +34,98 @@ extern SensorManager sensors;
 extern RelayManager relays;
 
 // Global instances
-VPSClient vpsClient;
 VPSWebSocketClient vpsWebSocket;
+#if METRICS_HTTP_PORT
+WiFiServer metricsServer(METRICS_HTTP_PORT);
+WiFiClient scrapeClient;                // Scrape whose request headers are still arriving
+unsigned long scrapeAcceptedAt = 0;
+uint8_t scrapeNewlines = 0;             // Consecutive line ends seen (2 = end of headers)
+#endif
+
+// Loop-level metrics
+static Histogram loopDurationMetric("loop_duration_us", "Duration of one main loop iteration in microseconds");
+static Gauge uptimeMetric("uptime_seconds", "Seconds since boot");
+static Counter sensorSendsMetric("sensor_sends_total", "Sensor readings sent to the backend");
+static Counter sensorSendFailuresMetric("sensor_send_failures_total", "Sensor readings that could not be sent");
+static Counter sensorBlocksMetric("sensor_blocks_sent_total", "sensor:block uploads of readings taken offline");
+static Counter sensorBacklogDroppedMetric("sensor_backlog_dropped_total",
+                                          "Offline readings not kept for backfill (block full)");
 
 // Timers
 unsigned long lastSensorSend = 0;
 unsigned long lastHealthCheck = 0;
 unsigned long lastMetricsSend = 0;
 
-// Status tracking
-bool vpsConnected = false;
-int failedRequests = 0;
-const int MAX_FAILED_REQUESTS = 5;
-
+void setupOTA();
 void sendSensorData();
+void publishSensorData();
+void recordHistory(const SensorData& data);
+void flushSensorBacklog();
 void sendMetrics();
 
+/**
+ * @brief Single relay command path for the backend and the LAN API
+ * 
+ * The new state is always reported to the backend, so the dashboard follows
+ * commands that arrived over the LAN. A real change holds drift detection
+ * while the greenhouse responds to it. A command on a relay under on-device
+ * control holds that loop (CONTROL_OVERRIDE_MS).
+ */
+void applyRelayCommand(int relayId, bool state, const char* changedBy) {
+    climateControl.overrideRelay(relayId);
+    if (relays.getRelayState(relayId) != state) {
+        anomalyDetector.actuatorChanged(TimeBase::monotonicMs());
+    }
+    relays.setRelay(relayId, state);
+    vpsWebSocket.sendRelayState(relayId, state, "remote", changedBy);
+}
+
 // WebSocket callbacks
 void onRelayCommand(int relayId, bool state) {
-    relays.setRelay(relayId, state);
-    vpsWebSocket.sendRelayState(relayId, state, "remote", "websocket");
+    applyRelayCommand(relayId, state, "websocket");
+}
+
+// LAN API callback
+void onLanRelayCommand(int relayId, bool state) {
+    applyRelayCommand(relayId, state, "lan");
+}
+
+// Climate controller callback
+void onControlSwitch(int relayId, bool state) {
+    anomalyDetector.actuatorChanged(TimeBase::monotonicMs());
+    vpsWebSocket.sendRelayState(relayId, state, "auto", "climate_control");
+}
+
+// Anomaly detector callback
+void onSensorAnomaly(const AnomalyEvent& event) {
+    LOG_WARNF("Sensor anomaly: %s %s (value %.1f, baseline %.1f, score %.1f)\n",
+              AnomalyDetector::channelName(event.channel), AnomalyDetector::kindName(event.kind), event.value,
+              event.baseline, event.score);
+    vpsWebSocket.sendAnomaly(event);
+}
+
+// Link recovery ladder callback
+void onRecoveryAction(RecoveryRung rung) {
+    switch (rung) {
+        case RECOVERY_RUNG_SOCKET:
+            vpsWebSocket.resetSocket();
+            break;
+        case RECOVERY_RUNG_TLS:
+            vpsWebSocket.restartTransport();
+            break;
+        case RECOVERY_RUNG_REASSOCIATE:
+            wifiLink.reassociate();
+            break;
+        case RECOVERY_RUNG_WIFI_RESTART:
+            wifiLink.restartDriver();
+            break;
+        case RECOVERY_RUNG_REBOOT:
+            deferredLog.flush();
+            ESP.restart();
+            break;
+        default:
+            break;
+    }
 }
 
 void onSensorRequestReceived() {
@@ -49,95 +134,123 @@ void onSensorRequestReceived() {
 }
 
 /**
- * @brief Setup WiFi connection with security considerations
+ * @brief Start the services that need an IP address
  * 
- * Establishes WiFi connection to the configured network.
- * - Uses WPA2 security (configured in secrets.h)
- * - Implements timeout with watchdog feeding
- * - Logs connection status but NOT SSID for security
- * - Restarts ESP32 if connection fails (critical for operation)
+ * - SNTP runs in the background (TimeBase); BOOT_PHASE_TIME is marked when it lands
+ * - The WebSocket client connects on its next loop() (TLS overlaps with SNTP)
+ * - OTA, the local metrics endpoint and the LAN control API
  */
-void setupWiFi() {
-    DEBUG_PRINTLN("Connecting to WiFi...");
-    // Don't log SSID for security (prevents network name disclosure)
-    
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-        delay(WIFI_CONNECT_DELAY_MS);
-        DEBUG_PRINT(".");
-        attempts++;
-        if (attempts % 5 == 0) {
-            esp_task_wdt_reset(); // Feed watchdog every 2.5 seconds during WiFi connection
-        }
+void startNetworkServices() {
+    timeBase.begin();
+    
+    setupOTA();
+    
+#if METRICS_HTTP_PORT
+    metricsServer.begin();
+    DEBUG_PRINTF("[OK] Metrics endpoint on port %d\n", (int)METRICS_HTTP_PORT);
+#endif
+    
+    localApi.begin(runtimeConfig.deviceId());
+    
+    DEBUG_PRINTLN("\n=== Initializing WebSocket ===");
+    vpsWebSocket.begin();
+}
+
+/**
+ * @brief Publish relay states and the latest reading once authenticated
+ * 
+ * The backend ignores device events before device:auth_success, so nothing
+ * is sent earlier; one relay frame per channel (RELAY_COUNT) goes out back to back.
+ */
+void publishInitialState() {
+    DEBUG_PRINTLN("\n=== Sending Initial Relay States ===");
+    vpsWebSocket.sendLog("info", "ESP32 Greenhouse started - WebSocket mode");
+    for (int i = 0; i < RELAY_COUNT; i++) {
+        bool state = relays.getRelayState(i);
+        vpsWebSocket.sendRelayState(i, state, "manual", "system");
+        DEBUG_PRINTF("Relay %d initial state: %s\n", i, state ? "ON" : "OFF");
     }
+    DEBUG_PRINTLN("[OK] Initial relay states sent");
     
-    if (WiFi.status() == WL_CONNECTED) {
-        DEBUG_PRINTLN("\n[OK] WiFi connected");
-        DEBUG_PRINT("IP address: ");
-        DEBUG_PRINTLN(WiFi.localIP());
-        DEBUG_PRINT("Signal strength: ");
-        DEBUG_PRINT(WiFi.RSSI());
-        DEBUG_PRINTLN(" dBm");
-    } else {
-        DEBUG_PRINTLN("\n✗ WiFi connection failed!");
-        DEBUG_PRINTLN("Restarting in 5 seconds...");
-        delay(WIFI_FAILED_RESTART_DELAY_MS);
-        ESP.restart();
+    if (bootTimeline.reached(BOOT_PHASE_FIRST_READING)) {
+        publishSensorData();
     }
 }
 
 /**
- * @brief Synchronize system time with NTP server
+ * @brief Advance the network side of the boot pipeline (called every loop)
  * 
- * Configures NTP client for accurate timestamps.
- * - Required for sensor data timestamping
- * - Uses GMT offset and daylight saving configuration
- * - Non-blocking with timeout (continues if NTP fails)
- * - Critical for data logging and rule evaluation
+ * Every stage is polled, never waited for, so relays and sensors keep being
+ * served while the network comes up:
+ * - WiFi associated → network services started
+ * - First SNTP sync → time phase recorded
+ * - Authenticated → initial state published, boot ready
+ * - Boot report sent once, when ready and the first reading is in
+ * WiFi failures are retried by wifiLink; the device keeps running offline.
  */
-void setupNTP() {
-    DEBUG_PRINTLN("Syncing time...");
-    configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
-    
-    struct tm timeinfo;
-    int attempts = 0;
-    while (!getLocalTime(&timeinfo) && attempts < 10) {
-        DEBUG_PRINT(".");
-        delay(NTP_SYNC_RETRY_DELAY_MS);
-        attempts++;
+void advanceBootPipeline() {
+    if (!bootTimeline.reached(BOOT_PHASE_WIFI)) {
+        if (wifiLink.isConnected()) {
+            bootTimeline.mark(BOOT_PHASE_WIFI);
+            startNetworkServices();
+        }
+        return;
     }
     
-    if (attempts < 10) {
-        DEBUG_PRINTLN("[OK] Time synchronized");
-        DEBUG_PRINTLN(&timeinfo, "%Y-%m-%d %H:%M:%S");
-    } else {
-        DEBUG_PRINTLN("[WARN] Time sync failed");
+    if (!bootTimeline.reached(BOOT_PHASE_TIME) && timeBase.isSntpSynced()) {
+        bootTimeline.mark(BOOT_PHASE_TIME);
+    }
+    
+    if (!bootTimeline.reached(BOOT_PHASE_READY) && vpsWebSocket.isAuthenticated()) {
+        publishInitialState();
+        bootTimeline.mark(BOOT_PHASE_READY);
+        // Reaching the backend is the health check for a freshly flashed image
+        esp_ota_mark_app_valid_cancel_rollback();
+    }
+    
+    if (bootTimeline.reportPending() && vpsWebSocket.isAuthenticated()) {
+        if (vpsWebSocket.sendBootReport()) {
+            bootTimeline.markReported();
+        }
     }
 }
 
+/**
+ * @brief Backend link health: recovery ladder every iteration, status log every interval
+ * 
+ * linkRecovery climbs from a socket reset to a reboot while the backend stays
+ * unreachable (see link_recovery.h); the rung that ended an outage is
+ * reported as link:recovery once the device is authenticated again.
+ */
 void checkVPSHealth() {
-    if (millis() - lastHealthCheck < HEALTH_CHECK_INTERVAL_MS) {
+    bool authenticated = vpsWebSocket.isAuthenticated();
+    linkRecovery.update(wifiLink.isConnected(), authenticated, vpsWebSocket.isAuthRejected());
+    
+    if (linkRecovery.reportPending() && authenticated) {
+        StaticJsonDocument<JSON_OBJECT_SIZE(4)> data;
+        JsonObject report = data.to<JsonObject>();
+        report["device_id"] = vpsWebSocket.getDeviceId();
+        linkRecovery.appendTo(report);
+        if (vpsWebSocket.emit("link:recovery", data)) {
+            linkRecovery.markReported();
+        }
+    }
+    
+    if (millis() - lastHealthCheck < runtimeConfig.values().healthCheckIntervalMs) {
         return;
     }
     lastHealthCheck = millis();
     
-    vpsConnected = vpsWebSocket.isConnected();
+    // A WiFi outage is recovered in place by wifiLink; the ladder waits for it
+    if (!wifiLink.isConnected()) {
+        DEBUG_PRINTLN("⚠ WiFi down - waiting for the link to rejoin");
+        return;
+    }
     
-    if (vpsConnected) {
-        failedRequests = 0;
+    if (authenticated) {
         DEBUG_PRINTLN("[OK] WebSocket connected - system healthy");
     } else {
-        failedRequests++;
-        DEBUG_PRINTF("⚠ WebSocket disconnected (%d/%d)\n", failedRequests, MAX_FAILED_REQUESTS);
-        
-        if (failedRequests >= MAX_FAILED_REQUESTS) {
-            DEBUG_PRINTLN("⚠ WebSocket disconnected for too long, restarting...");
-            delay(5000);
-            ESP.restart();
-        }
+        DEBUG_PRINTF("⚠ Backend unreachable (link recovery: %s)\n", LinkRecovery::rungName(linkRecovery.rung()));
     }
 }
 
@@ -146,7 +259,7 @@ void setupOTA() {
     DEBUG_PRINTLN("Setting up OTA...");
     
     // Set hostname
-    ArduinoOTA.setHostname(OTA_HOSTNAME);
+    ArduinoOTA.setHostname(runtimeConfig.deviceId());
     
     // Set OTA port
     ArduinoOTA.setPort(OTA_PORT);
@@ -156,8 +269,8 @@ void setupOTA() {
     
     // OTA callbacks for monitoring
     ArduinoOTA.onStart([]() {
-        String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
-        DEBUG_PRINTLN("\n[OTA] Update Started: " + type);
+        DEBUG_PRINTF("\n[OTA] Update Started: %s\n",
+                     (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem");
         // Disable watchdog during OTA update
         esp_task_wdt_delete(NULL);
     });
@@ -176,18 +289,19 @@ void setupOTA() {
     });
     
     ArduinoOTA.onError([](ota_error_t error) {
-        Serial.printf("[ERROR] OTA Error[%u]: ", error);
+        const char* reason = "";
         if (error == OTA_AUTH_ERROR) {
-            Serial.println("Auth Failed");
+            reason = "Auth Failed";
         } else if (error == OTA_BEGIN_ERROR) {
-            Serial.println("Begin Failed");
+            reason = "Begin Failed";
         } else if (error == OTA_CONNECT_ERROR) {
-            Serial.println("Connect Failed");
+            reason = "Connect Failed";
         } else if (error == OTA_RECEIVE_ERROR) {
-            Serial.println("Receive Failed");
+            reason = "Receive Failed";
         } else if (error == OTA_END_ERROR) {
-            Serial.println("End Failed");
+            reason = "End Failed";
         }
+        LOG_ERRORF("[OTA] Error[%u]: %s\n", (unsigned)error, reason);
         
         // Re-enable watchdog after failed OTA
         esp_task_wdt_add(NULL);
@@ -195,10 +309,8 @@ void setupOTA() {
     
     ArduinoOTA.begin();
     DEBUG_PRINTLN("[OK] OTA Ready");
-    DEBUG_PRINT("  Hostname: ");
-    DEBUG_PRINTLN(OTA_HOSTNAME);
-    DEBUG_PRINT("  Port: ");
-    DEBUG_PRINTLN(OTA_PORT);
+    DEBUG_PRINTF("  Hostname: %s\n", runtimeConfig.deviceId());
+    DEBUG_PRINTF("  Port: %d\n", (int)OTA_PORT);
     DEBUG_PRINTLN("  Password: ********");
 #else
     DEBUG_PRINTLN("⚠ OTA disabled in config");
@@ -206,26 +318,56 @@ void setupOTA() {
 }
 
 /**
- * @brief Send current sensor readings to VPS via WebSocket
+ * @brief Read sensors and send the readings to VPS via WebSocket
  * 
  * Reads sensor data and transmits to backend server with error handling:
- * - Rate-limited to prevent flooding (SENSOR_SEND_INTERVAL_MS)
+ * - Starts as soon as the sensors finish warming up (first reading retried
+ *   every SENSOR_READ_MIN_INTERVAL_MS until valid)
+ * - Rate-limited to prevent flooding (sensor_interval_ms, SENSOR_READ_INTERVAL_MS by default)
  * - Validates sensor readings before transmission
  * - Includes error counters for sensor health monitoring
  * - Tracks consecutive failures for circuit breaker pattern
- * - Non-blocking operation with timeout handling
  * 
  * Critical for real-time greenhouse monitoring and automation.
  */
 void sendSensorData() {
-    if (millis() - lastSensorSend < SENSOR_READ_INTERVAL_MS) {
+    if (!sensors.isWarmedUp()) {
+        return;
+    }
+    unsigned long interval = bootTimeline.reached(BOOT_PHASE_FIRST_READING) ? runtimeConfig.values().sensorIntervalMs
+                                                                             : SENSOR_READ_MIN_INTERVAL_MS;
+    if (millis() - lastSensorSend < interval) {
         return;
     }
     lastSensorSend = millis();
     
+    sensors.readSensors();
+    anomalyDetector.observe(sensors.getCurrentData());
+    if (sensors.getCurrentData().valid) {
+        bootTimeline.mark(BOOT_PHASE_FIRST_READING);
+        recordHistory(sensors.getCurrentData());
+    }
+    publishSensorData();
+}
+
+/**
+ * @brief Keep a new sample in the flash history (needs an epoch clock to place it)
+ */
+void recordHistory(const SensorData& data) {
+    uint64_t epochMs = timeBase.epochMsAt(data.acquired_ms);
+    if (epochMs == 0 || isnan(data.temperature) || isnan(data.humidity)) {
+        return;
+    }
+    float values[SENSOR_BLOCK_CHANNELS] = {data.temperature, data.humidity, data.soil_moisture};
+    historyStore.append(epochMs, values);
+}
+
+/**
+ * @brief Send the latest sensor readings without taking a new sample
+ */
+void publishSensorData() {
     DEBUG_PRINTLN("\n=== Sending Sensor Data ===");
     
-    sensors.readSensors();
     SensorData data = sensors.getCurrentData();
     
     float temp = data.temperature;
@@ -238,19 +380,50 @@ void sendSensorData() {
         return;
     }
     
-    bool success = vpsWebSocket.sendSensorData(temp, hum, data.soil_moisture, tempErrors, humErrors);
+    if (!vpsWebSocket.isAuthenticated()) {
+        // The backend would not store it: keep it for the sensor:block backfill
+        float values[SENSOR_BLOCK_CHANNELS] = {temp, hum, data.soil_moisture};
+        if (!sensorBacklog.append(data.acquired_ms, values)) {
+            sensorBacklogDroppedMetric.inc();
+        }
+    }
+    
+    bool success = vpsWebSocket.sendSensorData(temp, hum, data.soil_moisture, tempErrors, humErrors, data.acquired_ms);
     
     if (!success) {
-        failedRequests++;
-        DEBUG_PRINTF("Failed requests: %d/%d\n", failedRequests, MAX_FAILED_REQUESTS);
+        sensorSendFailuresMetric.inc();
     } else {
-        failedRequests = 0;
+        sensorSendsMetric.inc();
+    }
+}
+
+/**
+ * @brief Upload the readings taken offline as one sensor:block
+ * 
+ * Waits for authentication and a time source (the block's monotonic
+ * timestamps are placed on the epoch clock when sent). A full backlog keeps
+ * its oldest readings; later ones are counted in sensor_backlog_dropped_total.
+ * Backfill is optional work: it waits while the heap is under pressure.
+ */
+void flushSensorBacklog() {
+    if (sensorBacklog.count() == 0 || !vpsWebSocket.isAuthenticated() || !timeBase.isSynced()) {
+        return;
+    }
+    // Same rule as the remote log batches: the readings stay in the block until memory recovers
+    if (memoryMonitor.shedOptionalWork()) {
+        return;
+    }
+    if (vpsWebSocket.sendSensorBlock(sensorBacklog)) {
+        LOG_INFOF("Backfilled %u offline readings in %u bytes\n", (unsigned)sensorBacklog.count(),
+                  (unsigned)sensorBacklog.size());
+        sensorBlocksMetric.inc();
+        sensorBacklog.reset();
     }
 }
 
 void sendMetrics() {
-    // Send metrics every 5 minutes
-    if (millis() - lastMetricsSend < METRICS_SEND_INTERVAL_MS) {
+    // Send metrics every metrics_interval_ms (5 minutes by default)
+    if (millis() - lastMetricsSend < runtimeConfig.values().metricsIntervalMs) {
         return;
     }
     lastMetricsSend = millis();
@@ -259,17 +432,10 @@ void sendMetrics() {
         return;
     }
     
-    ConnectionMetrics metrics = vpsWebSocket.getMetrics();
-    
-    DEBUG_PRINTLN("\n=== Sending Connection Metrics ===");
-    DEBUG_PRINTF("Total Connections: %lu\n", metrics.totalConnections);
-    DEBUG_PRINTF("Reconnections: %lu\n", metrics.reconnections);
-    DEBUG_PRINTF("Auth Failures: %lu\n", metrics.authFailures);
-    DEBUG_PRINTF("Messages Sent: %lu\n", metrics.messagesSent);
-    DEBUG_PRINTF("Messages Received: %lu\n", metrics.messagesReceived);
-    DEBUG_PRINTF("Uptime: %lu seconds\n", metrics.uptimeSeconds);
+    DEBUG_PRINTLN("\n=== Sending Metrics ===");
+    uptimeMetric.set(millis() / 1000);
     
-    bool success = vpsWebSocket.sendMetrics(metrics);
+    bool success = vpsWebSocket.sendMetrics();
     if (success) {
         DEBUG_PRINTLN("[OK] Metrics sent");
     } else {
@@ -278,21 +444,66 @@ void sendMetrics() {
 }
 
 /**
- * @brief ESP32 initialization and startup sequence
+ * @brief Serve Prometheus scrapes on the local metrics port, one step per loop iteration
  * 
- * Performs complete system initialization in the correct order:
- * 1. Serial communication setup
+ * Never waits for the network:
+ * - Accepts one client at a time and reads only the bytes already received
+ * - Once the blank line that ends the request headers is in, replies with the
+ *   text exposition format and closes the connection
+ * - A client whose headers are not complete within METRICS_HTTP_TIMEOUT_MS
+ *   (or that hangs up first) is closed without a reply
+ * - Any path is accepted; there is only one resource
+ */
+void serveMetricsScrape() {
+#if METRICS_HTTP_PORT
+    if (!scrapeClient) {
+        scrapeClient = metricsServer.available();
+        if (!scrapeClient) {
+            return;
+        }
+        scrapeAcceptedAt = millis();
+        scrapeNewlines = 0;
+    }
+    
+    int c;
+    while (scrapeNewlines < 2 && (c = scrapeClient.read()) >= 0) {
+        if (c == '\n') {
+            scrapeNewlines++;
+        } else if (c != '\r') {
+            scrapeNewlines = 0;
+        }
+    }
+    
+    if (scrapeNewlines >= 2) {
+        uptimeMetric.set(millis() / 1000);
+        scrapeClient.print("HTTP/1.0 200 OK\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Connection: close\r\n\r\n");
+        metricsRegistry.writePrometheus(scrapeClient);
+    } else if (scrapeClient.connected() && millis() - scrapeAcceptedAt < METRICS_HTTP_TIMEOUT_MS) {
+        return;  // Rest of the request next iteration
+    }
+    scrapeClient.stop();
+#endif
+}
+
+/**
+ * @brief ESP32 initialization: start every boot stage, wait for none
+ * 
+ * Brings up, in this order and without blocking:
+ * 1. Serial communication and the deferred logger
  * 2. Watchdog timer configuration (critical for reliability)
- * 3. Hardware initialization (sensors, relays)
- * 4. Network setup (WiFi, NTP)
- * 5. VPS communication setup (WebSocket, OTA)
+ * 3. Hardware initialization (relays to their boot state, sensor warm-up,
+ *    flash history index)
+ * 4. WiFi association (cached access point first, see WiFiLink)
  * 
- * This function must complete successfully for the system to operate.
- * Failure in any step may cause ESP32 restart or degraded operation.
+ * Everything that depends on the network (NTP, OTA, WebSocket, initial
+ * state) is started by advanceBootPipeline() from loop() as its dependency
+ * completes, so relays and sensors are served from the first millisecond.
  */
 void setup() {
     DEBUG_SERIAL_BEGIN(115200);
-    delay(SYSTEM_STARTUP_DELAY_MS);
+    deferredLog.begin();
     
     DEBUG_PRINTLN("\n\n");
     DEBUG_PRINTLN("╔══════════════════════════════════════════════╗");
@@ -307,51 +518,31 @@ void setup() {
     esp_task_wdt_add(NULL); // Add current task to WDT watch
     DEBUG_PRINTF("[OK] Watchdog enabled (%d seconds)\n", WDT_TIMEOUT);
     
+    memoryMonitor.begin();
+    #if ALLOC_COUNTER
+    allocCounter.begin();
+    #endif
+    
+    // Identity and per-site settings before anything that uses them
+    runtimeConfig.begin();
+    vpsWebSocket.setDeviceId(runtimeConfig.deviceId());
+    
     DEBUG_PRINTLN("\n=== Initializing Hardware ===");
     relays.begin();
     sensors.begin();
+    historyStore.begin();
+    bootTimeline.mark(BOOT_PHASE_HARDWARE);
     DEBUG_PRINTLN("[OK] Hardware initialized");
     
-    setupWiFi();
-    setupNTP();
-    setupOTA();
-    
-    DEBUG_PRINTLN("\n=== Initializing WebSocket ===");
-    vpsWebSocket.begin();
-    
     vpsWebSocket.onRelayCommand(onRelayCommand);
     vpsWebSocket.onSensorRequest(onSensorRequestReceived);
+    localApi.onRelayCommand(onLanRelayCommand);
+    climateControl.onSwitch(onControlSwitch);
+    anomalyDetector.onAnomaly(onSensorAnomaly);
+    linkRecovery.onAction(onRecoveryAction);
+    linkRecovery.begin();
     
-    DEBUG_PRINTLN("Waiting for WebSocket connection...");
-    int attempts = 0;
-    while (!vpsWebSocket.isConnected() && attempts < 20) {
-        vpsWebSocket.loop();
-        delay(WS_CONNECTION_CHECK_DELAY_MS);
-        DEBUG_PRINT(".");
-        esp_task_wdt_reset(); // Feed watchdog during initialization
-        attempts++;
-    }
-    DEBUG_PRINTLN();
-    
-    if (vpsWebSocket.isConnected()) {
-        DEBUG_PRINTLN("[OK] WebSocket connected!");
-        
-        vpsWebSocket.sendLog("info", "ESP32 Greenhouse started - WebSocket mode");
-        
-        DEBUG_PRINTLN("\n=== Sending Initial Relay States ===");
-        for (int i = 0; i < 4; i++) {
-            bool state = relays.getRelayState(i);
-            vpsWebSocket.sendRelayState(i, state, "manual", "system");
-            DEBUG_PRINTF("Relay %d initial state: %s\n", i, state ? "ON" : "OFF");
-            delay(RELAY_STATE_SEND_DELAY_MS);
-        }
-        DEBUG_PRINTLN("[OK] Initial relay states sent");
-        
-        delay(WS_INITIAL_STATE_DELAY_MS);
-        sendSensorData();
-    } else {
-        DEBUG_PRINTLN("⚠ WebSocket connection failed, will retry in loop");
-    }
+    wifiLink.begin();
     
     DEBUG_PRINTLN("\n=== Setup Complete ===");
     DEBUG_PRINTLN("Entering main loop...\n");
@@ -363,10 +554,12 @@ void setup() {
  * Performs all ongoing system operations in priority order:
  * 1. Watchdog feeding (prevents system reset)
  * 2. OTA update handling (allows remote firmware updates)
- * 3. WebSocket communication maintenance
- * 4. VPS connectivity health checks
- * 5. Sensor data transmission
- * 6. System metrics reporting
+ * 3. WiFi link, time base, boot pipeline stages, WebSocket communication, LAN
+ *    control API, heater/fan loops, relay expander flush, delta OTA and flash
+ *    history queries
+ * 4. VPS connectivity health checks and the link recovery ladder
+ * 5. Sensor data transmission (and the backfill of readings taken offline)
+ * 6. System metrics reporting (push to VPS, local Prometheus scrape)
  * 
  * This loop must execute reliably for continuous greenhouse operation.
  * All operations are designed to be non-blocking to maintain responsiveness.
@@ -374,16 +567,34 @@ void setup() {
 void loop() {
     // Feed the watchdog timer at the start of each loop iteration
     esp_task_wdt_reset();
+    unsigned long loopStart = micros();
     
     // Handle OTA updates
     #if OTA_ENABLED
     ArduinoOTA.handle();
     #endif
     
+    wifiLink.update();
+    timeBase.update();
+    advanceBootPipeline();
     vpsWebSocket.loop();
+    localApi.loop();
+    climateControl.loop(sensors.getCurrentData());
+    relays.update();
+    otaUpdater.loop();
+    historyStore.loop();
+    memoryMonitor.update();
+    deferredLog.loop();
     checkVPSHealth();
     sendSensorData();
+    flushSensorBacklog();
     sendMetrics();
+    serveMetricsScrape();
+    // Work time only; the fixed delay below is excluded
+    loopDurationMetric.observe(micros() - loopStart);
+    #if ALLOC_COUNTER
+    allocCounter.endIteration(bootTimeline.reached(BOOT_PHASE_READY));
+    #endif
     delay(LOOP_ITERATION_DELAY_MS);
     yield();
 }
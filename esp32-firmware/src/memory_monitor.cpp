@@ -0,0 +1,241 @@
+// Heap fragmentation and stack high-water telemetry
+
+#include "memory_monitor.h"
+#include "alloc_counter.h"
+#include "metrics.h"
+#include "runtime_config.h"
+#include <esp_heap_caps.h>
+
+// Global instance
+MemoryMonitor memoryMonitor;
+
+static Gauge heapFreeMetric("heap_free_bytes", "Free 8-bit heap at the last sample");
+static Gauge heapLargestBlockMetric("heap_largest_block_bytes", "Largest free 8-bit heap block at the last sample");
+
+static const char* const ALLOC_SCOPE_NAMES[ALLOC_SCOPE_COUNT] = {
+    "tls",
+    "json"
+};
+
+MemoryMonitor::MemoryMonitor() {
+    _bucketIndex = 0;
+    _bucketStart = 0;
+    _lastSample = 0;
+    _taskCount = 0;
+    _lowMemoryEvents = 0;
+    _shedCount = 0;
+    _lowMemory = false;
+    memset(_tasks, 0, sizeof(_tasks));
+    memset(_scopes, 0, sizeof(_scopes));
+    resetWindow();
+}
+
+void MemoryMonitor::begin() {
+    registerTask(xTaskGetCurrentTaskHandle(), "loop");
+    _bucketStart = millis();
+    sample();
+    DEBUG_PRINTF("[OK] Memory monitor ready (free: %u, largest block: %u)\n",
+                 _buckets[_bucketIndex].freeMin, _buckets[_bucketIndex].blockMin);
+}
+
+bool MemoryMonitor::registerTask(TaskHandle_t task, const char* name) {
+    if (task == nullptr) {
+        return false;
+    }
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        if (_tasks[i].handle == task) {
+            return true;
+        }
+    }
+    if (_taskCount >= MEMORY_MAX_TRACKED_TASKS) {
+        LOG_WARNF("Memory monitor: task table full, not tracking %s\n", name);
+        return false;
+    }
+    _tasks[_taskCount].handle = task;
+    _tasks[_taskCount].name = name;
+    _tasks[_taskCount].minHighWater = UINT32_MAX;
+    _taskCount++;
+    return true;
+}
+
+void MemoryMonitor::update() {
+    if (millis() - _lastSample < runtimeConfig.values().memorySampleIntervalMs) {
+        return;
+    }
+    sample();
+}
+
+void MemoryMonitor::sample() {
+    unsigned long now = millis();
+    _lastSample = now;
+    advanceBucket(now);
+
+    uint32_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    uint32_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    heapFreeMetric.set((int32_t)freeBytes);
+    heapLargestBlockMetric.set((int32_t)largestBlock);
+
+    Bucket& bucket = _buckets[_bucketIndex];
+    if (!bucket.used) {
+        bucket.freeMin = bucket.freeMax = freeBytes;
+        bucket.blockMin = bucket.blockMax = largestBlock;
+        bucket.used = true;
+    } else {
+        if (freeBytes < bucket.freeMin) bucket.freeMin = freeBytes;
+        if (freeBytes > bucket.freeMax) bucket.freeMax = freeBytes;
+        if (largestBlock < bucket.blockMin) bucket.blockMin = largestBlock;
+        if (largestBlock > bucket.blockMax) bucket.blockMax = largestBlock;
+    }
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        uint32_t highWater = uxTaskGetStackHighWaterMark(_tasks[i].handle);
+        if (highWater < _tasks[i].minHighWater) {
+            _tasks[i].minHighWater = highWater;
+        }
+    }
+
+    updateLowMemoryState(freeBytes, largestBlock);
+}
+
+void MemoryMonitor::updateLowMemoryState(uint32_t freeBytes, uint32_t largestBlock) {
+    if (!_lowMemory) {
+        if (freeBytes < LOW_MEMORY_FREE_THRESHOLD || largestBlock < LOW_MEMORY_BLOCK_THRESHOLD) {
+            _lowMemory = true;
+            _lowMemoryEvents++;
+            LOG_WARNF("Low memory: free=%u largest=%u - shedding optional work\n", freeBytes, largestBlock);
+        }
+        return;
+    }
+
+    // Leave low-memory state only once both values clear the hysteresis band
+    if (freeBytes >= LOW_MEMORY_FREE_THRESHOLD + LOW_MEMORY_HYSTERESIS &&
+        largestBlock >= LOW_MEMORY_BLOCK_THRESHOLD) {
+        _lowMemory = false;
+        LOG_INFOF("Memory recovered: free=%u largest=%u\n", freeBytes, largestBlock);
+    }
+}
+
+bool MemoryMonitor::shedOptionalWork() {
+    if (!_lowMemory) {
+        return false;
+    }
+    _shedCount++;
+    return true;
+}
+
+// Scopes wrap every send, so they only read counters: heap_caps_get_free_size() sums the
+// per-heap totals, where heap_caps_get_info() walks every block under the allocator lock
+void MemoryMonitor::beginScope(AllocScope scope) {
+    ScopeStats& stats = _scopes[scope];
+#if ALLOC_COUNTER
+    stats.startAllocations = allocCounter.total();
+#endif
+    stats.startFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    stats.active = true;
+}
+
+void MemoryMonitor::endScope(AllocScope scope) {
+    ScopeStats& stats = _scopes[scope];
+    if (!stats.active) {
+        return;
+    }
+    stats.active = false;
+
+    uint32_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    uint32_t heapDrop = stats.startFree > freeBytes ? stats.startFree - freeBytes : 0;
+#if ALLOC_COUNTER
+    // Every malloc counts, also the ones freed again before the scope ends
+    uint32_t allocations = allocCounter.total() - stats.startAllocations;
+    if (allocations > stats.maxAllocations) stats.maxAllocations = allocations;
+#endif
+
+    stats.runs++;
+    if (heapDrop > stats.maxHeapDrop) stats.maxHeapDrop = heapDrop;
+}
+
+void MemoryMonitor::appendTo(JsonObject obj) {
+    // Make sure the current bucket reflects the latest state
+    sample();
+
+    JsonArray freeMin = obj.createNestedArray("free_min");
+    JsonArray freeMax = obj.createNestedArray("free_max");
+    JsonArray blockMin = obj.createNestedArray("block_min");
+    JsonArray blockMax = obj.createNestedArray("block_max");
+
+    // Oldest bucket first: start right after the current one and wrap around
+    for (uint8_t n = 1; n <= MEMORY_SERIES_BUCKETS; n++) {
+        const Bucket& bucket = _buckets[(_bucketIndex + n) % MEMORY_SERIES_BUCKETS];
+        if (!bucket.used) {
+            continue;
+        }
+        freeMin.add(bucket.freeMin);
+        freeMax.add(bucket.freeMax);
+        blockMin.add(bucket.blockMin);
+        blockMax.add(bucket.blockMax);
+    }
+
+    obj["bucket_ms"] = (uint32_t)bucketMs();
+
+    // The allocator's own low-water mark: exact, where sampling could miss a short dip
+    obj["min_ever"] = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    obj["low"] = _lowMemory;
+    obj["low_events"] = _lowMemoryEvents;
+    obj["shed"] = _shedCount;
+
+    JsonObject stacks = obj.createNestedObject("stack");
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        stacks[_tasks[i].name] = _tasks[i].minHighWater;
+    }
+
+    // Per scope: [runs, max heap drop in bytes, max allocations (ALLOC_COUNTER builds only)]
+    JsonObject alloc = obj.createNestedObject("alloc");
+    for (uint8_t s = 0; s < ALLOC_SCOPE_COUNT; s++) {
+        JsonArray entry = alloc.createNestedArray(ALLOC_SCOPE_NAMES[s]);
+        entry.add(_scopes[s].runs);
+        entry.add(_scopes[s].maxHeapDrop);
+#if ALLOC_COUNTER
+        entry.add(_scopes[s].maxAllocations);
+#endif
+    }
+
+    resetWindow();
+}
+
+void MemoryMonitor::resetWindow() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _bucketIndex = 0;
+    _bucketStart = millis();
+    for (uint8_t s = 0; s < ALLOC_SCOPE_COUNT; s++) {
+        _scopes[s].runs = 0;
+        _scopes[s].maxAllocations = 0;
+        _scopes[s].maxHeapDrop = 0;
+    }
+    _lowMemoryEvents = 0;
+    _shedCount = 0;
+}
+
+void MemoryMonitor::advanceBucket(unsigned long now) {
+    unsigned long width = bucketMs();
+    unsigned long elapsed = (now - _bucketStart) / width;
+    if (elapsed == 0) {
+        return;
+    }
+
+    // A gap longer than the whole series (e.g. blocked loop) invalidates every bucket
+    if (elapsed >= MEMORY_SERIES_BUCKETS) {
+        memset(_buckets, 0, sizeof(_buckets));
+        _bucketStart = now;
+        return;
+    }
+
+    for (unsigned long i = 0; i < elapsed; i++) {
+        _bucketIndex = (_bucketIndex + 1) % MEMORY_SERIES_BUCKETS;
+        _buckets[_bucketIndex].used = false;
+    }
+    _bucketStart += elapsed * width;
+}
+
+unsigned long MemoryMonitor::bucketMs() const {
+    // metrics_interval_ms is a config:set key: the buckets follow it, so a report always
+    // covers its own interval (no gap when it is longer, no overlap when shorter)
+    return runtimeConfig.values().metricsIntervalMs / MEMORY_SERIES_BUCKETS;
+}
@@ -0,0 +1,141 @@
+// Fixed-memory metrics registry: self-registering counters, gauges and histograms
+
+#include "metrics.h"
+
+// Registry list head; constant-initialized, so metrics in any translation unit can link in
+Metric* Metric::_head = nullptr;
+
+// Global instance
+MetricsRegistry metricsRegistry;
+
+Metric::Metric(const char* name, const char* help, MetricType type)
+    : _name(name), _help(help), _type(type), _next(nullptr), _exported(0) {
+    // Static constructors run on one core before setup(); no locking needed
+    _next = _head;
+    _head = this;
+}
+
+Histogram::Histogram(const char* name, const char* help) : Metric(name, help, METRIC_HISTOGRAM) {
+    for (uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        _buckets[i].store(0, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(uint32_t value) {
+    // Bucket i holds values <= 2^i; the last bucket is +Inf
+    uint8_t index = 0;
+    if (value > 1) {
+        index = (uint8_t)(32 - __builtin_clz(value - 1));
+    }
+    if (index >= METRICS_HISTOGRAM_BUCKETS) {
+        index = METRICS_HISTOGRAM_BUCKETS - 1;
+    }
+    _buckets[index].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricsRegistry::MetricsRegistry() {
+    _sequence = 0;
+    _forceFull = true;
+}
+
+uint32_t MetricsRegistry::current(const Metric* metric) {
+    switch (metric->type()) {
+        case METRIC_COUNTER:
+            return static_cast<const Counter*>(metric)->value();
+        case METRIC_GAUGE:
+            return (uint32_t)static_cast<const Gauge*>(metric)->value();
+        case METRIC_HISTOGRAM:
+            return static_cast<const Histogram*>(metric)->count();
+    }
+    return 0;
+}
+
+bool MetricsRegistry::changed(const Metric* metric) {
+    return current(metric) != metric->_exported;
+}
+
+size_t MetricsRegistry::appendDelta(JsonObject obj) {
+    bool full = _forceFull || (_sequence % METRICS_FULL_FRAME_EVERY) == 0;
+    _forceFull = false;
+    obj["seq"] = _sequence++;
+    obj["full"] = full;
+
+    // Counters and gauges: "name": value. Histograms: "name": [count, sum, b0, b1, ...]
+    // with trailing empty buckets trimmed (bucket i counts values <= 2^i, last is +Inf)
+    JsonObject series = obj.createNestedObject("series");
+    size_t written = 0;
+    for (Metric* metric = Metric::first(); metric != nullptr; metric = metric->next()) {
+        if (!full && !changed(metric)) {
+            continue;
+        }
+        metric->_exported = current(metric);
+        written++;
+
+        if (metric->type() == METRIC_COUNTER) {
+            series[metric->name()] = static_cast<Counter*>(metric)->value();
+        } else if (metric->type() == METRIC_GAUGE) {
+            series[metric->name()] = static_cast<Gauge*>(metric)->value();
+        } else {
+            const Histogram* histogram = static_cast<const Histogram*>(metric);
+            JsonArray values = series.createNestedArray(metric->name());
+            values.add(histogram->count());
+            values.add(histogram->sum());
+            int8_t last = METRICS_HISTOGRAM_BUCKETS - 1;
+            while (last >= 0 && histogram->bucket(last) == 0) {
+                last--;
+            }
+            for (int8_t i = 0; i <= last; i++) {
+                values.add(histogram->bucket(i));
+            }
+        }
+    }
+    return written;
+}
+
+void MetricsRegistry::writePrometheus(Print& out) {
+    char line[160];
+    for (Metric* metric = Metric::first(); metric != nullptr; metric = metric->next()) {
+        const char* typeName = metric->type() == METRIC_COUNTER ? "counter"
+                             : metric->type() == METRIC_GAUGE   ? "gauge"
+                                                                : "histogram";
+        int len = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n",
+                           metric->name(), metric->help(), metric->name(), typeName);
+        out.write((const uint8_t*)line, len < (int)sizeof(line) ? len : sizeof(line) - 1);
+
+        if (metric->type() == METRIC_COUNTER) {
+            len = snprintf(line, sizeof(line), "%s %u\n", metric->name(),
+                           (unsigned)static_cast<Counter*>(metric)->value());
+        } else if (metric->type() == METRIC_GAUGE) {
+            len = snprintf(line, sizeof(line), "%s %d\n", metric->name(),
+                           (int)static_cast<Gauge*>(metric)->value());
+        } else {
+            const Histogram* histogram = static_cast<const Histogram*>(metric);
+            // Prometheus buckets are cumulative
+            uint32_t cumulative = 0;
+            for (uint8_t i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+                cumulative += histogram->bucket(i);
+                len = snprintf(line, sizeof(line), "%s_bucket{le=\"%u\"} %u\n", metric->name(),
+                               (unsigned)Histogram::bucketBound(i), (unsigned)cumulative);
+                out.write((const uint8_t*)line, len);
+            }
+            cumulative += histogram->bucket(METRICS_HISTOGRAM_BUCKETS - 1);
+            len = snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %u\n%s_sum %u\n%s_count %u\n",
+                           metric->name(), (unsigned)cumulative, metric->name(), (unsigned)histogram->sum(),
+                           metric->name(), (unsigned)cumulative);
+        }
+        out.write((const uint8_t*)line, len < (int)sizeof(line) ? len : sizeof(line) - 1);
+    }
+}
+
+Metric* MetricsRegistry::find(const char* name) {
+    for (Metric* metric = Metric::first(); metric != nullptr; metric = metric->next()) {
+        if (strcmp(metric->name(), name) == 0) {
+            return metric;
+        }
+    }
+    return nullptr;
+}
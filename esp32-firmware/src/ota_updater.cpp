@@ -0,0 +1,444 @@
+// Signed delta OTA over the WebSocket: offer check, chunk pulls, streaming apply into the OTA slot
+
+#include "ota_updater.h"
+#include "ota_key.h"
+#include "vps_websocket.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "time_base.h"
+#include <mbedtls/pk.h>
+
+// Global instance
+OtaUpdater otaUpdater;
+
+static Counter otaUpdatesMetric("ota_updates_total", "Delta OTA images written and selected for boot");
+static Counter otaFailuresMetric("ota_failures_total", "Delta OTA offers rejected or updates abandoned");
+static Counter otaBytesMetric("ota_bytes_received_total", "Patch bytes received in ota:chunk events");
+static Counter otaRetriesMetric("ota_chunk_retries_total", "ota:pull requests repeated after a timeout");
+static Gauge otaApplyMetric("ota_apply_ms", "Time spent rebuilding the image in the last update");
+static Gauge otaTransferMetric("ota_transfer_ms", "Offer to boot selection in the last update");
+
+static const char OTA_MANIFEST_TAG[] = "ghota1";  // First line of the signed manifest
+static const size_t OTA_SIGNATURE_MAX = 80;         // DER ECDSA P-256 is at most 72 bytes
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode exactly `length` bytes; false on bad characters or the wrong length
+static bool parseHex(const char* hex, uint8_t* out, size_t length) {
+    if (!hex || strlen(hex) != length * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        int high = hexValue(hex[2 * i]);
+        int low = hexValue(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)((high << 4) | low);
+    }
+    return true;
+}
+
+static void formatHex(const uint8_t* bytes, size_t length, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+    out[2 * length] = '\0';
+}
+
+bool OtaUpdater::PartitionSource::read(uint32_t offset, uint8_t* buffer, size_t length) {
+    return esp_partition_read(partition, offset, buffer, length) == ESP_OK;
+}
+
+bool OtaUpdater::OtaSink::write(const uint8_t* data, size_t length) {
+    if (esp_ota_write(owner->_handle, data, length) != ESP_OK) {
+        return false;
+    }
+    mbedtls_md_update(&owner->_md, data, length);
+    return true;
+}
+
+OtaUpdater::OtaUpdater() {
+    _state = OTA_STATE_IDLE;
+    _client = nullptr;
+    _id[0] = '\0';
+    _version[0] = '\0';
+    _patchSize = 0;
+    _targetSize = 0;
+    _sourceSize = 0;
+    memset(_targetSha, 0, sizeof(_targetSha));
+    memset(_sourceSha, 0, sizeof(_sourceSha));
+    _runningShaKnown = false;
+    _runningShaSize = 0;
+    memset(_runningSha, 0, sizeof(_runningSha));
+    _hashed = 0;
+    _running = nullptr;
+    _target = nullptr;
+    _handle = 0;
+    _handleOpen = false;
+    mbedtls_md_init(&_md);
+    _mdActive = false;
+    _chunkLength = 0;
+    _chunkPos = 0;
+    _received = 0;
+    _pullSent = false;
+    _pullAt = 0;
+    _pullAttempts = 0;
+    _nextStatusAt = 0;
+    _startUs = 0;
+    _applyUs = 0;
+    _rebootAt = 0;
+    _source.partition = nullptr;
+    _sink.owner = this;
+}
+
+void OtaUpdater::handleOffer(VPSWebSocketClient& client, JsonObject& offer) {
+    const char* id = offer["id"] | "";
+    if (_state != OTA_STATE_IDLE) {
+        if (strcmp(id, _id) != 0) {
+            reject(client, id, "busy");
+        }
+        return;  // Same offer again (reconnect): the pull loop resumes by itself
+    }
+
+    const char* version = offer["version"] | "";
+    uint32_t patchSize = offer["patch_size"] | 0;
+    uint32_t targetSize = offer["target_size"] | 0;
+    uint32_t sourceSize = offer["source_size"] | 0;
+    const char* targetSha = offer["target_sha256"] | "";
+    const char* sourceSha = offer["source_sha256"] | "";
+    const char* signature = offer["signature"] | "";
+
+    if (id[0] == '\0' || strlen(id) >= sizeof(_id) || version[0] == '\0' || strlen(version) >= sizeof(_version) ||
+        patchSize == 0 || targetSize == 0 || !parseHex(targetSha, _targetSha, sizeof(_targetSha)) ||
+        (sourceSize > 0 && !parseHex(sourceSha, _sourceSha, sizeof(_sourceSha)))) {
+        reject(client, id, "bad_offer");
+        return;
+    }
+    if (strcmp(version, FIRMWARE_VERSION) == 0) {
+        reject(client, id, "already_running");
+        return;
+    }
+
+    _running = esp_ota_get_running_partition();
+    _target = esp_ota_get_next_update_partition(nullptr);
+    if (!_running || !_target || targetSize > _target->size || sourceSize > _running->size) {
+        reject(client, id, "no_space");
+        return;
+    }
+
+    strcpy(_version, version);
+    _targetSize = targetSize;
+    if (!verifySignature(signature)) {
+        reject(client, id, "bad_signature");
+        return;
+    }
+
+    strcpy(_id, id);
+    _client = &client;
+    _patchSize = patchSize;
+    _sourceSize = sourceSize;
+    _startUs = TimeBase::monotonicUs();
+    _applyUs = 0;
+    LOG_INFOF("[OTA] Offer %s: v%s, %lu byte patch for a %lu byte image\n", _id, _version, (unsigned long)_patchSize,
+              (unsigned long)_targetSize);
+
+    if (_sourceSize == 0) {
+        startDownload();  // Full image: nothing to check the running one against
+        return;
+    }
+    if (_runningShaKnown && _runningShaSize == _sourceSize) {
+        if (memcmp(_runningSha, _sourceSha, sizeof(_sourceSha)) != 0) {
+            fail("source_mismatch");
+            return;
+        }
+        startDownload();
+        return;
+    }
+    mbedtls_md_setup(&_md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    mbedtls_md_starts(&_md);
+    _mdActive = true;
+    _hashed = 0;
+    _state = OTA_STATE_HASHING;
+}
+
+void OtaUpdater::handleChunk(VPSWebSocketClient& client, const char* id, uint32_t offset, const uint8_t* data,
+                             size_t length) {
+    if (&client != _client || _state != OTA_STATE_DOWNLOADING || !id || strcmp(id, _id) != 0 || offset != _received) {
+        return;
+    }
+    if (length == 0 || length > sizeof(_chunk) || _received + length > _patchSize) {
+        fail("bad_chunk");
+        return;
+    }
+    memcpy(_chunk, data, length);
+    _chunkLength = length;
+    _chunkPos = 0;
+    _received += length;
+    _pullSent = false;
+    otaBytesMetric.inc(length);
+    _state = OTA_STATE_APPLYING;
+}
+
+void OtaUpdater::loop() {
+    switch (_state) {
+        case OTA_STATE_IDLE:
+            break;
+        case OTA_STATE_HASHING:
+            hashStep();
+            break;
+        case OTA_STATE_DOWNLOADING:
+            pollDownload();
+            break;
+        case OTA_STATE_APPLYING:
+            applyStep();
+            break;
+        case OTA_STATE_REBOOTING:
+            if (millis() - _rebootAt >= OTA_REBOOT_DELAY_MS) {
+                LOG_WARNF("[OTA] Restarting into v%s\n", _version);
+                deferredLog.flush();
+                ESP.restart();
+            }
+            break;
+    }
+}
+
+void OtaUpdater::hashStep() {
+    uint32_t budgetEnd = _hashed + OTA_HASH_BUDGET_BYTES;
+    while (_hashed < _sourceSize && _hashed < budgetEnd) {
+        size_t length = _sourceSize - _hashed < sizeof(_chunk) ? _sourceSize - _hashed : sizeof(_chunk);
+        if (esp_partition_read(_running, _hashed, _chunk, length) != ESP_OK) {
+            fail("source_read");
+            return;
+        }
+        mbedtls_md_update(&_md, _chunk, length);
+        _hashed += length;
+    }
+    if (_hashed < _sourceSize) {
+        return;
+    }
+
+    mbedtls_md_finish(&_md, _runningSha);
+    mbedtls_md_free(&_md);
+    _mdActive = false;
+    _runningShaKnown = true;
+    _runningShaSize = _sourceSize;
+    if (memcmp(_runningSha, _sourceSha, sizeof(_sourceSha)) != 0) {
+        fail("source_mismatch");  // The backend answers with a full image
+        return;
+    }
+    startDownload();
+}
+
+void OtaUpdater::startDownload() {
+    esp_err_t err = esp_ota_begin(_target, OTA_WITH_SEQUENTIAL_WRITES, &_handle);
+    if (err != ESP_OK) {
+        LOG_ERRORF("[OTA] esp_ota_begin failed: %s\n", esp_err_to_name(err));
+        fail("ota_begin");
+        return;
+    }
+    _handleOpen = true;
+    mbedtls_md_setup(&_md, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    mbedtls_md_starts(&_md);
+    _mdActive = true;
+
+    _source.partition = _running;
+    _patcher.begin(&_source, &_sink);
+    _received = 0;
+    _pullSent = false;
+    _pullAttempts = 0;
+    _nextStatusAt = OTA_STATUS_STEP_BYTES;
+    _state = OTA_STATE_DOWNLOADING;
+    sendStatus("downloading");
+}
+
+void OtaUpdater::pollDownload() {
+    if (!_client->isAuthenticated()) {
+        _pullSent = false;  // Whatever was in flight is lost; pull again after reconnecting
+        _pullAttempts = 0;
+        return;
+    }
+    if (!_pullSent) {
+        sendPull();
+        return;
+    }
+    if (millis() - _pullAt < OTA_CHUNK_TIMEOUT_MS) {
+        return;
+    }
+    if (_pullAttempts >= OTA_CHUNK_RETRIES) {
+        fail("chunk_timeout");
+        return;
+    }
+    otaRetriesMetric.inc();
+    LOG_WARNF("[OTA] Chunk at %lu timed out, pulling again\n", (unsigned long)_received);
+    sendPull();
+}
+
+void OtaUpdater::applyStep() {
+    uint64_t start = TimeBase::monotonicUs();
+    _chunkPos += _patcher.feed(_chunk + _chunkPos, _chunkLength - _chunkPos, OTA_APPLY_BUDGET_BYTES);
+    _applyUs += TimeBase::monotonicUs() - start;
+
+    DeltaStatus status = _patcher.status();
+    if (status != DELTA_OK && status != DELTA_DONE) {
+        LOG_ERRORF("[OTA] Patch failed at %lu: %s\n", (unsigned long)_received, DeltaPatcher::statusName(status));
+        fail(DeltaPatcher::statusName(status));
+        return;
+    }
+    if (_chunkPos < _chunkLength || _patcher.hasPendingOutput()) {
+        return;  // Budget used up; continue on the next iteration
+    }
+    if (_received == _patchSize) {
+        complete();
+        return;
+    }
+    if (_received >= _nextStatusAt) {
+        _nextStatusAt += OTA_STATUS_STEP_BYTES;
+        sendStatus("downloading");
+    }
+    _state = OTA_STATE_DOWNLOADING;
+    pollDownload();  // Pull the next chunk right away
+}
+
+void OtaUpdater::complete() {
+    uint64_t start = TimeBase::monotonicUs();
+    DeltaStatus status = _patcher.finish();
+    _applyUs += TimeBase::monotonicUs() - start;
+    if (status != DELTA_DONE) {
+        fail(DeltaPatcher::statusName(status));
+        return;
+    }
+
+    uint8_t digest[32];
+    mbedtls_md_finish(&_md, digest);
+    mbedtls_md_free(&_md);
+    _mdActive = false;
+    if (memcmp(digest, _targetSha, sizeof(digest)) != 0) {
+        fail("target_mismatch");
+        return;
+    }
+
+    esp_err_t err = esp_ota_end(_handle);
+    _handleOpen = false;
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(_target);
+    }
+    if (err != ESP_OK) {
+        LOG_ERRORF("[OTA] Image not bootable: %s\n", esp_err_to_name(err));
+        fail("ota_end");
+        return;
+    }
+
+    otaUpdatesMetric.inc();
+    otaApplyMetric.set((int32_t)(_applyUs / 1000ULL));
+    otaTransferMetric.set((int32_t)((TimeBase::monotonicUs() - _startUs) / 1000ULL));
+    LOG_INFOF("[OTA] v%s written to %s: %lu byte patch, %lu byte image, applied in %lu ms\n", _version, _target->label,
+              (unsigned long)_patchSize, (unsigned long)_targetSize, (unsigned long)(_applyUs / 1000ULL));
+    sendStatus("applied");
+    _rebootAt = millis();
+    _state = OTA_STATE_REBOOTING;
+}
+
+void OtaUpdater::fail(const char* error) {
+    otaFailuresMetric.inc();
+    LOG_WARNF("[OTA] Update %s failed: %s\n", _id, error);
+    sendStatus("failed", error);
+    releaseResources();
+    _state = OTA_STATE_IDLE;
+    _id[0] = '\0';
+}
+
+void OtaUpdater::reject(VPSWebSocketClient& client, const char* id, const char* error) {
+    otaFailuresMetric.inc();
+    LOG_WARNF("[OTA] Offer %s rejected: %s\n", id, error);
+    StaticJsonDocument<JSON_OBJECT_SIZE(4)> data;
+    data["device_id"] = client.getDeviceId();
+    data["id"] = id;
+    data["state"] = "rejected";
+    data["error"] = error;
+    client.emit("ota:status", data);
+}
+
+void OtaUpdater::sendPull() {
+    uint32_t remaining = _patchSize - _received;
+    StaticJsonDocument<JSON_OBJECT_SIZE(4)> data;
+    data["device_id"] = _client->getDeviceId();
+    data["id"] = (const char*)_id;
+    data["offset"] = _received;
+    data["length"] = remaining < OTA_CHUNK_SIZE ? remaining : (uint32_t)OTA_CHUNK_SIZE;
+    if (_client->emit("ota:pull", data)) {
+        _pullSent = true;
+        _pullAt = millis();
+        _pullAttempts++;
+    }
+}
+
+void OtaUpdater::sendStatus(const char* state, const char* error) {
+    if (!_client) {
+        return;
+    }
+    StaticJsonDocument<JSON_OBJECT_SIZE(11)> data;
+    data["device_id"] = _client->getDeviceId();
+    data["id"] = (const char*)_id;
+    data["version"] = (const char*)_version;
+    data["state"] = state;
+    data["bytes_received"] = _received;
+    data["patch_size"] = _patchSize;
+    data["target_size"] = _targetSize;
+    data["image_bytes"] = _patcher.produced();
+    data["apply_ms"] = (uint32_t)(_applyUs / 1000ULL);
+    data["transfer_ms"] = (uint32_t)((TimeBase::monotonicUs() - _startUs) / 1000ULL);
+    if (error) {
+        data["error"] = error;
+    }
+    _client->emit("ota:status", data);
+}
+
+void OtaUpdater::releaseResources() {
+    if (_handleOpen) {
+        esp_ota_abort(_handle);
+        _handleOpen = false;
+    }
+    if (_mdActive) {
+        mbedtls_md_free(&_md);
+        _mdActive = false;
+    }
+    _received = 0;
+    _chunkLength = 0;
+    _chunkPos = 0;
+    _pullSent = false;
+}
+
+bool OtaUpdater::verifySignature(const char* signatureHex) {
+    uint8_t signature[OTA_SIGNATURE_MAX];
+    size_t signatureLength = strlen(signatureHex) / 2;
+    if (signatureLength == 0 || signatureLength > sizeof(signature) ||
+        !parseHex(signatureHex, signature, signatureLength)) {
+        return false;
+    }
+
+    // The manifest binds the version to the exact image; the patch itself needs no
+    // signature because the rebuilt image is checked against this hash
+    char targetHex[65];
+    formatHex(_targetSha, sizeof(_targetSha), targetHex);
+    char manifest[OTA_VERSION_MAX_LENGTH + 96];
+    int manifestLength = snprintf(manifest, sizeof(manifest), "%s\n%s\n%lu\n%s\n", OTA_MANIFEST_TAG, _version,
+                                  (unsigned long)_targetSize, targetHex);
+    uint8_t digest[32];
+    mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*)manifest, manifestLength, digest);
+
+    static const char publicKey[] = OTA_SIGNING_PUBLIC_KEY;
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    bool valid = mbedtls_pk_parse_public_key(&key, (const uint8_t*)publicKey, sizeof(publicKey)) == 0 &&
+                 mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature, signatureLength) == 0;
+    mbedtls_pk_free(&key);
+    return valid;
+}
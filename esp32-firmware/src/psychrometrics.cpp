@@ -0,0 +1,119 @@
+// Table-driven psychrometrics: VPD, dew point and absolute humidity for sensor:data
+
+#include "psychrometrics.h"
+#include <Arduino.h>
+
+// Global instance
+Psychrometrics psychrometrics;
+
+static const int TABLE_SIZE = PSYCHRO_TABLE_MAX_C - PSYCHRO_TABLE_MIN_C + 1;
+
+// Magnus saturation vapour pressure (kPa) at PSYCHRO_TABLE_MIN_C + i °C
+static const float SVP_TABLE[TABLE_SIZE] = {
+    0.00189188f, 0.00214842f, 0.00243639f, 0.00275923f, 0.00312069f, 0.00352488f, 0.00397629f, 0.00447983f,
+    0.00504085f, 0.00566515f, 0.00635907f, 0.0071295f, 0.0079839f, 0.00893037f, 0.00997769f, 0.0111354f,
+    0.0124137f, 0.0138237f, 0.0153774f, 0.0170876f, 0.0189684f, 0.0210347f, 0.0233026f, 0.0257893f,
+    0.0285134f, 0.0314948f, 0.034755f, 0.0383166f, 0.0422042f, 0.0464439f, 0.0510635f, 0.056093f,
+    0.061564f, 0.0675104f, 0.0739683f, 0.0809761f, 0.0885746f, 0.0968071f, 0.10572f, 0.115361f,
+    0.125784f, 0.137042f, 0.149194f, 0.162302f, 0.17643f, 0.191648f, 0.208029f, 0.225648f,
+    0.244587f, 0.264932f, 0.286773f, 0.310204f, 0.335325f, 0.362242f, 0.391064f, 0.421908f,
+    0.454896f, 0.490156f, 0.527821f, 0.568033f, 0.61094f, 0.656696f, 0.705462f, 0.757409f,
+    0.812713f, 0.87156f, 0.934143f, 1.00066f, 1.07134f, 1.14638f, 1.22602f, 1.3105f,
+    1.40007f, 1.495f, 1.59554f, 1.70198f, 1.81462f, 1.93377f, 2.05973f, 2.19284f,
+    2.33344f, 2.48189f, 2.63855f, 2.80381f, 2.97807f, 3.16174f, 3.35523f, 3.55901f,
+    3.77352f, 3.99924f, 4.23665f, 4.48627f, 4.74862f, 5.02424f, 5.3137f, 5.61757f,
+    5.93645f, 6.27096f, 6.62173f, 6.98942f, 7.37472f, 7.77831f, 8.20093f, 8.64331f,
+    9.10622f, 9.59045f, 10.0968f, 10.6261f, 11.1793f, 11.7571f, 12.3606f, 12.9906f,
+    13.6481f, 14.3341f, 15.0497f, 15.7958f, 16.5735f, 17.3839f, 18.2282f, 19.1075f,
+    20.023f,
+};
+
+// Ideal gas: density (g/m³) = e (kPa) * 1e6 / (461.4 J/(kg K) * T (K))
+static const float VAPOR_DENSITY_FACTOR = 2167.4f;
+
+static float vaporDensity(float vaporPressure, float temperature) {
+    return VAPOR_DENSITY_FACTOR * vaporPressure / (temperature + 273.15f);
+}
+
+Psychrometrics::Psychrometrics() {
+    _outdoorTemperature = NAN;
+    _outdoorHumidity = NAN;
+    _outdoorValid = false;
+    _outdoorAt = 0;
+}
+
+float Psychrometrics::saturationVaporPressure(float temperature) {
+    float x = temperature - (float)PSYCHRO_TABLE_MIN_C;
+    if (!(x > 0.0f)) {
+        return SVP_TABLE[0];  // NaN lands here too
+    }
+    if (x >= (float)(TABLE_SIZE - 1)) {
+        return SVP_TABLE[TABLE_SIZE - 1];
+    }
+    int i = (int)x;
+    float fraction = x - (float)i;
+    return SVP_TABLE[i] + (SVP_TABLE[i + 1] - SVP_TABLE[i]) * fraction;
+}
+
+float Psychrometrics::dewPointFromVaporPressure(float vaporPressure) {
+    if (!(vaporPressure > SVP_TABLE[0])) {
+        return (float)PSYCHRO_TABLE_MIN_C;
+    }
+    if (vaporPressure >= SVP_TABLE[TABLE_SIZE - 1]) {
+        return (float)PSYCHRO_TABLE_MAX_C;
+    }
+    // Last entry at or below the pressure: fixed halving steps, no data-dependent loop exit
+    int low = 0;
+    for (int step = 64; step > 0; step >>= 1) {
+        if (low + step < TABLE_SIZE && SVP_TABLE[low + step] <= vaporPressure) {
+            low += step;
+        }
+    }
+    int high = low + 1;
+    float fraction = (vaporPressure - SVP_TABLE[low]) / (SVP_TABLE[high] - SVP_TABLE[low]);
+    return (float)(PSYCHRO_TABLE_MIN_C + low) + fraction;
+}
+
+float Psychrometrics::dewPoint(float temperature, float humidity) {
+    return dewPointFromVaporPressure(saturationVaporPressure(temperature) * humidity * 0.01f);
+}
+
+float Psychrometrics::vaporPressureDeficit(float temperature, float humidity) {
+    return saturationVaporPressure(temperature) * (1.0f - humidity * 0.01f);
+}
+
+float Psychrometrics::absoluteHumidity(float temperature, float humidity) {
+    return vaporDensity(saturationVaporPressure(temperature) * humidity * 0.01f, temperature);
+}
+
+bool Psychrometrics::compute(float temperature, float humidity, ClimateMetrics& metrics) const {
+    if (isnan(temperature) || !(humidity >= 0.0f && humidity <= 100.0f)) {
+        return false;
+    }
+    // One table lookup serves all three
+    float saturation = saturationVaporPressure(temperature);
+    float vapor = saturation * humidity * 0.01f;
+    metrics.vpd = saturation - vapor;
+    metrics.dewPoint = dewPointFromVaporPressure(vapor);
+    metrics.absoluteHumidity = vaporDensity(vapor, temperature);
+
+    metrics.outdoor = hasOutdoor() && !isnan(_outdoorTemperature);
+    if (metrics.outdoor) {
+        float outdoorVapor = saturationVaporPressure(_outdoorTemperature) * _outdoorHumidity * 0.01f;
+        metrics.outdoorDewPoint = dewPointFromVaporPressure(outdoorVapor);
+        metrics.absoluteHumidityDelta = metrics.absoluteHumidity - vaporDensity(outdoorVapor, _outdoorTemperature);
+    }
+    return true;
+}
+
+void Psychrometrics::setOutdoor(float temperature, float humidity) {
+    // The backend sends -1 when its weather API failed
+    _outdoorValid = humidity >= 0.0f && humidity <= 100.0f;
+    _outdoorTemperature = temperature;
+    _outdoorHumidity = humidity;
+    _outdoorAt = millis();
+}
+
+bool Psychrometrics::hasOutdoor() const {
+    return _outdoorValid && millis() - _outdoorAt < CLIMATE_OUTDOOR_MAX_AGE_MS;
+}
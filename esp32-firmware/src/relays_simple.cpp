@@ -4,8 +4,21 @@
 #include "relays.h"
 #include <Arduino.h>
 
+#if RELAY_EXPANDER_COUNT > 0
+#include <Wire.h>
+#include "metrics.h"
+
+static Counter busWritesMetric("relay_bus_writes_total", "I2C writes to the relay expanders");
+static Counter busErrorsMetric("relay_bus_errors_total", "I2C writes to the relay expanders that were not acknowledged");
+
+// MCP23017 registers (IOCON.BANK = 0, the power-on mapping; sequential addressing on)
+static const uint8_t MCP23017_IODIRA = 0x00;
+static const uint8_t MCP23017_OLATA = 0x14;
+static const uint8_t EXPANDER_ALL = (uint8_t)((1u << RELAY_EXPANDER_COUNT) - 1);
+#endif
+
 // Define relay pins array
-const uint8_t RelayManager::relayPins[4] = {
+const uint8_t RelayManager::relayPins[RELAY_GPIO_COUNT] = {
     RELAY_LUCES_PIN,
     RELAY_VENTILADOR_PIN,
     RELAY_BOMBA_PIN,
@@ -17,7 +30,7 @@ const char RelayManager::relayName0[] PROGMEM = "luces";
 const char RelayManager::relayName1[] PROGMEM = "ventilador";
 const char RelayManager::relayName2[] PROGMEM = "bomba";
 const char RelayManager::relayName3[] PROGMEM = "calefactor";
-const char* const RelayManager::relayNames_P[4] PROGMEM = {
+const char* const RelayManager::relayNames_P[RELAY_GPIO_COUNT] PROGMEM = {
     RelayManager::relayName0,
     RelayManager::relayName1,
     RelayManager::relayName2,
@@ -28,59 +41,189 @@ const char* const RelayManager::relayNames_P[4] PROGMEM = {
 RelayManager relays;
 
 RelayManager::RelayManager() : lastAutoCheck(0), safetyLimitsEnabled(false) {
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < RELAY_COUNT; i++) {
         relayStates[i].is_on = false;
         relayStates[i].mode = RELAY_MODE_MANUAL;
         relayStates[i].last_change = 0;
         relayStates[i].total_on_time = 0;
-        relayStates[i].auto_rule = "";
+        relayStates[i].auto_rule[0] = '\0';
+    }
+#if RELAY_EXPANDER_COUNT > 0
+    for (int i = 0; i < RELAY_COUNT - RELAY_GPIO_COUNT; i++) {
+        snprintf(_expanderNames[i], RELAY_NAME_MAX, "rele_%d", RELAY_GPIO_COUNT + i);
+    }
+    for (int e = 0; e < RELAY_EXPANDER_COUNT; e++) {
+        _expanderOutputs[e] = RELAY_EXPANDER_ACTIVE_LOW ? 0xFFFF : 0x0000;  // All OFF
     }
+    _expanderDirty = 0;
+    _expanderNeedsConfig = EXPANDER_ALL;
+    _expanderFailing = 0;
+    _lastBusFailure = 0;
+    _lastBusRefresh = 0;
+#endif
 }
 
-String RelayManager::relayName(uint8_t idx) const {
-    if (idx >= 4) return "unknown";
-    char buffer[32];
-    strcpy_P(buffer, (char*)pgm_read_ptr(&relayNames_P[idx]));
-    return String(buffer);
+const char* RelayManager::relayName(uint8_t idx) const {
+    if (idx >= RELAY_COUNT) return "unknown";
+#if RELAY_EXPANDER_COUNT > 0
+    if (idx >= RELAY_GPIO_COUNT) return _expanderNames[idx - RELAY_GPIO_COUNT];
+#endif
+    // Flash is memory-mapped on the ESP32: the name is printed in place
+    return (const char*)pgm_read_ptr(&relayNames_P[idx]);
 }
 
 bool RelayManager::begin() {
     DEBUG_PRINTLN("Initializing relays...");
     
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < RELAY_GPIO_COUNT; i++) {
         pinMode(relayPins[i], OUTPUT);
         digitalWrite(relayPins[i], LOW);  // Relays OFF by default (active HIGH)
         relayStates[i].is_on = false;
-        DEBUG_PRINTF("  Relay %d (%s): PIN %d - OFF\n", i, relayName(i).c_str(), relayPins[i]);
+        DEBUG_PRINTF("  Relay %d (%s): PIN %d - OFF\n", i, relayName(i), relayPins[i]);
+    }
+    
+#if RELAY_EXPANDER_COUNT > 0
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCK_HZ);
+    _expanderNeedsConfig = EXPANDER_ALL;
+    _lastBusFailure = 0;
+    update();
+    _lastBusRefresh = millis();
+    for (int e = 0; e < RELAY_EXPANDER_COUNT; e++) {
+        DEBUG_PRINTF("  Relays %d-%d: %s at 0x%02X - %s\n", RELAY_GPIO_COUNT + e * RELAY_CHANNELS_PER_EXPANDER,
+                     RELAY_GPIO_COUNT + (e + 1) * RELAY_CHANNELS_PER_EXPANDER - 1,
+                     RELAY_EXPANDER_TYPE == RELAY_EXPANDER_MCP23017 ? "MCP23017" : "PCF8575",
+                     RELAY_EXPANDER_BASE_ADDRESS + e, (_expanderFailing & (1 << e)) ? "NOT RESPONDING" : "OFF");
+    }
+    if (_expanderFailing) {
+        return false;
     }
+#endif
     
     DEBUG_PRINTLN("[OK] Relays initialized");
     return true;
 }
 
 void RelayManager::update() {
-    // No-op in VPS client mode
-    // Relay states are controlled from VPS
+    // No automation in VPS client mode: relay states are controlled from VPS.
+    // What is left is getting expander channels onto their pins.
+#if RELAY_EXPANDER_COUNT > 0
+    unsigned long now = millis();
+    if (now - _lastBusRefresh >= RELAY_BUS_REFRESH_MS) {
+        // An expander that browned out alone comes back as inputs without NACKing anything
+        _lastBusRefresh = now;
+        _expanderNeedsConfig = EXPANDER_ALL;
+    }
+    if (!(_expanderDirty | _expanderNeedsConfig)) {
+        return;
+    }
+    if (_expanderFailing && now - _lastBusFailure < RELAY_BUS_RETRY_MS) {
+        return;
+    }
+    
+    for (uint8_t e = 0; e < RELAY_EXPANDER_COUNT; e++) {
+        uint8_t bit = 1 << e;
+        if (!((_expanderDirty | _expanderNeedsConfig) & bit)) {
+            continue;
+        }
+        bool ok = (_expanderNeedsConfig & bit) ? configureExpander(e) : writeExpander(e);
+        if (ok) {
+            _expanderDirty &= ~bit;
+            _expanderNeedsConfig &= ~bit;
+            if (_expanderFailing & bit) {
+                _expanderFailing &= ~bit;
+                LOG_INFOF("[RELAY] Expander 0x%02X responding again\n", RELAY_EXPANDER_BASE_ADDRESS + e);
+            }
+        } else {
+            _expanderNeedsConfig |= bit;  // State after a failed transaction is unknown
+            _lastBusFailure = now;
+            if (!(_expanderFailing & bit)) {
+                _expanderFailing |= bit;
+                LOG_ERRORF("[RELAY] Expander 0x%02X not responding, retrying every %d ms\n",
+                           RELAY_EXPANDER_BASE_ADDRESS + e, RELAY_BUS_RETRY_MS);
+            }
+        }
+    }
+#endif
+}
+
+bool RelayManager::busSettled() const {
+#if RELAY_EXPANDER_COUNT > 0
+    return !_expanderDirty && !_expanderFailing;
+#else
+    return true;
+#endif
 }
 
+#if RELAY_EXPANDER_COUNT > 0
+bool RelayManager::configureExpander(uint8_t expander) {
+    if (RELAY_EXPANDER_TYPE == RELAY_EXPANDER_PCF8575) {
+        return writeExpander(expander);  // No direction register: writing the port is the whole setup
+    }
+    // Latch first, then directions, so no pin glitches ON while turning into an output
+    if (!writeExpander(expander)) {
+        return false;
+    }
+    uint8_t directions[] = {MCP23017_IODIRA, 0x00, 0x00};  // IODIRA, IODIRB: all outputs
+    Wire.beginTransmission(RELAY_EXPANDER_BASE_ADDRESS + expander);
+    Wire.write(directions, sizeof(directions));
+    busWritesMetric.inc();
+    if (Wire.endTransmission() != 0) {
+        busErrorsMetric.inc();
+        return false;
+    }
+    return true;
+}
+
+bool RelayManager::writeExpander(uint8_t expander) {
+    uint16_t outputs = _expanderOutputs[expander];
+    Wire.beginTransmission(RELAY_EXPANDER_BASE_ADDRESS + expander);
+    if (RELAY_EXPANDER_TYPE == RELAY_EXPANDER_MCP23017) {
+        Wire.write(MCP23017_OLATA);  // OLATA then OLATB: all 16 outputs in one transaction
+    }
+    Wire.write((uint8_t)outputs);
+    Wire.write((uint8_t)(outputs >> 8));
+    busWritesMetric.inc();
+    if (Wire.endTransmission() != 0) {
+        busErrorsMetric.inc();
+        return false;
+    }
+    return true;
+}
+#endif
+
 bool RelayManager::setRelay(int relayIndex, bool state) {
-    if (relayIndex < 0 || relayIndex >= 4) {
+    if (relayIndex < 0 || relayIndex >= RELAY_COUNT) {
         DEBUG_PRINTF("Invalid relay index: %d\n", relayIndex);
         return false;
     }
     
-    digitalWrite(relayPins[relayIndex], state ? HIGH : LOW);
+    if (relayIndex < RELAY_GPIO_COUNT) {
+        digitalWrite(relayPins[relayIndex], state ? HIGH : LOW);
+    }
+#if RELAY_EXPANDER_COUNT > 0
+    else {
+        int channel = relayIndex - RELAY_GPIO_COUNT;
+        uint8_t expander = channel / RELAY_CHANNELS_PER_EXPANDER;
+        uint16_t mask = (uint16_t)(1u << (channel % RELAY_CHANNELS_PER_EXPANDER));
+        uint16_t outputs = (state != (bool)RELAY_EXPANDER_ACTIVE_LOW) ? (_expanderOutputs[expander] | mask)
+                                                                       : (_expanderOutputs[expander] & ~mask);
+        if (outputs != _expanderOutputs[expander]) {
+            _expanderOutputs[expander] = outputs;
+            _expanderDirty |= 1 << expander;  // Written by the next update()
+        }
+    }
+#endif
     relayStates[relayIndex].is_on = state;
     relayStates[relayIndex].last_change = millis();
     relayStates[relayIndex].mode = RELAY_MODE_MANUAL;
     
-    DEBUG_PRINTF("Relay %d (%s): %s\n", relayIndex, relayName(relayIndex).c_str(), state ? "ON" : "OFF");
+    DEBUG_PRINTF("Relay %d (%s): %s\n", relayIndex, relayName(relayIndex), state ? "ON" : "OFF");
     
     return true;
 }
 
 bool RelayManager::toggleRelay(int relayIndex) {
-    if (relayIndex < 0 || relayIndex >= 4) {
+    if (relayIndex < 0 || relayIndex >= RELAY_COUNT) {
         return false;
     }
     
@@ -88,7 +231,7 @@ bool RelayManager::toggleRelay(int relayIndex) {
 }
 
 bool RelayManager::getRelayState(int relayIndex) {
-    if (relayIndex < 0 || relayIndex >= 4) {
+    if (relayIndex < 0 || relayIndex >= RELAY_COUNT) {
         return false;
     }
     
@@ -96,13 +239,13 @@ bool RelayManager::getRelayState(int relayIndex) {
 }
 
 RelayState RelayManager::getRelayStateStruct(int relayIndex) {
-    if (relayIndex < 0 || relayIndex >= 4) {
+    if (relayIndex < 0 || relayIndex >= RELAY_COUNT) {
         RelayState empty;
         empty.is_on = false;
         empty.mode = RELAY_MODE_MANUAL;
         empty.last_change = 0;
         empty.total_on_time = 0;
-        empty.auto_rule = "";
+        empty.auto_rule[0] = '\0';
         return empty;
     }
     
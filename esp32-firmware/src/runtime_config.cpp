@@ -0,0 +1,293 @@
+// Device identity and the NVS runtime configuration pushed by the backend (config:set)
+
+#include "runtime_config.h"
+#include <Preferences.h>
+#include <stddef.h>
+
+// Global instance
+RuntimeConfig runtimeConfig;
+
+static const char* const CONFIG_NVS_NAMESPACE = "config";
+static const char* const CONFIG_NVS_KEY = "runtime";
+
+/**
+ * One tunable value: JSON key, location in RuntimeConfigValues and accepted range
+ */
+struct RuntimeConfigField {
+    const char* key;
+    size_t offset;
+    bool isFloat;
+    double min;
+    double max;
+};
+
+// Ranges keep a bad push from bricking the link (a 0 ms interval, a week-long backoff)
+static const RuntimeConfigField CONFIG_FIELDS[] = {
+    {"sensor_interval_ms", offsetof(RuntimeConfigValues, sensorIntervalMs), false, SENSOR_READ_MIN_INTERVAL_MS, 3600000},
+    {"metrics_interval_ms", offsetof(RuntimeConfigValues, metricsIntervalMs), false, 10000, 86400000},
+    {"health_check_interval_ms", offsetof(RuntimeConfigValues, healthCheckIntervalMs), false, 5000, 3600000},
+    {"reconnect_interval_ms", offsetof(RuntimeConfigValues, reconnectIntervalMs), false, 1000, 600000},
+    {"auth_backoff_base_ms", offsetof(RuntimeConfigValues, authBackoffBaseMs), false, 1000, 3600000},
+    {"auth_backoff_max_ms", offsetof(RuntimeConfigValues, authBackoffMaxMs), false, 1000, 86400000},
+    {"log_forward_interval_ms", offsetof(RuntimeConfigValues, logForwardIntervalMs), false, 1000, 600000},
+    {"time_probe_interval_ms", offsetof(RuntimeConfigValues, timeProbeIntervalMs), false, 10000, 86400000},
+    {"memory_sample_interval_ms", offsetof(RuntimeConfigValues, memorySampleIntervalMs), false, 1000, 600000},
+    {"max_temp_change", offsetof(RuntimeConfigValues, maxTempChange), true, 0.5, 50},
+    {"max_humidity_change", offsetof(RuntimeConfigValues, maxHumidityChange), true, 1, 100},
+    {"heater_mode", offsetof(RuntimeConfigValues, heaterMode), false, CONTROL_MODE_OFF, CONTROL_MODE_PID},
+    {"heater_setpoint", offsetof(RuntimeConfigValues, heaterSetpoint), true, 0, 40},
+    {"heater_kp", offsetof(RuntimeConfigValues, heaterKp), true, 0, 10},
+    {"heater_ki", offsetof(RuntimeConfigValues, heaterKi), true, 0, 1},
+    {"heater_kd", offsetof(RuntimeConfigValues, heaterKd), true, 0, 10},
+    {"fan_mode", offsetof(RuntimeConfigValues, fanMode), false, CONTROL_MODE_OFF, CONTROL_MODE_PID},
+    {"fan_setpoint", offsetof(RuntimeConfigValues, fanSetpoint), true, 5, 45},
+    {"fan_kp", offsetof(RuntimeConfigValues, fanKp), true, 0, 10},
+    {"fan_ki", offsetof(RuntimeConfigValues, fanKi), true, 0, 1},
+    {"fan_kd", offsetof(RuntimeConfigValues, fanKd), true, 0, 10},
+    {"fan_humidity_max", offsetof(RuntimeConfigValues, fanHumidityMax), true, 30, 100},
+    {"control_band", offsetof(RuntimeConfigValues, controlBand), true, 0.2, 10},
+    {"control_window_ms", offsetof(RuntimeConfigValues, controlWindowMs), false, 10000, 3600000},
+    {"control_min_switch_ms", offsetof(RuntimeConfigValues, controlMinSwitchMs), false, 0, 600000},
+};
+static const size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+// Stored as header + values (header.length bytes) + FNV-1a checksum of both
+struct RuntimeConfigHeader {
+    uint16_t schema;
+    uint16_t length;
+    uint32_t revision;
+};
+
+static double fieldValue(const RuntimeConfigValues& values, const RuntimeConfigField& field) {
+    const uint8_t* base = (const uint8_t*)&values + field.offset;
+    return field.isFloat ? (double)*(const float*)base : (double)*(const uint32_t*)base;
+}
+
+static void setFieldValue(RuntimeConfigValues& values, const RuntimeConfigField& field, double value) {
+    uint8_t* base = (uint8_t*)&values + field.offset;
+    if (field.isFloat) {
+        *(float*)base = (float)value;
+    } else {
+        *(uint32_t*)base = (uint32_t)value;
+    }
+}
+
+static bool inRange(const RuntimeConfigField& field, double value) {
+    return value >= field.min && value <= field.max;
+}
+
+static uint32_t checksum(const uint8_t* bytes, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+RuntimeConfig::RuntimeConfig() {
+    _values = defaults();
+    _revision = 0;
+    _deviceId[0] = '\0';
+}
+
+RuntimeConfigValues RuntimeConfig::defaults() {
+    RuntimeConfigValues values;
+    values.sensorIntervalMs = SENSOR_READ_INTERVAL_MS;
+    values.metricsIntervalMs = METRICS_SEND_INTERVAL_MS;
+    values.healthCheckIntervalMs = HEALTH_CHECK_INTERVAL_MS;
+    values.unusedPingIdleMs = 0;
+    values.reconnectIntervalMs = WS_RECONNECT_INTERVAL_MS;
+    values.authBackoffBaseMs = AUTH_BACKOFF_BASE_MS;
+    values.authBackoffMaxMs = AUTH_BACKOFF_MAX_MS;
+    values.logForwardIntervalMs = LOG_FORWARD_INTERVAL_MS;
+    values.timeProbeIntervalMs = TIME_SERVER_PROBE_INTERVAL_MS;
+    values.memorySampleIntervalMs = MEMORY_SAMPLE_INTERVAL_MS;
+    values.maxTempChange = MAX_TEMP_CHANGE_PER_READ;
+    values.maxHumidityChange = MAX_HUMIDITY_CHANGE_PER_READ;
+    values.heaterMode = CONTROL_HEATER_MODE;
+    values.heaterSetpoint = CONTROL_HEATER_SETPOINT;
+    values.heaterKp = CONTROL_HEATER_KP;
+    values.heaterKi = CONTROL_HEATER_KI;
+    values.heaterKd = CONTROL_HEATER_KD;
+    values.fanMode = CONTROL_FAN_MODE;
+    values.fanSetpoint = CONTROL_FAN_SETPOINT;
+    values.fanKp = CONTROL_FAN_KP;
+    values.fanKi = CONTROL_FAN_KI;
+    values.fanKd = CONTROL_FAN_KD;
+    values.fanHumidityMax = CONTROL_FAN_HUMIDITY_MAX;
+    values.controlBand = CONTROL_BAND_C;
+    values.controlWindowMs = CONTROL_WINDOW_MS;
+    values.controlMinSwitchMs = CONTROL_MIN_SWITCH_MS;
+    return values;
+}
+
+void RuntimeConfig::begin() {
+    if (DEVICE_ID[0] != '\0') {
+        strncpy(_deviceId, DEVICE_ID, sizeof(_deviceId) - 1);
+        _deviceId[sizeof(_deviceId) - 1] = '\0';
+    } else {
+        // Factory MAC from eFuse (valid before WiFi starts), first byte lowest
+        uint64_t mac = ESP.getEfuseMac();
+        snprintf(_deviceId, sizeof(_deviceId), "%s%02X%02X%02X%02X%02X%02X", DEVICE_ID_PREFIX,
+                 (unsigned)(uint8_t)mac, (unsigned)(uint8_t)(mac >> 8), (unsigned)(uint8_t)(mac >> 16),
+                 (unsigned)(uint8_t)(mac >> 24), (unsigned)(uint8_t)(mac >> 32), (unsigned)(uint8_t)(mac >> 40));
+    }
+
+    if (load()) {
+        LOG_INFOF("[CONFIG] %s: stored configuration revision %lu\n", _deviceId, (unsigned long)_revision);
+    } else {
+        DEBUG_PRINTF("[CONFIG] %s: compiled defaults\n", _deviceId);
+    }
+}
+
+bool RuntimeConfig::load() {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    uint8_t blob[sizeof(RuntimeConfigHeader) + sizeof(RuntimeConfigValues) + sizeof(uint32_t)];
+    size_t length = prefs.getBytes(CONFIG_NVS_KEY, blob, sizeof(blob));
+    prefs.end();
+
+    RuntimeConfigHeader header;
+    if (length < sizeof(header) + sizeof(uint32_t)) {
+        return false;
+    }
+    memcpy(&header, blob, sizeof(header));
+    if (header.schema != CONFIG_SCHEMA_VERSION || header.length > sizeof(RuntimeConfigValues) ||
+        length != sizeof(header) + header.length + sizeof(uint32_t)) {
+        LOG_WARNF("[CONFIG] Stored configuration has schema %u (expected %u), using defaults\n", (unsigned)header.schema,
+                  (unsigned)CONFIG_SCHEMA_VERSION);
+        return false;
+    }
+    uint32_t stored;
+    memcpy(&stored, blob + sizeof(header) + header.length, sizeof(stored));
+    if (stored != checksum(blob, sizeof(header) + header.length)) {
+        LOG_WARN("[CONFIG] Stored configuration is corrupt, using defaults");
+        return false;
+    }
+
+    RuntimeConfigValues values = defaults();
+    memcpy(&values, blob + sizeof(header), header.length);
+    RuntimeConfigValues fallback = defaults();
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (!inRange(CONFIG_FIELDS[i], fieldValue(values, CONFIG_FIELDS[i]))) {
+            setFieldValue(values, CONFIG_FIELDS[i], fieldValue(fallback, CONFIG_FIELDS[i]));
+        }
+    }
+    _values = values;
+    _revision = header.revision;
+    return true;
+}
+
+void RuntimeConfig::store() {
+    uint8_t blob[sizeof(RuntimeConfigHeader) + sizeof(RuntimeConfigValues) + sizeof(uint32_t)];
+    RuntimeConfigHeader header;
+    header.schema = CONFIG_SCHEMA_VERSION;
+    header.length = sizeof(RuntimeConfigValues);
+    header.revision = _revision;
+    memcpy(blob, &header, sizeof(header));
+    memcpy(blob + sizeof(header), &_values, sizeof(_values));
+    uint32_t sum = checksum(blob, sizeof(header) + sizeof(_values));
+    memcpy(blob + sizeof(header) + sizeof(_values), &sum, sizeof(sum));
+
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, false) || prefs.putBytes(CONFIG_NVS_KEY, blob, sizeof(blob)) != sizeof(blob)) {
+        LOG_ERROR("[CONFIG] Failed to store configuration (applied until reboot)");
+    }
+    prefs.end();
+}
+
+void RuntimeConfig::reset() {
+    _values = defaults();
+    _revision = 0;
+    Preferences prefs;
+    if (prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+        prefs.remove(CONFIG_NVS_KEY);
+        prefs.end();
+    }
+}
+
+// The list is bounded: a payload full of unknown keys must not outgrow config:state
+static void reject(JsonArray rejected, int& rejectedCount, const char* key) {
+    if (rejectedCount < CONFIG_REJECTED_KEYS_MAX) {
+        rejected.add(key);
+    }
+    rejectedCount++;
+}
+
+int RuntimeConfig::apply(JsonObject& data, JsonArray rejected, int& rejectedCount) {
+    rejectedCount = 0;
+    if (data["reset"] | false) {
+        RuntimeConfigValues previous = _values;
+        reset();
+        LOG_INFO("[CONFIG] Reset to compiled defaults");
+        return memcmp(&previous, &_values, sizeof(previous)) != 0 ? 1 : 0;
+    }
+
+    RuntimeConfigValues next = _values;
+    for (JsonPair pair : data) {
+        const char* key = pair.key().c_str();
+        if (strcmp(key, "device_id") == 0) {
+            continue;  // Addressing, added by the backend
+        }
+        const RuntimeConfigField* field = nullptr;
+        for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+            if (strcmp(CONFIG_FIELDS[i].key, key) == 0) {
+                field = &CONFIG_FIELDS[i];
+                break;
+            }
+        }
+        JsonVariant value = pair.value();
+        if (!field || !value.is<double>() || !inRange(*field, value.as<double>())) {
+            reject(rejected, rejectedCount, key);
+            continue;
+        }
+        setFieldValue(next, *field, value.as<double>());
+    }
+    if (next.authBackoffMaxMs < next.authBackoffBaseMs) {
+        next.authBackoffBaseMs = _values.authBackoffBaseMs;
+        next.authBackoffMaxMs = _values.authBackoffMaxMs;
+        reject(rejected, rejectedCount, "auth_backoff_max_ms");
+    }
+    if (next.heaterSetpoint >= next.fanSetpoint) {
+        // The loops would fight: heating into the band the fan is cooling
+        next.heaterSetpoint = _values.heaterSetpoint;
+        next.fanSetpoint = _values.fanSetpoint;
+        reject(rejected, rejectedCount, "fan_setpoint");
+    }
+    if (next.controlMinSwitchMs * 2 > next.controlWindowMs) {
+        // Every window would be all on or all off
+        next.controlWindowMs = _values.controlWindowMs;
+        next.controlMinSwitchMs = _values.controlMinSwitchMs;
+        reject(rejected, rejectedCount, "control_min_switch_ms");
+    }
+
+    int changed = 0;
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (fieldValue(next, CONFIG_FIELDS[i]) != fieldValue(_values, CONFIG_FIELDS[i])) {
+            changed++;
+        }
+    }
+    if (changed == 0) {
+        return 0;  // Same values again: spare the flash
+    }
+    _values = next;
+    _revision++;
+    store();
+    LOG_INFOF("[CONFIG] %d value(s) changed, revision %lu\n", changed, (unsigned long)_revision);
+    return changed;
+}
+
+void RuntimeConfig::toJson(JsonObject& out) const {
+    out["schema"] = CONFIG_SCHEMA_VERSION;
+    out["revision"] = _revision;
+    JsonObject values = out.createNestedObject("values");
+    for (size_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (CONFIG_FIELDS[i].isFloat) {
+            values[CONFIG_FIELDS[i].key] = (float)fieldValue(_values, CONFIG_FIELDS[i]);
+        } else {
+            values[CONFIG_FIELDS[i].key] = (uint32_t)fieldValue(_values, CONFIG_FIELDS[i]);
+        }
+    }
+}
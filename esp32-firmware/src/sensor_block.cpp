@@ -0,0 +1,262 @@
+// Gorilla-style compressed blocks of sensor readings (delta-of-delta timestamps, XOR floats)
+
+#include "sensor_block.h"
+
+// Global instance
+SensorBlockEncoder sensorBacklog;
+
+static_assert(SENSOR_BLOCK_MAX_BYTES * 8 >= SENSOR_BLOCK_HEADER_BYTES * 8 + SENSOR_BLOCK_MAX_READING_BITS,
+              "SENSOR_BLOCK_MAX_BYTES cannot hold one reading");
+
+static const uint8_t NO_WINDOW = 0xFF;      // No explicit value code written yet for the channel
+
+// Delta-of-delta buckets: prefix, prefix length, payload bits and bias (payload = dod + bias)
+struct TimestampBucket {
+    uint8_t prefix;
+    uint8_t prefixBits;
+    uint8_t payloadBits;
+    int32_t bias;
+};
+
+static const TimestampBucket TIMESTAMP_BUCKETS[] = {
+    {0x2, 2, 7, 63},        // '10'   [-63, 64]
+    {0x6, 3, 9, 255},       // '110'  [-255, 256]
+    {0xE, 4, 12, 2047},     // '1110' [-2047, 2048]
+};
+
+SensorBlockEncoder::SensorBlockEncoder() {
+    reset();
+}
+
+void SensorBlockEncoder::reset(size_t capacity) {
+    const size_t minimum = SENSOR_BLOCK_HEADER_BYTES + (SENSOR_BLOCK_MAX_READING_BITS + 7) / 8;
+    _capacity = capacity > SENSOR_BLOCK_MAX_BYTES ? SENSOR_BLOCK_MAX_BYTES : (capacity < minimum ? minimum : capacity);
+    _bits = 0;
+    _count = 0;
+    _firstMs = 0;
+    _lastMs = 0;
+    _lastDelta = 0;
+    memset(_lastValue, 0, sizeof(_lastValue));
+    memset(_leading, NO_WINDOW, sizeof(_leading));
+    memset(_trailing, 0, sizeof(_trailing));
+}
+
+bool SensorBlockEncoder::append(uint64_t timestampMs, const float values[SENSOR_BLOCK_CHANNELS]) {
+    uint32_t raw[SENSOR_BLOCK_CHANNELS];
+    memcpy(raw, values, sizeof(raw));
+
+    if (_count == 0) {
+        _buffer[0] = SENSOR_BLOCK_VERSION;
+        _buffer[1] = SENSOR_BLOCK_CHANNELS;
+        for (uint8_t i = 0; i < 8; i++) {
+            _buffer[4 + i] = (uint8_t)(timestampMs >> (8 * i));
+        }
+        _firstMs = timestampMs;
+        for (uint8_t channel = 0; channel < SENSOR_BLOCK_CHANNELS; channel++) {
+            writeBits(raw[channel], 32);
+            _lastValue[channel] = raw[channel];
+        }
+    } else {
+        size_t freeBits = (_capacity - SENSOR_BLOCK_HEADER_BYTES) * 8 - _bits;
+        if (_count == UINT16_MAX || freeBits < SENSOR_BLOCK_MAX_READING_BITS) {
+            return false;
+        }
+        if (timestampMs < _lastMs || timestampMs - _lastMs > (uint64_t)INT32_MAX) {
+            return false;  // Backwards, or an interval the 32-bit code cannot carry: start a new block
+        }
+        int64_t delta = (int64_t)(timestampMs - _lastMs);
+        writeTimestamp(delta - _lastDelta);
+        _lastDelta = delta;
+        for (uint8_t channel = 0; channel < SENSOR_BLOCK_CHANNELS; channel++) {
+            writeValue(channel, raw[channel]);
+        }
+    }
+    _lastMs = timestampMs;
+    _count++;
+    _buffer[2] = (uint8_t)_count;
+    _buffer[3] = (uint8_t)(_count >> 8);
+    return true;
+}
+
+void SensorBlockEncoder::writeBits(uint32_t value, uint8_t bits) {
+    uint8_t* stream = _buffer + SENSOR_BLOCK_HEADER_BYTES;
+    while (bits > 0) {
+        size_t byte = _bits / 8;
+        uint8_t room = 8 - (_bits % 8);
+        uint8_t take = bits < room ? bits : room;
+        uint8_t chunk = (uint8_t)((value >> (bits - take)) & ((1u << take) - 1));
+        if (room == 8) {
+            stream[byte] = 0;
+        }
+        stream[byte] |= (uint8_t)(chunk << (room - take));
+        _bits += take;
+        bits -= take;
+    }
+}
+
+void SensorBlockEncoder::writeTimestamp(int64_t deltaOfDelta) {
+    if (deltaOfDelta == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    for (const TimestampBucket& bucket : TIMESTAMP_BUCKETS) {
+        if (deltaOfDelta >= -bucket.bias && deltaOfDelta <= bucket.bias + 1) {
+            writeBits(bucket.prefix, bucket.prefixBits);
+            writeBits((uint32_t)(deltaOfDelta + bucket.bias), bucket.payloadBits);
+            return;
+        }
+    }
+    writeBits(0xF, 4);
+    writeBits((uint32_t)(int32_t)deltaOfDelta, 32);
+}
+
+void SensorBlockEncoder::writeValue(uint8_t channel, uint32_t value) {
+    uint32_t x = value ^ _lastValue[channel];
+    _lastValue[channel] = value;
+    if (x == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    uint8_t leading = (uint8_t)__builtin_clz(x);
+    uint8_t trailing = (uint8_t)__builtin_ctz(x);
+    if (_leading[channel] != NO_WINDOW && leading >= _leading[channel] && trailing >= _trailing[channel]) {
+        // Fits the previous window: no need to repeat its position
+        writeBits(0x2, 2);
+        writeBits(x >> _trailing[channel], 32 - _leading[channel] - _trailing[channel]);
+        return;
+    }
+    uint8_t length = 32 - leading - trailing;
+    writeBits(0x3, 2);
+    writeBits(leading, 5);
+    writeBits(length - 1, 5);
+    writeBits(x >> trailing, length);
+    _leading[channel] = leading;
+    _trailing[channel] = trailing;
+}
+
+SensorBlockDecoder::SensorBlockDecoder(const uint8_t* data, size_t length) {
+    _data = data;
+    _position = 0;
+    _decoded = 0;
+    _lastMs = 0;
+    _lastDelta = 0;
+    memset(_lastValue, 0, sizeof(_lastValue));
+    memset(_leading, 0, sizeof(_leading));
+    memset(_trailing, 0, sizeof(_trailing));
+    _valid = length >= SENSOR_BLOCK_HEADER_BYTES && data[0] == SENSOR_BLOCK_VERSION &&
+             data[1] == SENSOR_BLOCK_CHANNELS;
+    if (!_valid) {
+        _lengthBits = 0;
+        _count = 0;
+        return;
+    }
+    _lengthBits = (length - SENSOR_BLOCK_HEADER_BYTES) * 8;
+    _count = (uint16_t)(data[2] | (data[3] << 8));
+    for (uint8_t i = 0; i < 8; i++) {
+        _lastMs |= (uint64_t)data[4 + i] << (8 * i);
+    }
+}
+
+bool SensorBlockDecoder::next(uint64_t& timestampMs, float values[SENSOR_BLOCK_CHANNELS]) {
+    if (!_valid || _decoded >= _count) {
+        return false;
+    }
+    if (_decoded == 0) {
+        for (uint8_t channel = 0; channel < SENSOR_BLOCK_CHANNELS; channel++) {
+            if (!readBits(32, _lastValue[channel])) {
+                return false;
+            }
+        }
+    } else {
+        int64_t deltaOfDelta;
+        if (!readTimestamp(deltaOfDelta)) {
+            return false;
+        }
+        _lastDelta += deltaOfDelta;
+        _lastMs += _lastDelta;
+        for (uint8_t channel = 0; channel < SENSOR_BLOCK_CHANNELS; channel++) {
+            if (!readValue(channel)) {
+                return false;
+            }
+        }
+    }
+    _decoded++;
+    timestampMs = _lastMs;
+    memcpy(values, _lastValue, sizeof(_lastValue));
+    return true;
+}
+
+bool SensorBlockDecoder::readBits(uint8_t bits, uint32_t& value) {
+    if (_position + bits > _lengthBits) {
+        return false;
+    }
+    const uint8_t* stream = _data + SENSOR_BLOCK_HEADER_BYTES;
+    value = 0;
+    while (bits > 0) {
+        uint8_t room = 8 - (_position % 8);
+        uint8_t take = bits < room ? bits : room;
+        uint8_t chunk = (uint8_t)((stream[_position / 8] >> (room - take)) & ((1u << take) - 1));
+        value = (value << take) | chunk;
+        _position += take;
+        bits -= take;
+    }
+    return true;
+}
+
+bool SensorBlockDecoder::readTimestamp(int64_t& deltaOfDelta) {
+    uint32_t bit;
+    if (!readBits(1, bit)) {
+        return false;
+    }
+    if (bit == 0) {
+        deltaOfDelta = 0;
+        return true;
+    }
+    for (const TimestampBucket& bucket : TIMESTAMP_BUCKETS) {
+        if (!readBits(1, bit)) {
+            return false;
+        }
+        if (bit == 0) {
+            uint32_t payload;
+            if (!readBits(bucket.payloadBits, payload)) {
+                return false;
+            }
+            deltaOfDelta = (int64_t)payload - bucket.bias;
+            return true;
+        }
+    }
+    uint32_t payload;
+    if (!readBits(32, payload)) {
+        return false;
+    }
+    deltaOfDelta = (int32_t)payload;
+    return true;
+}
+
+bool SensorBlockDecoder::readValue(uint8_t channel) {
+    uint32_t control;
+    if (!readBits(1, control)) {
+        return false;
+    }
+    if (control == 0) {
+        return true;  // Unchanged
+    }
+    if (!readBits(1, control)) {
+        return false;
+    }
+    if (control == 1) {
+        uint32_t leading;
+        uint32_t length;
+        if (!readBits(5, leading) || !readBits(5, length) || leading + length + 1 > 32) {
+            return false;
+        }
+        _leading[channel] = (uint8_t)leading;
+        _trailing[channel] = (uint8_t)(32 - leading - (length + 1));
+    }
+    uint32_t bits;
+    if (!readBits(32 - _leading[channel] - _trailing[channel], bits)) {
+        return false;
+    }
+    _lastValue[channel] ^= bits << _trailing[channel];
+    return true;
+}
@@ -5,6 +5,8 @@
 // Basic DHT22 reading without complex state management
 
 #include "sensors.h"
+#include "time_base.h"
+#include "runtime_config.h"
 #include <Arduino.h>
 
 // Global instance
@@ -23,6 +25,7 @@ void SensorManager::clearExternalHumidity() {
 SensorManager::SensorManager() {
     // dht is automatically initialized as nullptr by unique_ptr
     lastReadTime = 0;
+    warmupStart = 0;
     soilMoisture1Offset = 0.0;
     readingIndex = 0;
     bufferFull = false;
@@ -30,7 +33,7 @@ SensorManager::SensorManager() {
     lastSoilComplete = false;
     externalHumidity = -1.0f;
     // Initialize data
-    currentData = {0.0, 0.0, 0.0, 0, false};
+    currentData = {0.0, 0.0, 0.0, 0, 0, false};
     lastValidData = currentData;
     // Initialize validation tracking
     lastValidTemp = 20.0f;  // Reasonable default
@@ -57,8 +60,11 @@ bool SensorManager::begin() {
     // Initialize soil moisture pins
     pinMode(SOIL_MOISTURE_1_PIN, INPUT);
     
+    // The DHT needs time to stabilize after power-on: readings are skipped
+    // until then instead of blocking the boot pipeline
+    warmupStart = millis();
+    
     DEBUG_PRINTLN("[OK] Sensors initialized");
-    delay(DHT_INIT_STABILIZE_DELAY_MS);  // Give DHT time to stabilize
     
     return true;
 }
@@ -82,9 +88,10 @@ bool SensorManager::validateTemperature(float temp) {
     // Check for abrupt changes (possible sensor glitch)
     if (consecutiveTempErrors < SENSOR_MAX_CONSECUTIVE_ERRORS) {
         float change = abs(temp - lastValidTemp);
-        if (change > MAX_TEMP_CHANGE_PER_READ) {
+        float maxChange = runtimeConfig.values().maxTempChange;
+        if (change > maxChange) {
             LOG_WARNF("Temperature change too abrupt: %.1f°C change (max: %.1f°C)\n", 
-                      change, MAX_TEMP_CHANGE_PER_READ);
+                      change, maxChange);
             consecutiveTempErrors++;
             return false;
         }
@@ -115,9 +122,10 @@ bool SensorManager::validateHumidity(float humidity) {
     // Check for abrupt changes (possible sensor glitch)
     if (consecutiveHumidityErrors < SENSOR_MAX_CONSECUTIVE_ERRORS) {
         float change = abs(humidity - lastValidHumidity);
-        if (change > MAX_HUMIDITY_CHANGE_PER_READ) {
+        float maxChange = runtimeConfig.values().maxHumidityChange;
+        if (change > maxChange) {
             LOG_WARNF("Humidity change too abrupt: %.1f%% change (max: %.1f%%)\n", 
-                      change, MAX_HUMIDITY_CHANGE_PER_READ);
+                      change, maxChange);
             consecutiveHumidityErrors++;
             return false;
         }
@@ -129,9 +137,17 @@ bool SensorManager::validateHumidity(float humidity) {
     return true;
 }
 
+bool SensorManager::isWarmedUp() const {
+    return dht && millis() - warmupStart >= DHT_INIT_STABILIZE_DELAY_MS;
+}
+
 bool SensorManager::readSensors() {
     unsigned long now = millis();
     
+    if (!isWarmedUp()) {
+        return false;
+    }
+    
     // Rate limiting: minimum interval between reads
     if (now - lastReadTime < SENSOR_READ_MIN_INTERVAL_MS) {
         return false;
@@ -142,6 +158,7 @@ bool SensorManager::readSensors() {
     // Read DHT11
     float temp = dht->readTemperature();
     float hum = dht->readHumidity();
+    currentData.acquired_ms = TimeBase::monotonicMs();
     
     // Store last measured values (always, even if invalid)
     lastMeasuredTemp = temp;
@@ -242,7 +259,7 @@ bool SensorManager::isDataValid(const SensorData& data) {
            data.humidity >= 0 && data.humidity <= 100;
 }
 
-String SensorManager::getLastError() {
+const char* SensorManager::getLastError() {
     if (!lastDhtValid) {
         return "DHT22 reading failed";
     }
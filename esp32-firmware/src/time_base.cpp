@@ -0,0 +1,182 @@
+// Monotonic time base with epoch mapping from SNTP (drift-corrected) or the backend
+
+#include "time_base.h"
+#include "metrics.h"
+#include <esp_sntp.h>
+#include <atomic>
+#include <math.h>
+
+// Global instance
+TimeBase timeBase;
+
+static Gauge timeSourceMetric("time_source", "Epoch timestamp source: 0 none, 1 backend ping/pong, 2 SNTP");
+static Gauge timeDriftMetric("time_drift_ppb", "Estimated local clock drift against SNTP in parts per billion");
+static Gauge timeSntpStepMetric("time_sntp_step_ms", "Correction applied at the last SNTP resync in milliseconds");
+static Gauge timeServerOffsetMetric("time_server_offset_ms", "Backend clock minus SNTP time in milliseconds");
+static Gauge timeServerRttMetric("time_server_rtt_ms", "Round trip of the ping/pong probe used for the backend offset");
+static Counter timeSntpSyncsMetric("time_sntp_syncs_total", "Completed SNTP syncs");
+static Counter timeSntpRestartsMetric("time_sntp_restarts_total", "SNTP clients restarted after an overdue sync");
+
+static const float DRIFT_EWMA_ALPHA = 0.25f;  // Weight of the newest drift measurement
+
+// Written by the SNTP callback (lwIP task), taken by update() once the flag is set
+static std::atomic<bool> sntpPending(false);
+static uint64_t sntpPendingMonoMs = 0;
+static uint64_t sntpPendingEpochMs = 0;
+
+static void onSntpSync(struct timeval* tv) {
+    sntpPendingMonoMs = TimeBase::monotonicMs();
+    sntpPendingEpochMs = (uint64_t)tv->tv_sec * 1000ULL + (uint64_t)tv->tv_usec / 1000ULL;
+    sntpPending.store(true, std::memory_order_release);
+}
+
+static int32_t gaugeValue(int64_t value) {
+    if (value > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (value < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)value;
+}
+
+TimeBase::TimeBase() {
+    _started = false;
+    _sntpDeadlineMs = 0;
+    _sntpAnchored = false;
+    _anchorMonoMs = 0;
+    _anchorEpochMs = 0;
+    _driftPpm = 0.0f;
+    _driftKnown = false;
+    memset(_serverSamples, 0, sizeof(_serverSamples));
+    _serverSampleCount = 0;
+    _serverSampleNext = 0;
+    _serverOffsetMs = 0;
+}
+
+void TimeBase::begin() {
+    if (_started) {
+        return;
+    }
+    DEBUG_PRINTLN("Syncing time...");
+    sntp_set_time_sync_notification_cb(onSntpSync);
+    sntp_set_sync_interval(TIME_SNTP_RESYNC_MS);
+    configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+    _started = true;
+    _sntpDeadlineMs = monotonicMs() + TIME_SNTP_RETRY_MS;
+}
+
+void TimeBase::update() {
+    if (!_started) {
+        return;
+    }
+
+    // Clears the one-shot COMPLETED status; the sample itself comes from the callback
+    sntp_get_sync_status();
+    if (sntpPending.load(std::memory_order_acquire)) {
+        uint64_t monoMs = sntpPendingMonoMs;
+        uint64_t epochMs = sntpPendingEpochMs;
+        sntpPending.store(false, std::memory_order_relaxed);
+        applySntpSample(monoMs, epochMs);
+    }
+
+    uint64_t now = monotonicMs();
+    if (now >= _sntpDeadlineMs) {
+        // lwIP retries on its own, but a client started without a route can stay stuck
+        timeSntpRestartsMetric.inc();
+        LOG_WARNF("[TIME] SNTP sync overdue, restarting client\n");
+        sntp_restart();
+        _sntpDeadlineMs = now + TIME_SNTP_RETRY_MS;
+    }
+}
+
+uint64_t TimeBase::epochMsAt(uint64_t monotonic) const {
+    if (_sntpAnchored) {
+        return sntpEpochMsAt(monotonic);
+    }
+    if (_serverSampleCount > 0) {
+        return (uint64_t)((int64_t)monotonic + _serverOffsetMs);
+    }
+    return 0;
+}
+
+TimeSource TimeBase::source() const {
+    if (_sntpAnchored) {
+        return TIME_SOURCE_SNTP;
+    }
+    return _serverSampleCount > 0 ? TIME_SOURCE_SERVER : TIME_SOURCE_NONE;
+}
+
+void TimeBase::addServerSample(uint64_t sentMs, uint64_t serverMs, uint64_t receivedMs) {
+    if (receivedMs < sentMs || serverMs < (uint64_t)NTP_VALID_EPOCH * 1000ULL) {
+        return;
+    }
+
+    // NTP midpoint: the server stamped the pong halfway through the round trip
+    ServerSample& sample = _serverSamples[_serverSampleNext];
+    sample.rttMs = (uint32_t)(receivedMs - sentMs);
+    sample.offsetMs = (int64_t)serverMs - (int64_t)(sentMs + sample.rttMs / 2);
+    _serverSampleNext = (_serverSampleNext + 1) % TIME_SERVER_SAMPLES;
+    if (_serverSampleCount < TIME_SERVER_SAMPLES) {
+        _serverSampleCount++;
+    }
+
+    // Queueing only ever adds delay, so the fastest round trip is the most accurate
+    const ServerSample* best = &_serverSamples[0];
+    for (uint8_t i = 1; i < _serverSampleCount; i++) {
+        if (_serverSamples[i].rttMs < best->rttMs) {
+            best = &_serverSamples[i];
+        }
+    }
+    _serverOffsetMs = best->offsetMs;
+    timeServerRttMetric.set(gaugeValue(best->rttMs));
+    timeSourceMetric.set(source());
+
+    if (_sntpAnchored) {
+        int64_t serverNow = (int64_t)receivedMs + _serverOffsetMs;
+        timeServerOffsetMetric.set(gaugeValue(serverNow - (int64_t)sntpEpochMsAt(receivedMs)));
+    } else if (_serverSampleCount == 1) {
+        LOG_INFOF("[TIME] Using backend clock until SNTP syncs (RTT %u ms)\n", (unsigned)sample.rttMs);
+    }
+}
+
+void TimeBase::applySntpSample(uint64_t monoMs, uint64_t epochMs) {
+    if (epochMs < (uint64_t)NTP_VALID_EPOCH * 1000ULL) {
+        return;
+    }
+    timeSntpSyncsMetric.inc();
+    _sntpDeadlineMs = monoMs + TIME_SNTP_RESYNC_MS + TIME_SNTP_RETRY_MS;
+
+    if (_sntpAnchored) {
+        int64_t stepMs = (int64_t)epochMs - (int64_t)sntpEpochMsAt(monoMs);
+        timeSntpStepMetric.set(gaugeValue(stepMs));
+
+        uint64_t span = monoMs - _anchorMonoMs;
+        if (span >= TIME_DRIFT_MIN_SPAN_MS) {
+            int64_t error = (int64_t)(epochMs - _anchorEpochMs) - (int64_t)span;
+            float measured = (float)((double)error * 1e6 / (double)span);
+            if (fabsf(measured) <= TIME_DRIFT_MAX_PPM) {
+                _driftPpm = _driftKnown ? _driftPpm + DRIFT_EWMA_ALPHA * (measured - _driftPpm) : measured;
+                _driftKnown = true;
+                timeDriftMetric.set(gaugeValue(lroundf(_driftPpm * 1000.0f)));
+            } else {
+                LOG_WARNF("[TIME] Ignoring drift estimate of %.0f ppm (bad sync?)\n", measured);
+            }
+        }
+        DEBUG_PRINTF("[TIME] SNTP resync: step %ld ms, drift %.2f ppm\n", (long)stepMs, _driftPpm);
+    } else {
+        LOG_INFOF("[OK] Time synchronized (SNTP)\n");
+    }
+
+    _anchorMonoMs = monoMs;
+    _anchorEpochMs = epochMs;
+    _sntpAnchored = true;
+    timeSourceMetric.set(TIME_SOURCE_SNTP);
+}
+
+uint64_t TimeBase::sntpEpochMsAt(uint64_t monotonic) const {
+    // Negative for stamps taken before the last sync, which is fine
+    int64_t elapsed = (int64_t)(monotonic - _anchorMonoMs);
+    int64_t correction = llround((double)elapsed * (double)_driftPpm / 1e6);
+    return (uint64_t)((int64_t)_anchorEpochMs + elapsed + correction);
+}
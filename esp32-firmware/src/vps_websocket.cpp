@@ -1,56 +1,127 @@
 #include "vps_websocket.h"
 #include "config.h"
 #include "sensors.h"
+#include "memory_monitor.h"
+#include "log_forwarder.h"
+#include "metrics.h"
+#include "boot_timeline.h"
+#include "time_base.h"
+#include "runtime_config.h"
+#include "history_store.h"
+#include "psychrometrics.h"
 
-VPSWebSocketClient* VPSWebSocketClient::_instance = nullptr;
+// Connection metrics (exported through the metrics registry)
+static Counter wsConnections("ws_connections_total", "Successful WebSocket connections");
+static Counter wsReconnections("ws_reconnections_total", "Connections after the first one");
+static Counter wsDisconnections("ws_disconnections_total", "WebSocket disconnection events");
+static Counter wsPingTimeouts("ws_ping_timeouts_total", "Connections closed for a missing Engine.IO ping");
+static Counter wsAuthFailures("ws_auth_failures_total", "Device authentication failures");
+static Counter wsMessagesReceived("ws_messages_received_total", "Frames received from the backend");
+static Counter wsMessagesSent("ws_messages_sent_total", "Frames sent to the backend");
+static Counter wsBytesSent("ws_bytes_sent_total", "Payload bytes sent to the backend");
+static Gauge wsConnected("ws_connected", "1 while the WebSocket is connected");
+static Gauge wsLastConnection("ws_last_connection_seconds", "Uptime at the last successful connection");
+static Histogram wsFrameBytes("ws_frame_bytes", "Size of frames sent to the backend");
+static Counter relayCommandDuplicates("relay_command_duplicates_total", "Sequenced relay commands already applied (resends)");
+static Counter wsEventsDropped("ws_events_dropped_total", "Events larger than their frame buffer, not sent");
+static Counter metricsFramesDropped("metrics_frames_dropped_total", "Metrics frames larger than METRICS_JSON_CAPACITY, not sent");
+static Counter relayCommandGaps("relay_command_gaps_total", "Sequenced relay commands dropped for arriving out of order");
 
 VPSWebSocketClient::VPSWebSocketClient() {
+    setDeviceId(DEVICE_ID);
     _connected = false;
+    _authenticated = false;
     _lastReconnectAttempt = 0;
-    _lastPing = 0;
-    _lastActivity = 0;
+    _lastServerPing = 0;
+    _pingIntervalMs = WS_ENGINEIO_PING_INTERVAL_MS;
+    _pingTimeoutMs = WS_ENGINEIO_PING_TIMEOUT_MS;
+    _lastTimeProbe = 0;
+    _timeProbeDue = false;
+    _binaryPending = false;
+    _binaryId[0] = '\0';
+    _binaryOffset = 0;
     _authFailed = false;
     _authFailureCount = 0;
     _lastAuthAttempt = 0;
+    _authBackoffMs = 0;
     _consecutiveFailures = 0;
     _circuitBreakerOpen = false;
     _circuitBreakerOpenTime = 0;
+    _commandEpoch[0] = '\0';
+    _commandSeq = 0;
+    _commandAckDue = false;
+    _commandGap = false;
     _relayCommandCallback = nullptr;
     _sensorRequestCallback = nullptr;
-    _instance = this;
-    _startTime = millis();
-    
-    // Initialize metrics
-    _metrics.totalConnections = 0;
-    _metrics.authFailures = 0;
-    _metrics.reconnections = 0;
-    _metrics.messagesReceived = 0;
-    _metrics.messagesSent = 0;
-    _metrics.uptimeSeconds = 0;
-    _metrics.lastConnectionTime = 0;
-    _metrics.totalDisconnections = 0;
+}
+
+void VPSWebSocketClient::setDeviceId(const char* deviceId) {
+    strncpy(_deviceId, deviceId, sizeof(_deviceId) - 1);
+    _deviceId[sizeof(_deviceId) - 1] = '\0';
 }
 
 bool VPSWebSocketClient::begin() {
     DEBUG_PRINTLN("Initializing WebSocket connection...");
     
-    #ifdef VPS_WEBSOCKET_USE_SSL
-    _webSocket.beginSSL(VPS_WEBSOCKET_HOST, VPS_WEBSOCKET_PORT, VPS_WEBSOCKET_PATH);
-    DEBUG_PRINTF("WebSocket SSL configured: wss://%s:%d%s\n", VPS_WEBSOCKET_HOST, VPS_WEBSOCKET_PORT, VPS_WEBSOCKET_PATH);
-    #else
-    _webSocket.begin(VPS_WEBSOCKET_HOST, VPS_WEBSOCKET_PORT, VPS_WEBSOCKET_PATH);
-    DEBUG_PRINTF("WebSocket configured: ws://%s:%d%s\n", VPS_WEBSOCKET_HOST, VPS_WEBSOCKET_PORT, VPS_WEBSOCKET_PATH);
-    #endif
+    _endpoints.begin(VPS_ENDPOINTS, VPS_WEBSOCKET_HOST, VPS_WEBSOCKET_PORT);
+    connectEndpoint();
     
-    _webSocket.onEvent(webSocketEvent);
-    // Disable automatic heartbeat - we'll send manual pings based on activity
+    _webSocket.onEvent([this](WStype_t type, uint8_t * payload, size_t length) {
+        webSocketEvent(type, payload, length);
+    });
+    // No WebSocket-level pings: liveness comes from the Engine.IO heartbeat (see loop())
     _webSocket.enableHeartbeat(WS_HEARTBEAT_PING_INTERVAL_MS, WS_HEARTBEAT_PONG_TIMEOUT_MS, 0);  // 0 = disable ping, keep pong handling
-    _webSocket.setReconnectInterval(WS_RECONNECT_INTERVAL_MS);
+    _webSocket.setReconnectInterval(runtimeConfig.values().reconnectIntervalMs);
+    
+    // Track heap usage of the first connection attempt (TLS handshake)
+    memoryMonitor.beginScope(ALLOC_SCOPE_TLS_RECONNECT);
     
     return true;
 }
 
+void VPSWebSocketClient::connectEndpoint() {
+    const BackendEndpoint& endpoint = _endpoints.active();
+    #ifdef VPS_WEBSOCKET_USE_SSL
+    _webSocket.beginSSL(endpoint.host, endpoint.port, VPS_WEBSOCKET_PATH);
+    DEBUG_PRINTF("WebSocket SSL configured: wss://%s:%d%s\n", endpoint.host, endpoint.port, VPS_WEBSOCKET_PATH);
+    #else
+    _webSocket.begin(endpoint.host, endpoint.port, VPS_WEBSOCKET_PATH);
+    DEBUG_PRINTF("WebSocket configured: ws://%s:%d%s\n", endpoint.host, endpoint.port, VPS_WEBSOCKET_PATH);
+    #endif
+}
+
+bool VPSWebSocketClient::reconnect() {
+    // Drop the current endpoint (reported as a normal disconnect) and start on the selected one
+    if (_webSocket.isConnected()) {
+        _webSocket.disconnect();
+    }
+    connectEndpoint();
+    // The breaker counts failures of the endpoint we just left
+    _consecutiveFailures = 0;
+    _circuitBreakerOpen = false;
+    return true;
+}
+
+void VPSWebSocketClient::resetSocket() {
+    if (_webSocket.isConnected()) {
+        _webSocket.disconnect();  // Reports WStype_DISCONNECTED; the client reconnects as usual
+    }
+    _consecutiveFailures = 0;
+    _circuitBreakerOpen = false;
+}
+
+void VPSWebSocketClient::restartTransport() {
+    _endpoints.renew();
+    reconnect();
+}
+
 void VPSWebSocketClient::loop() {
+    // Endpoint probes keep running while the breaker is open: a healthy alternative closes it.
+    // A rejected token is not the endpoint's fault, so auth backoff counts as connected.
+    if (_endpoints.loop(_connected || _authFailed)) {
+        reconnect();
+    }
+    
     // Circuit breaker: stop trying if too many consecutive failures
     if (_circuitBreakerOpen) {
         unsigned long timeSinceOpen = millis() - _circuitBreakerOpenTime;
@@ -71,12 +142,7 @@ void VPSWebSocketClient::loop() {
     
     // Si hay fallo de autenticación, aplicar backoff exponencial con jitter
     if (_authFailed) {
-        unsigned long baseDelay = min(AUTH_BACKOFF_BASE_MS * (1 << (_authFailureCount - 1)), AUTH_BACKOFF_MAX_MS);
-        // Add ±10% random jitter to prevent thundering herd
-        int jitter = (random(-AUTH_BACKOFF_JITTER_PERCENT, AUTH_BACKOFF_JITTER_PERCENT + 1) * baseDelay) / 100;
-        unsigned long backoffDelay = baseDelay + jitter;
-        
-        if (millis() - _lastAuthAttempt < backoffDelay) {
+        if (millis() - _lastAuthAttempt < _authBackoffMs) {
             // Aún esperando el backoff
             return;
         }
@@ -87,22 +153,26 @@ void VPSWebSocketClient::loop() {
     
     _webSocket.loop();
     
-    // Intelligent heartbeat: only send ping if no activity in last 30 seconds
-    if (_connected && (millis() - _lastPing > WS_PING_IDLE_THRESHOLD_MS)) {
-        unsigned long timeSinceActivity = millis() - _lastActivity;
-        
-        // Only send ping if we haven't sent/received any message recently
-        if (timeSinceActivity >= WS_PING_IDLE_THRESHOLD_MS) {
-            _lastPing = millis();
-            StaticJsonDocument<64> doc;
-            doc["type"] = "ping";
-            doc["device_id"] = DEVICE_ID;
-            sendEvent("ping", doc);
-            DEBUG_PRINTLN("♡ Heartbeat (no recent activity)");
-        } else {
-            // Activity detected, reset ping timer
-            _lastPing = millis();
-        }
+    // One cumulative ack for every relay command handled in this iteration
+    if (_commandAckDue && _connected) {
+        sendRelayAck();
+    }
+    
+    if (_connected && logForwarder.due()) {
+        sendLogBatch();
+    }
+    
+    // Clock offset probe: right after authentication, then periodically even when busy
+    if (_authenticated && (_timeProbeDue || millis() - _lastTimeProbe >= runtimeConfig.values().timeProbeIntervalMs)) {
+        sendTimeProbe();
+    }
+    
+    // Engine.IO liveness: the server pings every pingInterval and waits pingTimeout for
+    // the pong; missing a ping for both means the link is gone even if TCP has not noticed
+    if (_connected && millis() - _lastServerPing > (unsigned long)_pingIntervalMs + _pingTimeoutMs) {
+        LOG_WARNF("No Engine.IO ping for %lu ms: closing the connection\n", millis() - _lastServerPing);
+        wsPingTimeouts.inc();
+        _webSocket.disconnect();  // Reports WStype_DISCONNECTED; the client reconnects as usual
     }
 }
 
@@ -111,50 +181,67 @@ bool VPSWebSocketClient::isConnected() {
 }
 
 void VPSWebSocketClient::webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
-    if (_instance) {
-        switch(type) {
-            case WStype_DISCONNECTED:
-                _instance->handleDisconnected();
-                break;
-                
-            case WStype_CONNECTED:
-                _instance->handleConnected();
-                break;
-                
-            case WStype_TEXT:
-                _instance->handleMessage(payload, length);
-                break;
-                
-            case WStype_ERROR:
-                DEBUG_PRINTF("WebSocket Error: %s\n", payload);
-                break;
-                
-            default:
-                break;
-        }
+    switch(type) {
+        case WStype_DISCONNECTED:
+            handleDisconnected();
+            break;
+            
+        case WStype_CONNECTED:
+            handleConnected();
+            break;
+            
+        case WStype_TEXT:
+            handleMessage(payload, length);
+            break;
+            
+        case WStype_BIN:
+            handleBinary(payload, length);
+            break;
+            
+        case WStype_ERROR:
+            DEBUG_PRINTF("WebSocket Error: %s\n", payload);
+            break;
+            
+        default:
+            break;
     }
 }
 
 void VPSWebSocketClient::handleConnected() {
     _connected = true;
-    _metrics.totalConnections++;
-    _metrics.lastConnectionTime = millis() / 1000;
-    _lastActivity = millis();  // Reset activity timer on new connection
+    memoryMonitor.endScope(ALLOC_SCOPE_TLS_RECONNECT);
+    wsConnections.inc();
+    wsConnected.set(1);
+    wsLastConnection.set(millis() / 1000);
+    bootTimeline.mark(BOOT_PHASE_WS_CONNECTED);
+    // The backend starts a fresh view for the new socket
+    metricsRegistry.forceFull();
+    // Defaults until the open packet arrives; the liveness timer starts now
+    _pingIntervalMs = WS_ENGINEIO_PING_INTERVAL_MS;
+    _pingTimeoutMs = WS_ENGINEIO_PING_TIMEOUT_MS;
+    _lastServerPing = millis();
     // Encender LED integrado al conectar WebSocket
     pinMode(STATUS_LED_PIN, OUTPUT);
     LED_WRITE_ON(STATUS_LED_PIN);
     // Reset circuit breaker on successful connection
     _consecutiveFailures = 0;
     _circuitBreakerOpen = false;
-    if (_metrics.totalConnections > 1) {
-        _metrics.reconnections++;
+    _endpoints.connected();
+    if (wsConnections.value() > 1) {
+        wsReconnections.inc();
     }
     DEBUG_PRINTLN("[OK] WebSocket connected to VPS!");
 }
 
 void VPSWebSocketClient::handleDisconnected() {
     _connected = false;
-    _metrics.totalDisconnections++;
+    _authenticated = false;
+    _binaryPending = false;
+    wsDisconnections.inc();
+    wsConnected.set(0);
+    _endpoints.disconnected();
+    // Everything allocated until the next connection is attributed to the reconnect
+    memoryMonitor.beginScope(ALLOC_SCOPE_TLS_RECONNECT);
     // Apagar LED integrado al desconectar WebSocket
     pinMode(STATUS_LED_PIN, OUTPUT);
     LED_WRITE_OFF(STATUS_LED_PIN);
@@ -164,52 +251,59 @@ void VPSWebSocketClient::handleDisconnected() {
         _circuitBreakerOpen = true;
         _circuitBreakerOpenTime = millis();
         LOG_ERRORF("Circuit breaker OPEN: %d consecutive failures. Pausing for %lu seconds\n", 
-                   _consecutiveFailures, CIRCUIT_BREAKER_TIMEOUT_MS / 1000);
+                   _consecutiveFailures, (unsigned long)(CIRCUIT_BREAKER_TIMEOUT_MS / 1000));
     }
     DEBUG_PRINTLN("✗ WebSocket disconnected from VPS");
 }
 
 void VPSWebSocketClient::handleMessage(uint8_t * payload, size_t length) {
-    // Increment received messages counter and update last activity
-    _metrics.messagesReceived++;
-    _lastActivity = millis();
+    // Increment received messages counter
+    wsMessagesReceived.inc();
     
     if (length == 0) return;
     
     char packetType = payload[0];
     
     if (packetType == '0') {
-        DEBUG_PRINTLN("[OK] Connected to server");
-        _webSocket.sendTXT("40");
-        
-        delay(WS_REGISTRATION_DELAY_MS);
-        
-        unsigned long regStart = millis();
+        handleOpen(payload, length);
+        return;
+    }
+    
+    if (length >= 2 && payload[0] == '4' && payload[1] == '0') {
+        // Namespace joined: the server accepts events from here on
         StaticJsonDocument<256> deviceInfo;
-        deviceInfo["device_id"] = DEVICE_ID;
+        deviceInfo["device_id"] = getDeviceId();
         deviceInfo["device_type"] = "esp32";
         deviceInfo["firmware_version"] = FIRMWARE_VERSION;
+        deviceInfo["config_schema"] = CONFIG_SCHEMA_VERSION;
+        deviceInfo["relay_count"] = RELAY_COUNT;
+        deviceInfo["config_revision"] = runtimeConfig.revision();
+        // Relay commands already applied: the backend resends only what is past them
+        deviceInfo["command_epoch"] = (const char*)_commandEpoch;
+        deviceInfo["command_ack"] = _commandSeq;
         deviceInfo["auth_token"] = DEVICE_AUTH_TOKEN;
         sendEvent("device:register", deviceInfo);
-        
-        while (millis() - regStart < WS_REGISTRATION_TIMEOUT_MS) {
-            delay(LOOP_ITERATION_DELAY_MS);
-        }
-        
-        DEBUG_PRINTLN("[OK] Device registered");
-        
+        DEBUG_PRINTLN("[OK] Registration sent");
         return;
     }
     
     if (packetType == '2') {
-        _webSocket.sendTXT("3");
+        // Engine.IO ping: the heartbeat that keeps both ends' liveness timers going
+        _lastServerPing = millis();
+        sendFrame("3");
+        return;
+    }
+    
+    if (length >= 2 && payload[0] == '4' && payload[1] == '5') {
+        handleBinaryEvent(payload, length);
         return;
     }
     
     if (length >= 2 && payload[0] == '4' && payload[1] == '2') {
         const char* jsonStart = (const char*)(payload + 2);
         
-        StaticJsonDocument<512> doc;
+        // ota:offer (hashes and signature) is the largest inbound event
+        StaticJsonDocument<768> doc;
         DeserializationError error = deserializeJson(doc, jsonStart);
         
         if (error) {
@@ -230,18 +324,22 @@ void VPSWebSocketClient::handleMessage(uint8_t * payload, size_t length) {
         if (strcmp(eventName, "sensor:climate") == 0 && doc.size() >= 2) {
             JsonObject data = doc[1];
             float ciudadHumidity = data["ciudad_humidity"] | -1;
-            const char* ciudad = data["ciudad"] | "";
+            float ciudadTemperature = data["ciudad_temperature"] | NAN;
             const char* apiError = data["api_error"] | "";
-            DEBUG_PRINTF("[CLIMA] Humedad ciudad (%s): %.1f%%\n", ciudad, ciudadHumidity);
+            DEBUG_PRINTF("[CLIMA] Humedad ciudad (%s): %.1f%%\n", (const char*)(data["ciudad"] | ""), ciudadHumidity);
             if (apiError && strlen(apiError) > 0) {
                 DEBUG_PRINTF("Error API meteorológica: %s\n", apiError);
             }
             extern SensorManager sensors;
             sensors.setExternalHumidity(ciudadHumidity);
+            psychrometrics.setOutdoor(ciudadTemperature, ciudadHumidity);
             return;
         }
         if (strcmp(eventName, "device:auth_success") == 0) {
             DEBUG_PRINTLN("[OK] Authentication successful");
+            _authenticated = true;
+            _timeProbeDue = true;
+            bootTimeline.mark(BOOT_PHASE_REGISTERED);
             _authFailed = false;
             _authFailureCount = 0;
             
@@ -253,17 +351,21 @@ void VPSWebSocketClient::handleMessage(uint8_t * payload, size_t length) {
         } else if (strcmp(eventName, "device:auth_failed") == 0) {
             DEBUG_PRINTLN("✗ Authentication FAILED - invalid token!");
             _connected = false;
+            _authenticated = false;
             _authFailed = true;
             _authFailureCount++;
             _lastAuthAttempt = millis();
-            _metrics.authFailures++;  // Track auth failures in metrics
+            wsAuthFailures.inc();  // Track auth failures in metrics
             
             // Calcular backoff exponencial con jitter: 30s, 60s, 120s, 240s, max 5 minutos
-            unsigned long baseDelay = min(AUTH_BACKOFF_BASE_MS * (1 << (_authFailureCount - 1)), AUTH_BACKOFF_MAX_MS);
+            const RuntimeConfigValues& config = runtimeConfig.values();
+            unsigned long baseDelay = min((unsigned long)config.authBackoffBaseMs << min(_authFailureCount - 1, 8),
+                                          (unsigned long)config.authBackoffMaxMs);
             // Add ±10% random jitter to prevent thundering herd
-            int jitter = (random(-AUTH_BACKOFF_JITTER_PERCENT, AUTH_BACKOFF_JITTER_PERCENT + 1) * baseDelay) / 100;
-            unsigned long backoffDelay = baseDelay + jitter;
-            DEBUG_PRINTF("⚠ Retry after %.1f seconds (attempt %d)\n", backoffDelay / 1000.0, _authFailureCount);
+            // (signed arithmetic: a negative draw times an unsigned delay would wrap)
+            long jitter = (random(-AUTH_BACKOFF_JITTER_PERCENT, AUTH_BACKOFF_JITTER_PERCENT + 1) * (long)baseDelay) / 100;
+            _authBackoffMs = baseDelay + jitter;
+            DEBUG_PRINTF("⚠ Retry after %.1f seconds (attempt %d)\n", _authBackoffMs / 1000.0, _authFailureCount);
             
             if (_authFailureCount >= 5) {
                 DEBUG_PRINTLN("⚠ Too many auth failures - check your token configuration!");
@@ -275,43 +377,124 @@ void VPSWebSocketClient::handleMessage(uint8_t * payload, size_t length) {
             if (!data.isNull()) {
                 handleRelayCommand(data);
             }
+        } else if (strcmp(eventName, "ota:offer") == 0 && doc.size() >= 2) {
+            JsonObject data = doc[1];
+            if (!data.isNull()) {
+                otaUpdater.handleOffer(*this, data);
+            }
         } else if (strcmp(eventName, "sensor:request") == 0) {
             handleSensorRequest();
-        } else if (strcmp(eventName, "ping") == 0) {
-            StaticJsonDocument<64> response;
-            response["type"] = "pong";
-            sendEvent("pong", response);
+        } else if (strcmp(eventName, "sensor:history") == 0) {
+            JsonObject data = doc[1];  // Null without a payload: every field has a default
+            historyStore.handleQuery(*this, data);
+        } else if (strcmp(eventName, "log:level") == 0 && doc.size() >= 2) {
+            JsonObject data = doc[1];
+            if (!data.isNull()) {
+                handleLogLevel(data);
+            }
+        } else if (strcmp(eventName, "config:set") == 0 && doc.size() >= 2) {
+            JsonObject data = doc[1];
+            if (!data.isNull()) {
+                handleConfigSet(data);
+            }
+        } else if (strcmp(eventName, "config:get") == 0) {
+            JsonObject none;
+            handleConfigSet(none);  // No keys: just report the current values
+        } else if (strcmp(eventName, "time:sync") == 0 && doc.size() >= 2) {
+            // Reply to our probe: t0 echoed back with the backend clock
+            JsonObject data = doc[1];
+            uint64_t sentMs = data["t0"] | (uint64_t)0;
+            uint64_t serverMs = data["server_time"] | (uint64_t)0;
+            if (sentMs != 0 && serverMs != 0) {
+                timeBase.addServerSample(sentMs, serverMs, TimeBase::monotonicMs());
+            }
             } else if (strcmp(eventName, "sensor:storm") == 0 && doc.size() >= 2) {
                 JsonObject data = doc[1];
                 float ciudadHumidity = data["ciudad_humidity"] | -1;
-                const char* ciudad = data["ciudad"] | "";
+                float ciudadTemperature = data["ciudad_temperature"] | NAN;
                 const char* apiError = data["api_error"] | "";
                 DEBUG_PRINTLN("[AVISO] Tormenta detectada por backend!");
-                DEBUG_PRINTF("Humedad ciudad (%s): %.1f%%\n", ciudad, ciudadHumidity);
+                DEBUG_PRINTF("Humedad ciudad (%s): %.1f%%\n", (const char*)(data["ciudad"] | ""), ciudadHumidity);
                 if (apiError && strlen(apiError) > 0) {
                     DEBUG_PRINTF("Error API meteorológica: %s\n", apiError);
                 }
                 extern SensorManager sensors;
                 sensors.setExternalHumidity(ciudadHumidity);
+                psychrometrics.setOutdoor(ciudadTemperature, ciudadHumidity);
         }
     }
 }
 
-void VPSWebSocketClient::handleRelayCommand(JsonObject& data) {
-    if (!data.containsKey("relay_id") || !data.containsKey("state")) {
-        DEBUG_PRINTLN("⚠ Missing relay_id or state in command");
+// Server-chosen heartbeat values, bounded so a bad handshake cannot disable or spin the liveness check
+static uint32_t clampPingMs(uint32_t ms) {
+    return ms < WS_ENGINEIO_MIN_PING_MS ? WS_ENGINEIO_MIN_PING_MS : (ms > WS_ENGINEIO_MAX_PING_MS ? WS_ENGINEIO_MAX_PING_MS : ms);
+}
+
+void VPSWebSocketClient::handleOpen(uint8_t * payload, size_t length) {
+    // Engine.IO open: {"sid", "upgrades", "pingInterval", "pingTimeout", "maxPayload"}
+    StaticJsonDocument<256> open;
+    if (deserializeJson(open, (const char*)(payload + 1), length - 1) == DeserializationError::Ok) {
+        uint32_t interval = open["pingInterval"] | (uint32_t)WS_ENGINEIO_PING_INTERVAL_MS;
+        uint32_t timeout = open["pingTimeout"] | (uint32_t)WS_ENGINEIO_PING_TIMEOUT_MS;
+        _pingIntervalMs = clampPingMs(interval);
+        _pingTimeoutMs = clampPingMs(timeout);
+    }
+    _lastServerPing = millis();
+    DEBUG_PRINTF("[OK] Connected to server (ping %lu ms, timeout %lu ms)\n", (unsigned long)_pingIntervalMs,
+                 (unsigned long)_pingTimeoutMs);
+    // Join the default namespace, registration follows its ack
+    sendFrame("40");
+}
+
+void VPSWebSocketClient::handleBinaryEvent(uint8_t * payload, size_t length) {
+    // 45<attachments>-[event, data]: the data's {"_placeholder":true} is sent next as a BIN frame
+    _binaryPending = false;
+    const char* dash = (const char*)memchr(payload + 2, '-', length - 2);
+    if (!dash || atoi((const char*)payload + 2) != 1) {
+        DEBUG_PRINTLN("⚠ Unsupported binary event (one attachment expected)");
         return;
     }
     
-    int relayId = data["relay_id"];
-    bool state = data["state"];
-    
-    if (relayId < 0 || relayId >= 4) {
-        DEBUG_PRINTF("⚠ Invalid relay_id: %d (valid: 0-3)\n", relayId);
-        
+    StaticJsonDocument<256> doc;
+    DeserializationError error = deserializeJson(doc, dash + 1);
+    if (error || !doc.is<JsonArray>() || doc.size() < 2) {
+        DEBUG_PRINTLN("Invalid Socket.IO binary event format");
+        return;
+    }
+    const char* eventName = doc[0];
+    if (!eventName || strcmp(eventName, "ota:chunk") != 0) {
+        return;
+    }
+    const char* id = doc[1]["id"] | "";
+    strncpy(_binaryId, id, sizeof(_binaryId) - 1);
+    _binaryId[sizeof(_binaryId) - 1] = '\0';
+    _binaryOffset = doc[1]["offset"] | (uint32_t)0;
+    _binaryPending = true;
+}
+
+void VPSWebSocketClient::handleBinary(uint8_t * payload, size_t length) {
+    wsMessagesReceived.inc();
+    if (!_binaryPending) {
+        return;  // Attachment of an event we did not parse
+    }
+    _binaryPending = false;
+    otaUpdater.handleChunk(*this, _binaryId, _binaryOffset, payload, length);
+}
+
+void VPSWebSocketClient::handleRelayCommand(JsonObject& data) {
+    bool sequenced = (data["seq"] | 0) != 0;  // Backends before lib/relayCommands.js send no seq
+    if (sequenced && !acceptCommandSeq(data)) {
+        return;
+    }
+    int relayId;
+    bool state;
+    const char* rejected = parseRelayCommand(data, relayId, state);
+    if (rejected) {
         StaticJsonDocument<128> error;
-        error["error"] = "invalid_relay_id";
-        error["relay_id"] = relayId;
+        fillRelayError(error.to<JsonObject>(), rejected, relayId);
+        if (sequenced) {
+            error["seq"] = _commandSeq;  // Consumed all the same: resending it cannot help
+        }
         sendEvent("relay:error", error);
         return;
     }
@@ -321,6 +504,119 @@ void VPSWebSocketClient::handleRelayCommand(JsonObject& data) {
     }
 }
 
+bool VPSWebSocketClient::acceptCommandSeq(JsonObject& data) {
+    uint32_t seq = data["seq"] | 0;
+    const char* epoch = data["epoch"] | "";
+    _commandAckDue = true;  // Every sequenced command is answered, applied or not
+    if (strcmp(epoch, _commandEpoch) != 0) {
+        // Backend restarted or this device did: its first command starts the sequence
+        strncpy(_commandEpoch, epoch, sizeof(_commandEpoch) - 1);
+        _commandEpoch[sizeof(_commandEpoch) - 1] = '\0';
+        _commandSeq = seq - 1;
+        _commandGap = false;
+        LOG_INFOF("[RELAY] Command epoch %s from seq %lu\n", _commandEpoch, (unsigned long)seq);
+    }
+    if (seq <= _commandSeq) {
+        relayCommandDuplicates.inc();  // Resent after a lost ack: acking again is all it needs
+        return false;
+    }
+    if (seq != _commandSeq + 1) {
+        // A command before it was lost: applying this one first could be undone by the resend
+        relayCommandGaps.inc();
+        _commandGap = true;
+        return false;
+    }
+    _commandSeq = seq;
+    return true;
+}
+
+void VPSWebSocketClient::sendRelayAck() {
+    StaticJsonDocument<128> ack;
+    ack["device_id"] = getDeviceId();
+    ack["epoch"] = (const char*)_commandEpoch;
+    ack["ack"] = _commandSeq;
+    if (_commandGap) {
+        ack["gap"] = true;
+    }
+    sendEvent("relay:ack", ack);
+    _commandAckDue = false;
+    _commandGap = false;
+}
+
+const char* VPSWebSocketClient::parseRelayCommand(JsonObject& data, int& relayId, bool& state) {
+    if (!data.containsKey("relay_id") || !data.containsKey("state")) {
+        DEBUG_PRINTLN("⚠ Missing relay_id or state in command");
+        return "missing_fields";
+    }
+    
+    relayId = data["relay_id"];
+    state = data["state"];
+    
+    if (relayId < 0 || relayId >= RELAY_COUNT) {
+        DEBUG_PRINTF("⚠ Invalid relay_id: %d (valid: 0-%d)\n", relayId, RELAY_COUNT - 1);
+        return "invalid_relay_id";
+    }
+    return nullptr;
+}
+
+void VPSWebSocketClient::fillRelayError(JsonObject error, const char* code, int relayId) {
+    error["error"] = code;
+    if (strcmp(code, "invalid_relay_id") == 0) {
+        error["relay_id"] = relayId;
+    }
+}
+
+void VPSWebSocketClient::handleLogLevel(JsonObject& data) {
+    int serialLevel = data.containsKey("level") ? LogForwarder::parseLevel(data["level"]) : -1;
+    int remoteLevel = data.containsKey("remote") ? LogForwarder::parseLevel(data["remote"]) : -1;
+    
+    if (serialLevel < 0 && remoteLevel < 0) {
+        DEBUG_PRINTLN("⚠ log:level without a valid level or remote field");
+        return;
+    }
+    logForwarder.setLevels(serialLevel, remoteLevel);
+    
+    // Echo the effective levels so the dashboard can confirm the change
+    StaticJsonDocument<128> response;
+    response["device_id"] = getDeviceId();
+    response["level"] = LogForwarder::levelName(deferredLog.getSerialLevel());
+    response["remote"] = LogForwarder::levelName(logForwarder.getLevel());
+    sendEvent("log:level", response);
+}
+
+void VPSWebSocketClient::handleConfigSet(JsonObject& data) {
+    StaticJsonDocument<1024> response;
+    JsonArray rejected = response.createNestedArray("rejected");
+    int rejectedCount = 0;
+    int changed = runtimeConfig.apply(data, rejected, rejectedCount);
+    if (changed > 0) {
+        // Everything else reads runtimeConfig at the point of use
+        _webSocket.setReconnectInterval(runtimeConfig.values().reconnectIntervalMs);
+    }
+    if (rejectedCount > 0) {
+        LOG_WARNF("[CONFIG] %d key(s) rejected\n", rejectedCount);
+        response["rejected_count"] = rejectedCount;
+    } else {
+        response.remove("rejected");
+    }
+    sendConfigState(response);
+}
+
+void VPSWebSocketClient::sendConfigState(JsonDocument& response) {
+    if (!_connected) {
+        return;
+    }
+    response["device_id"] = getDeviceId();
+    JsonObject state = response.as<JsonObject>();
+    runtimeConfig.toJson(state);
+    
+    memoryMonitor.beginScope(ALLOC_SCOPE_JSON_SEND);
+    // Static: every value plus the rejected keys is more than sendEvent()'s stack buffer holds
+    static char payload[CONFIG_STATE_FRAME_CAPACITY];
+    sendEventFrame("config:state", response, payload, sizeof(payload));
+    memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
+}
+
 void VPSWebSocketClient::handleSensorRequest() {
     DEBUG_PRINTLN("Sensor data request received");
     
@@ -329,20 +625,17 @@ void VPSWebSocketClient::handleSensorRequest() {
     }
 }
 
-bool VPSWebSocketClient::sendSensorData(float temperature, float humidity, float soilMoisture, int tempErrors, int humidityErrors) {
+bool VPSWebSocketClient::sendSensorData(float temperature, float humidity, float soilMoisture, int tempErrors, int humidityErrors,
+                                        uint64_t acquiredMs) {
     if (!_connected) {
         DEBUG_PRINTLN("Cannot send sensor data: not connected");
         return false;
     }
     
-    StaticJsonDocument<256> data;
-    data["device_id"] = DEVICE_ID;
-    data["temperature"] = temperature;
-    data["humidity"] = humidity;
-    data["temp_errors"] = tempErrors;
-    data["humidity_errors"] = humidityErrors;
-    data["soil_moisture"] = soilMoisture;
-    data["timestamp"] = millis();
+    memoryMonitor.beginScope(ALLOC_SCOPE_JSON_SEND);
+    
+    StaticJsonDocument<384> data;
+    fillSensorData(data.to<JsonObject>(), temperature, humidity, soilMoisture, tempErrors, humidityErrors, acquiredMs);
     char payload[512];
     size_t len = 0;
     len += snprintf(payload + len, sizeof(payload) - len, "42[\"sensor:data\",");
@@ -350,6 +643,7 @@ bool VPSWebSocketClient::sendSensorData(float temperature, float humidity, float
     size_t remaining = sizeof(payload) - len - 2;
     if (json_size > remaining) {
         DEBUG_PRINTLN("ERROR: JSON payload too large for buffer!");
+        memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
         return false;
     }
     len += serializeJson(data, payload + len, remaining);
@@ -360,7 +654,8 @@ bool VPSWebSocketClient::sendSensorData(float temperature, float humidity, float
         payload[len] = '\0';
     }
     
-    _webSocket.sendTXT(payload);
+    sendFrame(payload, len);
+    memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
     
     return true;
 }
@@ -371,13 +666,10 @@ bool VPSWebSocketClient::sendRelayState(int relayId, bool state, const char* mod
         return false;
     }
     
+    memoryMonitor.beginScope(ALLOC_SCOPE_JSON_SEND);
+    
     StaticJsonDocument<256> data;
-    data["device_id"] = DEVICE_ID;
-    data["relay_id"] = relayId;
-    data["state"] = state;
-    data["mode"] = mode;
-    data["changed_by"] = changedBy;
-    data["timestamp"] = millis();
+    fillRelayState(data.to<JsonObject>(), relayId, state, mode, changedBy);
     
     // Use static buffer to avoid String object allocation
     char payload[512];  // Increased buffer size for safety
@@ -392,6 +684,7 @@ bool VPSWebSocketClient::sendRelayState(int relayId, bool state, const char* mod
     
     if (json_size > remaining) {
         DEBUG_PRINTLN("ERROR: Relay state JSON too large for buffer!");
+        memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
         return false;
     }
     
@@ -403,36 +696,128 @@ bool VPSWebSocketClient::sendRelayState(int relayId, bool state, const char* mod
         payload[len] = '\0';
     }
     
-    _webSocket.sendTXT(payload);
+    sendFrame(payload, len);
+    memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
     DEBUG_PRINTF("[OK] Relay %d: %s\n", relayId, state ? "ON" : "OFF");
     
     return true;
 }
 
-bool VPSWebSocketClient::sendLog(const char* level, const char* message) {
+bool VPSWebSocketClient::sendAnomaly(const AnomalyEvent& event) {
     if (!_connected) {
+        DEBUG_PRINTLN("Cannot send anomaly: not connected");
         return false;
     }
     
     StaticJsonDocument<256> data;
-    data["device_id"] = DEVICE_ID;
-    data["level"] = level;
-    data["message"] = message;
-    data["timestamp"] = millis();
+    data["device_id"] = getDeviceId();
+    data["channel"] = AnomalyDetector::channelName(event.channel);
+    data["kind"] = AnomalyDetector::kindName(event.kind);
+    data["value"] = event.value;
+    data["baseline"] = event.baseline;
+    data["sigma"] = event.sigma;
+    data["score"] = event.score;
+    uint64_t epochMs = timeBase.epochMsAt(event.acquiredMs);
+    if (epochMs != 0) {
+        data["timestamp"] = epochMs;
+    }
+    return sendEvent("sensor:anomaly", data);
+}
+
+bool VPSWebSocketClient::sendSensorBlock(const SensorBlockEncoder& block) {
+    if (!_connected || block.count() == 0) {
+        return false;
+    }
+    uint64_t firstEpochMs = timeBase.epochMsAt(block.firstMs());
+    if (firstEpochMs == 0) {
+        return false;
+    }
     
-    // Use static buffer to avoid String object allocation
-    char payload[512];  // Increased buffer size for safety
+    StaticJsonDocument<JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(2)> data;
+    data["device_id"] = getDeviceId();
+    data["count"] = block.count();
+    // Block timestamps are monotonic; both ends pinned to the epoch clock place every reading
+    data["first_timestamp"] = firstEpochMs;
+    data["last_timestamp"] = timeBase.epochMsAt(block.lastMs());
+    return emitBinary("sensor:block", data, "block", block.data(), block.size());
+}
+
+void VPSWebSocketClient::fillSensorData(JsonObject data, float temperature, float humidity, float soilMoisture,
+                                        int tempErrors, int humidityErrors, uint64_t acquiredMs) {
+    data["device_id"] = getDeviceId();
+    data["temperature"] = temperature;
+    data["humidity"] = humidity;
+    data["temp_errors"] = tempErrors;
+    data["humidity_errors"] = humidityErrors;
+    data["soil_moisture"] = soilMoisture;
+    // Derived on the device so rules can use them (psychrometrics.h); rounded, the sensor is coarser
+    ClimateMetrics metrics;
+    if (psychrometrics.compute(temperature, humidity, metrics)) {
+        data["vpd"] = roundf(metrics.vpd * 1000.0f) / 1000.0f;
+        data["dew_point"] = roundf(metrics.dewPoint * 100.0f) / 100.0f;
+        data["absolute_humidity"] = roundf(metrics.absoluteHumidity * 100.0f) / 100.0f;
+        if (metrics.outdoor) {
+            data["outdoor_dew_point"] = roundf(metrics.outdoorDewPoint * 100.0f) / 100.0f;
+            data["absolute_humidity_delta"] = roundf(metrics.absoluteHumidityDelta * 100.0f) / 100.0f;
+        }
+    }
+    // Acquisition time in epoch ms; omitted until a time source exists (backend uses arrival time)
+    uint64_t epochMs = timeBase.epochMsAt(acquiredMs ? acquiredMs : TimeBase::monotonicMs());
+    if (epochMs != 0) {
+        data["timestamp"] = epochMs;
+    }
+}
+
+void VPSWebSocketClient::fillRelayState(JsonObject data, int relayId, bool state, const char* mode, const char* changedBy) {
+    data["device_id"] = getDeviceId();
+    data["relay_id"] = relayId;
+    data["state"] = state;
+    data["mode"] = mode;
+    data["changed_by"] = changedBy;
+    uint64_t epochMs = timeBase.epochMs();
+    if (epochMs != 0) {
+        data["timestamp"] = epochMs;
+    }
+}
+
+bool VPSWebSocketClient::sendLog(const char* level, const char* message) {
+    int parsed = LogForwarder::parseLevel(level);
+    logForwarder.enqueue(parsed > 0 ? (uint8_t)parsed : LOG_LEVEL_INFO, message);
+    return true;
+}
+
+bool VPSWebSocketClient::sendLogBatch() {
+    // Remote logs are optional work: keep them queued while the heap is under pressure
+    if (memoryMonitor.shedOptionalWork()) {
+        return false;
+    }
+    
+    memoryMonitor.beginScope(ALLOC_SCOPE_JSON_SEND);
+    
+    // Messages are referenced, not copied, from the forwarder's batch buffer
+    StaticJsonDocument<JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(LOG_FORWARD_BATCH_MAX) +
+                       LOG_FORWARD_BATCH_MAX * JSON_OBJECT_SIZE(4)> data;
+    data["device_id"] = getDeviceId();
+    JsonArray logs = data.createNestedArray("logs");
+    uint32_t dropped = logForwarder.takeBatch(logs);
+    if (dropped > 0) {
+        data["dropped"] = dropped;
+    }
+    
+    // Static buffer: only the loop task sends, and it is too large for the stack
+    static char payload[64 + LOG_FORWARD_BATCH_MAX * (LOG_FORWARD_MESSAGE_MAX * 2 + 64)];
     size_t len = 0;
     
     // Safe string building with bounds checking
-    len += snprintf(payload + len, sizeof(payload) - len, "42[\"log\",");
+    len += snprintf(payload + len, sizeof(payload) - len, "42[\"log:batch\",");
     
     // Measure JSON size before serialization
     size_t json_size = measureJson(data);
     size_t remaining = sizeof(payload) - len - 2;  // -2 for "]" and null terminator
     
     if (json_size > remaining) {
-        // Can't log error here (would cause recursion), just fail silently
+        // Can't log error here (would feed back into the batch), just fail silently
+        memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
         return false;
     }
     
@@ -444,28 +829,28 @@ bool VPSWebSocketClient::sendLog(const char* level, const char* message) {
         payload[len] = '\0';
     }
     
-    _webSocket.sendTXT(payload);
+    sendFrame(payload, len);
+    memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
     
     return true;
 }
 
-bool VPSWebSocketClient::sendMetrics(const ConnectionMetrics& metrics) {
+bool VPSWebSocketClient::sendMetrics() {
     if (!_connected) {
         return false;
     }
     
-    StaticJsonDocument<384> data;
-    data["totalConnections"] = metrics.totalConnections;
-    data["authFailures"] = metrics.authFailures;
-    data["reconnections"] = metrics.reconnections;
-    data["messagesReceived"] = metrics.messagesReceived;
-    data["messagesSent"] = metrics.messagesSent;
-    data["uptimeSeconds"] = metrics.uptimeSeconds;
-    data["lastConnectionTime"] = metrics.lastConnectionTime;
-    data["totalDisconnections"] = metrics.totalDisconnections;
+    memoryMonitor.beginScope(ALLOC_SCOPE_JSON_SEND);
     
-    // Use static buffer to avoid String object allocation
-    char payload[768];  // Larger buffer for metrics (more data)
+    // Static: only the loop task sends metrics, and a full frame is too large for the stack
+    static StaticJsonDocument<METRICS_JSON_CAPACITY> data;
+    JsonObject root = data.to<JsonObject>();
+    root["device_id"] = getDeviceId();
+    metricsRegistry.appendDelta(root);
+    memoryMonitor.appendTo(root.createNestedObject("memory"));
+    bool full = root["full"];
+    
+    static char payload[METRICS_JSON_CAPACITY];
     size_t len = 0;
     
     // Safe string building with bounds checking
@@ -475,8 +860,16 @@ bool VPSWebSocketClient::sendMetrics(const ConnectionMetrics& metrics) {
     size_t json_size = measureJson(data);
     size_t remaining = sizeof(payload) - len - 2;  // -2 for "]" and null terminator
     
-    if (json_size > remaining) {
-        DEBUG_PRINTLN("ERROR: Metrics JSON too large for buffer!");
+    if (data.overflowed() || json_size > remaining) {
+        metricsFramesDropped.inc();
+        LOG_ERRORF("Metrics frame dropped: %u bytes for %u (full: %d), raise METRICS_JSON_CAPACITY\n",
+                   (unsigned)json_size, (unsigned)remaining, (int)full);
+        // A lost delta marked its series exported: the next frame resends everything. A full
+        // frame that does not fit is not retried as one, or no frame would ever go out
+        if (!full) {
+            metricsRegistry.forceFull();
+        }
+        memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
         return false;
     }
     
@@ -488,43 +881,90 @@ bool VPSWebSocketClient::sendMetrics(const ConnectionMetrics& metrics) {
         payload[len] = '\0';
     }
     
-    _webSocket.sendTXT(payload);
+    sendFrame(payload, len);
+    memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
     
     return true;
 }
 
-void VPSWebSocketClient::sendEvent(const char* event, JsonDocument& data) {
-    if (!_connected) return;
+bool VPSWebSocketClient::sendBootReport() {
+    if (!_connected) {
+        return false;
+    }
+    
+    StaticJsonDocument<JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(BOOT_PHASE_COUNT)> data;
+    data["device_id"] = getDeviceId();
+    data["firmware_version"] = FIRMWARE_VERSION;
+    bootTimeline.appendTo(data.createNestedObject("phases"));
+    return sendEvent("device:boot", data);
+}
+
+void VPSWebSocketClient::sendTimeProbe() {
+    _lastTimeProbe = millis();
+    _timeProbeDue = false;
+    StaticJsonDocument<JSON_OBJECT_SIZE(2)> doc;
+    doc["device_id"] = getDeviceId();  // const char*: stored by reference, not copied into the document
+    doc["t0"] = TimeBase::monotonicMs();  // Echoed in the reply for the clock offset
+    sendEvent("time:sync", doc);
+}
+
+bool VPSWebSocketClient::emit(const char* event, JsonDocument& data) {
+    return sendEvent(event, data);
+}
+
+bool VPSWebSocketClient::emitBinary(const char* event, JsonDocument& data, const char* key, const uint8_t* attachment,
+                                    size_t length) {
+    if (!_connected) {
+        return false;
+    }
+    JsonObject placeholder = data.createNestedObject(key);
+    placeholder["_placeholder"] = true;
+    placeholder["num"] = 0;
+    
+    // 451-[event, data]: one attachment, sent as the next (binary) frame
+    char payload[384];
+    size_t len = snprintf(payload, sizeof(payload), "451-[\"%s\",", event);
+    len += serializeJson(data, payload + len, sizeof(payload) - len - 2);
+    if (len >= sizeof(payload) - 2) {
+        DEBUG_PRINTLN("WARNING: Binary event JSON too large, not sent");
+        return false;
+    }
+    payload[len++] = ']';
+    payload[len] = '\0';
+    if (!sendFrame(payload, len)) {
+        return false;
+    }
+    return sendBinaryFrame(attachment, length);
+}
+
+bool VPSWebSocketClient::sendEvent(const char* event, JsonDocument& data) {
+    if (!_connected) return false;
     
-    // Increment sent messages counter and update last activity
-    _metrics.messagesSent++;
-    _lastActivity = millis();
+    memoryMonitor.beginScope(ALLOC_SCOPE_JSON_SEND);
     
     // Use static buffer to avoid String object allocation
     char payload[768];  // Larger buffer for generic events
-    size_t len = 0;
-    
-    // Safe string building with bounds checking
-    len += snprintf(payload + len, sizeof(payload) - len, "42[\"%s\",", event);
-    
-    // Measure JSON size before serialization
+    bool sent = sendEventFrame(event, data, payload, sizeof(payload));
+    memoryMonitor.endScope(ALLOC_SCOPE_JSON_SEND);
+    return sent;
+}
+
+bool VPSWebSocketClient::sendEventFrame(const char* event, JsonDocument& data, char* payload, size_t capacity) {
+    int header = snprintf(payload, capacity, "42[\"%s\",", event);
     size_t json_size = measureJson(data);
-    size_t remaining = sizeof(payload) - len - 2;  // -2 for "]" and null terminator
-    
-    if (json_size > remaining) {
-        DEBUG_PRINTLN("WARNING: Event JSON too large, truncating");
-        // Truncate but still send
-    }
     
-    len += serializeJson(data, payload + len, remaining);
-    
-    // Safe append closing bracket
-    if (len < sizeof(payload) - 1) {
-        payload[len++] = ']';
-        payload[len] = '\0';
+    // A cut frame is invalid JSON the backend drops anyway: refuse it here, where it is counted.
+    // +2 for "]" and the null terminator
+    if (header < 0 || (size_t)header + json_size + 2 > capacity || data.overflowed()) {
+        wsEventsDropped.inc();
+        LOG_ERRORF("%s event dropped: %u bytes for a %u byte frame\n", event, (unsigned)json_size, (unsigned)capacity);
+        return false;
     }
     
-    _webSocket.sendTXT(payload);
+    size_t len = header + serializeJson(data, payload + header, capacity - header - 1);
+    payload[len++] = ']';
+    payload[len] = '\0';
+    return sendFrame(payload, len);
 }
 
 void VPSWebSocketClient::onRelayCommand(RelayCommandCallback callback) {
@@ -535,12 +975,24 @@ void VPSWebSocketClient::onSensorRequest(SensorRequestCallback callback) {
     _sensorRequestCallback = callback;
 }
 
-ConnectionMetrics VPSWebSocketClient::getMetrics() {
-    // Update uptime
-    _metrics.uptimeSeconds = (millis() - _startTime) / 1000;
-    return _metrics;
+bool VPSWebSocketClient::sendFrame(const char* payload, size_t length) {
+    if (length == 0) {
+        length = strlen(payload);
+    }
+    // Every outgoing frame is counted here, whichever send path produced it
+    wsMessagesSent.inc();
+    wsBytesSent.inc(length);
+    wsFrameBytes.observe(length);
+    return _webSocket.sendTXT(payload, length);
+}
+
+bool VPSWebSocketClient::sendBinaryFrame(const uint8_t* payload, size_t length) {
+    wsMessagesSent.inc();
+    wsBytesSent.inc(length);
+    wsFrameBytes.observe(length);
+    return _webSocket.sendBIN(payload, length);
 }
 
-String VPSWebSocketClient::getStatus() {
+const char* VPSWebSocketClient::getStatus() {
     return _connected ? "Connected" : "Disconnected";
 }
@@ -0,0 +1,257 @@
+// WiFi station management: cached fast join, scan fallback and in-place reconnect
+
+#include "wifi_link.h"
+#include "metrics.h"
+#include "secrets.h"
+#include <Preferences.h>
+#include <stddef.h>
+
+// Global instance
+WiFiLink wifiLink;
+
+// Survives software and watchdog resets; validated by magic and checksum after power-on
+RTC_NOINIT_ATTR static WiFiLinkCache rtcCache;
+
+static Histogram wifiAssociationMetric("wifi_association_ms", "Join start to association in milliseconds (scan included)");
+static Histogram wifiDhcpMetric("wifi_dhcp_ms", "Association to IP address in milliseconds (about 0 with a reused lease)");
+static Counter wifiConnectsMetric("wifi_connects_total", "Successful WiFi joins");
+static Counter wifiDisconnectsMetric("wifi_disconnects_total", "WiFi link losses after connecting");
+static Counter wifiScanFallbacksMetric("wifi_scan_fallbacks_total", "Cached joins that failed and fell back to a full scan");
+static Gauge wifiConnectedMetric("wifi_connected", "1 while the WiFi station has an address");
+
+static const uint32_t WIFI_CACHE_MAGIC = 0x57464331;  // "WFC1"
+static const char* const WIFI_NVS_NAMESPACE = "wifi";
+static const char* const WIFI_NVS_KEY = "link";
+
+WiFiLink::WiFiLink() : _associatedAt(0), _disconnectReason(0) {
+    _state = WIFI_LINK_IDLE;
+    memset(&_cache, 0, sizeof(_cache));
+    _cacheValid = false;
+    _attemptStart = 0;
+    _retryAt = 0;
+    _failedRounds = 0;
+}
+
+void WiFiLink::begin() {
+    DEBUG_PRINTLN("Connecting to WiFi...");
+    // Don't log SSID for security (prevents network name disclosure)
+
+    // The link is managed here: no SDK flash write on every begin(), no core auto-reconnect
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+        onEvent(event, info);
+    });
+
+    _cacheValid = loadCache();
+    if (_cacheValid) {
+        DEBUG_PRINTF("WiFi cache: channel %d, lease %s\n", (int)_cache.channel, _cache.hasLease ? "yes" : "no");
+    }
+    join(_cacheValid);
+}
+
+void WiFiLink::update() {
+    wl_status_t status = WiFi.status();
+
+    switch (_state) {
+        case WIFI_LINK_JOINING_CACHED:
+        case WIFI_LINK_JOINING_SCAN: {
+            if (status == WL_CONNECTED) {
+                handleConnected();
+                break;
+            }
+            // A disconnect event after the join started means the join failed
+            unsigned long timeout = _state == WIFI_LINK_JOINING_CACHED ? WIFI_FAST_CONNECT_TIMEOUT_MS
+                                                                       : WIFI_CONNECT_TIMEOUT_MS;
+            if (_disconnectReason != 0 || millis() - _attemptStart >= timeout) {
+                handleJoinFailed();
+            }
+            break;
+        }
+
+        case WIFI_LINK_CONNECTED:
+            if (status != WL_CONNECTED) {
+                wifiDisconnectsMetric.inc();
+                wifiConnectedMetric.set(0);
+                LOG_WARNF("WiFi link lost (reason %u), rejoining\n", (unsigned)_disconnectReason.load());
+                // Same access point first: it is by far the likeliest to come back
+                _failedRounds = 0;
+                join(_cacheValid);
+            }
+            break;
+
+        case WIFI_LINK_BACKOFF:
+            if ((long)(millis() - _retryAt) >= 0) {
+                join(_cacheValid);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void WiFiLink::reassociate() {
+    WiFi.disconnect();
+    wifiConnectedMetric.set(0);
+    _failedRounds = 0;
+    join(_cacheValid);
+}
+
+void WiFiLink::restartDriver() {
+    // Whatever state the driver is stuck in goes with it; the scan also finds a moved access point
+    WiFi.disconnect();
+    WiFi.mode(WIFI_OFF);
+    WiFi.mode(WIFI_STA);
+    wifiConnectedMetric.set(0);
+    _failedRounds = 0;
+    join(false);
+}
+
+void WiFiLink::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    // WiFi event task: record only, the loop acts on it in update()
+    if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+        _associatedAt = millis();
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        uint8_t reason = info.wifi_sta_disconnected.reason;
+        if (reason == WIFI_REASON_ASSOC_LEAVE) {
+            return;  // Our own WiFi.disconnect(), possibly delivered after the next join started
+        }
+        _disconnectReason = reason ? reason : 1;
+    }
+}
+
+void WiFiLink::join(bool useCache) {
+    _associatedAt = 0;
+    _disconnectReason = 0;
+    _attemptStart = millis();
+
+    #if WIFI_REUSE_LEASE
+    if (useCache && _cache.hasLease) {
+        WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet), IPAddress(_cache.dns));
+    } else {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());  // All zeros: DHCP
+    }
+    #endif
+
+    if (useCache) {
+        // Targeted join: probes one channel for one BSSID, no scan
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, _cache.channel, _cache.bssid);
+        _state = WIFI_LINK_JOINING_CACHED;
+    } else {
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+        _state = WIFI_LINK_JOINING_SCAN;
+    }
+}
+
+void WiFiLink::handleConnected() {
+    unsigned long now = millis();
+    uint32_t associatedAt = _associatedAt;
+    if (associatedAt == 0) {
+        associatedAt = now;  // Event not seen yet: count it all as association
+    }
+    uint32_t associationMs = associatedAt - _attemptStart;
+    uint32_t dhcpMs = now - associatedAt;
+    wifiAssociationMetric.observe(associationMs);
+    wifiDhcpMetric.observe(dhcpMs);
+    wifiConnectsMetric.inc();
+    wifiConnectedMetric.set(1);
+
+    LOG_INFOF("[OK] WiFi connected (%s join: association %u ms, DHCP %u ms)\n",
+              _state == WIFI_LINK_JOINING_CACHED ? "cached" : "scan", (unsigned)associationMs, (unsigned)dhcpMs);
+    DEBUG_PRINTF("IP address: %s\n", WiFi.localIP().toString().c_str());
+    DEBUG_PRINTF("Signal strength: %d dBm\n", (int)WiFi.RSSI());
+
+    _state = WIFI_LINK_CONNECTED;
+    _failedRounds = 0;
+    _disconnectReason = 0;
+    storeCache();
+}
+
+void WiFiLink::handleJoinFailed() {
+    uint8_t reason = _disconnectReason;  // Before disconnect() posts a reason of its own
+    (void)reason;  // Only the log lines read it; they compile out below LOG_LEVEL 2
+    WiFi.disconnect();
+
+    if (_state == WIFI_LINK_JOINING_CACHED) {
+        // The access point may have changed channel or been replaced
+        wifiScanFallbacksMetric.inc();
+        LOG_WARNF("Cached WiFi join failed (reason %u), scanning\n", (unsigned)reason);
+        join(false);
+        return;
+    }
+
+    // Not found even with a scan: the AP is most likely down, so the cache is kept
+    unsigned long retryDelay = min((unsigned long)WIFI_RETRY_BASE_MS << min((int)_failedRounds, 4),
+                                   (unsigned long)WIFI_RETRY_MAX_MS);
+    if (_failedRounds < 255) {
+        _failedRounds++;
+    }
+    _retryAt = millis() + retryDelay;
+    _state = WIFI_LINK_BACKOFF;
+    LOG_WARNF("WiFi join failed (reason %u), retrying in %u s\n", (unsigned)reason, (unsigned)(retryDelay / 1000));
+}
+
+bool WiFiLink::loadCache() {
+    if (rtcCache.magic == WIFI_CACHE_MAGIC && rtcCache.checksum == checksum(rtcCache)) {
+        _cache = rtcCache;
+        return true;
+    }
+
+    // Power-on or brownout: RTC memory is garbage, fall back to NVS
+    Preferences prefs;
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    WiFiLinkCache stored;
+    size_t length = prefs.getBytes(WIFI_NVS_KEY, &stored, sizeof(stored));
+    prefs.end();
+    if (length != sizeof(stored) || stored.magic != WIFI_CACHE_MAGIC || stored.checksum != checksum(stored)) {
+        return false;
+    }
+    _cache = stored;
+    rtcCache = stored;
+    return true;
+}
+
+void WiFiLink::storeCache() {
+    WiFiLinkCache fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.magic = WIFI_CACHE_MAGIC;
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) {
+        return;
+    }
+    memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+    fresh.channel = (uint8_t)WiFi.channel();
+    fresh.hasLease = 1;
+    fresh.ip = (uint32_t)WiFi.localIP();
+    fresh.gateway = (uint32_t)WiFi.gatewayIP();
+    fresh.subnet = (uint32_t)WiFi.subnetMask();
+    fresh.dns = (uint32_t)WiFi.dnsIP();
+    fresh.checksum = checksum(fresh);
+
+    rtcCache = fresh;
+    if (_cacheValid && fresh.checksum == _cache.checksum && memcmp(&fresh, &_cache, sizeof(fresh)) == 0) {
+        return;  // Unchanged: spare the flash
+    }
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_NVS_NAMESPACE, false)) {
+        prefs.putBytes(WIFI_NVS_KEY, &fresh, sizeof(fresh));
+        prefs.end();
+        DEBUG_PRINTF("WiFi cache updated (channel %d)\n", (int)fresh.channel);
+    }
+    _cache = fresh;
+    _cacheValid = true;
+}
+
+uint32_t WiFiLink::checksum(const WiFiLinkCache& cache) {
+    const uint8_t* bytes = (const uint8_t*)&cache;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(WiFiLinkCache, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
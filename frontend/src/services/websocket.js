@@ -82,6 +82,11 @@ class WebSocketService {
       this.emit('sensor:new', data);
     });
 
+    this.socket.on('sensor:anomaly', (data) => {
+      // Device-side anomaly detection
+      this.emit('sensor:anomaly', data);
+    });
+
     this.socket.on('relay:changed', (data) => {
       // Silent relay change
       this.emit('relay:changed', data);
@@ -175,7 +180,7 @@ class WebSocketService {
 
   /**
    * Send relay command to ESP32 via server
-   * @param {number} relayId - Relay ID (0-3)
+   * @param {number} relayId - Relay ID (0-3 on-board, 4+ expander channels)
    * @param {boolean} state - Relay state (on/off)
    * @param {string} mode - Control mode ('manual', 'auto', 'rule')
    * @param {string} changedBy - Who initiated the change